@@ -0,0 +1,35 @@
+//
+// Created by Nevermore on 2025/7/4.
+// slark BenchUtil
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string_view>
+
+namespace slark::bench {
+
+///run func iterations times and print the average cost
+template <typename Func>
+double measure(std::string_view name, uint32_t iterations, Func&& func) {
+    func(); //warm up
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        func();
+    }
+    auto cost = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    auto average = cost / iterations;
+    std::println("{:<40} {:>12.2f} us/op", name, average);
+    return average;
+}
+
+///keep the compiler from dropping the result
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} //end of namespace slark::bench
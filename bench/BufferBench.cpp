@@ -0,0 +1,124 @@
+//
+// Created by Nevermore on 2025/7/4.
+// slark BufferBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <print>
+#include <vector>
+#include "BenchUtil.h"
+#include "Buffer.hpp"
+#include "Util.hpp"
+
+using namespace slark;
+using namespace slark::bench;
+
+namespace {
+
+constexpr uint64_t kBlockSize = 64 * 1024;
+constexpr uint64_t kTotalSize = 4 * 1024 * 1024;
+constexpr uint64_t kSampleSize = 3000;
+constexpr uint64_t kPacketSize = 188;
+
+///single block buffer, the implementation before Buffer kept chunks
+class LinearBuffer {
+public:
+    void append(DataPtr ptr) noexcept {
+        if (data_) {
+            data_->append(std::move(ptr));
+        } else {
+            data_ = std::move(ptr);
+        }
+    }
+
+    [[nodiscard]] bool require(uint64_t size) const noexcept {
+        return data_ && data_->length >= readPos_ + size;
+    }
+
+    bool read4ByteBE(uint32_t& value) noexcept {
+        if (!require(4)) {
+            return false;
+        }
+        auto view = data_->view().substr(static_cast<size_t>(readPos_));
+        readPos_ += 4;
+        return Util::read4ByteBE(view, value);
+    }
+
+    DataPtr readData(uint64_t size) noexcept {
+        auto ptr = data_->copy(readPos_, static_cast<int64_t>(size));
+        readPos_ += size;
+        return ptr;
+    }
+
+    DataView shotView(uint64_t size) const noexcept {
+        return data_->view().substr(static_cast<size_t>(readPos_), static_cast<size_t>(size));
+    }
+
+    void skip(int64_t size) noexcept {
+        readPos_ += static_cast<uint64_t>(size);
+    }
+
+    void shrink() noexcept {
+        if (readPos_ == 0) {
+            return;
+        }
+        data_ = data_->copy(readPos_);
+        readPos_ = 0;
+    }
+private:
+    DataPtr data_;
+    uint64_t readPos_ = 0;
+};
+
+DataPtr makeBlock() {
+    return std::make_unique<Data>(kBlockSize, [](uint8_t* data) {
+        std::fill_n(data, kBlockSize, 0x47);
+        return kBlockSize;
+    });
+}
+
+///append a 4MB box in 64KB blocks and read length prefixed samples, shrink after each block
+template <typename T>
+void readSamples() {
+    T buffer;
+    for (uint64_t appended = 0; appended < kTotalSize; appended += kBlockSize) {
+        buffer.append(makeBlock());
+        uint32_t value = 0;
+        while (buffer.require(kSampleSize + 4)) {
+            buffer.read4ByteBE(value);
+            auto sample = buffer.readData(kSampleSize);
+            doNotOptimize(sample->rawData);
+        }
+        buffer.shrink();
+    }
+}
+
+///append a 4MB ts segment in 64KB blocks and walk it packet by packet, shrink once at the end
+template <typename T>
+void readPackets() {
+    T buffer;
+    uint64_t sum = 0;
+    for (uint64_t appended = 0; appended < kTotalSize; appended += kBlockSize) {
+        buffer.append(makeBlock());
+        while (buffer.require(kPacketSize)) {
+            auto view = buffer.shotView(kPacketSize);
+            sum += static_cast<uint8_t>(view[0]);
+            buffer.skip(static_cast<int64_t>(kPacketSize));
+        }
+    }
+    buffer.shrink();
+    doNotOptimize(sum);
+}
+
+} //end of namespace
+
+int main() {
+    constexpr uint32_t kIterations = 20;
+    std::println("append {}KB blocks up to {}KB", kBlockSize / 1024, kTotalSize / 1024);
+    auto linearSample = measure("LinearBuffer read samples", kIterations, readSamples<LinearBuffer>);
+    auto chunkSample = measure("Buffer read samples", kIterations, readSamples<Buffer>);
+    auto linearPacket = measure("LinearBuffer read ts packets", kIterations, readPackets<LinearBuffer>);
+    auto chunkPacket = measure("Buffer read ts packets", kIterations, readPackets<Buffer>);
+    std::println("speed up: samples {:.2f}x, ts packets {:.2f}x",
+                 linearSample / chunkSample, linearPacket / chunkPacket);
+    return 0;
+}
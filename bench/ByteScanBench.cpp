@@ -0,0 +1,141 @@
+//
+// Created by Nevermore on 2025/7/8.
+// slark ByteScanBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <format>
+#include <print>
+#include <random>
+#include <string>
+#include "BenchUtil.h"
+#include "ByteScan.h"
+
+using namespace slark;
+using namespace slark::bench;
+
+namespace {
+
+constexpr uint64_t kStreamSize = 8 * 1024 * 1024;
+constexpr uint64_t kPacketSize = 188;
+
+///random payload without 00 00 0x, like an escaped nalu payload
+void fillPayload(std::string& str, uint64_t size, std::mt19937& gen) {
+    std::uniform_int_distribution<uint32_t> dis(0, 255);
+    for (uint64_t i = 0; i < size; i++) {
+        auto c = static_cast<uint8_t>(dis(gen));
+        if (c <= 3 && str.size() >= 2 && str[str.size() - 1] == 0 && str[str.size() - 2] == 0) {
+            str.push_back(0x03);
+        }
+        str.push_back(static_cast<char>(c));
+    }
+}
+
+///annex-b stream of 1KB to 32KB nalus
+std::string makeAnnexB() {
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<uint64_t> sizeDis(1024, 32 * 1024);
+    std::string str;
+    while (str.size() < kStreamSize) {
+        str.append(std::string_view("\x00\x00\x00\x01", 4));
+        fillPayload(str, sizeDis(gen), gen);
+    }
+    return str;
+}
+
+std::string makeTs() {
+    std::mt19937 gen(2);
+    std::uniform_int_distribution<uint32_t> dis(0, 255);
+    std::string str;
+    while (str.size() < kStreamSize) {
+        str.push_back(0x47);
+        for (uint64_t i = 1; i < kPacketSize; i++) {
+            str.push_back(static_cast<char>(dis(gen)));
+        }
+    }
+    return str;
+}
+
+///adts frames of about 400 bytes, payload without syncwords
+std::string makeAdts() {
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<uint32_t> dis(0, 254);
+    std::string str;
+    while (str.size() < kStreamSize) {
+        str.append(std::string_view("\xff\xf1\x50\x80\x32\x1f\xfc", 7));
+        for (int i = 0; i < 393; i++) {
+            str.push_back(static_cast<char>(dis(gen)));
+        }
+    }
+    return str;
+}
+
+///the byte at a time loops the scanners replaced
+uint64_t naiveStartCode(DataView view) {
+    for (uint64_t p = 0; p + 2 < view.length(); p++) {
+        if (view[p] == 0 && view[p + 1] == 0 && view[p + 2] == 1) {
+            return p;
+        }
+    }
+    return ByteScan::kNotFound;
+}
+
+uint64_t naiveSyncByte(DataView view) {
+    auto p = view.view().find(static_cast<char>(0x47));
+    return p == std::string_view::npos ? ByteScan::kNotFound : p;
+}
+
+uint64_t naiveSyncword(DataView view) {
+    for (uint64_t p = 0; p + 1 < view.length(); p++) {
+        if (view[p] == 0xff && (view[p + 1] & 0xf0) == 0xf0) {
+            return p;
+        }
+    }
+    return ByteScan::kNotFound;
+}
+
+///walk the whole stream match by match
+template <typename Func>
+void scanAll(const std::string& str, Func&& func) {
+    uint64_t count = 0;
+    for (uint64_t offset = 0; offset < str.size();) {
+        auto res = func(DataView(std::string_view(str).substr(offset)));
+        if (res == ByteScan::kNotFound) {
+            break;
+        }
+        offset += res + 1;
+        count++;
+    }
+    doNotOptimize(count);
+}
+
+template <typename Naive, typename Scan>
+void run(std::string_view name, const std::string& str, Naive&& naive, Scan&& scan) {
+    constexpr uint32_t kIterations = 20;
+    auto base = measure(std::format("{} naive", name), kIterations, [&] {
+        scanAll(str, naive);
+    });
+    for (auto level : ByteScan::supportedLevels()) {
+        auto cost = measure(std::format("{} {}", name, ByteScan::levelName(level)), kIterations, [&] {
+            scanAll(str, [&](DataView view) {
+                return scan(view, level);
+            });
+        });
+        std::println("{:<40} {:>12.2f}x", "", base / cost);
+    }
+}
+
+} //end of namespace
+
+int main() {
+    std::println("stream size {}KB, best level {}", kStreamSize / 1024, ByteScan::levelName(ByteScan::bestLevel()));
+    run("h264 start code", makeAnnexB(), naiveStartCode, [](DataView view, ScanLevel level) {
+        return ByteScan::findStartCode(view, level);
+    });
+    run("ts sync byte", makeTs(), naiveSyncByte, [](DataView view, ScanLevel level) {
+        return ByteScan::findSyncByte(view, 0x47, kPacketSize, level);
+    });
+    run("adts syncword", makeAdts(), naiveSyncword, [](DataView view, ScanLevel level) {
+        return ByteScan::findSyncword(view, level);
+    });
+    return 0;
+}
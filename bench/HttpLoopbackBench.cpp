@@ -0,0 +1,151 @@
+//
+// Created by Nevermore on 2025/7/18.
+// slark HttpLoopbackBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchUtil.h"
+#include "Request.h"
+
+using namespace slark;
+using namespace slark::http;
+using namespace slark::bench;
+
+namespace {
+
+constexpr uint64_t kMB = 1024 * 1024;
+
+///answers every connection with one response of bodySize bytes, then closes it
+class LoopbackServer {
+public:
+    explicit LoopbackServer(uint64_t bodySize)
+        : bodySize_(bodySize) {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(listenFd_, 64);
+        socklen_t length = sizeof(addr);
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread([this] {
+            while (true) {
+                auto fd = ::accept(listenFd_, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                workers_.emplace_back(&LoopbackServer::serve, this, fd);
+            }
+        });
+    }
+
+    ~LoopbackServer() {
+        ::shutdown(listenFd_, SHUT_RDWR);
+        ::close(listenFd_);
+        acceptor_.join();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    [[nodiscard]] std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_) + "/bench";
+    }
+private:
+    void serve(int fd) const {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (size <= 0) {
+                ::close(fd);
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(size));
+        }
+        auto header = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: " + std::to_string(bodySize_) + "\r\n\r\n";
+        ::send(fd, header.data(), header.size(), MSG_NOSIGNAL);
+        std::string block(256 * 1024, 'x');
+        for (uint64_t sent = 0; sent < bodySize_;) {
+            auto size = std::min<uint64_t>(block.size(), bodySize_ - sent);
+            auto res = ::send(fd, block.data(), size, MSG_NOSIGNAL);
+            if (res <= 0) {
+                break;
+            }
+            sent += static_cast<uint64_t>(res);
+        }
+        ::close(fd);
+    }
+private:
+    uint64_t bodySize_ = 0;
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::vector<std::thread> workers_;
+    std::thread acceptor_;
+};
+
+///start count downloads at once and wait for all of them, returns the received bytes
+uint64_t download(const std::string& url, uint32_t count) {
+    std::mutex mutex;
+    std::condition_variable cond;
+    uint32_t finishedCount = 0;
+    std::atomic<uint64_t> receivedSize = 0;
+    std::vector<std::unique_ptr<Request>> requests;
+    for (uint32_t i = 0; i < count; i++) {
+        RequestInfo info;
+        info.url = url;
+        info.methodType = HttpMethodType::Get;
+        ResponseHandler handler;
+        handler.onData = [&](const RequestInfo&, DataPtr data) {
+            receivedSize += data->length;
+        };
+        handler.onCompleted = [&](const RequestInfo&) {
+            {
+                std::lock_guard lock(mutex);
+                finishedCount++;
+            }
+            cond.notify_all();
+        };
+        requests.push_back(std::make_unique<Request>(std::move(info), std::move(handler)));
+    }
+    std::unique_lock lock(mutex);
+    cond.wait(lock, [&] { return finishedCount == count; });
+    lock.unlock();
+    requests.clear();
+    return receivedSize;
+}
+
+void run(uint64_t bodySize, uint32_t count) {
+    LoopbackServer server(bodySize);
+    uint64_t receivedSize = 0;
+    auto name = std::format("{} x {}MB", count, bodySize / kMB);
+    auto cost = measure(name, 3, [&] {
+        receivedSize = download(server.url(), count);
+    });
+    auto speed = static_cast<double>(receivedSize) / kMB / (cost / 1000000.0);
+    std::println("{:<40} {:>12.2f} MB/s", name, speed);
+}
+
+} //end of namespace
+
+int main() {
+    run(256 * kMB, 1);
+    run(32 * kMB, 8);
+    run(4 * kMB, 64);
+    return 0;
+}
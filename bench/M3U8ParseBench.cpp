@@ -0,0 +1,76 @@
+//
+// Created by Nevermore on 2025/7/24.
+// slark M3U8ParseBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <format>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+#include "BenchUtil.h"
+#include "HLSDemuxer.h"
+
+using namespace slark;
+using namespace slark::bench;
+
+namespace {
+
+///a vod media play list of segmentCount segments close to 6 seconds long
+std::string makePlayList(uint32_t segmentCount) {
+    std::string playList = "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:7\n#EXT-X-MEDIA-SEQUENCE:0\n";
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint32_t> durationDis(5000, 6999);
+    for (uint32_t i = 0; i < segmentCount; i++) {
+        playList += std::format("#EXTINF:{}.{:06},\nsegment_{}.ts\n", durationDis(gen) / 1000, durationDis(gen) % 1000 * 1000, i);
+    }
+    playList += "#EXT-X-ENDLIST\n";
+    return playList;
+}
+
+void run(uint32_t segmentCount) {
+    constexpr uint32_t kSeekCount = 1000;
+    auto playList = makePlayList(segmentCount);
+    std::println("segments:{} play list:{} bytes", segmentCount, playList.size());
+    measure(std::format("parse {} segments", segmentCount), 20, [&] {
+        Buffer buffer;
+        buffer.append(std::make_unique<Data>(playList));
+        M3U8Parser parser("https://slark.test/lecture");
+        doNotOptimize(parser.parse(buffer));
+    });
+
+    Buffer buffer;
+    buffer.append(std::make_unique<Data>(playList));
+    M3U8Parser parser("https://slark.test/lecture");
+    parser.parse(buffer);
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<double> timeDis(0.0, parser.totalDuration());
+    std::vector<double> times(kSeekCount);
+    for (auto& time : times) {
+        time = timeDis(gen);
+    }
+    const auto& infos = parser.TSInfos();
+    auto base = measure(std::format("linear seek x{}", kSeekCount), 20, [&] {
+        for (auto time : times) {
+            auto it = std::find_if(infos.begin(), infos.end(), [time](const auto& info) {
+                return info.startTime <= time && time <= info.endTime();
+            });
+            doNotOptimize(it);
+        }
+    });
+    auto cost = measure(std::format("indexed seek x{}", kSeekCount), 20, [&] {
+        for (auto time : times) {
+            doNotOptimize(parser.tsIndexOf(time));
+        }
+    });
+    std::println("{:<40} {:>12.2f}x", "", base / cost);
+}
+
+} //end of namespace
+
+int main() {
+    run(1000);
+    run(10000);
+    return 0;
+}
@@ -0,0 +1,187 @@
+//
+// Created by Nevermore on 2025/7/10.
+// slark Mp4SeekBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <format>
+#include <print>
+#include <random>
+#include <vector>
+#include "BenchUtil.h"
+#include "Mp4Demuxer.h"
+
+using namespace slark;
+using namespace slark::bench;
+
+namespace {
+
+constexpr uint32_t kDurationSeconds = 2 * 60 * 60;
+
+template <typename T>
+std::shared_ptr<T> makeBox(std::string_view symbol) {
+    BoxInfo info;
+    info.symbol = symbol;
+    return std::make_shared<T>(std::move(info));
+}
+
+void appendBE(std::string& str, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        str += static_cast<char>((value >> shift) & 0xff);
+    }
+}
+
+///a track with its sample tables coded like in a moov, and the plain tables for the linear walk
+struct TestTrack {
+    std::shared_ptr<TrackContext> context;
+    std::unique_ptr<Buffer> moov;
+    std::vector<uint32_t> sizes;
+    std::vector<uint64_t> chunks;
+    uint32_t samplesPerChunk = 0;
+    uint32_t sampleDelta = 0;
+};
+
+///a long track with samplesPerChunk samples in every chunk and a key frame every gop samples
+TestTrack makeTrack(
+    TrackType type,
+    uint32_t timeScale,
+    uint32_t sampleDelta,
+    uint32_t samplesPerChunk,
+    uint32_t gop,
+    uint64_t& fileOffset
+) {
+    TestTrack test;
+    test.samplesPerChunk = samplesPerChunk;
+    test.sampleDelta = sampleDelta;
+    auto track = std::make_shared<TrackContext>();
+    track->type = type;
+    track->mdhd = makeBox<BoxMdhd>("mdhd");
+    track->mdhd->timeScale = timeScale;
+    track->stsz = makeBox<BoxStsz>("stsz");
+    track->stsc = makeBox<BoxStsc>("stsc");
+    track->stco = makeBox<BoxStco>("stco");
+    track->stts = makeBox<BoxStts>("stts");
+    auto sampleCount = static_cast<uint32_t>(uint64_t(kDurationSeconds) * timeScale / sampleDelta);
+    std::mt19937 gen(sampleCount);
+    std::uniform_int_distribution<uint32_t> sizeDis(200, 20000);
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        auto size = sizeDis(gen);
+        if (i % samplesPerChunk == 0) {
+            test.chunks.push_back(fileOffset);
+        }
+        test.sizes.push_back(size);
+        fileOffset += size;
+    }
+    std::string tables;
+    track->stsz->sampleCount = sampleCount;
+    track->stsz->entryStart = tables.size();
+    for (auto size : test.sizes) {
+        appendBE(tables, size);
+    }
+    //the audio track starts past 4 GB, as co64
+    track->stco->is64Bit = true;
+    track->stco->entryCount = static_cast<uint32_t>(test.chunks.size());
+    track->stco->entryStart = tables.size();
+    for (auto chunk : test.chunks) {
+        appendBE(tables, static_cast<uint32_t>(chunk >> 32));
+        appendBE(tables, static_cast<uint32_t>(chunk));
+    }
+    track->stts->entryCount = 1;
+    track->stts->entryStart = tables.size();
+    appendBE(tables, sampleCount);
+    appendBE(tables, sampleDelta);
+    track->stsc->entrys.push_back({1, samplesPerChunk, 1});
+    if (gop > 1) {
+        track->stss = makeBox<BoxStss>("stss");
+        track->stss->entryStart = tables.size();
+        for (uint32_t i = 1; i <= sampleCount; i += gop) {
+            appendBE(tables, i);
+            track->stss->entryCount++;
+        }
+    }
+    test.moov = std::make_unique<Buffer>();
+    test.moov->append(0, std::make_unique<Data>(tables));
+    test.context = std::move(track);
+    return test;
+}
+
+///the per-sample walk TrackContext::seek did before the sample index
+uint64_t linearSeek(const TestTrack& test, uint64_t pos) {
+    const auto& sizes = test.sizes;
+    const auto& chunks = test.chunks;
+    uint64_t chunkIndex = 0;
+    uint64_t entrySampleIndex = 0;
+    uint64_t sampleOffset = 0;
+    int64_t dts = 0;
+    uint64_t index = 0;
+    while (index < sizes.size() && chunks[chunkIndex] + sampleOffset < pos) {
+        sampleOffset += sizes[index++];
+        if (++entrySampleIndex >= test.samplesPerChunk) {
+            chunkIndex = std::min<uint64_t>(chunkIndex + 1, chunks.size() - 1);
+            sampleOffset = 0;
+            entrySampleIndex = 0;
+        }
+        dts += test.sampleDelta;
+    }
+    doNotOptimize(dts);
+    return index;
+}
+
+///seek to random positions in the second half of the track data
+void run(std::string_view name, TestTrack& test) {
+    constexpr uint32_t kSeekCount = 100;
+    auto& track = *test.context;
+    auto begin = test.chunks.front();
+    auto end = test.chunks.back();
+    std::mt19937 gen(4);
+    std::uniform_int_distribution<uint64_t> posDis(begin + (end - begin) / 2, end);
+    std::vector<uint64_t> positions(kSeekCount);
+    for (auto& pos : positions) {
+        pos = posDis(gen);
+    }
+
+    std::println("{} samples:{}", name, test.sizes.size());
+    measure(std::format("{} build index", name), 5, [&] {
+        track.init(*test.moov);
+    });
+    auto memorySize = track.samples.memorySize();
+    std::println("{} index memory:{} KB, {:.2f} bytes per sample", name, memorySize / 1024,
+                 static_cast<double>(memorySize) / static_cast<double>(track.samples.size()));
+    auto base = measure(std::format("{} linear seek x{}", name, kSeekCount), 5, [&] {
+        for (auto pos : positions) {
+            doNotOptimize(linearSeek(test, pos));
+        }
+    });
+    auto cost = measure(std::format("{} indexed seek x{}", name, kSeekCount), 5, [&] {
+        for (auto pos : positions) {
+            track.seek(pos);
+            doNotOptimize(track.index);
+        }
+    });
+    std::println("{:<40} {:>12.2f}x", "", base / cost);
+    auto timeCost = measure(std::format("{} seek pos by time x{}", name, kSeekCount), 5, [&] {
+        for (uint32_t i = 0; i < kSeekCount; i++) {
+            doNotOptimize(track.getSeekPos(static_cast<double>(kDurationSeconds) * i / kSeekCount));
+        }
+    });
+    doNotOptimize(timeCost);
+    auto readCost = measure(std::format("{} read every sample", name), 5, [&] {
+        uint64_t bytes = 0;
+        for (uint64_t i = 0; i < track.samples.size(); i++) {
+            bytes += track.samples.sampleSize(i) + static_cast<uint64_t>(track.samples.dts(i));
+        }
+        doNotOptimize(bytes);
+    });
+    doNotOptimize(readCost);
+}
+
+} //end of namespace
+
+int main() {
+    uint64_t fileOffset = 0;
+    //2 hours of 30fps video with a 2s gop and 44.1kHz aac, as separate tracks in one mdat
+    auto video = makeTrack(TrackType::Video, 30000, 1000, 10, 60, fileOffset);
+    auto audio = makeTrack(TrackType::Audio, 44100, 1024, 20, 1, fileOffset);
+    run("video", video);
+    run("audio", audio);
+    return 0;
+}
@@ -0,0 +1,170 @@
+//
+// Created by Nevermore on 2025/7/26.
+// slark TSDemuxBench
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+#include "BenchUtil.h"
+#include "HLSDemuxer.h"
+
+using namespace slark;
+using namespace slark::bench;
+
+namespace {
+
+constexpr uint64_t kBlockSize = 64 * 1024;
+constexpr uint16_t kPmtPid = 0x1000;
+constexpr uint16_t kVideoPid = 0x100;
+constexpr uint16_t kAudioPid = 0x101;
+
+///Writes 188-byte packets of a program with one h264 and one aac stream.
+class TSWriter {
+public:
+    void writePSI() {
+        //pat, one program
+        writeSection(0, {0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+                         0x00, 0x01, static_cast<uint8_t>(0xe0 | (kPmtPid >> 8)), static_cast<uint8_t>(kPmtPid & 0xff),
+                         0, 0, 0, 0});
+        //pmt, h264 and aac
+        writeSection(kPmtPid, {0x02, 0xb0, 23, 0x00, 0x01, 0xc1, 0x00, 0x00,
+                               static_cast<uint8_t>(0xe0 | (kVideoPid >> 8)), static_cast<uint8_t>(kVideoPid & 0xff), 0xf0, 0x00,
+                               0x1b, static_cast<uint8_t>(0xe0 | (kVideoPid >> 8)), static_cast<uint8_t>(kVideoPid & 0xff), 0xf0, 0x00,
+                               0x0f, static_cast<uint8_t>(0xe0 | (kAudioPid >> 8)), static_cast<uint8_t>(kAudioPid & 0xff), 0xf0, 0x00,
+                               0, 0, 0, 0});
+    }
+
+    void writePES(uint16_t pid, uint8_t streamId, int64_t pts, const std::string& payload) {
+        std::string pes = {0x00, 0x00, 0x01, static_cast<char>(streamId), 0x00, 0x00,
+                           static_cast<char>(0x80), static_cast<char>(0xc0), 10};
+        appendTimestamp(pes, 0x30, pts);
+        appendTimestamp(pes, 0x10, pts);
+        pes += payload;
+        bool isStart = true;
+        size_t pos = 0;
+        while (pos < pes.size()) {
+            auto size = std::min<size_t>(184, pes.size() - pos);
+            writePacket(pid, isStart, std::string_view(pes).substr(pos, size));
+            isStart = false;
+            pos += size;
+        }
+    }
+
+    std::string& data() noexcept {
+        return data_;
+    }
+private:
+    static void appendTimestamp(std::string& str, uint8_t flag, int64_t time) {
+        str += static_cast<char>(flag | ((time >> 29) & 0x0e) | 0x01);
+        str += static_cast<char>((time >> 22) & 0xff);
+        str += static_cast<char>(((time >> 14) & 0xfe) | 0x01);
+        str += static_cast<char>((time >> 7) & 0xff);
+        str += static_cast<char>(((time << 1) & 0xfe) | 0x01);
+    }
+
+    void writeSection(uint16_t pid, std::vector<uint8_t> section) {
+        section.insert(section.begin(), 0); //pointer field
+        writePacket(pid, true, std::string_view(reinterpret_cast<const char*>(section.data()), section.size()));
+    }
+
+    void writePacket(uint16_t pid, bool isStart, std::string_view payload) {
+        std::string packet = {0x47, static_cast<char>((isStart ? 0x40 : 0x00) | (pid >> 8)), static_cast<char>(pid & 0xff)};
+        if (payload.size() < 184) {
+            //stuff the adaptation field
+            auto adaptationSize = 184 - payload.size() - 1;
+            packet += static_cast<char>(0x30);
+            packet += static_cast<char>(adaptationSize);
+            if (adaptationSize > 0) {
+                packet += static_cast<char>(0x00);
+                packet.append(adaptationSize - 1, static_cast<char>(0xff));
+            }
+        } else {
+            packet += static_cast<char>(0x10);
+        }
+        packet += payload;
+        data_ += packet;
+    }
+private:
+    std::string data_;
+};
+
+///random bytes without zeros, so no start code shows up inside a nalu
+void appendPayload(std::string& str, std::mt19937& gen, size_t size) {
+    std::uniform_int_distribution<int> byteDis(1, 255);
+    for (size_t i = 0; i < size; i++) {
+        str += static_cast<char>(byteDis(gen));
+    }
+}
+
+///ten seconds of 30 fps h264 with an idr every second and aac in between
+std::string makeStream() {
+    constexpr std::string_view kStartCode("\x00\x00\x00\x01", 4);
+    constexpr std::string_view kSps("\x67\x64\x00\x1f\xac\xd9\x40\x50\x05\xbb\x01\x10\x00\x00\x03\x00\x10\x00\x00\x03\x03\xc0\xf1\x83\x19\x60", 26);
+    constexpr std::string_view kPps("\x68\xeb\xe3\xcb\x22\xc0", 6);
+    std::mt19937 gen(19);
+    std::uniform_int_distribution<size_t> sizeDis(4000, 20000);
+    TSWriter writer;
+    writer.writePSI();
+    for (int64_t i = 0; i < 300; i++) {
+        auto pts = i * 3000;
+        std::string frame(kStartCode);
+        frame += "\x09\xf0";
+        if (i % 30 == 0) {
+            frame += kStartCode;
+            frame += kSps;
+            frame += kStartCode;
+            frame += kPps;
+            frame += kStartCode;
+            frame += "\x65\x88";
+            appendPayload(frame, gen, 60000);
+        } else {
+            frame += kStartCode;
+            frame += "\x41\xe0";
+            appendPayload(frame, gen, sizeDis(gen));
+        }
+        writer.writePES(kVideoPid, 0xe0, pts, frame);
+        if (i % 3 == 0) {
+            //two adts frames of 300 bytes, 44.1kHz stereo lc
+            std::string audio;
+            for (int j = 0; j < 2; j++) {
+                audio += std::string("\xff\xf1\x50\x80\x25\x9f\xfc", 7);
+                appendPayload(audio, gen, 293);
+            }
+            writer.writePES(kAudioPid, 0xc0, pts, audio);
+        }
+    }
+    return std::move(writer.data());
+}
+
+} //end of namespace
+
+int main() {
+    auto stream = makeStream();
+    std::println("ts stream:{} bytes", stream.size());
+    uint64_t frameCount = 0;
+    uint64_t frameBytes = 0;
+    measure("demux 10s h264/aac ts", 20, [&] {
+        std::shared_ptr<AudioInfo> audioInfo;
+        std::shared_ptr<VideoInfo> videoInfo;
+        TSDemuxer demuxer(audioInfo, videoInfo);
+        Buffer buffer;
+        frameCount = 0;
+        frameBytes = 0;
+        for (size_t pos = 0; pos < stream.size(); pos += kBlockSize) {
+            buffer.append(std::make_unique<Data>(std::string_view(stream).substr(pos, kBlockSize)));
+            DemuxerResult result;
+            demuxer.parseData(buffer, 0, result);
+            for (const auto& frames : {&result.videoFrames, &result.audioFrames}) {
+                for (const auto& frame : *frames) {
+                    frameCount++;
+                    frameBytes += frame->data->length;
+                }
+            }
+        }
+    });
+    std::println("frames:{} bytes:{}", frameCount, frameBytes);
+    return 0;
+}
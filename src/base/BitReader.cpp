@@ -0,0 +1,69 @@
+//
+// Created by Nevermore on 2025/7/9.
+// slark BitReader
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <cstring>
+#include "BitReader.h"
+
+namespace slark {
+
+namespace {
+
+uint64_t loadBE64(const uint8_t* data) noexcept {
+    uint64_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    if constexpr (std::endian::native == std::endian::little) {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+bool hasByte03(uint64_t word) noexcept {
+    constexpr uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr uint64_t kHighs = 0x8080808080808080ULL;
+    auto value = word ^ (kOnes * 0x03);
+    return ((value - kOnes) & ~value & kHighs) != 0;
+}
+
+} //end of namespace
+
+void BitReader::refill() noexcept {
+    if (cacheBits_ > 56) {
+        return;
+    }
+    if (pos_ + 8 <= size_) {
+        auto word = loadBE64(data_ + pos_);
+        //a 0x03 anywhere in the word may be an emulation prevention byte, take the byte path
+        if (!skipEmulation_ || !hasByte03(word)) {
+            auto count = (64 - cacheBits_) / 8;
+            auto bits = cacheBits_ + count * 8;
+            auto mask = bits == 64 ? ~0ULL : ~(~0ULL >> bits);
+            cache_ |= (word >> cacheBits_) & mask;
+            cacheBits_ = bits;
+            auto* last = data_ + pos_ + count - 1;
+            if (*last != 0) {
+                zeroCount_ = 0;
+            } else if (count >= 2) {
+                zeroCount_ = *(last - 1) == 0 ? 2 : 1;
+            } else {
+                zeroCount_ = std::min<uint32_t>(zeroCount_ + 1, 2);
+            }
+            pos_ += count;
+            return;
+        }
+    }
+    while (cacheBits_ <= 56 && pos_ < size_) {
+        auto byte = data_[pos_++];
+        if (skipEmulation_ && zeroCount_ >= 2 && byte == 0x03) {
+            zeroCount_ = 0;
+            continue;
+        }
+        zeroCount_ = byte == 0 ? std::min<uint32_t>(zeroCount_ + 1, 2) : 0;
+        cache_ |= static_cast<uint64_t>(byte) << (56 - cacheBits_);
+        cacheBits_ += 8;
+    }
+}
+
+} //end of namespace slark
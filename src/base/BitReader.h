@@ -0,0 +1,122 @@
+//
+// Created by Nevermore on 2025/7/9.
+// slark BitReader
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include "DataView.h"
+
+namespace slark {
+
+///MSB first bit reader over a 64-bit cache.
+///With skipEmulation the 0x03 of every 00 00 03 sequence is dropped while reading, so RBSP syntax
+///can be parsed straight from a NALU. Reading past the end returns 0 and sets the error state,
+///which stays set until the reader is destroyed.
+class BitReader {
+public:
+    explicit BitReader(DataView view, bool skipEmulation = true) noexcept
+        : data_(reinterpret_cast<const uint8_t*>(view.view().data()))
+        , size_(view.length())
+        , skipEmulation_(skipEmulation) {
+
+    }
+
+    ///n in [0, 32]
+    uint32_t readBits(uint32_t n) noexcept {
+        if (n == 0) {
+            return 0;
+        }
+        if (cacheBits_ < n) {
+            refill();
+            if (cacheBits_ < n) {
+                return fail();
+            }
+        }
+        auto value = static_cast<uint32_t>(cache_ >> (64 - n));
+        consume(n);
+        return value;
+    }
+
+    bool readBit() noexcept {
+        return readBits(1) != 0;
+    }
+
+    void skipBits(uint64_t n) noexcept {
+        while (n > 32) {
+            readBits(32);
+            n -= 32;
+        }
+        readBits(static_cast<uint32_t>(n));
+    }
+
+    ///unsigned Exp-Golomb, ue(v)
+    uint32_t readUE() noexcept {
+        if (cacheBits_ < 32) {
+            refill();
+        }
+        auto leadingZeros = static_cast<uint32_t>(std::countl_zero(cache_));
+        if (leadingZeros >= cacheBits_ || leadingZeros > 31) {
+            return fail();
+        }
+        auto length = 2 * leadingZeros + 1;
+        if (length <= cacheBits_) {
+            auto value = (cache_ >> (64 - length)) - 1;
+            consume(length);
+            return static_cast<uint32_t>(value);
+        }
+        consume(leadingZeros);
+        auto value = static_cast<uint64_t>(readBits(leadingZeros + 1)) - 1;
+        return isError() ? 0 : static_cast<uint32_t>(value);
+    }
+
+    ///signed Exp-Golomb, se(v)
+    int32_t readSE() noexcept {
+        auto code = static_cast<int64_t>(readUE());
+        return static_cast<int32_t>((code & 1) ? (code + 1) / 2 : -(code / 2));
+    }
+
+    [[nodiscard]] bool isError() const noexcept {
+        return isError_;
+    }
+
+    ///bits read so far, emulation prevention bytes are not counted
+    [[nodiscard]] uint64_t bitPos() const noexcept {
+        return bitPos_;
+    }
+
+private:
+    void consume(uint32_t n) noexcept {
+        //n is at most 63 here, a full 64-bit shift is undefined
+        cache_ <<= n;
+        cacheBits_ -= n;
+        bitPos_ += n;
+    }
+
+    uint32_t fail() noexcept {
+        isError_ = true;
+        bitPos_ += cacheBits_;
+        cache_ = 0;
+        cacheBits_ = 0;
+        return 0;
+    }
+
+    ///top up the cache to at least 57 bits while data remains
+    void refill() noexcept;
+
+private:
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t pos_ = 0;
+    uint64_t cache_ = 0;
+    uint32_t cacheBits_ = 0;
+    ///zero bytes right before pos_, up to 2
+    uint32_t zeroCount_ = 0;
+    uint64_t bitPos_ = 0;
+    bool skipEmulation_ = true;
+    bool isError_ = false;
+};
+
+} //end of namespace slark
@@ -5,6 +5,7 @@
 //  Created by Nevermore.
 //
 
+#include <algorithm>
 #include <utility>
 #include "Buffer.hpp"
 #include "Util.hpp"
@@ -18,39 +19,102 @@ Buffer::Buffer(uint64_t size)
 }
 
 bool Buffer::empty() const noexcept {
-    if (!data_) {
-        return true;
-    }
-    return data_->length <= readPos_;
+    return length_ <= readPos_;
 }
 
 uint64_t Buffer::length() const noexcept {
     if (empty()) {
         return 0;
     }
-    return data_->length - readPos_;
+    return length_ - readPos_;
 }
 
 uint64_t Buffer::totalLength() const noexcept {
     if (empty()) {
         return 0;
     }
-    return data_->length;
+    return length_;
 }
 
 bool Buffer::require(uint64_t size) const noexcept {
     return length() >= size;
 }
 
+size_t Buffer::findChunk(uint64_t pos) const noexcept {
+    if (cursor_ < chunks_.size()) {
+        if (chunks_[cursor_].start <= pos && pos < chunks_[cursor_].end()) {
+            return cursor_;
+        }
+        //sequential read moves to the next chunk
+        if (cursor_ + 1 < chunks_.size() && chunks_[cursor_ + 1].start <= pos && pos < chunks_[cursor_ + 1].end()) {
+            return ++cursor_;
+        }
+    }
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), pos, [](uint64_t value, const Chunk& chunk) {
+        return value < chunk.start;
+    });
+    cursor_ = static_cast<size_t>(std::distance(chunks_.begin(), it)) - 1;
+    return cursor_;
+}
+
+DataView Buffer::peek(uint64_t size) const noexcept {
+    if (size == 0) {
+        return {};
+    }
+    auto index = findChunk(readPos_);
+    auto inner = readPos_ - chunks_[index].start;
+    if (inner + size <= chunks_[index].length()) {
+        return chunks_[index].view().substr(static_cast<size_t>(inner), static_cast<size_t>(size));
+    }
+    window_.length = 0;
+    window_.reserve(size);
+    for (auto i = index; i < chunks_.size() && window_.length < size; i++) {
+        auto view = chunks_[i].view().substr(static_cast<size_t>(inner)).view();
+        auto copySize = std::min(static_cast<uint64_t>(view.length()), size - window_.length);
+        auto src = reinterpret_cast<const uint8_t*>(view.data());
+        std::copy(src, src + copySize, window_.rawData + window_.length);
+        window_.length += copySize;
+        inner = 0;
+    }
+    return window_.view();
+}
+
+void Buffer::linearize() const noexcept {
+    if (chunks_.size() <= 1) {
+        return;
+    }
+    auto& front = chunks_.front();
+    if (front.data.use_count() > 1) {
+        //the block is shared with slices, merge into a new one
+        auto data = Data::obtain(length_ - front.start);
+        data->append(front.view());
+        front.data = std::move(data);
+        front.begin = 0;
+    }
+    //grow geometrically, a probe buffer is viewed after every append and large sizes are not rounded up
+    auto needed = front.begin + length_ - front.start;
+    if (needed > front.data->capacity) {
+        front.data->reserve(std::max(needed, front.data->capacity * 3 / 2));
+    }
+    for (size_t i = 1; i < chunks_.size(); i++) {
+        front.data->append(chunks_[i].view());
+    }
+    chunks_.resize(1);
+    cursor_ = 0;
+}
+
 bool Buffer::append(DataPtr ptr) noexcept {
     if (!ptr) {
         return false;
     }
-    if (data_) {
-        data_->append(std::move(ptr));
-    } else {
-        data_ = std::move(ptr);
+    if (ptr->empty()) {
+        return true;
     }
+    Chunk chunk;
+    chunk.start = length_;
+    length_ += ptr->length;
+    chunk.data = std::move(ptr);
+    chunks_.push_back(std::move(chunk));
     return true;
 }
 
@@ -63,7 +127,9 @@ bool Buffer::append(uint64_t offset, DataPtr ptr) noexcept {
     }
     if (offset_ > offset) {
         LogI("reset buffer:offset {}, now offset:{}, discard:{}", offset, offset_, length());
-        data_.reset();
+        chunks_.clear();
+        cursor_ = 0;
+        length_ = 0;
         offset_ = offset;
     }
     append(std::move(ptr));
@@ -72,22 +138,27 @@ bool Buffer::append(uint64_t offset, DataPtr ptr) noexcept {
 }
 
 DataView Buffer::view() const noexcept {
-    if (data_) {
-        return data_->view();
+    linearize();
+    if (chunks_.empty()) {
+        return {};
     }
-    return {};
+    return chunks_.front().view();
 }
 
 DataView Buffer::shotView() const noexcept {
-    if (!data_) {
+    if (empty()) {
         return {};
     }
-    return data_->view().substr(static_cast<size_t>(readPos_));
+    return view().substr(static_cast<size_t>(readPos_));
+}
+
+DataView Buffer::shotView(uint64_t size) const noexcept {
+    return peek(std::min(size, length()));
 }
 
 bool Buffer::skipTo(int64_t pos) noexcept {
     auto p = pos - static_cast<int64_t>(offset_);
-    if (0 <= p && p <= static_cast<int64_t>(data_->length)) {
+    if (0 <= p && p <= static_cast<int64_t>(length_)) {
         readPos_ = static_cast<uint64_t>(p);
         return true;
     }
@@ -96,7 +167,7 @@ bool Buffer::skipTo(int64_t pos) noexcept {
 
 bool Buffer::skip(int64_t skipOffset) noexcept {
     auto pos = static_cast<int64_t>(readPos_) + skipOffset;
-    if (0 <= pos && pos <= static_cast<int64_t>(data_->length)) {
+    if (0 <= pos && pos <= static_cast<int64_t>(length_)) {
         readPos_ = static_cast<uint64_t>(pos);
         return true;
     }
@@ -107,7 +178,7 @@ bool Buffer::read8ByteBE(uint64_t& value) noexcept {
     if (!require(8)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(8);
     readPos_ += 8;
     return Util::read8ByteBE(view, value);
 }
@@ -116,7 +187,7 @@ bool Buffer::read4ByteBE(uint32_t& value) noexcept {
     if (!require(4)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(4);
     readPos_ += 4;
     return Util::read4ByteBE(view, value);
 }
@@ -125,7 +196,7 @@ bool Buffer::read3ByteBE(uint32_t& value) noexcept {
     if (!require(3)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(3);
     readPos_ += 3;
     return Util::read3ByteBE(view, value);
 }
@@ -134,7 +205,7 @@ bool Buffer::read2ByteBE(uint16_t& value) noexcept {
     if (!require(2)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(2);
     readPos_ += 2;
     return Util::read2ByteBE(view, value);
 }
@@ -143,11 +214,7 @@ bool Buffer::readBE(uint32_t size, uint32_t& value) noexcept {
     if (!require(size) || size == 0) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
-    if (view.length() < size) {
-        return false;
-    }
-    view = view.substr(0, static_cast<size_t>(size));
+    auto view = peek(size);
     readPos_ += size;
     return Util::readBE(view, size, value);
 }
@@ -156,11 +223,7 @@ bool Buffer::readLE(uint32_t size, uint32_t& value) noexcept {
     if (!require(size) || size == 0) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
-    if (view.length() < size) {
-        return false;
-    }
-    view = view.substr(0, static_cast<size_t>(size));
+    auto view = peek(size);
     readPos_ += size;
     return Util::readLE(view, size, value);
 }
@@ -169,16 +232,17 @@ bool Buffer::readByte(uint8_t& value) noexcept {
     if (empty()) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto& chunk = chunks_[findChunk(readPos_)];
+    value = chunk.data->rawData[chunk.begin + readPos_ - chunk.start];
     readPos_ += 1;
-    return Util::readByte(view, value);
+    return true;
 }
 
 bool Buffer::read8ByteLE(uint64_t& value) noexcept {
     if (!require(8)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(8);
     readPos_ += 8;
     return Util::read8ByteLE(view, value);
 }
@@ -187,7 +251,7 @@ bool Buffer::read4ByteLE(uint32_t& value) noexcept {
     if (!require(4)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(4);
     readPos_ += 4;
     return Util::read4ByteLE(view, value);
 }
@@ -196,7 +260,7 @@ bool Buffer::read3ByteLE(uint32_t& value) noexcept {
     if (!require(3)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(3);
     readPos_ += 3;
     return Util::read3ByteLE(view, value);
 }
@@ -205,7 +269,7 @@ bool Buffer::read2ByteLE(uint16_t& value) noexcept {
     if (!require(2)) {
         return false;
     }
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
+    auto view = peek(2);
     readPos_ += 2;
     return Util::read2ByteLE(view, value);
 }
@@ -214,7 +278,34 @@ DataPtr Buffer::readData(uint64_t size) noexcept {
     if (!require(size)) {
         return nullptr;
     }
-    auto ptr = data_->copy(readPos_, static_cast<int64_t>(size));
+    auto ptr = Data::obtain(size);
+    auto index = size == 0 ? chunks_.size() : findChunk(readPos_);
+    auto inner = readPos_ - (index < chunks_.size() ? chunks_[index].start : 0);
+    for (auto i = index; i < chunks_.size() && ptr->length < size; i++) {
+        auto view = chunks_[i].view().substr(static_cast<size_t>(inner)).view();
+        auto copySize = std::min(static_cast<uint64_t>(view.length()), size - ptr->length);
+        auto src = reinterpret_cast<const uint8_t*>(view.data());
+        std::copy(src, src + copySize, ptr->rawData + ptr->length);
+        ptr->length += copySize;
+        inner = 0;
+    }
+    readPos_ += size;
+    return ptr;
+}
+
+DataPtr Buffer::readSlice(uint64_t size) noexcept {
+    if (!require(size)) {
+        return nullptr;
+    }
+    if (size == 0) {
+        return std::make_unique<Data>();
+    }
+    auto& chunk = chunks_[findChunk(readPos_)];
+    auto inner = readPos_ - chunk.start;
+    if (inner + size > chunk.length()) {
+        return readData(size);
+    }
+    auto ptr = Data::makeSlice(chunk.data, chunk.begin + inner, size);
     readPos_ += size;
     return ptr;
 }
@@ -223,22 +314,37 @@ bool Buffer::readString(uint64_t size, std::string& str) noexcept {
     if (!require(size)) {
         return false;
     }
-    
-    auto view = data_->view().substr(static_cast<size_t>(readPos_), static_cast<size_t>(size));
+    auto view = peek(size);
     readPos_ += size;
     str = view.str();
     return true;
 }
 
 bool Buffer::readLine(DataView& line) noexcept {
-    auto view = data_->view().substr(static_cast<size_t>(readPos_));
-    auto pos = view.find("\n");
-    if (pos == std::string_view::npos) {
+    if (empty()) {
         return false;
     }
-    line = view.substr(0, pos);
-    readPos_ += pos + 1; //remove '\n'
-    return true;
+    auto index = findChunk(readPos_);
+    auto inner = readPos_ - chunks_[index].start;
+    uint64_t lineLength = 0;
+    for (auto i = index; i < chunks_.size(); i++) {
+        auto view = chunks_[i].view().substr(static_cast<size_t>(inner));
+        auto pos = view.find("\n");
+        inner = 0;
+        if (pos == std::string_view::npos) {
+            lineLength += view.length();
+            continue;
+        }
+        lineLength += pos;
+        if (i != index) {
+            //a view of the peek window would not outlive the next read, keep the line in a chunk
+            linearize();
+        }
+        line = peek(lineLength);
+        readPos_ += lineLength + 1; //remove '\n'
+        return true;
+    }
+    return false;
 }
 
 //If this function is called, the previous view cannot be used anymore
@@ -246,21 +352,43 @@ void Buffer::shrink() noexcept {
     if (readPos_ == 0) {
         return;
     }
-    auto p = data_->copy(readPos_);
-    data_.reset();
-    data_ = std::move(p);
+    auto consumed = std::min(readPos_, length_);
+    while (!chunks_.empty() && chunks_.front().end() <= consumed) {
+        chunks_.pop_front();
+    }
+    if (!chunks_.empty()) {
+        auto& front = chunks_.front();
+        front.begin += consumed - front.start;
+        front.start = consumed;
+    }
+    for (auto& chunk : chunks_) {
+        chunk.start -= consumed;
+    }
+    cursor_ = 0;
+    length_ -= consumed;
     offset_ += readPos_;
     readPos_ = 0;
 }
 
 DataPtr Buffer::detachData() noexcept {
-    auto data = std::move(data_);
+    linearize();
+    DataPtr data = nullptr;
+    if (!chunks_.empty()) {
+        auto& front = chunks_.front();
+        if (front.begin == 0 && front.data.use_count() == 1) {
+            data = std::make_unique<Data>(std::move(*front.data));
+        } else {
+            data = std::make_unique<Data>(front.view());
+        }
+    }
     reset();
     return data;
 }
 
 void Buffer::reset() noexcept {
-    data_.reset();
+    chunks_.clear();
+    cursor_ = 0;
+    length_ = 0;
     readPos_ = 0;
     offset_ = 0;
 }
@@ -6,6 +6,7 @@
 //
 
 #pragma once
+#include <deque>
 #include <expected>
 #include <shared_mutex>
 #include "Data.hpp"
@@ -13,6 +14,9 @@
 
 namespace slark {
 
+///Chunk chained buffer, appended data is kept as is.
+///Reads that cross a chunk boundary are linearized into a small window,
+///view() and shotView() merge the chunks on demand.
 class Buffer: public NonCopyable {
 public:
     Buffer() = default;
@@ -32,6 +36,9 @@ public:
     bool append(uint64_t offset, DataPtr) noexcept;
     
     DataView shotView() const noexcept;
+
+    ///view of at most size bytes from the read position, valid until the next call
+    DataView shotView(uint64_t size) const noexcept;
     
     DataView view() const noexcept;
     
@@ -58,9 +65,13 @@ public:
     bool readLE(uint32_t size, uint32_t& value) noexcept;
     
     DataPtr readData(uint64_t) noexcept;
+
+    ///like readData, but shares the appended block instead of copying when the range is inside one chunk
+    DataPtr readSlice(uint64_t) noexcept;
     
     bool readString(uint64_t size, std::string& str) noexcept;
     
+    ///the line stays valid until the next append or shrink
     bool readLine(DataView& line) noexcept;
     
     bool skipTo(int64_t pos) noexcept;
@@ -103,50 +114,42 @@ public:
     }
     
 private:
-    bool isUpdatedOffset = false;
-    DataPtr data_ = nullptr;
-    uint64_t readPos_ = 0;
-    uint64_t offset_ = 0;
-    uint64_t totalSize_ = 0;
-};
+    struct Chunk {
+        DataRefPtr data;
+        ///first valid byte in data
+        uint64_t begin = 0;
+        ///position of the first valid byte in the buffer
+        uint64_t start = 0;
+
+        [[nodiscard]] uint64_t length() const noexcept {
+            return data->length - begin;
+        }
 
+        [[nodiscard]] uint64_t end() const noexcept {
+            return start + length();
+        }
 
-class BitReadView{
-public:
-    explicit BitReadView(Buffer& buffer)
-        : buffer_(buffer){
+        [[nodiscard]] DataView view() const noexcept {
+            return data->view().substr(static_cast<size_t>(begin));
+        }
+    };
 
-    }
+    ///index of the chunk which contains pos, pos must be less than length_
+    size_t findChunk(uint64_t pos) const noexcept;
 
-    uint8_t readBit() {
-        uint8_t value = 0;
-        if (bitPos == 0) {
-            if (!buffer_.readByte(bitBuffer)) {
-                return false;
-            }
-            bitPos = 8;
-        }
-        value = (bitBuffer >> (bitPos - 1)) & 0x01;
-        bitPos--;
-        return value;
-    }
+    ///size bytes from the read position, caller must check require(size)
+    DataView peek(uint64_t size) const noexcept;
 
-    ///Please note that before reading, you should ensure that the readable range is not exceeded,
-    ///otherwise the problem of discarding intermediate data will occur!
-    uint32_t readBits(uint32_t n) {
-        uint32_t val = 0;
-        if (!buffer_.require(n / 8)) {
-            return false;
-        }
-        for (uint32_t i = 0; i < n; ++i) {
-            val = (val << 1) | readBit();
-        }
-        return val;
-    }
+    void linearize() const noexcept;
 private:
-    Buffer& buffer_;
-    uint8_t bitBuffer = 0;
-    int8_t bitPos = 0;
+    bool isUpdatedOffset = false;
+    mutable std::deque<Chunk> chunks_;
+    mutable size_t cursor_ = 0;
+    mutable Data window_;
+    uint64_t length_ = 0;
+    uint64_t readPos_ = 0;
+    uint64_t offset_ = 0;
+    uint64_t totalSize_ = 0;
 };
 
 }
@@ -0,0 +1,249 @@
+//
+// Created by Nevermore on 2025/7/8.
+// slark ByteScan
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <bit>
+#include "ByteScan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define SLARK_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define SLARK_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace slark {
+
+namespace {
+
+///Every scanner is built on one kernel: the first p with data[p] == first and (data[p + dist] & mask) == second.
+///dist = 0, mask = 0, second = 0 degrades into a plain byte search.
+struct PairPattern {
+    uint8_t first = 0;
+    uint64_t dist = 0;
+    uint8_t second = 0;
+    uint8_t mask = 0;
+};
+
+using PairKernel = uint64_t (*)(const uint8_t* data, uint64_t size, PairPattern pattern) noexcept;
+
+uint64_t findPairScalar(const uint8_t* data, uint64_t size, PairPattern pattern) noexcept {
+    if (size <= pattern.dist) {
+        return ByteScan::kNotFound;
+    }
+    auto end = size - pattern.dist;
+    for (uint64_t p = 0; p < end; p++) {
+        if (data[p] == pattern.first && (data[p + pattern.dist] & pattern.mask) == pattern.second) {
+            return p;
+        }
+    }
+    return ByteScan::kNotFound;
+}
+
+///scan the rest of the range after the vector loop stopped at pos
+uint64_t findPairTail(const uint8_t* data, uint64_t size, uint64_t pos, PairPattern pattern) noexcept {
+    auto res = findPairScalar(data + pos, size - pos, pattern);
+    return res == ByteScan::kNotFound ? res : pos + res;
+}
+
+#if SLARK_SCAN_X86
+uint64_t findPairSSE2(const uint8_t* data, uint64_t size, PairPattern pattern) noexcept {
+    constexpr uint64_t kWidth = 16;
+    if (size <= pattern.dist) {
+        return ByteScan::kNotFound;
+    }
+    auto end = size - pattern.dist;
+    auto first = _mm_set1_epi8(static_cast<char>(pattern.first));
+    auto second = _mm_set1_epi8(static_cast<char>(pattern.second));
+    auto mask = _mm_set1_epi8(static_cast<char>(pattern.mask));
+    uint64_t p = 0;
+    for (; p + kWidth <= end; p += kWidth) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + p));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + p + pattern.dist));
+        auto eq = _mm_and_si128(_mm_cmpeq_epi8(x, first), _mm_cmpeq_epi8(_mm_and_si128(y, mask), second));
+        auto bits = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+        if (bits != 0) {
+            return p + static_cast<uint64_t>(std::countr_zero(bits));
+        }
+    }
+    return findPairTail(data, size, p, pattern);
+}
+
+__attribute__((target("avx2")))
+uint64_t findPairAVX2(const uint8_t* data, uint64_t size, PairPattern pattern) noexcept {
+    constexpr uint64_t kWidth = 32;
+    if (size <= pattern.dist) {
+        return ByteScan::kNotFound;
+    }
+    auto end = size - pattern.dist;
+    auto first = _mm256_set1_epi8(static_cast<char>(pattern.first));
+    auto second = _mm256_set1_epi8(static_cast<char>(pattern.second));
+    auto mask = _mm256_set1_epi8(static_cast<char>(pattern.mask));
+    uint64_t p = 0;
+    for (; p + kWidth <= end; p += kWidth) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + p));
+        auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + p + pattern.dist));
+        auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(x, first),
+                                   _mm256_cmpeq_epi8(_mm256_and_si256(y, mask), second));
+        auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+        if (bits != 0) {
+            return p + static_cast<uint64_t>(std::countr_zero(bits));
+        }
+    }
+    return findPairTail(data, size, p, pattern);
+}
+#endif
+
+#if SLARK_SCAN_NEON
+uint64_t findPairNEON(const uint8_t* data, uint64_t size, PairPattern pattern) noexcept {
+    constexpr uint64_t kWidth = 16;
+    if (size <= pattern.dist) {
+        return ByteScan::kNotFound;
+    }
+    auto end = size - pattern.dist;
+    auto first = vdupq_n_u8(pattern.first);
+    auto second = vdupq_n_u8(pattern.second);
+    auto mask = vdupq_n_u8(pattern.mask);
+    uint64_t p = 0;
+    for (; p + kWidth <= end; p += kWidth) {
+        auto x = vld1q_u8(data + p);
+        auto y = vld1q_u8(data + p + pattern.dist);
+        auto eq = vandq_u8(vceqq_u8(x, first), vceqq_u8(vandq_u8(y, mask), second));
+        //narrow every byte of the mask to a nibble
+        auto bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        if (bits != 0) {
+            return p + static_cast<uint64_t>(std::countr_zero(bits)) / 4;
+        }
+    }
+    return findPairTail(data, size, p, pattern);
+}
+#endif
+
+PairKernel kernel(ScanLevel level) noexcept {
+    if (!ByteScan::isSupported(level)) {
+        return findPairScalar;
+    }
+    switch (level) {
+#if SLARK_SCAN_X86
+        case ScanLevel::SSE2:
+            return findPairSSE2;
+        case ScanLevel::AVX2:
+            return findPairAVX2;
+#endif
+#if SLARK_SCAN_NEON
+        case ScanLevel::NEON:
+            return findPairNEON;
+#endif
+        default:
+            return findPairScalar;
+    }
+}
+
+const uint8_t* bytes(DataView view) noexcept {
+    return reinterpret_cast<const uint8_t*>(view.view().data());
+}
+
+} //end of namespace
+
+bool ByteScan::isSupported(ScanLevel level) noexcept {
+    switch (level) {
+        case ScanLevel::Scalar:
+            return true;
+#if SLARK_SCAN_X86
+        case ScanLevel::SSE2:
+            return true;
+        case ScanLevel::AVX2: {
+            static const bool kHasAVX2 = __builtin_cpu_supports("avx2");
+            return kHasAVX2;
+        }
+#endif
+#if SLARK_SCAN_NEON
+        case ScanLevel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+ScanLevel ByteScan::bestLevel() noexcept {
+    static const ScanLevel kLevel = [] {
+        for (auto level : {ScanLevel::AVX2, ScanLevel::SSE2, ScanLevel::NEON}) {
+            if (isSupported(level)) {
+                return level;
+            }
+        }
+        return ScanLevel::Scalar;
+    }();
+    return kLevel;
+}
+
+std::vector<ScanLevel> ByteScan::supportedLevels() noexcept {
+    std::vector<ScanLevel> levels;
+    for (auto level : {ScanLevel::Scalar, ScanLevel::SSE2, ScanLevel::AVX2, ScanLevel::NEON}) {
+        if (isSupported(level)) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+const char* ByteScan::levelName(ScanLevel level) noexcept {
+    switch (level) {
+        case ScanLevel::SSE2:
+            return "SSE2";
+        case ScanLevel::AVX2:
+            return "AVX2";
+        case ScanLevel::NEON:
+            return "NEON";
+        default:
+            return "Scalar";
+    }
+}
+
+uint64_t ByteScan::findByte(DataView view, uint8_t value, ScanLevel level) noexcept {
+    return kernel(level)(bytes(view), view.length(), {value, 0, 0, 0});
+}
+
+uint64_t ByteScan::findStartCode(DataView view, ScanLevel level) noexcept {
+    auto func = kernel(level);
+    auto* data = bytes(view);
+    auto size = view.length();
+    uint64_t pos = 0;
+    //match 00 ?? 01, then check the middle byte
+    while (pos < size) {
+        auto res = func(data + pos, size - pos, {0x00, 2, 0x01, 0xff});
+        if (res == kNotFound) {
+            return kNotFound;
+        }
+        pos += res;
+        if (data[pos + 1] == 0x00) {
+            return pos;
+        }
+        pos++;
+    }
+    return kNotFound;
+}
+
+uint64_t ByteScan::findSyncByte(DataView view, uint8_t sync, uint64_t stride, ScanLevel level) noexcept {
+    auto func = kernel(level);
+    auto* data = bytes(view);
+    auto size = view.length();
+    auto res = func(data, size, {sync, stride, sync, 0xff});
+    if (res != kNotFound) {
+        return res;
+    }
+    auto tail = size > stride ? size - stride : 0;
+    res = func(data + tail, size - tail, {sync, 0, 0, 0});
+    return res == kNotFound ? res : tail + res;
+}
+
+uint64_t ByteScan::findSyncword(DataView view, ScanLevel level) noexcept {
+    return kernel(level)(bytes(view), view.length(), {0xff, 1, 0xf0, 0xf0});
+}
+
+} //end of namespace slark
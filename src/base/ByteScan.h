@@ -0,0 +1,52 @@
+//
+// Created by Nevermore on 2025/7/8.
+// slark ByteScan
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "DataView.h"
+
+namespace slark {
+
+enum class ScanLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+///Vectorized byte pattern scanners for bitstream parsing.
+///The best level supported by the cpu is chosen once at runtime, every function also takes an explicit level
+///for tests and benchmarks, an unsupported level falls back to scalar.
+class ByteScan {
+public:
+    static constexpr uint64_t kNotFound = std::numeric_limits<uint64_t>::max();
+
+    [[nodiscard]] static ScanLevel bestLevel() noexcept;
+
+    [[nodiscard]] static bool isSupported(ScanLevel level) noexcept;
+
+    ///scalar first
+    [[nodiscard]] static std::vector<ScanLevel> supportedLevels() noexcept;
+
+    [[nodiscard]] static const char* levelName(ScanLevel level) noexcept;
+
+    [[nodiscard]] static uint64_t findByte(DataView view, uint8_t value, ScanLevel level = bestLevel()) noexcept;
+
+    ///position of the first 00 00 01
+    [[nodiscard]] static uint64_t findStartCode(DataView view, ScanLevel level = bestLevel()) noexcept;
+
+    ///first sync byte that is followed by another sync byte stride bytes later,
+    ///inside the last stride of the view a single sync byte is enough
+    [[nodiscard]] static uint64_t findSyncByte(DataView view, uint8_t sync, uint64_t stride,
+                                               ScanLevel level = bestLevel()) noexcept;
+
+    ///position of the first 12-bit syncword 0xFFF, as used by ADTS
+    [[nodiscard]] static uint64_t findSyncword(DataView view, ScanLevel level = bestLevel()) noexcept;
+};
+
+} //end of namespace slark
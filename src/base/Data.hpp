@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <functional>
 #include "DataView.h"
+#include "DataPool.h"
 
 namespace slark {
 
@@ -21,6 +22,10 @@ struct Data {
     uint64_t capacity = 0;
     uint64_t length = 0;
     uint8_t* rawData = nullptr;
+    ///backing block of a slice, rawData points into it and is not owned
+    DataRefPtr owner = nullptr;
+    ///the bytes are read again later, like the pages of a file mapping, they are changed in a copy only
+    bool isReadOnly = false;
 
     Data()
         : capacity(0)
@@ -33,7 +38,7 @@ struct Data {
         : capacity(size)
         , length(size)
         , rawData(nullptr) {
-        rawData = new uint8_t[length];
+        rawData = DataPool::allocate(length);
         std::copy(data, data + size, rawData);
     }
 
@@ -41,7 +46,7 @@ struct Data {
         : capacity(size)
         , length(0)
         , rawData(nullptr) {
-        rawData = new uint8_t[size];
+        rawData = DataPool::allocate(size);
         std::fill_n(rawData, size, 0);
     }
 
@@ -49,7 +54,7 @@ struct Data {
         : capacity(size)
         , length(0)
         , rawData(nullptr) {
-        rawData = new uint8_t[size];
+        rawData = DataPool::allocate(size);
         if (func) {
             length = func(rawData);
         }
@@ -74,7 +79,7 @@ struct Data {
         , length (data.length)
         , rawData(nullptr) {
         if (!data.empty()) {
-            rawData = new uint8_t[data.capacity];
+            rawData = DataPool::allocate(data.capacity);
             std::copy(data.rawData, data.rawData + data.length, rawData);
         }
     }
@@ -82,7 +87,9 @@ struct Data {
     Data(Data&& data) noexcept
         : capacity (data.capacity)
         , length (data.length)
-        , rawData(data.rawData) {
+        , rawData(data.rawData)
+        , owner(std::move(data.owner))
+        , isReadOnly(data.isReadOnly) {
         data.rawData = nullptr;
         data.length = 0;
         data.capacity = 0;
@@ -93,7 +100,7 @@ struct Data {
             return *this;
         }
         reset();
-        rawData = new uint8_t[data.capacity];
+        rawData = DataPool::allocate(data.capacity);
         capacity = data.capacity;
         length = data.length;
         std::copy(data.rawData, data.rawData + data.length, rawData);
@@ -108,10 +115,68 @@ struct Data {
         capacity = data.capacity;
         length = data.length;
         rawData = data.rawData;
+        owner = std::move(data.owner);
+        isReadOnly = data.isReadOnly;
         data.rawData = nullptr;
         return *this;
     }
 
+    ///pool backed data with at least size bytes of capacity, the content is uninitialized
+    [[nodiscard]] static inline DataPtr obtain(uint64_t size) noexcept {
+        auto res = std::make_unique<Data>();
+        res->reserve(size);
+        return res;
+    }
+
+    ///share size bytes of block from pos without copying, the block must not be modified while it is shared
+    [[nodiscard]] static inline DataPtr makeSlice(const DataRefPtr& block, uint64_t pos, uint64_t size) noexcept {
+        auto res = std::make_unique<Data>();
+        if (!block || block->empty() || pos >= block->length) {
+            return res;
+        }
+        size = std::min(size, block->length - pos);
+        auto& root = block->owner ? block->owner : block;
+        res->rawData = block->rawData + pos;
+        res->length = size;
+        res->capacity = size;
+        res->owner = root;
+        return res;
+    }
+
+    ///slice of this data, shares the backing block if this is a slice, otherwise copies
+    [[nodiscard]] inline DataPtr slice(uint64_t pos, uint64_t size) const noexcept {
+        if (!owner || pos >= length) {
+            return copy(pos, static_cast<int64_t>(size));
+        }
+        auto offset = static_cast<uint64_t>(rawData - owner->rawData);
+        return makeSlice(owner, offset + pos, std::min(size, length - pos));
+    }
+
+    [[nodiscard]] inline bool isSlice() const noexcept {
+        return owner != nullptr;
+    }
+
+    ///false if a change of rawData in place would be seen by another holder or a later read of the same bytes,
+    ///a slice is writable only while it is the last holder of its block
+    [[nodiscard]] inline bool isWritable() const noexcept {
+        if (owner) {
+            return owner.use_count() == 1 && !owner->isReadOnly;
+        }
+        return !isReadOnly;
+    }
+
+    ///copy on write, call before changing rawData of a slice in place
+    inline void ensureUnique() noexcept {
+        if (!owner) {
+            return;
+        }
+        auto p = rawData;
+        capacity = DataPool::roundUp(length);
+        rawData = DataPool::allocate(capacity);
+        std::copy(p, p + length, rawData);
+        owner.reset();
+    }
+
     [[nodiscard]] inline DataPtr copy() const noexcept {
         return this->copy(0, static_cast<int64_t>(length));
     }
@@ -126,16 +191,16 @@ struct Data {
             resLen = length - pos;
         }
         auto size = std::min(static_cast<uint64_t>(resLen), length - pos);
-        res->capacity = size;
+        res->capacity = DataPool::roundUp(size);
         res->length = size;
-        res->rawData = new uint8_t[size];
+        res->rawData = DataPool::allocate(res->capacity);
         std::copy(rawData + pos, rawData + std::min(pos + resLen, length), res->rawData);
         return res;
     }
 
     inline void reset() {
         if (rawData) {
-            delete [] rawData;
+            releaseRawData(rawData);
             rawData = nullptr;
         }
         length = 0;
@@ -144,6 +209,7 @@ struct Data {
 
     [[maybe_unused]]
     inline void resetData() noexcept {
+        ensureUnique();
         if (rawData) {
             std::fill_n(rawData, capacity, 0);
         }
@@ -160,12 +226,27 @@ struct Data {
             return;
         }
         auto p = rawData;
-        rawData = new uint8_t [size];
+        rawData = DataPool::allocate(size);
         auto contentLength = std::min(size, length);
         std::copy(p, p + contentLength, rawData);
+        releaseRawData(p);
         length = contentLength;
         capacity = size;
-        delete[] p;
+    }
+
+    ///grow capacity to at least size bytes, the content is kept
+    inline void reserve(uint64_t size) noexcept {
+        if (size <= capacity && rawData) {
+            return;
+        }
+        auto p = rawData;
+        auto newCapacity = DataPool::roundUp(size);
+        rawData = DataPool::allocate(newCapacity);
+        if (p) {
+            std::copy(p, p + length, rawData);
+            releaseRawData(p);
+        }
+        capacity = newCapacity;
     }
 
     inline DataPtr detachData() {
@@ -173,6 +254,7 @@ struct Data {
         res->length = length;
         res->capacity = capacity;
         res->rawData = rawData;
+        res->owner = std::move(owner);
         length = 0;
         capacity = 0;
         rawData = nullptr;
@@ -190,16 +272,10 @@ struct Data {
         }
         auto expectLength = length + str.length();
         if (capacity < expectLength) {
-            auto p = rawData;
-            auto len = static_cast<int64_t>(static_cast<float>(expectLength) * 1.5f);
-            rawData = new uint8_t[static_cast<size_t>(len)];
-            capacity = static_cast<uint64_t>(len);
-            if (p) {
-                std::copy(p, p + length, rawData);
-                delete[] p;
-            }
+            reserve(static_cast<uint64_t>(static_cast<float>(expectLength) * 1.5f));
         }
-        std::copy(str.data(), str.data() + str.length(), rawData + length);
+        auto src = reinterpret_cast<const uint8_t*>(str.data());
+        std::copy(src, src + str.length(), rawData + length);
         length = expectLength;
     }
 
@@ -210,14 +286,7 @@ struct Data {
         }
         auto expectLength = length + d.length;
         if (capacity < expectLength) {
-            auto p = rawData;
-            auto len = static_cast<int64_t>(static_cast<float>(expectLength) * 1.5f);
-            rawData = new uint8_t[static_cast<size_t>(len)];
-            capacity = static_cast<uint64_t>(len);
-            if (p) {
-                std::copy(p, p + length, rawData);
-                delete[] p;
-            }
+            reserve(static_cast<uint64_t>(static_cast<float>(expectLength) * 1.5f));
         }
         std::copy(d.rawData, d.rawData + d.length, rawData + length);
         length = expectLength;
@@ -231,6 +300,7 @@ struct Data {
             rawData = appendData->rawData;
             length = appendData->length;
             capacity = appendData->capacity;
+            owner = std::move(appendData->owner);
             appendData->rawData = nullptr;
         } else {
             append(*appendData);
@@ -267,6 +337,15 @@ struct Data {
     [[nodiscard]] inline bool operator==(const Data& data) const noexcept {
         return length == data.length && view() == data.view();
     }
+private:
+    ///p is the current storage with the current capacity
+    inline void releaseRawData(uint8_t* p) noexcept {
+        if (owner) {
+            owner.reset();
+        } else {
+            DataPool::release(p, capacity);
+        }
+    }
 }; //end of class Data
 
 struct DataPacket {
@@ -0,0 +1,205 @@
+//
+// Created by Nevermore on 2025/7/2.
+// slark DataPool
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <vector>
+#include "DataPool.h"
+
+namespace slark {
+
+namespace {
+
+using BlockList = std::array<std::vector<uint8_t*>, DataPool::kClassCount>;
+
+constexpr uint32_t kMinClassShift = static_cast<uint32_t>(std::countr_zero(DataPool::kMinBlockSize));
+
+std::atomic<uint64_t> gHitCount = 0;
+std::atomic<uint64_t> gMissCount = 0;
+std::atomic<uint64_t> gDropCount = 0;
+
+bool isInRange(uint64_t size) noexcept {
+    return DataPool::kMinBlockSize < size && size <= DataPool::kMaxBlockSize;
+}
+
+///size must be in range
+uint32_t classIndex(uint64_t size) noexcept {
+    auto base = std::bit_floor(size - 1);
+    auto step = base / DataPool::kStepsPerClass;
+    auto steps = (size + step - 1) / step; //(kStepsPerClass, 2 * kStepsPerClass]
+    auto shift = static_cast<uint32_t>(std::countr_zero(base)) - kMinClassShift;
+    return shift * DataPool::kStepsPerClass + static_cast<uint32_t>(steps) - DataPool::kStepsPerClass - 1;
+}
+
+uint64_t classSize(uint32_t index) noexcept {
+    auto base = DataPool::kMinBlockSize << (index / DataPool::kStepsPerClass);
+    return base + (base / DataPool::kStepsPerClass) * (index % DataPool::kStepsPerClass + 1);
+}
+
+uint64_t threadCacheLimit(uint32_t index) noexcept {
+    return std::max<uint64_t>(DataPool::kThreadCacheClassBytes / classSize(index), 1);
+}
+
+void freeBlocks(std::vector<uint8_t*>& blocks) noexcept {
+    for (auto* block : blocks) {
+        delete[] block;
+    }
+    blocks.clear();
+}
+
+struct Depot {
+    std::mutex mutex;
+    BlockList blocks;
+    uint64_t bytes = 0;
+
+    ///move up to count blocks of the class into dst
+    void take(uint32_t index, uint64_t count, std::vector<uint8_t*>& dst) noexcept {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& list = blocks[index];
+        auto size = classSize(index);
+        while (count > 0 && !list.empty()) {
+            dst.push_back(list.back());
+            list.pop_back();
+            bytes -= size;
+            count--;
+        }
+    }
+
+    ///blocks that do not fit into the depot are freed
+    void give(uint32_t index, std::vector<uint8_t*>& src, uint64_t count) noexcept {
+        auto size = classSize(index);
+        std::lock_guard<std::mutex> lock(mutex);
+        while (count > 0 && !src.empty()) {
+            auto* block = src.back();
+            src.pop_back();
+            count--;
+            if (bytes + size <= DataPool::kDepotBytes) {
+                blocks[index].push_back(block);
+                bytes += size;
+            } else {
+                delete[] block;
+                gDropCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void clear() noexcept {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& list : blocks) {
+            freeBlocks(list);
+        }
+        bytes = 0;
+    }
+};
+
+Depot& depot() noexcept {
+    //intentionally leaked, thread caches may be flushed after static destruction
+    static auto* depot = new Depot();
+    return *depot;
+}
+
+thread_local bool tCacheDestroyed = false;
+
+struct ThreadCache {
+    BlockList blocks;
+
+    ~ThreadCache() {
+        for (uint32_t i = 0; i < DataPool::kClassCount; i++) {
+            depot().give(i, blocks[i], blocks[i].size());
+        }
+        tCacheDestroyed = true;
+    }
+};
+
+ThreadCache* threadCache() noexcept {
+    if (tCacheDestroyed) {
+        return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+} //end of namespace
+
+uint64_t DataPool::roundUp(uint64_t size) noexcept {
+    if (!isInRange(size)) {
+        return size;
+    }
+    return classSize(classIndex(size));
+}
+
+bool DataPool::isPooledSize(uint64_t size) noexcept {
+    return isInRange(size) && roundUp(size) == size;
+}
+
+uint8_t* DataPool::allocate(uint64_t size) noexcept {
+    if (!isPooledSize(size)) {
+        return new uint8_t[size];
+    }
+    auto index = classIndex(size);
+    if (auto* cache = threadCache(); cache) {
+        auto& list = cache->blocks[index];
+        if (list.empty()) {
+            depot().take(index, (threadCacheLimit(index) + 1) / 2, list);
+        }
+        if (!list.empty()) {
+            auto* block = list.back();
+            list.pop_back();
+            gHitCount.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    gMissCount.fetch_add(1, std::memory_order_relaxed);
+    return new uint8_t[size];
+}
+
+void DataPool::release(uint8_t* ptr, uint64_t size) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (!isPooledSize(size)) {
+        delete[] ptr;
+        return;
+    }
+    auto index = classIndex(size);
+    auto* cache = threadCache();
+    if (cache == nullptr) {
+        std::vector<uint8_t*> blocks{ptr};
+        depot().give(index, blocks, 1);
+        return;
+    }
+    auto& list = cache->blocks[index];
+    list.push_back(ptr);
+    auto limit = threadCacheLimit(index);
+    if (list.size() > limit) {
+        depot().give(index, list, list.size() - limit / 2);
+    }
+}
+
+void DataPool::trim() noexcept {
+    if (auto* cache = threadCache(); cache) {
+        for (auto& list : cache->blocks) {
+            freeBlocks(list);
+        }
+    }
+    depot().clear();
+}
+
+DataPoolStats DataPool::stats() noexcept {
+    DataPoolStats stats;
+    stats.hitCount = gHitCount.load(std::memory_order_relaxed);
+    stats.missCount = gMissCount.load(std::memory_order_relaxed);
+    stats.dropCount = gDropCount.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(depot().mutex);
+        stats.depotBytes = depot().bytes;
+    }
+    return stats;
+}
+
+} //end of namespace slark
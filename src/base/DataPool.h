@@ -0,0 +1,51 @@
+//
+// Created by Nevermore on 2025/7/2.
+// slark DataPool
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <cstdint>
+
+namespace slark {
+
+struct DataPoolStats {
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    ///blocks returned to the system because the caches were full
+    uint64_t dropCount = 0;
+    ///bytes held by the global depot
+    uint64_t depotBytes = 0;
+};
+
+///Size-class allocator for Data payloads.
+///Blocks in (kMinBlockSize, kMaxBlockSize] are rounded up to one of four steps per power of two,
+///released blocks are kept in a thread local cache first and spill into a global depot.
+///Every pooled block is a plain new uint8_t[classSize], so pooled and unpooled memory can be mixed freely.
+class DataPool {
+public:
+    static constexpr uint64_t kMinBlockSize = 2 * 1024;
+    static constexpr uint64_t kMaxBlockSize = 4 * 1024 * 1024;
+    static constexpr uint32_t kStepsPerClass = 4;
+    static constexpr uint32_t kClassCount = 44; //(log2(kMaxBlockSize) - log2(kMinBlockSize)) * kStepsPerClass
+    static constexpr uint64_t kThreadCacheClassBytes = 1024 * 1024;
+    static constexpr uint64_t kDepotBytes = 32 * 1024 * 1024;
+
+    ///size rounded up to its size class, sizes outside the pool range are returned unchanged
+    [[nodiscard]] static uint64_t roundUp(uint64_t size) noexcept;
+
+    [[nodiscard]] static bool isPooledSize(uint64_t size) noexcept;
+
+    ///return a block of exactly size bytes, content is uninitialized
+    [[nodiscard]] static uint8_t* allocate(uint64_t size) noexcept;
+
+    ///size must be the size the block was allocated with
+    static void release(uint8_t* ptr, uint64_t size) noexcept;
+
+    ///free every block cached by the depot and the calling thread
+    static void trim() noexcept;
+
+    [[nodiscard]] static DataPoolStats stats() noexcept;
+};
+
+} //end of namespace slark
@@ -15,6 +15,8 @@ namespace slark {
 
 struct IReader;
 using ReaderDataCallBack = std::function<void(IReader*, DataPacket, IOState)>;
+///the packet holds the requested range, shorter at the end of file, empty on failure
+using ReadAtCallBack = std::function<void(DataPacket)>;
 
 enum class ReaderType {
     Local,
@@ -63,6 +65,11 @@ struct IReader: public NonCopyable {
     virtual void seek(uint64_t pos) noexcept = 0;
     
     virtual uint64_t size() noexcept = 0;
+
+    ///Read size bytes from offset without moving the sequential read position.
+    ///Several requests may be outstanding, each callback is invoked once, possibly before readAt returns.
+    ///Returns false if the request is not accepted, the callback is not invoked then.
+    virtual bool readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept = 0;
     
     [[nodiscard]] ReaderType type() const noexcept {
         return type_;
@@ -0,0 +1,353 @@
+//
+// Created by Nevermore on 2025/7/14.
+// slark MmapReader
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include "MmapReader.h"
+#include "Log.hpp"
+#include "Util.hpp"
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace slark {
+
+static const std::string kMmapReaderPrefixName = "MmapReader_";
+
+MmapReader::MmapReader()
+    : worker_(Util::genRandomName(kMmapReaderPrefixName), &MmapReader::process, this) {
+    type_ = ReaderType::Local;
+}
+
+MmapReader::~MmapReader() {
+    worker_.pause();
+    file_.withWriteLock([](auto& file){
+        if (file) {
+            LogI("{} mmap reader closed", file->path);
+        }
+        file.reset();
+    });
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        task_.reset();
+    }
+    worker_.stop();
+}
+
+std::unique_ptr<MmapReader::MappedFile> MmapReader::map(const std::string& path) noexcept {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LogE("open {} failed, errno:{}", path, errno);
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LogE("stat {} failed or file is empty, errno:{}", path, errno);
+        ::close(fd);
+        return nullptr;
+    }
+    auto length = static_cast<uint64_t>(st.st_size);
+    //private writable pages are copied on write, so a packet changed in place never touches the file
+    auto addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        LogE("mmap {} failed, errno:{}", path, errno);
+        ::close(fd);
+        return nullptr;
+    }
+    ::madvise(addr, length, MADV_SEQUENTIAL);
+
+    auto data = new Data();
+    data->rawData = static_cast<uint8_t*>(addr);
+    data->length = length;
+    data->capacity = length;
+    //the pages are read again after a seek, a packet changed in place has to be copied first
+    data->isReadOnly = true;
+    auto file = std::make_unique<MappedFile>();
+    file->path = path;
+    file->fd = fd;
+    file->data = DataRefPtr(data, [](Data* p) {
+        ::munmap(p->rawData, p->capacity);
+        //the pages do not belong to the pool
+        p->rawData = nullptr;
+        p->length = 0;
+        p->capacity = 0;
+        delete p;
+    });
+    adviseReadAhead(*file);
+    return file;
+}
+
+MmapReader::MappedFile::~MappedFile() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+uint64_t MmapReader::validLength(const MappedFile& file) noexcept {
+    struct stat st{};
+    if (::fstat(file.fd, &st) != 0) {
+        return file.data->length;
+    }
+    return std::min(file.data->length, static_cast<uint64_t>(std::max<off_t>(st.st_size, 0)));
+}
+
+void MmapReader::adviseReadAhead(MappedFile& file) noexcept {
+    auto length = file.data->length;
+    if (file.adviseEnd >= length || file.pos + kMmapWillNeedSize / 2 < file.adviseEnd) {
+        return;
+    }
+    static const auto kPageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = file.pos / kPageSize * kPageSize;
+    auto end = std::min(file.pos + kMmapWillNeedSize, length);
+    ::madvise(file.data->rawData + begin, end - begin, MADV_WILLNEED);
+    file.adviseEnd = end;
+}
+
+bool MmapReader::open(ReaderTaskPtr ptr) noexcept {
+    bool isSuccess = false;
+    file_.withWriteLock([&](auto& file){
+        file = map(ptr->path);
+        isSuccess = file != nullptr;
+    });
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        task_ = std::move(ptr);
+    }
+    return isSuccess;
+}
+
+bool MmapReader::isCompleted() noexcept {
+    bool hasSeek = false;
+    {
+        std::lock_guard<std::mutex> lock(seekMutex_);
+        hasSeek = seekPos_.has_value();
+    }
+    return isReadCompleted_ && !hasSeek;
+}
+
+bool MmapReader::isRunning() noexcept {
+    return worker_.isRunning();
+}
+
+IOState MmapReader::state() noexcept {
+    IOState state = IOState::Normal;
+    uint64_t tell = 0;
+    file_.withReadLock([&state, &tell, this](auto& file){
+        if (!file || worker_.isExit()) {
+            state = IOState::Closed;
+        } else if (file->pos >= file->data->length) {
+            state = IOState::EndOfFile;
+        } else if (!worker_.isRunning()) {
+            state = IOState::Pause;
+        }
+        if (file) {
+            tell = file->pos;
+        }
+    });
+    do {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!task_) {
+            break;
+        }
+        const auto& readRange = task_->range;
+        if (readRange.isValid() && tell > readRange.end()) {
+            state = IOState::EndOfFile;
+        }
+    } while(false);
+    return state;
+}
+
+void MmapReader::start() noexcept {
+    worker_.start();
+}
+
+void MmapReader::pause() noexcept {
+    worker_.pause();
+}
+
+void MmapReader::reset() noexcept {
+    worker_.pause();
+    file_.withWriteLock([](auto& file){
+        if (file) {
+            LogI("{} mmap reader closed", file->path);
+        }
+        file.reset();
+    });
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        task_.reset();
+    }
+}
+
+void MmapReader::close() noexcept {
+    reset();
+    worker_.stop();
+}
+
+std::string MmapReader::path() noexcept {
+    std::string path;
+    file_.withReadLock([&](auto& file){
+        if (file) {
+            path = file->path;
+        }
+    });
+    return path;
+}
+
+void MmapReader::seek(uint64_t pos) noexcept {
+    if (worker_.isExit()) {
+        LogE("MmapReader is exit.");
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(seekMutex_);
+        seekPos_ = static_cast<int64_t>(pos);
+        isReadCompleted_ = false;
+    }
+    worker_.wakeUp();
+}
+
+void MmapReader::doSeek() noexcept {
+    std::lock_guard<std::mutex> lock(seekMutex_);
+    if (seekPos_.has_value()) {
+        file_.withWriteLock([&](auto& file){
+            if (!file) {
+                return;
+            }
+            file->pos = std::min(static_cast<uint64_t>(seekPos_.value()), file->data->length);
+            file->adviseEnd = file->pos;
+            adviseReadAhead(*file);
+        });
+        seekPos_.reset();
+    }
+}
+
+void MmapReader::process() noexcept {
+    doSeek();
+    auto nowState = state();
+    if (nowState == IOState::EndOfFile) {
+        worker_.pause();
+        isReadCompleted_ = true;
+        LogI("read data completed.");
+        return;
+    }
+
+    uint64_t readBlockSize = kMmapReadBlockSize;
+    Range readRange;
+    std::chrono::milliseconds timeInterval{};
+    ReaderDataCallBack callBack;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!task_) {
+            worker_.idle();
+            return;
+        }
+        readBlockSize = std::max(task_->readBlockSize, kMmapReadBlockSize);
+        readRange = task_->range;
+        timeInterval = task_->timeInterval;
+        callBack = task_->callBack;
+    }
+    //the interval paces reading, seek and start cut it short
+    worker_.idle(timeInterval);
+    DataPacket data;
+    file_.withWriteLock([&](auto& file){
+        if (!file) {
+            return;
+        }
+        auto readSize = readBlockSize;
+        if (readRange.isValid() && readSize > (readRange.end() - file->pos + 1)) {
+            readSize = readRange.end() - file->pos + 1;
+        }
+        auto length = validLength(*file);
+        if (length < file->data->length && file->pos + readSize > length) {
+            if (file->pos >= length) {
+                //truncated behind the read position, the pages left would raise SIGBUS
+                LogE("{} is truncated to {}, stop reading at {}", file->path, length, file->pos);
+                file->pos = file->data->length;
+                return;
+            }
+            readSize = length - file->pos;
+        }
+        data.offset = static_cast<int64_t>(file->pos);
+        data.data = Data::makeSlice(file->data, file->pos, readSize);
+        file->pos += data.length();
+        adviseReadAhead(*file);
+    });
+
+    nowState = state();
+    isReadCompleted_ = nowState == IOState::EndOfFile;
+    if (callBack) {
+        callBack(this, std::move(data), nowState);
+    }
+}
+
+void MmapReader::updateReadRange(Range range) noexcept {
+    if (worker_.isExit()) {
+        LogE("MmapReader is exit.");
+        return;
+    }
+    if (!range.isValid()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (task_) {
+            task_->range = range;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(seekMutex_);
+        seekPos_ = static_cast<int64_t>(range.start());
+        isReadCompleted_ = false;
+    }
+    worker_.start();
+}
+
+int64_t MmapReader::tell() noexcept {
+    int64_t pos = 0;
+    file_.withReadLock([&](auto& file){
+        if (file) {
+            pos = static_cast<int64_t>(file->pos);
+        }
+    });
+    return pos;
+}
+
+uint64_t MmapReader::size() noexcept {
+    uint64_t size = 0;
+    file_.withReadLock([&](auto& file){
+        if (file) {
+            size = file->data->length;
+        }
+    });
+    return size;
+}
+
+bool MmapReader::readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept {
+    if (!callBack) {
+        return false;
+    }
+    DataPacket packet;
+    packet.offset = static_cast<int64_t>(offset);
+    bool isOpened = false;
+    file_.withReadLock([&](auto& file){
+        if (!file) {
+            return;
+        }
+        isOpened = true;
+        auto length = validLength(*file);
+        if (offset < length) {
+            packet.data = Data::makeSlice(file->data, offset, std::min(size, length - offset));
+        }
+    });
+    if (!isOpened) {
+        return false;
+    }
+    callBack(std::move(packet));
+    return true;
+}
+
+}//end namespace slark
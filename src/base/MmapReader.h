@@ -0,0 +1,89 @@
+//
+// Created by Nevermore on 2025/7/14.
+// slark MmapReader
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include "IReader.h"
+#include "Thread.h"
+#include "Synchronized.hpp"
+#include <optional>
+#include <chrono>
+
+namespace slark {
+
+///minimum size of a packet handed out by MmapReader, packets are slices of the mapping so a large block costs nothing
+constexpr uint64_t kMmapReadBlockSize = 1024 * 512; //512kb
+///size of the range ahead of the read position the kernel is asked to page in
+constexpr uint64_t kMmapWillNeedSize = 1024 * 1024 * 4; //4mb
+
+///Local file reader that maps the whole file, every packet references the mapping without copying.
+///The mapping lives until the reader and all of its packets are released. Packets are cut to the current
+///file size, but a file truncated by someone else still raises SIGBUS if a packet handed out before is read
+///past the new end. open fails for files that can not be mapped, use Reader for them.
+class MmapReader: public IReader {
+public:
+    MmapReader();
+
+    ~MmapReader() override;
+public:
+    bool open(ReaderTaskPtr) noexcept override;
+
+    IOState state() noexcept override;
+
+    void reset() noexcept override;
+
+    void close() noexcept override;
+
+    void start() noexcept override;
+
+    void pause() noexcept override;
+
+    bool isRunning() noexcept override;
+
+    bool isCompleted() noexcept override;
+
+    void updateReadRange(Range range) noexcept override;
+
+    void seek(uint64_t pos) noexcept override;
+
+    uint64_t size() noexcept override;
+
+    ///hands out a slice of the mapping before returning
+    bool readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept override;
+public:
+    int64_t tell() noexcept;
+    std::string path() noexcept;
+private:
+    struct MappedFile {
+        std::string path;
+        ///read only mapping of the whole file, released with the last packet that shares it
+        DataRefPtr data;
+        uint64_t pos = 0;
+        ///end of the range already advised with WILLNEED
+        uint64_t adviseEnd = 0;
+        ///kept open to notice a file truncated while it is mapped
+        int fd = -1;
+
+        ~MappedFile();
+    };
+
+    static std::unique_ptr<MappedFile> map(const std::string& path) noexcept;
+
+    static void adviseReadAhead(MappedFile& file) noexcept;
+
+    ///bytes of the mapping still backed by the file, pages past the end of a truncated file raise SIGBUS
+    static uint64_t validLength(const MappedFile& file) noexcept;
+
+    void process() noexcept;
+    void doSeek() noexcept;
+private:
+    std::atomic_bool isReadCompleted_ = false;
+    std::mutex seekMutex_;
+    std::optional<int64_t> seekPos_;
+    Synchronized<std::unique_ptr<MappedFile>, std::shared_mutex> file_;
+    Thread worker_;
+};
+
+}
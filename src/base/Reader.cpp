@@ -36,7 +36,6 @@ Reader::~Reader() {
 
 bool Reader::open(ReaderTaskPtr ptr) noexcept {
     bool isSuccess = false;
-    worker_.setInterval(ptr->timeInterval);
     file_.withWriteLock([&](auto& file){
         file = std::make_unique<File::ReadFile>(std::string(ptr->path));
         isSuccess = file->open();
@@ -135,9 +134,12 @@ void Reader::seek(uint64_t pos) noexcept {
         return;
     }
     
-    std::lock_guard<std::mutex> lock(seekMutex_);
-    seekPos_ = static_cast<int64_t>(pos);
-    isReadCompleted_ = false;
+    {
+        std::lock_guard<std::mutex> lock(seekMutex_);
+        seekPos_ = static_cast<int64_t>(pos);
+        isReadCompleted_ = false;
+    }
+    worker_.wakeUp();
 }
 
 void Reader::doSeek() noexcept {
@@ -169,22 +171,28 @@ void Reader::process() noexcept {
 
     uint64_t readBlockSize = kReadDefaultSize;
     Range readRange;
+    std::chrono::milliseconds timeInterval{};
     {
         std::lock_guard<std::mutex> lock(taskMutex_);
         if (!task_) {
+            worker_.idle();
             return;
         }
         readBlockSize = task_->readBlockSize;
         readRange = task_->range;
+        timeInterval = task_->timeInterval;
     }
-    DataPacket data(readBlockSize);
+    //the interval paces reading, seek and start cut it short
+    worker_.idle(timeInterval);
+    DataPacket data;
+    data.data = Data::obtain(readBlockSize);
     file_.withReadLock([&](auto& file){
         if (!file) {
             return;
         }
 
         auto tell = file->tell();
-        auto readSize = data.data->capacity;
+        auto readSize = readBlockSize;
         if (readRange.isValid() && readSize > (readRange.end() - tell + 1)) {
             readSize = readRange.end() - tell + 1;
         }
@@ -238,5 +246,26 @@ uint64_t Reader::size() noexcept {
     return size;
 }
 
+bool Reader::readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept {
+    auto filePath = path();
+    if (filePath.empty() || !callBack) {
+        return false;
+    }
+    DataPacket packet;
+    packet.offset = static_cast<int64_t>(offset);
+    //a handle of its own, the sequential read position is untouched
+    File::ReadFile file(std::move(filePath));
+    if (size > 0 && file.open()) {
+        file.seek(static_cast<int64_t>(offset));
+        packet.data = Data::obtain(size);
+        if (!file.read(*packet.data, size)) {
+            packet.data.reset();
+        }
+        file.close();
+    }
+    callBack(std::move(packet));
+    return true;
+}
+
 }//end namespace slark
 
@@ -41,6 +41,9 @@ public:
     void seek(uint64_t pos) noexcept override;
     
     uint64_t size() noexcept override;
+
+    ///served in the calling thread, the callback is invoked before returning
+    bool readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept override;
 public:
     //public function
     int64_t tell() noexcept;
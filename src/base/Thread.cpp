@@ -48,26 +48,62 @@ void Thread::pause() noexcept {
 void Thread::start() noexcept {
     {
         std::lock_guard<std::shared_mutex> lock(mutex_);
-        if (isRunning_ || isExit_) {
+        if (isExit_) {
             return;
         }
         isRunning_ = true;
+        isWakeUp_ = true;
     }
     cond_.notify_all();
 }
 
+void Thread::idle(milliseconds maxWait) noexcept {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    isIdle_ = true;
+    idleWaitTime_ = std::min(idleWaitTime_, maxWait);
+}
+
+void Thread::wakeUp() noexcept {
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        isWakeUp_ = true;
+    }
+    cond_.notify_all();
+}
+
+void Thread::waitIdle() noexcept {
+    auto waitTime = timerPool_.peekActiveTime();
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    waitTime = std::min(waitTime, idleWaitTime_);
+    isIdle_ = false;
+    idleWaitTime_ = kIdleWaitForever;
+    if (waitTime <= 0ms) {
+        return;
+    }
+    cond_.wait_for(lock, waitTime, [this] {
+        return isExit_ || !isRunning_ || isWakeUp_;
+    });
+}
+
 void Thread::process() noexcept {
     while (!isExit_) {
         if (!isInit_) {
             setup();
         }
         if (isRunning_) {
+            {
+                //a wake up that comes while func_ runs must not be lost by the idle wait after it
+                std::lock_guard<std::shared_mutex> lock(mutex_);
+                isWakeUp_ = false;
+            }
             lastRunTimeStamp_ = Time::nowTimeStamp().point();
             if (func_) {
                 func_();
             }
             timerPool_.loop();
-            if (interval_ > 0ms) {
+            if (isIdle_) {
+                waitIdle();
+            } else if (interval_ > 0ms) {
                 std::this_thread::sleep_for(interval_);
             }
         } else {
@@ -97,15 +133,21 @@ void Thread::setup() noexcept {
 }
 
 TimerId Thread::runAt(Time::TimePoint timeStamp, TimerTask func) noexcept {
-    return timerPool_.runAt(timeStamp, std::move(func), ExecuteMode::Serial);
+    auto timerId = timerPool_.runAt(timeStamp, std::move(func), ExecuteMode::Serial);
+    wakeUp(); //the idle wait may end after the new deadline
+    return timerId;
 }
 
 TimerId Thread::runAfter(milliseconds delayTime, TimerTask func) noexcept {
-    return timerPool_.runAfter(delayTime, std::move(func), ExecuteMode::Serial);
+    auto timerId = timerPool_.runAfter(delayTime, std::move(func), ExecuteMode::Serial);
+    wakeUp();
+    return timerId;
 }
 
 TimerId Thread::runLoop(milliseconds timeInterval, TimerTask func) noexcept {
-    return timerPool_.runLoop(timeInterval, std::move(func), ExecuteMode::Serial);
+    auto timerId = timerPool_.runLoop(timeInterval, std::move(func), ExecuteMode::Serial);
+    wakeUp();
+    return timerId;
 }
 
 }//end namespace slark
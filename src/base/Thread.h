@@ -25,6 +25,8 @@ namespace slark {
 class Thread : public NonCopyable {
 
 public:
+    static constexpr std::chrono::milliseconds kIdleWaitForever = std::chrono::milliseconds::max();
+
     template <typename Func, typename ... Args>
     requires std::is_invocable_v<Func, Args...>
     Thread(std::string name, Func&& f, Args&& ... args)
@@ -52,6 +54,14 @@ public:
 
     void stop() noexcept;
 
+    ///Called from the thread function when there is nothing left to do.
+    ///After the current run the thread blocks until wakeUp(), start(), stop(), a new timer,
+    ///the next timer deadline or maxWait, instead of running again after interval.
+    void idle(std::chrono::milliseconds maxWait = kIdleWaitForever) noexcept;
+
+    ///ends an idle wait, the thread function runs again right away
+    void wakeUp() noexcept;
+
     TimerId runAt(Time::TimePoint timePoint, TimerTask func) noexcept;
     
     TimerId runAfter(std::chrono::milliseconds delayTime, TimerTask func) noexcept;
@@ -99,9 +109,14 @@ private:
     void process() noexcept;
     
     void setup() noexcept;
+
+    void waitIdle() noexcept;
 private:
     bool isRunning_ = false;
     bool isExit_ = false;
+    bool isIdle_ = false;
+    bool isWakeUp_ = false;
+    std::chrono::milliseconds idleWaitTime_ = kIdleWaitForever;
     std::atomic<bool> isInit_ = false;
     std::chrono::milliseconds interval_{0};
     std::string name_;
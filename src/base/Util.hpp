@@ -51,14 +51,6 @@ bool readLE(DataView view, uint32_t size, uint32_t& value) noexcept;
 
 [[maybe_unused]] std::string uint32ToStringBE(uint32_t value) noexcept;
 
-struct Golomb {
-    static bool readBit(DataView view, int32_t& offset) noexcept;
-    
-    static uint32_t readBits(DataView view, int32_t& offset, int32_t numBits) noexcept;
-    
-    static uint32_t readUe(DataView view, int32_t& offset) noexcept;
-};
-
 }
 
 
@@ -114,6 +114,8 @@ public:
     uint64_t offset = 0;
     uint64_t keyIndex = 0;
     FrameFormat format = FrameFormat::Unknown;
+    ///where each nalu header sits in the frame data, behind its start code or length field
+    std::vector<uint32_t> naluOffsets;
 };
 
 struct AVFrame {
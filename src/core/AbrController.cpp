@@ -0,0 +1,116 @@
+//
+// Created by Nevermore on 2025/7/22.
+// slark AbrController
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <optional>
+#include "AbrController.h"
+#include "Log.hpp"
+
+namespace slark {
+
+uint32_t ThroughputBufferStrategy::select(const AbrContext& context) noexcept {
+    const auto& bandwidths = context.bandwidths;
+    auto current = context.currentIndex;
+    if (bandwidths.empty() || context.throughput <= 0.0 || current >= bandwidths.size()) {
+        return current;
+    }
+    auto budget = context.throughput * kSafetyFactor;
+    //the highest variant within the budget, the lowest one if none fits
+    std::optional<uint32_t> target;
+    uint32_t lowest = 0;
+    for (uint32_t i = 0; i < bandwidths.size(); i++) {
+        if (bandwidths[i] < bandwidths[lowest]) {
+            lowest = i;
+        }
+        if (bandwidths[i] <= budget && (!target || bandwidths[i] > bandwidths[*target])) {
+            target = i;
+        }
+    }
+    auto index = target.value_or(lowest);
+    if (bandwidths[index] > bandwidths[current] && context.bufferTime < kMinUpSwitchBuffer) {
+        return current;
+    }
+    if (bandwidths[index] < bandwidths[current] && context.bufferTime > kMaxDownSwitchBuffer) {
+        return current;
+    }
+    return index;
+}
+
+void ThroughputEstimator::addSample(uint64_t size, std::chrono::milliseconds cost) noexcept {
+    if (size < kMinSampleSize) {
+        return;
+    }
+    auto seconds = static_cast<double>(std::max<int64_t>(cost.count(), 1)) / 1000.0;
+    auto sample = static_cast<double>(size) * 8.0 / seconds;
+    throughput_ = throughput_ <= 0.0 ? sample : kAlpha * sample + (1.0 - kAlpha) * throughput_;
+}
+
+AbrController::AbrController()
+    : strategy_(std::make_unique<ThroughputBufferStrategy>()) {
+
+}
+
+void AbrController::setBandwidths(std::vector<uint32_t> bandwidths) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bandwidths_ = std::move(bandwidths);
+    currentIndex_ = 0;
+}
+
+void AbrController::setStrategy(std::unique_ptr<IAbrStrategy> strategy) noexcept {
+    if (!strategy) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    strategy_ = std::move(strategy);
+}
+
+void AbrController::onSegmentDownloaded(uint64_t size, std::chrono::milliseconds cost) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    estimator_.addSample(size, cost);
+}
+
+uint32_t AbrController::select(double bufferTime) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bandwidths_.size() <= 1) {
+        return currentIndex_;
+    }
+    AbrContext context{bandwidths_, currentIndex_, estimator_.throughput(), bufferTime};
+    auto index = strategy_->select(context);
+    if (index >= bandwidths_.size()) {
+        LogE("abr select invalid variant:{}, count:{}", index, bandwidths_.size());
+        return currentIndex_;
+    }
+    if (index != currentIndex_) {
+        LogI("abr select variant {} -> {}, throughput:{:.0f}bps, buffer:{:.2f}s",
+             currentIndex_, index, context.throughput, bufferTime);
+    }
+    return index;
+}
+
+void AbrController::setCurrentIndex(uint32_t index) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < bandwidths_.size()) {
+        currentIndex_ = index;
+    }
+}
+
+uint32_t AbrController::currentIndex() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return currentIndex_;
+}
+
+uint32_t AbrController::variantCount() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(bandwidths_.size());
+}
+
+void AbrController::reset() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bandwidths_.clear();
+    currentIndex_ = 0;
+    estimator_.reset();
+}
+
+}//end namespace slark
@@ -0,0 +1,102 @@
+//
+// Created by Nevermore on 2025/7/22.
+// slark AbrController
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace slark {
+
+///what a strategy knows when the next segment is about to be fetched
+struct AbrContext {
+    ///bandwidth of every variant in bits per second, in play list order
+    const std::vector<uint32_t>& bandwidths;
+    uint32_t currentIndex = 0;
+    ///estimated download rate in bits per second, 0 before the first segment
+    double throughput = 0.0;
+    ///seconds demuxed ahead of the played time
+    double bufferTime = 0.0;
+};
+
+///Picks the variant of the next segment, replaceable to change the switching policy.
+class IAbrStrategy {
+public:
+    virtual ~IAbrStrategy() = default;
+
+    ///the index of the variant to play next
+    virtual uint32_t select(const AbrContext& context) noexcept = 0;
+};
+
+///Takes the best variant the throughput carries with a safety margin,
+///goes up only with enough buffer and stays put while the buffer is large.
+class ThroughputBufferStrategy : public IAbrStrategy {
+public:
+    ///share of the throughput a variant may use
+    static constexpr double kSafetyFactor = 0.8;
+    ///no switching up below this buffer, seconds
+    static constexpr double kMinUpSwitchBuffer = 10.0;
+    ///no switching down above this buffer, seconds
+    static constexpr double kMaxDownSwitchBuffer = 25.0;
+
+    uint32_t select(const AbrContext& context) noexcept override;
+};
+
+///Exponentially weighted moving average of segment download rates.
+class ThroughputEstimator {
+public:
+    ///weight of the newest sample
+    static constexpr double kAlpha = 0.3;
+    ///smaller downloads are mostly latency, they say little about the rate
+    static constexpr uint64_t kMinSampleSize = 16 * 1024;
+
+    void addSample(uint64_t size, std::chrono::milliseconds cost) noexcept;
+
+    void reset() noexcept {
+        throughput_ = 0.0;
+    }
+
+    ///bits per second, 0 without samples
+    [[nodiscard]] double throughput() const noexcept {
+        return throughput_;
+    }
+private:
+    double throughput_ = 0.0;
+};
+
+class AbrController {
+public:
+    AbrController();
+
+    ///the variants to choose from, the first one is played until a download is measured
+    void setBandwidths(std::vector<uint32_t> bandwidths) noexcept;
+
+    void setStrategy(std::unique_ptr<IAbrStrategy> strategy) noexcept;
+
+    void onSegmentDownloaded(uint64_t size, std::chrono::milliseconds cost) noexcept;
+
+    ///choose the variant of the next segment
+    uint32_t select(double bufferTime) noexcept;
+
+    ///the variant has been switched to
+    void setCurrentIndex(uint32_t index) noexcept;
+
+    [[nodiscard]] uint32_t currentIndex() noexcept;
+
+    [[nodiscard]] uint32_t variantCount() noexcept;
+
+    void reset() noexcept;
+private:
+    std::mutex mutex_;
+    uint32_t currentIndex_ = 0;
+    std::vector<uint32_t> bandwidths_;
+    ThroughputEstimator estimator_;
+    std::unique_ptr<IAbrStrategy> strategy_;
+};
+
+}//end namespace slark
@@ -7,22 +7,30 @@
 
 #include "HLSReader.h"
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include "Log.hpp"
 #include "Util.hpp"
+#include "TimerManager.h"
 
 namespace slark {
 
 static constexpr std::string_view kM3u8Tag = "HLSRequestM3u8";
 static constexpr std::string_view kTsTag = "HLSRequestTs";
 
-bool parseTsTag(const std::string& tag, uint32_t& tsIndex) noexcept {
+///tag of a segment is HLSRequestTs_<ts index>, of a part HLSRequestTs_<ts index>_<part index>
+bool parseTsTag(const std::string& tag, uint32_t& tsIndex, uint32_t& partIndex) noexcept {
     auto pos = tag.find('_');
     if (pos == std::string::npos) {
         return false;
     }
     auto index = tag.substr(pos + 1);
     tsIndex = static_cast<uint32_t>(std::stoi(index));
+    auto partPos = index.find('_');
+    if (partPos != std::string::npos) {
+        partIndex = static_cast<uint32_t>(std::stoi(index.substr(partPos + 1)));
+    }
     return true;
 }
 
@@ -40,21 +48,104 @@ void HLSReader::handleError(const http::ErrorInfo&) noexcept {
     }
 }
 
-void HLSReader::handleTSData(uint32_t index, DataPtr dataPtr) noexcept {
+void HLSReader::deliverData(uint32_t tsIndex, HLSSegment& segment, DataPtr dataPtr) noexcept {
     DataPacket data;
     data.data = std::move(dataPtr);
-    data.offset = static_cast<int64_t>(receiveLength_);
-    data.tag = std::to_string(index);
-    receiveLength_ += data.data->length;
+    data.offset = static_cast<int64_t>(segment.offset);
+    data.tag = std::to_string(tsIndex);
+    segment.offset += data.data->length;
     {
         std::lock_guard<std::mutex> lock(taskMutex_);
         task_->callBack(this, std::move(data), state());
     }
 }
 
-void HLSReader::handleTSCompleted(uint32_t tsIndex) noexcept {
-    fetchTSData(tsIndex + 1);
-    LogI("fetch ts index: {}", tsIndex + 1);
+void HLSReader::deliverSegments() noexcept {
+    for (auto it = segments_.find(deliverIndex_); it != segments_.end(); it = segments_.find(deliverIndex_)) {
+        auto& segment = it->second;
+        for (auto& data : segment.datas) {
+            deliverData(it->first, segment, std::move(data));
+        }
+        segment.datas.clear();
+        if (!segment.isCompleted) {
+            break;
+        }
+        segments_.erase(it);
+        deliverIndex_++;
+    }
+}
+
+void HLSReader::handleTSData(uint32_t index, DataPtr dataPtr) noexcept {
+    std::lock_guard<std::mutex> lock(segmentMutex_);
+    auto it = segments_.find(index);
+    if (it == segments_.end()) {
+        //left over from before a seek
+        return;
+    }
+    it->second.length += dataPtr->length;
+    if (index == deliverIndex_) {
+        deliverData(index, it->second, std::move(dataPtr));
+    } else {
+        it->second.datas.push_back(std::move(dataPtr));
+    }
+}
+
+void HLSReader::handleTSCompleted(uint32_t tsIndex, uint32_t partIndex) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex_);
+        auto it = segments_.find(tsIndex);
+        if (it == segments_.end()) {
+            return;
+        }
+        auto& segment = it->second;
+        if (partIndex != kInvalidIndex) {
+            //the segment completes once it is listed and its last part is received
+            segment.isPartLoading = false;
+        } else {
+            segment.isCompleted = true;
+            //concurrent downloads share the link, each one sees a part of it
+            auto inFlight = static_cast<uint64_t>(std::ranges::count_if(segments_, [](const auto& pair) {
+                return !pair.second.isCompleted;
+            })) + 1;
+            auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - segment.startTime);
+            abrController_.onSegmentDownloaded(segment.length * inFlight, cost);
+            deliverSegments();
+        }
+    }
+    prefetch();
+}
+
+void HLSReader::loadVariant(uint32_t variantIndex) noexcept {
+    std::string m3u8Url;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!demuxer_) {
+            return;
+        }
+        if (demuxer_->isVariantLoaded(variantIndex)) {
+            demuxer_->switchVariant(variantIndex);
+        } else {
+            demuxer_->prepareVariant(variantIndex);
+            m3u8Url = demuxer_->playListInfos()[variantIndex].m3u8Url;
+        }
+    }
+    if (m3u8Url.empty()) {
+        abrController_.setCurrentIndex(variantIndex);
+        return;
+    }
+    pendingVariant_ = variantIndex;
+    sendM3u8Request(m3u8Url);
+    LogI("load variant:{}, url:{}", variantIndex, m3u8Url);
+}
+
+double HLSReader::bufferTime() noexcept {
+    double time = 0.0;
+    bufferTimeFunc_.withLock([&time](auto& func) {
+        if (func) {
+            time = func();
+        }
+    });
+    return time;
 }
 
 void HLSReader::handleM3u8Data(DataPtr data) noexcept {
@@ -71,27 +162,64 @@ void HLSReader::handleM3u8Data(DataPtr data) noexcept {
 
 void HLSReader::handleM3u8Completed() noexcept {
     m3u8Buffer_->reset();
-    bool isPlayList = false;
+    bool isMasterList = false;
+    std::vector<uint32_t> bandwidths;
     {
         std::lock_guard<std::mutex> lock(taskMutex_);
-        isPlayList = demuxer_->isPlayList() && !demuxer_->isOpened();
+        demuxer_->loadCompleted();
+        isMasterList = demuxer_->isPlayList() && !demuxer_->isOpened() && pendingVariant_ == kInvalidIndex;
+        if (isMasterList) {
+            for (const auto& info : demuxer_->playListInfos()) {
+                bandwidths.push_back(info.codeRate);
+            }
+        }
+        isLive_ = demuxer_->isLive();
     }
-    if (!isPlayList) {
-        fetchTSData(0);
+    if (isMasterList) {
+        if (bandwidths.empty()) {
+            LogE("play list is empty!");
+            return;
+        }
+        //the first variant is played until a download is measured
+        abrController_.setBandwidths(std::move(bandwidths));
+        loadVariant(0);
         return;
     }
-    PlayListInfo playInfo;
-    {
-        std::lock_guard<std::mutex> lock(taskMutex_);
-        const auto& playList = demuxer_->playListInfos();
-        playInfo = playList.front();
+    if (isRefreshing_.exchange(false)) {
+        prefetch();
+        scheduleRefresh();
+        return;
     }
-    if (!playInfo.m3u8Url.empty()) {
-        sendM3u8Request(playInfo.m3u8Url);
-        LogI("play list, resend m3u8 req:{}, url:{}", playInfo.name, playInfo.m3u8Url);
-    } else {
-        LogE("play list is empty!");
+    auto variant = pendingVariant_.exchange(kInvalidIndex);
+    if (variant != kInvalidIndex) {
+        bool isSwitched = false;
+        bool isOpened = false;
+        {
+            std::lock_guard<std::mutex> lock(taskMutex_);
+            isSwitched = demuxer_->switchVariant(variant);
+            isOpened = demuxer_->isOpened();
+        }
+        if (isSwitched) {
+            abrController_.setCurrentIndex(variant);
+        } else {
+            LogE("load variant failed:{}, keep variant:{}", variant, abrController_.currentIndex());
+        }
+        if (!isOpened) {
+            LogE("no variant play list is loaded");
+            return;
+        }
     }
+    if (isStarted_.exchange(true)) {
+        prefetch();
+        return;
+    }
+    uint32_t tsIndex = 0;
+    if (isLive_) {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        tsIndex = demuxer_->liveStartIndex();
+    }
+    fetchTSData(tsIndex);
+    scheduleRefresh();
 }
 
 void HLSReader::sendM3u8Request(const std::string& m3u8Url) noexcept {
@@ -105,54 +233,57 @@ void HLSReader::sendM3u8Request(const std::string& m3u8Url) noexcept {
 
 void HLSReader::setupDataProvider() noexcept {
     std::lock_guard<std::mutex> lock(requestMutex_);
-    if (requestSession_) {
-        requestSession_->close();
-        requestSession_.reset();
-    }
-    auto handler = std::make_unique<http::ResponseHandler>();
-    handler->onParseHeaderDone = [this] (const http::RequestInfo& info,
-                                         http::ResponseHeader&& header) {
-        if (header.httpStatusCode == http::HttpStatusCode::OK) {
-            return;
-        }
-        http::ErrorInfo errorInfo;
-        errorInfo.errorCode = static_cast<int>(header.httpStatusCode);
-        errorInfo.retCode = http::ResultCode::ConnectGenericError;
-        handleError(errorInfo);
-        LogE("{}, http code:{} error code:{}", info.tag, errorInfo.errorCode, static_cast<int>(errorInfo.retCode));
-    };
-    handler->onData = [this] (const http::RequestInfo& info,
-                              DataPtr data) {
-        if (info.tag == kM3u8Tag) {
-            handleM3u8Data(std::move(data));
-        } else {
-            uint32_t tsIndex = 0;
-            if (!parseTsTag(info.tag, tsIndex)) {
-                LogE("error tag:{}", info.tag);
+    for (auto& session : requestSessions_) {
+        session->close();
+    }
+    requestSessions_.clear();
+    for (uint32_t i = 0; i <= kMaxPrefetchCount; i++) {
+        auto handler = std::make_unique<http::ResponseHandler>();
+        handler->onParseHeaderDone = [this] (const http::RequestInfo& info,
+                                             http::ResponseHeader&& header) {
+            if (header.httpStatusCode == http::HttpStatusCode::OK) {
                 return;
             }
-            handleTSData(tsIndex, std::move(data));
-        }
-    };
-    handler->onError = [this] (const http::RequestInfo& info,
-                               http::ErrorInfo errorInfo) {
-        handleError(errorInfo);
-        LogE("{}, http code:{} error code:{}", info.tag, errorInfo.errorCode, static_cast<int>(errorInfo.retCode));
-    };
-    handler->onCompleted = [this] (const http::RequestInfo& info) {
-        if (info.tag == kM3u8Tag) {
-            handleM3u8Completed();
-        } else {
-            uint32_t tsIndex = 0;
-            if (!parseTsTag(info.tag, tsIndex)) {
-                LogE("error tag:{}", info.tag);
-                return;
+            http::ErrorInfo errorInfo;
+            errorInfo.errorCode = static_cast<int>(header.httpStatusCode);
+            errorInfo.retCode = http::ResultCode::ConnectGenericError;
+            handleError(errorInfo);
+            LogE("{}, http code:{} error code:{}", info.tag, errorInfo.errorCode, static_cast<int>(errorInfo.retCode));
+        };
+        handler->onData = [this] (const http::RequestInfo& info,
+                                  DataPtr data) {
+            if (info.tag == kM3u8Tag) {
+                handleM3u8Data(std::move(data));
+            } else {
+                uint32_t tsIndex = 0;
+                uint32_t partIndex = kInvalidIndex;
+                if (!parseTsTag(info.tag, tsIndex, partIndex)) {
+                    LogE("error tag:{}", info.tag);
+                    return;
+                }
+                handleTSData(tsIndex, std::move(data));
             }
-            handleTSCompleted(tsIndex);
-        }
-    };
-    
-    requestSession_ = std::make_unique<http::RequestSession>(std::move(handler));
+        };
+        handler->onError = [this] (const http::RequestInfo& info,
+                                   http::ErrorInfo errorInfo) {
+            handleError(errorInfo);
+            LogE("{}, http code:{} error code:{}", info.tag, errorInfo.errorCode, static_cast<int>(errorInfo.retCode));
+        };
+        handler->onCompleted = [this] (const http::RequestInfo& info) {
+            if (info.tag == kM3u8Tag) {
+                handleM3u8Completed();
+            } else {
+                uint32_t tsIndex = 0;
+                uint32_t partIndex = kInvalidIndex;
+                if (!parseTsTag(info.tag, tsIndex, partIndex)) {
+                    LogE("error tag:{}", info.tag);
+                    return;
+                }
+                handleTSCompleted(tsIndex, partIndex);
+            }
+        };
+        requestSessions_.push_back(std::make_unique<http::RequestSession>(std::move(handler)));
+    }
 }
 
 bool HLSReader::open(ReaderTaskPtr task) noexcept {
@@ -172,7 +303,7 @@ bool HLSReader::open(ReaderTaskPtr task) noexcept {
     return true;
 }
 
-void HLSReader::sendTSRequest(uint32_t index, const std::string& url, Range range) noexcept {
+void HLSReader::sendTSRequest(uint32_t index, const std::string& url, Range range, uint32_t partIndex) noexcept {
     auto info = std::make_unique<http::RequestInfo>();
     info->url = url;
     info->methodType = http::HttpMethodType::Get;
@@ -180,16 +311,22 @@ void HLSReader::sendTSRequest(uint32_t index, const std::string& url, Range rang
         info->headers["Range"] = range.toHeaderString();
     }
     
-    info->tag = std::format("{}_{}", kTsTag, std::to_string(index));
-    receiveLength_ = range.start();
+    info->tag = std::format("{}_{}", kTsTag, index);
+    if (partIndex != kInvalidIndex) {
+        info->tag += std::format("_{}", partIndex);
+    }
     addRequest(std::move(info));
-    LogI("send ts request:{}, url:{}, range:{}", index, url, range.toString());
+    LogI("send ts request:{}, part:{}, url:{}, range:{}", index, static_cast<int64_t>(partIndex), url, range.toString());
 }
 
 void HLSReader::updateReadRange(Range) noexcept {
     //nothing
 }
 
+bool HLSReader::readAt(uint64_t, uint64_t, ReadAtCallBack) noexcept {
+    return false;
+}
+
 IOState HLSReader::state() noexcept {
     if (isClosed_) {
         return IOState::Closed;
@@ -214,16 +351,177 @@ void HLSReader::setDemuxer(std::shared_ptr<HLSDemuxer> demuxer) noexcept {
     demuxer_ = std::move(demuxer);
 }
 
+void HLSReader::setBufferTimeFunc(std::function<double()> func) noexcept {
+    bufferTimeFunc_.withLock([&func](auto& bufferTimeFunc) {
+        bufferTimeFunc = std::move(func);
+    });
+}
+
+void HLSReader::setAbrStrategy(std::unique_ptr<IAbrStrategy> strategy) noexcept {
+    abrController_.setStrategy(std::move(strategy));
+}
+
+void HLSReader::setCacheTime(double minCacheTime, double maxCacheTime) noexcept {
+    std::lock_guard<std::mutex> lock(segmentMutex_);
+    minCacheTime_ = minCacheTime;
+    maxCacheTime_ = maxCacheTime;
+}
+
+uint32_t HLSReader::prefetchCount(const std::vector<TSInfo>& tsInfos) const noexcept {
+    double duration = 0.0;
+    for (const auto& info : tsInfos) {
+        duration += info.duration;
+    }
+    if (tsInfos.empty() || duration <= 0.0) {
+        return 1;
+    }
+    auto segmentDuration = duration / static_cast<double>(tsInfos.size());
+    //enough in flight to refill the low watermark at once, never more than the player keeps
+    auto count = static_cast<uint32_t>(std::ceil(minCacheTime_ / segmentDuration));
+    auto maxCount = std::max(static_cast<uint32_t>(maxCacheTime_ / segmentDuration), 1u);
+    return std::clamp(count, 1u, std::min(maxCount, kMaxPrefetchCount));
+}
+
 void HLSReader::fetchTSData(uint32_t tsIndex) noexcept {
-    const auto& tsInfos = demuxer_->getTSInfos();
-    if (tsIndex >= tsInfos.size()) {
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex_);
+        segments_.clear();
+        fetchIndex_ = tsIndex;
+        deliverIndex_ = tsIndex;
+    }
+    prefetch();
+}
+
+void HLSReader::prefetch() noexcept {
+    std::lock_guard<std::mutex> lock(segmentMutex_);
+    uint32_t size = 0;
+    uint32_t count = 1;
+    {
+        std::lock_guard<std::mutex> taskLock(taskMutex_);
+        if (!demuxer_) {
+            return;
+        }
+        demuxer_->withTSInfos([&](const auto& infos) {
+            size = static_cast<uint32_t>(infos.size());
+            count = prefetchCount(infos);
+        });
+    }
+    if (deliverIndex_ >= size && !isLive_) {
         isCompleted_ = true;
         LogI("hls read completed");
         return;
     }
-    LogI("fetchTSData:{}", tsIndex);
-    const auto& info = tsInfos[tsIndex];
-    sendTSRequest(tsIndex, info.url, info.range);
+    while (pendingVariant_ == kInvalidIndex && fetchIndex_ < deliverIndex_ + count) {
+        if (fetchIndex_ >= size) {
+            if (isLive_) {
+                std::vector<TSPart> parts;
+                {
+                    std::lock_guard<std::mutex> taskLock(taskMutex_);
+                    parts = demuxer_->openParts();
+                }
+                fetchPart(fetchIndex_, parts, false);
+            }
+            break;
+        }
+        if (abrController_.variantCount() > 1 && !isLive_) {
+            //switch at the segment boundary, variants of a master play list are aligned by index
+            auto variant = abrController_.select(bufferTime());
+            if (variant != abrController_.currentIndex()) {
+                loadVariant(variant);
+                if (variant != abrController_.currentIndex()) {
+                    //requests go on once its play list is loaded
+                    break;
+                }
+            }
+        }
+        TSInfo info;
+        {
+            std::lock_guard<std::mutex> taskLock(taskMutex_);
+            info = demuxer_->withTSInfos([this](const auto& infos) {
+                return infos[fetchIndex_];
+            });
+        }
+        if (auto it = segments_.find(fetchIndex_); it != segments_.end() && it->second.partCount > 0) {
+            //started from its parts before it was listed, it goes on that way
+            if (!fetchPart(fetchIndex_, info.parts, true)) {
+                break;
+            }
+            fetchIndex_++;
+            continue;
+        }
+        auto& segment = segments_[fetchIndex_];
+        segment.offset = info.range.start();
+        segment.startTime = std::chrono::steady_clock::now();
+        LogI("fetchTSData:{}", fetchIndex_);
+        sendTSRequest(fetchIndex_, info.url(), info.range);
+        fetchIndex_++;
+    }
+}
+
+bool HLSReader::fetchPart(uint32_t tsIndex, const std::vector<TSPart>& parts, bool isListed) noexcept {
+    auto& segment = segments_[tsIndex];
+    if (segment.isPartLoading) {
+        return false;
+    }
+    if (segment.partCount < parts.size()) {
+        const auto& part = parts[segment.partCount];
+        if (segment.partCount == 0) {
+            segment.offset = part.range.start();
+            segment.startTime = std::chrono::steady_clock::now();
+        }
+        segment.isPartLoading = true;
+        sendTSRequest(tsIndex, part.url, part.range, segment.partCount);
+        segment.partCount++;
+        return false;
+    }
+    if (!isListed) {
+        return false;
+    }
+    if (segment.partCount > parts.size()) {
+        LogE("ts:{} lists {} parts, {} were received", tsIndex, parts.size(), segment.partCount);
+    }
+    segment.isCompleted = true;
+    deliverSegments();
+    return true;
+}
+
+void HLSReader::scheduleRefresh() noexcept {
+    if (!isLive_ || isClosed_) {
+        return;
+    }
+    std::chrono::milliseconds interval{0};
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!demuxer_) {
+            return;
+        }
+        interval = demuxer_->refreshInterval();
+    }
+    if (interval.count() == 0) {
+        refreshPlayList();
+        return;
+    }
+    refreshTimerId_.withLock([this, interval](auto& timerId) {
+        timerId = TimerManager::shareInstance().runAfter(interval, [this] {
+            refreshPlayList();
+        });
+    });
+}
+
+void HLSReader::refreshPlayList() noexcept {
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (!demuxer_ || !demuxer_->isLive()) {
+            return;
+        }
+        url = demuxer_->prepareRefresh();
+    }
+    if (url.empty()) {
+        return;
+    }
+    isRefreshing_ = true;
+    sendM3u8Request(url);
 }
 
 void HLSReader::reset() noexcept {
@@ -231,15 +529,31 @@ void HLSReader::reset() noexcept {
     isErrorOccurred_ = false;
     {
         std::lock_guard<std::mutex> lock(requestMutex_);
-        requestSession_->close();
-        requestSession_.reset();
+        for (auto& session : requestSessions_) {
+            session->close();
+        }
+        requestSessions_.clear();
     }
     {
         std::lock_guard<std::mutex> lock(taskMutex_);
         task_.reset();
         demuxer_.reset();
     }
-    receiveLength_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex_);
+        segments_.clear();
+        fetchIndex_ = 0;
+        deliverIndex_ = 0;
+    }
+    pendingVariant_ = kInvalidIndex;
+    isStarted_ = false;
+    isLive_ = false;
+    isRefreshing_ = false;
+    refreshTimerId_.withLock([](auto& timerId) {
+        TimerManager::shareInstance().cancel(timerId);
+        timerId = TimerId();
+    });
+    abrController_.reset();
     requestTasks_.withLock([](auto& tasks) {
         tasks.clear();
     });
@@ -275,16 +589,25 @@ uint64_t HLSReader::size() noexcept {
 
 void HLSReader::seek(uint64_t pos) noexcept {
     setupDataProvider();
+    //the dropped play list response may have left half a line
+    m3u8Buffer_->reset();
     requestTasks_.withLock([](auto& tasks) {
         tasks.clear();
     });
+    //a loading variant play list is dropped with its session, the current variant goes on
+    pendingVariant_ = kInvalidIndex;
+    if (isRefreshing_.exchange(false)) {
+        scheduleRefresh();
+    }
     auto tsIndex = static_cast<size_t>(pos);
-    const auto& infos = demuxer_->getTSInfos();
-    if (0 <= tsIndex && tsIndex < infos.size()) {
+    auto tsCount = demuxer_->withTSInfos([](const auto& infos) {
+        return infos.size();
+    });
+    if (tsIndex < tsCount) {
         fetchTSData(static_cast<uint32_t>(tsIndex));
         worker_.start();
     } else {
-        LogE("seek error:{}, info size:{}", tsIndex, infos.size());
+        LogE("seek error:{}, info size:{}", tsIndex, tsCount);
     }
     LogI("seek to ts index:{}", tsIndex);
 }
@@ -299,12 +622,9 @@ void HLSReader::addRequest(http::RequestInfoPtr task) noexcept {
 }
 
 void HLSReader::sendRequest() noexcept {
-    {
-        std::lock_guard<std::mutex> lock(requestMutex_);
-        if ((requestSession_ && requestSession_->isBusy()) || isPause_ || isErrorOccurred_) {
-            worker_.pause();
-            return;
-        }
+    if (isPause_ || isErrorOccurred_) {
+        worker_.pause();
+        return;
     }
     http::RequestInfoPtr task = nullptr;
     requestTasks_.withLock([&task](auto& tasks){
@@ -318,8 +638,18 @@ void HLSReader::sendRequest() noexcept {
         return;
     }
     isErrorOccurred_ = false;
+    //a segment is requested after the one a window ahead of it completed, so its session is idle.
+    //play lists have their own session, a blocking live reload does not hold up segments
+    uint32_t sessionIndex = kMaxPrefetchCount;
+    uint32_t tsIndex = 0;
+    uint32_t partIndex = kInvalidIndex;
+    if (task->tag != kM3u8Tag && parseTsTag(task->tag, tsIndex, partIndex)) {
+        sessionIndex = tsIndex % kMaxPrefetchCount;
+    }
     std::lock_guard<std::mutex> lock(requestMutex_);
-    requestSession_->request(std::move(task));
+    if (sessionIndex < requestSessions_.size()) {
+        requestSessions_[sessionIndex]->request(std::move(task));
+    }
 }
 
 }
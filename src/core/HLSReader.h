@@ -6,7 +6,9 @@
 //
 #pragma once
 
+#include <map>
 #include "IReader.h"
+#include "AbrController.h"
 #include "Buffer.hpp"
 #include "HLSDemuxer.h"
 #include "Thread.h"
@@ -19,7 +21,23 @@ enum class HLSRequestTaskType {
     TS
 };
 
+///a ts that is requested and not yet handed to the demuxer
+struct HLSSegment {
+    bool isCompleted = false;
+    ///offset of the next data handed out
+    uint64_t offset = 0;
+    ///bytes received, for the throughput
+    uint64_t length = 0;
+    std::chrono::steady_clock::time_point startTime;
+    ///received before the segments ahead of it were handed out
+    std::vector<DataPtr> datas;
+    ///a live segment fetched part by part, the parts requested so far
+    uint32_t partCount = 0;
+    bool isPartLoading = false;
+};
+
 class HLSReader : public IReader {
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
 public:
     HLSReader();
     
@@ -46,8 +64,19 @@ public:
     void seek(uint64_t pos) noexcept override;
     
     uint64_t size() noexcept override;
+
+    ///segments are not addressed by a file offset, always false
+    bool readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept override;
     
     void setDemuxer(std::shared_ptr<HLSDemuxer> demuxer) noexcept;
+
+    ///seconds buffered ahead of playback, used to pick the variant of a master play list
+    void setBufferTimeFunc(std::function<double()> func) noexcept;
+
+    void setAbrStrategy(std::unique_ptr<IAbrStrategy> strategy) noexcept;
+
+    ///cache targets of the player, they bound how many segments are requested ahead
+    void setCacheTime(double minCacheTime, double maxCacheTime) noexcept;
 private:
     void setupDataProvider() noexcept;
 
@@ -55,11 +84,36 @@ private:
 
     void sendRequest() noexcept;
 
+    ///restart the segment pipeline at the ts index
     void fetchTSData(uint32_t tsIndex) noexcept;
 
+    ///request segments until the prefetch window is full
+    void prefetch() noexcept;
+
+    ///request the next part of a live segment, true once all parts of the listed segment are received.
+    ///segmentMutex_ must be held
+    bool fetchPart(uint32_t tsIndex, const std::vector<TSPart>& parts, bool isListed) noexcept;
+
+    ///reload a live play list after its refresh interval
+    void scheduleRefresh() noexcept;
+
+    void refreshPlayList() noexcept;
+
+    uint32_t prefetchCount(const std::vector<TSInfo>& tsInfos) const noexcept;
+
+    ///hand out the data of completed segments in order, segmentMutex_ must be held
+    void deliverSegments() noexcept;
+
+    void deliverData(uint32_t tsIndex, HLSSegment& segment, DataPtr dataPtr) noexcept;
+
+    ///the segments from now on come from the variant, its play list is requested first if needed
+    void loadVariant(uint32_t variantIndex) noexcept;
+
+    double bufferTime() noexcept;
+
     void sendM3u8Request(const std::string& m3u8Url) noexcept;
 
-    void sendTSRequest(uint32_t index, const std::string& url, Range range) noexcept;
+    void sendTSRequest(uint32_t index, const std::string& url, Range range, uint32_t partIndex = kInvalidIndex) noexcept;
 
     void handleM3u8Data(DataPtr dataPtr) noexcept;
 
@@ -67,7 +121,7 @@ private:
 
     void handleTSData(uint32_t index, DataPtr dataPtr) noexcept;
 
-    void handleTSCompleted(uint32_t tsIndex) noexcept;
+    void handleTSCompleted(uint32_t tsIndex, uint32_t partIndex) noexcept;
 
     void handleError(const http::ErrorInfo& info) noexcept;
 private:
@@ -75,13 +129,29 @@ private:
     std::atomic_bool isClosed_ = false;
     std::atomic_bool isCompleted_ = false;
     std::atomic_bool isErrorOccurred_ = false;
-    std::atomic<uint64_t> receiveLength_ = 0;
+    std::atomic_bool isStarted_ = false;
+    std::atomic_bool isLive_ = false;
+    std::atomic_bool isRefreshing_ = false;
+    Synchronized<TimerId> refreshTimerId_;
+    ///upper bound of the prefetch window, one session per segment in flight
+    static constexpr uint32_t kMaxPrefetchCount = 4;
+    double minCacheTime_ = 5.0;
+    double maxCacheTime_ = 30.0;
+    std::mutex segmentMutex_;
+    ///the next ts to request and the next ts to hand to the demuxer
+    uint32_t fetchIndex_ = 0;
+    uint32_t deliverIndex_ = 0;
+    std::map<uint32_t, HLSSegment> segments_;
+    ///the variant whose play list is loading, requests wait for it
+    std::atomic<uint32_t> pendingVariant_ = kInvalidIndex;
+    AbrController abrController_;
+    Synchronized<std::function<double()>> bufferTimeFunc_;
     std::mutex requestMutex_;
     std::unique_ptr<Buffer> m3u8Buffer_;
-    std::unique_ptr<http::RequestSession> requestSession_;
+    ///ts index modulo the prefetch count picks the session, m3u8 requests use the last one
+    std::vector<std::unique_ptr<http::RequestSession>> requestSessions_;
     std::shared_ptr<HLSDemuxer> demuxer_;
     Synchronized<std::deque<http::RequestInfoPtr>> requestTasks_;
-    Synchronized<std::unordered_map<std::string, HLSRequestTaskType>> request;
     Thread worker_;
 };
 
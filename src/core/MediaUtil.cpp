@@ -4,16 +4,20 @@
 // Copyright (c) 2022 Nevermore All rights reserved.
 //
 
+#include <algorithm>
 #include <regex>
+#include <vector>
 #include "MediaUtil.h"
+#include "BitReader.h"
+#include "ByteScan.h"
 #include "Log.hpp"
 #include "VideoInfo.h"
 
-#define ReadUINT8(view, offset, count)  static_cast<uint8_t>(Golomb::readBits(view, offset, count))
-
 namespace slark {
 
 constexpr uint32_t kInvalidPos = static_cast<uint32_t>(std::string_view::npos);
+constexpr uint32_t kMaxShortTermRefPicSets = 64;
+constexpr uint32_t kMaxDeltaPocs = 32;
 
 bool isNetworkLink(
     const std::string& path
@@ -61,19 +65,11 @@ int32_t getAACSamplingRate(
 uint32_t findNaluStartCode(
     DataView dataView
 ) noexcept {
-    static const auto func = [](DataView view) {
-        uint32_t p = 0;
-        while(p + 2 < view.length()) {
-            if (view[p + 0] == 0 &&
-                view[p + 1] == 0 &&
-                view[p + 2] == 1) {
-                return p;
-            }
-            p++;
-        }
+    auto res = ByteScan::findStartCode(dataView);
+    if (res == ByteScan::kNotFound) {
         return kInvalidPos;
-    };
-    auto pos = func(dataView);
+    }
+    auto pos = static_cast<uint32_t>(res);
     if (0 < pos && pos < dataView.length() && dataView[pos - 1] == 0) {
         return pos - 1;
     }
@@ -102,127 +98,141 @@ bool findNaluUnit(
 std::tuple<uint32_t, uint32_t> parseAvcSliceType(
     DataView naluView
 ) noexcept {
-    using namespace Util;
-    int32_t offset = 0;
-    auto sliceView = naluView.substr(1);//skip nalu header
-    uint32_t firstMBInSlice = Golomb::readUe(sliceView, offset);
-    uint32_t sliceType = Golomb::readUe(sliceView, offset);
+    BitReader reader(naluView.substr(1)); //skip nalu header
+    uint32_t firstMBInSlice = reader.readUE();
+    uint32_t sliceType = reader.readUE();
     return {firstMBInSlice, sliceType};
 }
 
 std::tuple<uint32_t, uint32_t> parseHevcSliceType(
     DataView naluView,
-    uint8_t naluType
+    uint8_t naluType,
+    uint32_t extraSliceHeaderBits
 ) noexcept {
-    using namespace Util;
-    int32_t offset = 0;
-    auto sliceView = naluView.substr(2); // skip NALU header (2 bytes)
-    // first_slice_segment_in_pic_flag (1 bit)
-    Golomb::readBits(sliceView, offset, 1);
-    // no_output_of_prior_pics_flag (1 bit, only for IDR)
-    if (naluType == 19 || naluType == 20) {
-        Golomb::readBits(sliceView, offset, 1);
-    }
-    // slice_segment_address (UE)
-    uint32_t sliceSegmentAddr = Golomb::readUe(sliceView, offset);
-    // slice_type (UE)
-    uint32_t sliceType = Golomb::readUe(sliceView, offset);
-    return {sliceSegmentAddr, sliceType};
+    BitReader reader(naluView.substr(2)); // skip NALU header (2 bytes)
+    uint32_t firstSliceSegmentInPic = reader.readBits(1); // first_slice_segment_in_pic_flag
+    if (!firstSliceSegmentInPic) {
+        //the segment address needs the sps, a picture takes the type of its first segment
+        return {firstSliceSegmentInPic, kInvalidSliceType};
+    }
+    // no_output_of_prior_pics_flag (1 bit, IRAP only)
+    if (naluType >= 16 && naluType <= 23) {
+        reader.skipBits(1);
+    }
+    reader.readUE(); // slice_pic_parameter_set_id
+    reader.skipBits(extraSliceHeaderBits); // slice_reserved_flag
+    uint32_t sliceType = reader.readUE(); // slice_type
+    if (reader.isError()) {
+        return {firstSliceSegmentInPic, kInvalidSliceType};
+    }
+    return {firstSliceSegmentInPic, sliceType};
+}
+
+uint32_t parseH265ExtraSliceHeaderBits(
+    DataView pps
+) noexcept {
+    BitReader reader(pps.substr(2)); // skip NALU header (2 bytes)
+    reader.readUE(); // pps_pic_parameter_set_id
+    reader.readUE(); // pps_seq_parameter_set_id
+    reader.skipBits(1); // dependent_slice_segments_enabled_flag
+    reader.skipBits(1); // output_flag_present_flag
+    auto bits = reader.readBits(3); // num_extra_slice_header_bits
+    return reader.isError() ? 0 : bits;
 }
 
 void parseHrd(
-    DataView bitstream,
-    int32_t& offset
+    BitReader& reader
 ) {
-    using namespace Util;
-    auto cpbCntMinus1 = Golomb::readUe(bitstream, offset);
-    offset += 4; // bit_rate_scale
-    offset += 4; // cpb_size_scale
+    auto cpbCntMinus1 = reader.readUE();
+    reader.skipBits(4); // bit_rate_scale
+    reader.skipBits(4); // cpb_size_scale
     
-    for (uint32_t i = 0; i < cpbCntMinus1 + 1; i++) {
-        Golomb::readUe(bitstream, offset);
-        Golomb::readUe(bitstream, offset);
-        Golomb::readBits(bitstream, offset, 1);
-    }
-    offset += 5;
-    offset += 5;
-    offset += 5;
-    offset += 5;
+    for (uint32_t i = 0; i < cpbCntMinus1 + 1 && !reader.isError(); i++) {
+        reader.readUE();
+        reader.readUE();
+        reader.skipBits(1);
+    }
+    reader.skipBits(5);
+    reader.skipBits(5);
+    reader.skipBits(5);
+    reader.skipBits(5);
 }
 
 double parseH264Vui(
-    DataView bitstream,
-    int32_t& offset
+    BitReader& reader
 ) {
-    using namespace Util;
     double fps = 0.0;
     do {
-        auto vuiParametersPresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto vuiParametersPresentFlag = reader.readBit();
         if (!vuiParametersPresentFlag) {
             break;
         }
         
-        auto aspectRatioInfoPresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto aspectRatioInfoPresentFlag = reader.readBit();
         // Skip aspect ratio and overscan info for now (can be expanded)
         if (aspectRatioInfoPresentFlag) {
             //aspectRatioIdc
-            auto aspectRatioIdc = Golomb::readBits(bitstream, offset, 8);
+            auto aspectRatioIdc = reader.readBits(8);
             if (aspectRatioIdc == 255) {
-                offset += 16; //sar width
-                offset += 16; //sar height
+                reader.skipBits(16); //sar width
+                reader.skipBits(16); //sar height
             }
         }
         
-        auto overscanInfoPresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto overscanInfoPresentFlag = reader.readBit();
         if (overscanInfoPresentFlag) {
-            offset += 1;
+            reader.skipBits(1);
         }
         
-        auto videoSignalTypePresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto videoSignalTypePresentFlag = reader.readBit();
         if (videoSignalTypePresentFlag) {
             // Skip video_signal_type (can be expanded)
-            offset += 3; //videoFormat
-            offset += 1; //videoFullRangeFlag
-            auto colorFlag = Golomb::readBits(bitstream, offset, 1);
+            reader.skipBits(3); //videoFormat
+            reader.skipBits(1); //videoFullRangeFlag
+            auto colorFlag = reader.readBit();
             if (colorFlag) {
-                offset += 8; //color primaries
-                offset += 8; //transfer character
-                offset += 8; //matrix corfficuents
+                reader.skipBits(8); //color primaries
+                reader.skipBits(8); //transfer character
+                reader.skipBits(8); //matrix corfficuents
             }
         }
         
-        auto chromaInfoFlag = Golomb::readBits(bitstream, offset, 1);
+        auto chromaInfoFlag = reader.readBit();
         if (chromaInfoFlag) {
-            Golomb::readUe(bitstream, offset); //chroma type top field
-            Golomb::readUe(bitstream, offset); //chroma type bottom field
+            reader.readUE(); //chroma type top field
+            reader.readUE(); //chroma type bottom field
         }
         
-        auto frameRateInfoPresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto frameRateInfoPresentFlag = reader.readBit();
         if (frameRateInfoPresentFlag) {
-            auto timeScale = Golomb::readBits(bitstream, offset, 32);
-            uint32_t numUnitsInTick = Golomb::readBits(bitstream, offset, 32);
-            auto fixFlag = Golomb::readBits(bitstream, offset, 1);
-            if (fixFlag) {
+            auto timeScale = reader.readBits(32);
+            uint32_t numUnitsInTick = reader.readBits(32);
+            auto fixFlag = reader.readBit();
+            if (fixFlag && numUnitsInTick != 0) {
                 fps = static_cast<double>(timeScale) / static_cast<double>(numUnitsInTick);
             }
         }
-        auto nalHrdParametersPresentFlag = Golomb::readBits(bitstream, offset, 1); //nal_hrd_parameters_present_flag
+        auto nalHrdParametersPresentFlag = reader.readBit(); //nal_hrd_parameters_present_flag
         if (nalHrdParametersPresentFlag) {
-            parseHrd(bitstream, offset);
+            parseHrd(reader);
         }
-        auto vclHrdParametersPresentFlag = Golomb::readBits(bitstream, offset, 1);
+        auto vclHrdParametersPresentFlag = reader.readBit();
         if (vclHrdParametersPresentFlag) {
-            parseHrd(bitstream, offset);
+            parseHrd(reader);
         }
         
         if (nalHrdParametersPresentFlag || vclHrdParametersPresentFlag) {
-            Golomb::readBits(bitstream, offset, 1);
+            reader.skipBits(1);
         }
-        auto picStructPresentFlag = Golomb::readBits(bitstream, offset, 1);
+        auto picStructPresentFlag = reader.readBit();
         if (picStructPresentFlag) {
             fps /= 2;
         }
     } while (false);
+    if (reader.isError()) {
+        LogE("h264 vui is truncated");
+        return 0;
+    }
     return fps;
 }
 
@@ -231,49 +241,56 @@ void parseH264Sps(
     DataView bitstream,
     const std::shared_ptr<VideoInfo>& videoInfo
 ) noexcept {
-    using namespace Util;
-    bitstream = bitstream.substr(1); //skip header
-    int32_t offset = 0;
-    auto profileIdc = ReadUINT8(bitstream, offset, 8);
-    offset += 8; //skip flags + reserved
+    BitReader reader(bitstream.substr(1)); //skip header
+    auto profileIdc = static_cast<uint8_t>(reader.readBits(8));
+    reader.skipBits(8); //skip flags + reserved
     videoInfo->profile = profileIdc;
-    [[maybe_unused]] auto levelIdc = ReadUINT8(bitstream, offset, 8);
+    [[maybe_unused]] auto levelIdc = static_cast<uint8_t>(reader.readBits(8));
     videoInfo->level = levelIdc;
-    [[maybe_unused]] uint32_t seqParameterSetId = Golomb::readUe(bitstream, offset);
+    [[maybe_unused]] uint32_t seqParameterSetId = reader.readUE();
     uint32_t chromaFormatIdc = 1; //default 420
     static const std::vector<uint8_t> kSpecialProfile = {100, 110, 122, 244, 44, 83, 86, 118, 128};
     if (std::find(kSpecialProfile.begin(), kSpecialProfile.end(), profileIdc) != kSpecialProfile.end()) {
-        chromaFormatIdc = Golomb::readUe(bitstream, offset);
+        chromaFormatIdc = reader.readUE();
         if (chromaFormatIdc == 3) {
-            offset += 1; //separate_colour_plane_flag
+            reader.skipBits(1); //separate_colour_plane_flag
         }
-        Golomb::readUe(bitstream, offset); // bit_depth_luma_minus8
-        Golomb::readUe(bitstream, offset); // bit_depth_chroma_minus8
-        offset += 1;// qpprime_y_zero_transform_bypass_flag
-        auto seqScalingMatrixPresentFlag = Golomb::readBits(bitstream, offset, 1);// seq_scaling_matrix_present_flag
+        reader.readUE(); // bit_depth_luma_minus8
+        reader.readUE(); // bit_depth_chroma_minus8
+        reader.skipBits(1);// qpprime_y_zero_transform_bypass_flag
+        auto seqScalingMatrixPresentFlag = reader.readBit();// seq_scaling_matrix_present_flag
         if (seqScalingMatrixPresentFlag) {
             for (auto i = 0; i < (chromaFormatIdc != 3 ? 8 : 12); i++) {
-                seqScalingMatrixPresentFlag = Golomb::readBits(bitstream, offset, 1);// seq_scaling_list_present_flag
-                if (seqScalingMatrixPresentFlag) {
-                    auto count = i < 6 ? 4 : 8;
-                    offset += count * count;
+                auto seqScalingListPresentFlag = reader.readBit();// seq_scaling_list_present_flag
+                if (seqScalingListPresentFlag) {
+                    //scaling_list(), delta_scale is se(v)
+                    int32_t lastScale = 8;
+                    int32_t nextScale = 8;
+                    auto count = i < 6 ? 16 : 64;
+                    for (auto j = 0; j < count && nextScale != 0; j++) {
+                        nextScale = (lastScale + reader.readSE() + 256) % 256;
+                        lastScale = nextScale == 0 ? lastScale : nextScale;
+                    }
                 }
             }
         }
     }
     
     // Additional fields (Chroma Format, Bit Depth, etc.) would be here
-    [[maybe_unused]] uint32_t log2MaxFrameNumMinus4 = Golomb::readUe(bitstream, offset);
-    uint32_t picOrderCntType = Golomb::readUe(bitstream, offset);
+    [[maybe_unused]] uint32_t log2MaxFrameNumMinus4 = reader.readUE();
+    uint32_t picOrderCntType = reader.readUE();
 
     if (picOrderCntType == 0) {
-        uint32_t log2MaxPicOrderCntLsbMinus4 = Golomb::readUe(bitstream, offset);
+        uint32_t log2MaxPicOrderCntLsbMinus4 = reader.readUE();
         LogI("log2MaxPicOrderCntLsbMinus4:{}", log2MaxPicOrderCntLsbMinus4);
     } else if (picOrderCntType == 1) {
-        auto deltaPicOrderAlwaysZeroFlag = ReadUINT8(bitstream, offset, 1);
-        auto offsetForNonRefPic = static_cast<int32_t>(Golomb::readUe(bitstream, offset));
-        auto offsetForTopToBottomField = static_cast<int32_t>(Golomb::readUe(bitstream, offset));
-        auto numRefFramesInPicOrderCntCycle = Golomb::readUe(bitstream, offset);
+        auto deltaPicOrderAlwaysZeroFlag = reader.readBit();
+        auto offsetForNonRefPic = reader.readSE();
+        auto offsetForTopToBottomField = reader.readSE();
+        auto numRefFramesInPicOrderCntCycle = reader.readUE();
+        for (uint32_t i = 0; i < numRefFramesInPicOrderCntCycle && !reader.isError(); i++) {
+            reader.readSE(); //offset_for_ref_frame
+        }
 
         LogI("deltaPicOrderAlwaysZeroFlag:{}, offsetForNonRefPic:{}, "
              "offsetForTopToBottomField:{}, numRefFramesInPicOrderCntCycle:{}",
@@ -281,10 +298,14 @@ void parseH264Sps(
              offsetForTopToBottomField, numRefFramesInPicOrderCntCycle);
     }
 
-    uint32_t numRefFrames = Golomb::readUe(bitstream, offset);
-    [[maybe_unused]] auto gapsInFrameNumValueAllowedFlag = ReadUINT8(bitstream, offset, 1);
-    uint32_t picWidthInMbsMinus1 = Golomb::readUe(bitstream, offset);
-    uint32_t picHeightInMapUnitsMinus1 = Golomb::readUe(bitstream, offset);
+    uint32_t numRefFrames = reader.readUE();
+    [[maybe_unused]] auto gapsInFrameNumValueAllowedFlag = reader.readBit();
+    uint32_t picWidthInMbsMinus1 = reader.readUE();
+    uint32_t picHeightInMapUnitsMinus1 = reader.readUE();
+    if (reader.isError()) {
+        LogE("h264 sps is truncated");
+        return;
+    }
 
     LogI("numRefFrames:{}, picWidthInMbsMinus1:{}, picHeightInMapUnitsMinus1:{}", numRefFrames, picWidthInMbsMinus1, picHeightInMapUnitsMinus1);
 
@@ -294,17 +315,17 @@ void parseH264Sps(
     videoInfo->width = width;
     videoInfo->height = height;
 
-    auto frameMbsOnlyFlag = Golomb::readBits(bitstream, offset, 1); //frame_mbs_only_flag
+    auto frameMbsOnlyFlag = reader.readBits(1); //frame_mbs_only_flag
     if (frameMbsOnlyFlag == 0) {
-        offset += 1;
+        reader.skipBits(1);
     }
-    offset += 1; //skip direct_8x8_inference_flag
-    auto cropFlag = Golomb::readBits(bitstream, offset, 1);
+    reader.skipBits(1); //skip direct_8x8_inference_flag
+    auto cropFlag = reader.readBit();
     if (cropFlag) {
-        auto leftOffset = Golomb::readUe(bitstream, offset);
-        auto rightOffset = Golomb::readUe(bitstream, offset);
-        auto topOffset = Golomb::readUe(bitstream, offset);
-        auto bottomOffset = Golomb::readUe(bitstream, offset);
+        auto leftOffset = reader.readUE();
+        auto rightOffset = reader.readUE();
+        auto topOffset = reader.readUE();
+        auto bottomOffset = reader.readUE();
         
         unsigned int subWidth = 2;
         unsigned int subHeight = 2;
@@ -329,22 +350,49 @@ void parseH264Sps(
     }
     // Parse VUI for FPS
     LogI("width:{}, height:{}", width, height);
-    videoInfo->fps = static_cast<uint16_t>(parseH264Vui(bitstream, offset));
+    videoInfo->fps = static_cast<uint16_t>(parseH264Vui(reader));
 }
 
-double parseH265Vui(DataView bitstream, int32_t& offset) noexcept {
-    using namespace Util;
+double parseH265Vui(BitReader& reader) noexcept {
     do {
-        auto vuiParametersPresentFlag = ReadUINT8(bitstream, offset, 1);
+        auto vuiParametersPresentFlag = reader.readBit();
         if (!vuiParametersPresentFlag) {
             break;
         }
-        auto frameRateInfoPresentFlag = ReadUINT8(bitstream, offset, 1);
-        if (!frameRateInfoPresentFlag) {
+        if (reader.readBit()) { // aspect_ratio_info_present_flag
+            constexpr uint32_t kExtendedSar = 255;
+            if (reader.readBits(8) == kExtendedSar) { // aspect_ratio_idc
+                reader.skipBits(32); // sar_width, sar_height
+            }
+        }
+        if (reader.readBit()) { // overscan_info_present_flag
+            reader.skipBits(1); // overscan_appropriate_flag
+        }
+        if (reader.readBit()) { // video_signal_type_present_flag
+            reader.skipBits(4); // video_format, video_full_range_flag
+            if (reader.readBit()) { // colour_description_present_flag
+                reader.skipBits(24); // colour_primaries, transfer_characteristics, matrix_coeffs
+            }
+        }
+        if (reader.readBit()) { // chroma_loc_info_present_flag
+            reader.readUE(); // chroma_sample_loc_type_top_field
+            reader.readUE(); // chroma_sample_loc_type_bottom_field
+        }
+        reader.skipBits(3); // neutral_chroma_indication_flag, field_seq_flag, frame_field_info_present_flag
+        if (reader.readBit()) { // default_display_window_flag
+            for (int i = 0; i < 4; i++) {
+                reader.readUE(); // def_disp_win_*_offset
+            }
+        }
+        auto timingInfoPresentFlag = reader.readBit(); // vui_timing_info_present_flag
+        if (!timingInfoPresentFlag) {
+            break;
+        }
+        uint32_t numUnitsInTick = reader.readBits(32);
+        uint32_t timeScale = reader.readBits(32);
+        if (reader.isError() || numUnitsInTick == 0) {
             break;
         }
-        uint32_t timeScale = Golomb::readBits(bitstream, offset, 32);
-        uint32_t numUnitsInTick = Golomb::readBits(bitstream, offset, 32);
 
         auto fps = static_cast<double>(timeScale) / numUnitsInTick;
         LogI("Frame rate (fps):{} ", fps);
@@ -354,98 +402,185 @@ double parseH265Vui(DataView bitstream, int32_t& offset) noexcept {
 }
 
 void profileTierLevel(
-    DataView bitstream,
-    int32_t& offset,
+    BitReader& reader,
     uint8_t profilePresentFlag,
     uint32_t maxNumSubLayersMinus
 ) {
-    using namespace Util;
     if (profilePresentFlag) {
-        offset += 2; // general_profile_space
-        offset += 1; // general_tier_flag
-        offset += 5; //generalProfileIdc
-        offset += 5; // general_profile_idc
-        offset += 32;// general_profile_compatibility_flags
+        reader.skipBits(2); // general_profile_space
+        reader.skipBits(1); // general_tier_flag
+        reader.skipBits(5); // general_profile_idc
+        reader.skipBits(32);// general_profile_compatibility_flags
         
-        offset += 1; // general_progressive_source_flag
-        offset += 1; // general_interlaced_source_flag
-        offset += 1; // general_non_packed_constraint_flag
-        offset += 1; // general_frame_only_constraint_flag
+        reader.skipBits(1); // general_progressive_source_flag
+        reader.skipBits(1); // general_interlaced_source_flag
+        reader.skipBits(1); // general_non_packed_constraint_flag
+        reader.skipBits(1); // general_frame_only_constraint_flag
 
-        offset += 43; // general_reserved_zero_43bits
+        reader.skipBits(43); // general_reserved_zero_43bits
         
-        offset += 1; // general_reserved_zero_bit
+        reader.skipBits(1); // general_reserved_zero_bit
     }
 
-    offset += 8; // general_level_idc
+    reader.skipBits(8); // general_level_idc
 
     std::vector<uint32_t> subLayerProfilePresentFlags;
     for (uint32_t i = 0; i < maxNumSubLayersMinus; i++) {
-        auto subLayerProfilePresentFlag = Util::Golomb::readBits(bitstream, offset, 1);
-        offset += 1; // sub_layer_level_present_flag
+        auto subLayerProfilePresentFlag = reader.readBits(1);
+        reader.skipBits(1); // sub_layer_level_present_flag
         subLayerProfilePresentFlags.push_back(subLayerProfilePresentFlag);
     }
 
     if (maxNumSubLayersMinus > 0) {
         for (auto i = maxNumSubLayersMinus; i < 8; i++) {
-            offset += 2; // reserved_zero_2bits
+            reader.skipBits(2); // reserved_zero_2bits
         }
     }
 
     for (uint32_t i = 0; i < maxNumSubLayersMinus; i++) {
         if (subLayerProfilePresentFlags[i]) {
-            offset += 2; // sub_layer_profile_space
-            offset += 1; // sub_layer_tier_flag
-            offset += 5; // sub_layer_profile_idc
-            offset += 32; // sub_layer_profile_compatibility_flag
-            offset += 1; // sub_layer_progressive_source_flag
-            offset += 1; // sub_layer_interlaced_source_flag
-            offset += 1; // sub_layer_non_packed_constraint_flag
-            offset += 1; // sub_layer_frame_only_constraint_flag
-
-            offset += 43; // sub_layer_reserved_zero_43bits
-
-            offset += 1; // sub_layer_reserved_zero_bit
-            offset += 8; // sub_layer_level_idc
+            reader.skipBits(2); // sub_layer_profile_space
+            reader.skipBits(1); // sub_layer_tier_flag
+            reader.skipBits(5); // sub_layer_profile_idc
+            reader.skipBits(32); // sub_layer_profile_compatibility_flag
+            reader.skipBits(1); // sub_layer_progressive_source_flag
+            reader.skipBits(1); // sub_layer_interlaced_source_flag
+            reader.skipBits(1); // sub_layer_non_packed_constraint_flag
+            reader.skipBits(1); // sub_layer_frame_only_constraint_flag
+
+            reader.skipBits(43); // sub_layer_reserved_zero_43bits
+
+            reader.skipBits(1); // sub_layer_reserved_zero_bit
+            reader.skipBits(8); // sub_layer_level_idc
         }
     }
 }
 
+void skipScalingListData(
+    BitReader& reader
+) noexcept {
+    for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+        for (uint32_t matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1) {
+            if (!reader.readBit()) { // scaling_list_pred_mode_flag
+                reader.readUE(); // scaling_list_pred_matrix_id_delta
+                continue;
+            }
+            auto coefNum = std::min<uint32_t>(64, 1u << (4 + (sizeId << 1)));
+            if (sizeId > 1) {
+                reader.readSE(); // scaling_list_dc_coef_minus8
+            }
+            for (uint32_t i = 0; i < coefNum && !reader.isError(); i++) {
+                reader.readSE(); // scaling_list_delta_coef
+            }
+        }
+    }
+}
+
+//return NumDeltaPocs of the set, the sets before it are needed by inter prediction
+uint32_t skipShortTermRefPicSet(
+    BitReader& reader,
+    uint32_t index,
+    const std::vector<uint32_t>& numDeltaPocs
+) noexcept {
+    if (index != 0 && reader.readBit()) { // inter_ref_pic_set_prediction_flag
+        reader.skipBits(1); // delta_rps_sign
+        reader.readUE(); // abs_delta_rps_minus1
+        uint32_t count = 0;
+        //in a sps the reference set is always the previous one
+        for (uint32_t j = 0; j <= numDeltaPocs[index - 1] && !reader.isError(); j++) {
+            auto usedByCurrPicFlag = reader.readBit(); // used_by_curr_pic_flag
+            if (usedByCurrPicFlag || reader.readBit()) { // use_delta_flag
+                count++;
+            }
+        }
+        return count;
+    }
+    auto numNegativePics = reader.readUE(); // num_negative_pics
+    auto numPositivePics = reader.readUE(); // num_positive_pics
+    auto count = static_cast<uint64_t>(numNegativePics) + numPositivePics;
+    for (uint64_t i = 0; i < count && !reader.isError(); i++) {
+        reader.readUE(); // delta_poc_s0_minus1 or delta_poc_s1_minus1
+        reader.skipBits(1); // used_by_curr_pic_s0_flag or used_by_curr_pic_s1_flag
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(count, kMaxDeltaPocs));
+}
+
 void parseH265Sps(
     DataView bitstream,
     const std::shared_ptr<VideoInfo>& videoInfo
 ) noexcept {
-    using namespace Util;
-    int32_t offset = 0;
-    offset += 8;//skip header
-    offset += 4;//sps_video_parameter_set_id
-    auto maxSubLayers = Golomb::readBits(bitstream, offset, 3);//sps_max_sub_layers_minus1
-    offset += 1;//sps_temporal_id_nesting_flag
-    profileTierLevel(bitstream, offset, 1, maxSubLayers);
+    BitReader reader(bitstream);
+    reader.skipBits(16);//skip header
+    reader.skipBits(4);//sps_video_parameter_set_id
+    auto maxSubLayers = reader.readBits(3);//sps_max_sub_layers_minus1
+    reader.skipBits(1);//sps_temporal_id_nesting_flag
+    profileTierLevel(reader, 1, maxSubLayers);
     
-    Golomb::readUe(bitstream, offset);//sps_seq_parameter_set_id
-    auto chromaFormatIdc = Golomb::readUe(bitstream, offset); // chroma_format_idc
+    reader.readUE();//sps_seq_parameter_set_id
+    auto chromaFormatIdc = reader.readUE(); // chroma_format_idc
     uint32_t separateColourPlaneFlag = 0;
-    if (chromaFormatIdc) {
-        separateColourPlaneFlag = Golomb::readBits(bitstream, offset, 1); // separate_colour_plane_flag
+    if (chromaFormatIdc == 3) {
+        separateColourPlaneFlag = reader.readBits(1); // separate_colour_plane_flag
     }
-    uint32_t picWidthInMbsMinus = Golomb::readUe(bitstream, offset);
-    uint32_t picHeightInMapUnitsMinus = Golomb::readUe(bitstream, offset);
-    auto conformanceWindowFlag = Golomb::readBits(bitstream, offset, 1); //conformance_window_flag
+    uint32_t picWidthInLumaSamples = reader.readUE();
+    uint32_t picHeightInLumaSamples = reader.readUE();
+    auto conformanceWindowFlag = reader.readBit(); //conformance_window_flag
     if (conformanceWindowFlag) {
-        auto leftOffset = Golomb::readUe(bitstream, offset);
-        auto rightOffset = Golomb::readUe(bitstream, offset);
-        auto topOffset = Golomb::readUe(bitstream, offset);
-        auto bottomOffset = Golomb::readUe(bitstream, offset);
+        auto leftOffset = reader.readUE();
+        auto rightOffset = reader.readUE();
+        auto topOffset = reader.readUE();
+        auto bottomOffset = reader.readUE();
         auto subWidth = ( (1 == chromaFormatIdc) ||(2 == chromaFormatIdc)) && (0 == separateColourPlaneFlag) ? 2 : 1;
         auto subHeight = (1 == chromaFormatIdc) && (0 == separateColourPlaneFlag) ? 2 : 1;
-        picWidthInMbsMinus  -= (static_cast<uint32_t>(subWidth) * leftOffset + static_cast<uint32_t>(subWidth) * rightOffset);
-        picHeightInMapUnitsMinus -= (static_cast<uint32_t>(subHeight) * topOffset + static_cast<uint32_t>(subHeight) * bottomOffset);
+        picWidthInLumaSamples  -= (static_cast<uint32_t>(subWidth) * leftOffset + static_cast<uint32_t>(subWidth) * rightOffset);
+        picHeightInLumaSamples -= (static_cast<uint32_t>(subHeight) * topOffset + static_cast<uint32_t>(subHeight) * bottomOffset);
+    }
+    if (reader.isError()) {
+        LogE("h265 sps is truncated");
+        return;
+    }
+    videoInfo->width = picWidthInLumaSamples;
+    videoInfo->height = picHeightInLumaSamples;
+
+    //walk to the vui for the frame rate
+    reader.readUE(); // bit_depth_luma_minus8
+    reader.readUE(); // bit_depth_chroma_minus8
+    auto log2MaxPocLsb = reader.readUE() + 4; // log2_max_pic_order_cnt_lsb_minus4
+    auto subLayerOrderingInfoPresentFlag = reader.readBit();
+    for (auto i = subLayerOrderingInfoPresentFlag ? 0 : maxSubLayers; i <= maxSubLayers; i++) {
+        reader.readUE(); // sps_max_dec_pic_buffering_minus1
+        reader.readUE(); // sps_max_num_reorder_pics
+        reader.readUE(); // sps_max_latency_increase_plus1
+    }
+    //log2_min_luma_coding_block_size_minus3 to max_transform_hierarchy_depth_intra
+    for (int i = 0; i < 6; i++) {
+        reader.readUE();
+    }
+    if (reader.readBit() && reader.readBit()) { // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+        skipScalingListData(reader);
+    }
+    reader.skipBits(2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+    if (reader.readBit()) { // pcm_enabled_flag
+        reader.skipBits(8); // pcm_sample_bit_depth_luma_minus1, pcm_sample_bit_depth_chroma_minus1
+        reader.readUE(); // log2_min_pcm_luma_coding_block_size_minus3
+        reader.readUE(); // log2_diff_max_min_pcm_luma_coding_block_size
+        reader.skipBits(1); // pcm_loop_filter_disabled_flag
+    }
+    auto numShortTermRefPicSets = std::min(reader.readUE(), kMaxShortTermRefPicSets);
+    std::vector<uint32_t> numDeltaPocs;
+    numDeltaPocs.reserve(numShortTermRefPicSets);
+    for (uint32_t i = 0; i < numShortTermRefPicSets && !reader.isError(); i++) {
+        numDeltaPocs.push_back(skipShortTermRefPicSet(reader, i, numDeltaPocs));
+    }
+    if (reader.readBit()) { // long_term_ref_pics_present_flag
+        auto numLongTermRefPics = reader.readUE(); // num_long_term_ref_pics_sps
+        for (uint32_t i = 0; i < numLongTermRefPics && !reader.isError(); i++) {
+            reader.skipBits(log2MaxPocLsb + 1); // lt_ref_pic_poc_lsb_sps, used_by_curr_pic_lt_sps_flag
+        }
     }
-    videoInfo->width = picWidthInMbsMinus;
-    videoInfo->height = picHeightInMapUnitsMinus;
+    reader.skipBits(2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
     // Parse VUI for FPS
-    videoInfo->fps = static_cast<uint16_t>(parseH265Vui(bitstream, offset));
+    videoInfo->fps = reader.isError() ? 0 : static_cast<uint16_t>(parseH265Vui(reader));
 }
 
 }//end namespace slark
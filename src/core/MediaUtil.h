@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <limits>
 #include <string>
 #include <tuple>
 #include "Range.h"
@@ -35,9 +36,19 @@ std::tuple<uint32_t, uint32_t> parseAvcSliceType(
     DataView naluView
 ) noexcept;
 
+///the slice type of a segment that does not start its picture
+constexpr uint32_t kInvalidSliceType = std::numeric_limits<uint32_t>::max();
+
+//first first_slice_segment_in_pic_flag, second slice type (0 B, 1 P, 2 I)
 std::tuple<uint32_t, uint32_t> parseHevcSliceType(
     DataView naluView,
-    uint8_t naluType
+    uint8_t naluType,
+    uint32_t extraSliceHeaderBits = 0
+) noexcept;
+
+///num_extra_slice_header_bits of a pps, needed to reach the slice type
+uint32_t parseH265ExtraSliceHeaderBits(
+    DataView pps
 ) noexcept;
 
 void parseH264Sps(
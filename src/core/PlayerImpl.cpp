@@ -5,6 +5,7 @@
 //  Created by Nevermore on 2022/5/4.
 //
 
+#include <limits>
 #include "Player.h"
 #include "Log.hpp"
 #include "PlayerImpl.h"
@@ -29,6 +30,7 @@ const double kMinCanPlayTime = 0.5; //500ms
 const uint32_t kMaxCacheDecodedVideoFrame = 8;
 const uint32_t kMaxCacheDecodedAudioFrame = 10;
 constexpr double kMinPushDecodeTime = 0.2; //second
+constexpr std::chrono::milliseconds kActiveIdleWaitTime{10}; //render and decode push cadence
 
 Player::Impl::Impl(std::unique_ptr<PlayerParams> params)
     : playerId_(Random::uuid()) {
@@ -106,7 +108,6 @@ void Player::Impl::init() noexcept {
         return;
     }
     ownerThread_ = std::make_unique<Thread>("playerThread", &Player::Impl::process, this);
-    ownerThread_->setInterval(10ms);
     ownerThread_->runLoop(200ms, [this](){
         if (state() == PlayerState::Playing) {
             notifyPlayedTime();
@@ -151,6 +152,7 @@ bool Player::Impl::setupDataProvider() noexcept {
             self->dataList_.withLock([&](auto& dataList) {
                 dataList.emplace_back(std::move(data));
             });
+            self->wakeUpOwner();
         }
         
         if (state == IOState::Error) {
@@ -196,6 +198,7 @@ void Player::Impl::createAudioComponent(
         audioFrames_.withLock([&frame](auto& frames){
             frames.emplace_back(std::move(frame));
         });
+        wakeUpOwner();
     });
     helper_->debugInfo.createAudioDecoderTime = Time::nowTimeStamp();
     if (!audioDecodeComponent_) {
@@ -260,6 +263,7 @@ void Player::Impl::createVideoComponent(
         videoFrames_.withLock([&frame](auto& frames){
             frames.emplace(frame->pts, std::move(frame));
         });
+        wakeUpOwner();
     });
     helper_->debugInfo.createVideoDecoderTime = Time::nowTimeStamp();
     if (!videoDecodeComponent_) {
@@ -291,6 +295,7 @@ void Player::Impl::preparePlayerInfo() noexcept {
         info_.hasAudio = demuxerComponent_->hasAudio();
         info_.hasVideo = demuxerComponent_->hasVideo();
         info_.duration = demuxerComponent_->totalDuration().second();
+        info_.isLive = demuxerComponent_->isLive();
     }
     setState(PlayerState::Prepared);
     PlayerSetting setting;
@@ -423,6 +428,7 @@ bool Player::Impl::createDemuxerComponent() noexcept {
         }
         self->handleAudioPacket(result.audioFrames);
         self->handleVideoPacket(result.videoFrames);
+        self->wakeUpOwner();
         auto cachedDuration = self->demuxedDuration();
         auto playedTime = self->currentPlayedTime();
         auto cacheTime = cachedDuration - playedTime;
@@ -450,6 +456,14 @@ bool Player::Impl::createDemuxerComponent() noexcept {
         LogI("demuxer seek to pos:{}", range.toString());
         self->dataProvider_->updateReadRange(range);
     });
+    demuxerComponent_->setReadAtFunc([weak = weak_from_this()]
+       (uint64_t offset, uint64_t size, ReadAtCallBack callBack) {
+        auto self = weak.lock();
+        if (!self || self->isStopped_ || !self->dataProvider_) {
+            return false;
+        }
+        return self->dataProvider_->readAt(offset, size, std::move(callBack));
+    });
     demuxerComponent_->start();
     return true;
 }
@@ -650,6 +664,7 @@ void Player::Impl::pushAVFrameToRender() noexcept {
 void Player::Impl::process() noexcept {
     handleEvent(receiver_->tryReceiveAll());
     if (isStopped_) {
+        ownerThread_->idle();
         return;
     }
     auto nowState = state();
@@ -659,6 +674,28 @@ void Player::Impl::process() noexcept {
         nowState == PlayerState::Playing) {
         pushAVFrameToRender();
     }
+    //wait for the next event, data or timer, and keep a cadence only while frames have to flow
+    static const std::vector<PlayerState> idleStates = {
+        PlayerState::Ready,
+        PlayerState::Pause,
+        PlayerState::Stop,
+        PlayerState::Completed,
+        PlayerState::Error
+    };
+    auto isIdleState = std::ranges::any_of(idleStates, [nowState](PlayerState state) {
+        return state == nowState;
+    });
+    if (isIdleState && !stats_.isForceVideoRendered && !seekRequest_.isValid()) {
+        ownerThread_->idle();
+    } else {
+        ownerThread_->idle(kActiveIdleWaitTime);
+    }
+}
+
+void Player::Impl::wakeUpOwner() noexcept {
+    if (ownerThread_) {
+        ownerThread_->wakeUp();
+    }
 }
 
 void Player::Impl::doPlay() noexcept {
@@ -1061,6 +1098,7 @@ void Player::Impl::notifyPlayerState(
 
 void Player::Impl::notifyPlayedTime(bool isEndTime) noexcept {
     double time = 0.0;
+    auto duration = info_.isLive ? std::numeric_limits<double>::max() : info_.duration;
     if (!isEndTime) {
         //Here, we specifically do not use the function currentPlayTime,
         //but use render time to print the audio and video synchronization time difference
@@ -1068,15 +1106,15 @@ void Player::Impl::notifyPlayedTime(bool isEndTime) noexcept {
             auto videoTime = videoRenderTime();
             auto audioTime = audioRenderTime();
             time = std::min(videoTime, audioTime);
-            time = std::min(time, info_.duration);
+            time = std::min(time, duration);
             LogI("notifyTime:{}, video time:{}, audio time:{}", time, videoTime, audioTime);
         } else if (info_.hasAudio) {
             time = audioRenderTime();
-            time = std::min(time, info_.duration);
+            time = std::min(time, duration);
             LogI("notifyTime:{} (audio)", time);
         } else if (info_.hasVideo) {
             time = videoRenderTime();
-            time = std::min(time, info_.duration);
+            time = std::min(time, duration);
             LogI("notifyTime:{} (video)", time);
         }
         if (stats_.lastNotifyPlayedTime > 0 &&
@@ -1215,7 +1253,7 @@ void Player::Impl::checkCacheState() noexcept {
         LogI("unable to continue playing:{}", cacheTime);
     } else if (nowState == PlayerState::Buffering) {
         if (isEqualOrGreater(cacheTime, kMinCanPlayTime, 0.1) ||
-            isEqualOrGreater(cachedDuration, info_.duration, 0.1) ||
+            (!info_.isLive && isEqualOrGreater(cachedDuration, info_.duration, 0.1)) ||
             demuxerComponent_->isCompleted()) {
             setState(stats_.resumeAfterBuffering ? PlayerState::Playing : PlayerState::Ready);
             LogI("buffering end, cache time is enough:{}, playing:{}", cacheTime, stats_.resumeAfterBuffering);
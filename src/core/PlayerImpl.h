@@ -123,6 +123,8 @@ private:
     void pushVideoFrameToRender() noexcept;
 
     void process() noexcept;
+
+    void wakeUpOwner() noexcept;
     
     void handleEvent(std::list<EventPtr>&& events) noexcept;
     
@@ -34,16 +34,36 @@ bool PlayerImplHelper::createDataProvider(
         auto demuxer = DemuxerManager::shareInstance().create(DemuxerType::HLS);
         impl->createDemuxerComponent();
         reader->setDemuxer(std::dynamic_pointer_cast<HLSDemuxer>(demuxer));
+        reader->setBufferTimeFunc([weakPlayer = player_]() {
+            auto player = weakPlayer.lock();
+            if (!player) {
+                return 0.0;
+            }
+            return std::max(0.0, player->demuxedDuration() - player->currentPlayedTime());
+        });
+        impl->params_.withReadLock([&reader](auto& params) {
+            if (params) {
+                reader->setCacheTime(params->setting.minCacheTime, params->setting.maxCacheTime);
+            }
+        });
         impl->demuxerComponent_->setDemuxer(std::move(demuxer));
         impl->dataProvider_ = std::move(reader);
     } else if (isNetworkLink(path)) {
         impl->dataProvider_ = std::make_unique<RemoteReader>();
     } else {
+        auto task = std::make_unique<ReaderTask>(ReaderDataCallBack(callback));
+        task->path = path;
+        auto reader = std::make_unique<MmapReader>();
+        if (reader->open(std::move(task))) {
+            impl->dataProvider_ = std::move(reader);
+            return true;
+        }
+        //pipes, special files or no address space left for the mapping, read it the plain way
+        LogI("mmap {} failed, use file reader", path);
         impl->dataProvider_ = std::make_unique<Reader>();
     }
     ReaderTaskPtr task = std::make_unique<ReaderTask>(std::move(callback));
     task->path = path;
-    task->callBack = std::move(callback);
     if (!impl->dataProvider_->open(std::move(task))) {
         LogE("data provider open error!");
     }
@@ -66,7 +86,7 @@ bool PlayerImplHelper::isRenderEnd() noexcept {
     }
 
     auto time = player->currentPlayedTime();
-    if (isEqualOrGreater(time, player->info_.duration)) {
+    if (!player->info_.isLive && isEqualOrGreater(time, player->info_.duration)) {
         LogI("render end, played time:{}, duration:{}", time, player->info_.duration);
         return true;
     }
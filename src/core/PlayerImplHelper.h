@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Reader.h"
+#include "MmapReader.h"
 #include "RemoteReader.h"
 #include "Buffer.hpp"
 #include "Player.h"
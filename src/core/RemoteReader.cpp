@@ -15,6 +15,10 @@ RemoteReader::RemoteReader() {
     type_ = ReaderType::NetWork;
 }
 
+RemoteReader::~RemoteReader() {
+    releaseRangeRequests(true);
+}
+
 IOState RemoteReader::state() noexcept {
     if (!link_) {
         return IOState::Closed;
@@ -31,6 +35,7 @@ void RemoteReader::close() noexcept  {
 }
 
 void RemoteReader::reset() noexcept {
+    releaseRangeRequests(true);
     {
         std::lock_guard<std::mutex> lock(linkMutex_);
         link_.reset();
@@ -200,4 +205,115 @@ void RemoteReader::pause() noexcept {
     }
 }
 
+bool RemoteReader::readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept {
+    if (isClosed_ || size == 0 || !callBack) {
+        return false;
+    }
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex_);
+        if (task_) {
+            url = task_->path;
+        }
+    }
+    if (url.empty()) {
+        return false;
+    }
+    releaseRangeRequests(false);
+
+    auto request = std::make_shared<RangeRequest>();
+    request->offset = offset;
+    request->size = size;
+    request->callBack = std::move(callBack);
+    http::RequestInfo info;
+    info.url = std::move(url);
+    info.methodType = http::HttpMethodType::Get;
+    info.headers["Range"] = Range(offset, static_cast<int64_t>(size)).toHeaderString();
+
+    //the request outlives its link, the handlers can hold a plain pointer
+    auto ptr = request.get();
+    http::ResponseHandler handler;
+    handler.onParseHeaderDone = [this, ptr](const http::RequestInfo&, http::ResponseHeader&& header) {
+        //a server that ignores the range would send the whole file
+        if (header.httpStatusCode != http::HttpStatusCode::PartialContent) {
+            LogE("range request failed, http code:{}", static_cast<int>(header.httpStatusCode));
+            finishRangeRequest(*ptr, false);
+        }
+    };
+    handler.onData = [this, ptr](const http::RequestInfo&, DataPtr data) {
+        if (ptr->isFinished) {
+            return;
+        }
+        if (ptr->data) {
+            ptr->data->append(*data);
+        } else {
+            ptr->data = std::move(data);
+        }
+        if (ptr->data->length >= ptr->size) {
+            ptr->data->length = ptr->size;
+            finishRangeRequest(*ptr, true);
+        }
+    };
+    handler.onCompleted = [this, ptr](const http::RequestInfo&) {
+        finishRangeRequest(*ptr, ptr->data != nullptr);
+    };
+    handler.onError = [this, ptr](const http::RequestInfo&, http::ErrorInfo errorInfo) {
+        LogE("range request error, http code:{} error code:{}", errorInfo.errorCode, static_cast<int>(errorInfo.retCode));
+        finishRangeRequest(*ptr, false);
+    };
+    rangeRequests_.withLock([&](auto& list) {
+        request->link = std::make_unique<http::Request>(std::move(info), std::move(handler));
+        list.push_back(std::move(request));
+    });
+    LogI("read at:{}, size:{}", offset, size);
+    return true;
+}
+
+void RemoteReader::finishRangeRequest(RangeRequest& request, bool isSuccess) noexcept {
+    if (request.isFinished.exchange(true)) {
+        return;
+    }
+    DataPacket packet;
+    packet.offset = static_cast<int64_t>(request.offset);
+    if (isSuccess) {
+        packet.data = std::move(request.data);
+    }
+    request.callBack(std::move(packet));
+    //the link stops reading on its next event, the released request only waits for that
+    rangeRequests_.withLock([&request](auto&) {
+        if (request.link) {
+            request.link->cancel();
+        }
+    });
+    request.isDone = true;
+}
+
+void RemoteReader::releaseRangeRequests(bool isAll) noexcept {
+    std::list<RangeRequestPtr> released;
+    std::list<std::unique_ptr<http::Request>> links;
+    rangeRequests_.withLock([&](auto& list) {
+        for (auto it = list.begin(); it != list.end();) {
+            if (isAll || (*it)->isDone) {
+                if ((*it)->link) {
+                    links.push_back(std::move((*it)->link));
+                }
+                auto next = std::next(it);
+                released.splice(released.end(), list, it);
+                it = next;
+            } else {
+                ++it;
+            }
+        }
+    });
+    //joins the request threads, outside of the lock since their handlers may call readAt
+    for (auto& link : links) {
+        link->cancel();
+        link.reset();
+    }
+    //a cancelled request still reports once
+    for (auto& request : released) {
+        finishRangeRequest(*request, false);
+    }
+}
+
 }
@@ -10,6 +10,7 @@
 #include "IReader.h"
 #include "Synchronized.hpp"
 #include <deque>
+#include <list>
 #include <optional>
 
 namespace slark {
@@ -18,7 +19,7 @@ class RemoteReader : public IReader {
 public:
     RemoteReader();
     
-    ~RemoteReader() override = default;
+    ~RemoteReader() override;
 public:
     bool open(ReaderTaskPtr) noexcept override;
     
@@ -41,6 +42,27 @@ public:
     void start() noexcept override;
 
     void pause() noexcept override;
+
+    ///every range is fetched by a request of its own, the sequential link is not touched
+    bool readAt(uint64_t offset, uint64_t size, ReadAtCallBack callBack) noexcept override;
+private:
+    struct RangeRequest {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        ReadAtCallBack callBack;
+        DataPtr data;
+        std::atomic_bool isFinished = false;
+        ///the callback returned, the request can be released
+        std::atomic_bool isDone = false;
+        ///set and moved out under the lock of rangeRequests_, declared last, released first,
+        ///the request thread is joined before the rest goes away
+        std::unique_ptr<http::Request> link;
+    };
+    using RangeRequestPtr = std::shared_ptr<RangeRequest>;
+
+    ///report once and cancel the link, the rest of a body is not downloaded in the background
+    void finishRangeRequest(RangeRequest& request, bool isSuccess) noexcept;
+    void releaseRangeRequests(bool isAll) noexcept;
 private:
     void handleHeader(http::ResponseHeader&& header) noexcept;
     void handleData(DataPtr) noexcept;
@@ -54,6 +76,7 @@ private:
     std::optional<uint64_t> contentLength_;
     uint64_t receiveLength_ = 0;
     std::unique_ptr<http::Request> link_;
+    Synchronized<std::list<RangeRequestPtr>> rangeRequests_;
 };
 
 }
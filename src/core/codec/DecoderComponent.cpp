@@ -9,12 +9,15 @@
 #include "DecoderConfig.h"
 
 namespace slark {
+using namespace std::chrono_literals;
+
+///how long the worker waits before retrying a decoder that is not ready
+constexpr auto kDecodeRetryInterval = 5ms;
 
 DecoderComponent::DecoderComponent(DecoderReceiveFunc&& callback)
     : callback_(callback)
     , decodeWorker_("decoder", &DecoderComponent::pushFrameDecode, this) {
-    using namespace std::chrono_literals;
-    decodeWorker_.setInterval(5ms);
+
 }
 
 DecoderComponent::~DecoderComponent() {
@@ -95,6 +98,7 @@ bool DecoderComponent::open(
             coder = std::move(decoder);
         });
         isOpened_ = true;
+        decodeWorker_.wakeUp();
         auto workerName = Util::genRandomName(isVideo_ ?
             std::string("videoDecode_") : std::string("audioDecode_"));
         decodeWorker_.setThreadName(workerName);
@@ -106,6 +110,7 @@ bool DecoderComponent::open(
 void DecoderComponent::pushFrameDecode() {
     if (!isOpened_) {
         LogE("{} decoder is not opened", isVideo_ ? "video" : "audio");
+        decodeWorker_.idle(kDecodeRetryInterval);
         return;
     }
     if (empty() && !isInputCompleted_) {
@@ -120,12 +125,16 @@ void DecoderComponent::pushFrameDecode() {
             if (decoder) {
                 isCompleted = decoder->isCompleted();
             }
+            if (!isCompleted) {
+                decodeWorker_.idle(kDecodeRetryInterval);
+            }
             return;
         }
         if (isInputCompleted_ && !decoder->isCompleted()){
             auto eosFrame = buildEOSFrame(decoder->isVideo());
             decoder->decode(eosFrame);
             LogI("push eos frame, {}", isVideo_ ? "video" : "audio");
+            decodeWorker_.idle(kDecodeRetryInterval); //wait for the decoder to drain
             return;
         }
         AVFrameRefPtr frame;
@@ -137,6 +146,7 @@ void DecoderComponent::pushFrameDecode() {
             auto decodeRes = static_cast<int>(decoder->decode(frame));
             if (decodeRes < 0) {
                 LogE("decode error:{}", decodeRes);
+                decodeWorker_.idle(kDecodeRetryInterval);
                 break;
             }
             {
@@ -10,8 +10,7 @@ namespace slark {
 DemuxerComponent::DemuxerComponent(DemuxerConfig config)
     : worker_("DemuxerWorker", &DemuxerComponent::demuxData, this)
     , config_(std::move(config)) {
-    using namespace std::chrono_literals;
-    worker_.setInterval(5ms);
+
 }
 
 DemuxerComponent::~DemuxerComponent() {
@@ -20,11 +19,18 @@ DemuxerComponent::~DemuxerComponent() {
 }
 
 void DemuxerComponent::reset() noexcept {
-    worker_.pause();
+    pause();
     if (auto demuxer = demuxer_.load()) {
         demuxer->close();
     }
     clearData();
+    isWaitingTail_ = false;
+    isTailProbe_ = false;
+    tailList_.withLock([](auto& list) {
+        list.clear();
+    });
+    sideGeneration_++;
+    isSideReading_ = false;
     demuxer_.reset();
     probeBuffer_.reset();
 }
@@ -39,6 +45,7 @@ void DemuxerComponent::start() noexcept {
 }
 
 void DemuxerComponent::pause() noexcept {
+    isStarved_ = false;
     worker_.pause();
 }
 
@@ -48,6 +55,10 @@ bool DemuxerComponent::pushData(std::list<DataPacket>&& dataList) noexcept {
                     std::make_move_iterator(dataList.begin()),
                     std::make_move_iterator(dataList.end()));
     });
+    //resume only a worker that stopped for lack of data, not one paused by the owner
+    if (isStarved_.exchange(false)) {
+        worker_.start();
+    }
     return true;
 }
 
@@ -57,30 +68,119 @@ void DemuxerComponent::demuxData() noexcept {
         clearData();
         return;
     }
-    DataPacket demuxData;
-    dataList_.withLock([&demuxData](auto& list) {
-        if (list.empty()) {
-            return;
-        }
-        demuxData = std::move(list.front());
-        list.pop_front();
-    });
-    if (demuxData.empty()) {
-        worker_.pause();
+    auto demuxer = demuxer_.load();
+    //probing takes one packet at a time, opening may clear or refill the data list
+    auto isBatch = demuxer && demuxer->isOpened();
+    if (!isBatch && isWaitingTail_) {
+        handleTailData();
+        return;
+    }
+    auto dataList = takeData(isBatch);
+    if (dataList.empty()) {
+        waitData();
         return;
     }
     flushed_ = false; // Reset flushed state at the start of demuxing
-    if (auto demuxer = demuxer_.load(); !demuxer || !demuxer->isOpened()) {
-        openDemuxer(demuxData);
-        demuxer = demuxer_.load();
-        if (demuxer == nullptr) {
+    if (!isBatch) {
+        openDemuxer(dataList.front());
+        if (demuxer_.load() == nullptr) {
             LogE("demuxer is not created.");
-            return;
         }
-    } else if (demuxer) {
-        auto result = demuxer->parseData(demuxData);
+        return;
+    }
+
+    auto start = Time::nowTimeStamp();
+    uint64_t demuxedBytes = 0;
+    while (!dataList.empty() && !flushed_) {
+        auto& packet = dataList.front();
+        demuxedBytes += packet.length();
+        if (packet.tag == Mp4Demuxer::kSideStreamTag) {
+            isSideReading_ = false;
+        }
+        auto result = demuxer->parseData(packet);
+        dataList.pop_front();
         invokeHandleResultFunc(std::move(result));
+        if ((Time::nowTimeStamp() - start).toMilliSeconds() >= kDemuxTimeBudget) {
+            break;
+        }
+    }
+    if (!dataList.empty()) {
+        //over the time budget, the rest goes first in the next run, unless a flush came in meanwhile
+        dataList_.withLock([this, &dataList](auto& list) {
+            if (!flushed_) {
+                list.splice(list.begin(), dataList);
+            }
+        });
+    }
+    if (!flushed_) {
+        requestSideData();
     }
+    updateThroughput(demuxedBytes, Time::nowTimeStamp() - start);
+}
+
+void DemuxerComponent::waitData() noexcept {
+    isStarved_ = true;
+    worker_.pause();
+    //data pushed between the check and the pause must not wait for the owner to start again
+    auto hasData = dataList_.withLock([](auto& list) {
+        return !list.empty();
+    }) || tailList_.withLock([](auto& list) {
+        return !list.empty();
+    });
+    if (hasData && isStarved_.exchange(false)) {
+        worker_.start();
+    }
+}
+
+std::list<DataPacket> DemuxerComponent::takeData(bool isBatch) noexcept {
+    std::list<DataPacket> dataList;
+    dataList_.withLock([&dataList, isBatch](auto& list) {
+        uint64_t size = 0;
+        while (!list.empty() && (dataList.empty() || (isBatch && size < kDemuxByteBudget))) {
+            size += list.front().length();
+            dataList.splice(dataList.end(), list, list.begin());
+        }
+    });
+    if (dataList.size() <= 1) {
+        return dataList;
+    }
+
+    //merge small contiguous packets of the same source, each parseData call has a fixed cost
+    std::list<DataPacket> coalesced;
+    Data* merged = nullptr; //data of the last packet when it was created here, never a shared slice
+    for (auto& packet : dataList) {
+        if (!coalesced.empty()) {
+            auto& last = coalesced.back();
+            auto isContiguous = !last.empty() && !packet.empty() && last.tag == packet.tag &&
+                last.offset + static_cast<int64_t>(last.length()) == packet.offset;
+            if (isContiguous && last.length() + packet.length() <= kCoalesceSize) {
+                if (merged == nullptr) {
+                    auto data = Data::obtain(kCoalesceSize);
+                    data->append(*last.data);
+                    last.data = std::move(data);
+                    merged = last.data.get();
+                }
+                merged->append(*packet.data);
+                continue;
+            }
+        }
+        coalesced.push_back(std::move(packet));
+        merged = nullptr;
+    }
+    return coalesced;
+}
+
+void DemuxerComponent::updateThroughput(uint64_t bytes, Time::TimeDelta cost) noexcept {
+    constexpr double kReportInterval = 1.0; //second
+    stats_.bytes += bytes;
+    stats_.cost += cost;
+    if (stats_.cost.second() < kReportInterval) {
+        return;
+    }
+    auto throughput = static_cast<double>(stats_.bytes) / stats_.cost.second() / (1024.0 * 1024.0);
+    throughput_ = throughput;
+    LogI("demux throughput:{:.2f}MB/s, bytes:{}, busy time:{:.3f}s", throughput, stats_.bytes, stats_.cost.second());
+    stats_ = {};
 }
 
 bool DemuxerComponent::open() noexcept {
@@ -168,10 +268,19 @@ void DemuxerComponent::handleOpenMp4DemuxerResult(bool isSuccess) noexcept {
     }
     auto mp4Demuxer = std::dynamic_pointer_cast<Mp4Demuxer>(demuxer);
     if (isSuccess) {
-        auto dataStart = mp4Demuxer->headerInfo()->headerLength + 8; //skip size and type
+        //audio far from the video of its time would make the sequential stream hold everything in between
+        if (readAtFunc_.load() && !mp4Demuxer->isFragmented()) {
+            auto distance = mp4Demuxer->interleaveDistance();
+            if (distance > Mp4Demuxer::kSplitInterleaveDistance) {
+                mp4Demuxer->enableSideStream();
+                LogI("mp4 interleave distance:{}, audio is read on the side", distance);
+            }
+        }
+        auto headerInfo = mp4Demuxer->headerInfo();
+        auto dataStart = mp4Demuxer->dataStart();
         Range range;
         range.pos = dataStart;
-        range.size = static_cast<int64_t>(mp4Demuxer->headerInfo()->dataSize) - 8; //skip size and type
+        range.size = static_cast<int64_t>(headerInfo->headerLength + headerInfo->dataSize - dataStart);
         mp4Demuxer->seekPos(dataStart);
         invokeSeekFunc(range);
         LogI("mp4 seek to:{}", dataStart);
@@ -185,31 +294,141 @@ void DemuxerComponent::handleOpenMp4DemuxerResult(bool isSuccess) noexcept {
         LogI("mp4 info:{}", ss);
 #endif
     } else {
-        int64_t moovBoxStart = 0;
-        uint32_t moovBoxSize = 0;
-        constexpr int64_t kMb = 1024 * 1024;
-        if (mp4Demuxer->probeMoovBox(*probeBuffer_, moovBoxStart, moovBoxSize)) {
+        //the box walk tells where the header continues, the moov of a file which is not fast started
+        //sits behind the mdat and is fetched on the side instead of streaming the media data
+        constexpr uint64_t kStreamAheadSize = 1024 * 1024;
+        const auto& missing = mp4Demuxer->missingRange();
+        auto pos = missing.start();
+        auto bufferEnd = probeBuffer_->end();
+        if (!isTailProbe_ && pos <= bufferEnd + kStreamAheadSize) {
+            return; //the sequential reader brings it soon, a fast started moov for one
+        }
+        if (config_.fileSize > 0 && pos >= config_.fileSize) {
+            LogE("mp4 header not found, box walk ends at:{}", pos);
             return;
         }
-        auto pos = static_cast<int64_t>(probeBuffer_->pos());
-        if (pos == 0) {
-            auto headerInfo = mp4Demuxer->headerInfo();
-            if (headerInfo) {
-                pos = static_cast<int64_t>(headerInfo->headerLength + headerInfo->dataSize);
-            } else {
-                pos = static_cast<int64_t>(config_.fileSize) - kMb;
+        if (isTailProbe_) {
+            auto isFetched = missing.size.has_value() ? missing.end() < bufferEnd : pos == probeBuffer_->offset();
+            if (isFetched) {
+                LogE("mp4 header is broken, {}", missing.toString());
+                return;
             }
-        } else {
-            pos -= kMb;
         }
-        if (pos < 0) {
+        if (readTail(pos, tailSize(missing))) {
+            return;
+        }
+        //no reads on the side, the sequential reader skips to the box instead
+        probeFrom(pos);
+    }
+}
+
+uint64_t DemuxerComponent::tailSize(const Range& missing) const noexcept {
+    //a short tail is mostly the moov, it is read in one go, else the box headers are read one by one
+    constexpr uint64_t kMaxTailSize = 32 * 1024 * 1024;
+    constexpr uint64_t kBoxHeaderReadSize = 64 * 1024;
+    auto pos = missing.start();
+    auto restSize = config_.fileSize > pos ? config_.fileSize - pos : 0;
+    if (missing.size.has_value()) {
+        return std::min(static_cast<uint64_t>(missing.size.value()), restSize);
+    }
+    return restSize <= kMaxTailSize ? restSize : kBoxHeaderReadSize;
+}
+
+void DemuxerComponent::probeFrom(uint64_t pos) noexcept {
+    isTailProbe_ = false;
+    seekToPos(pos);
+    probeBuffer_->reset();
+    probeBuffer_->setOffset(pos);
+    invokeSeekFunc(Range(pos));
+}
+
+bool DemuxerComponent::readTail(uint64_t pos, uint64_t size) noexcept {
+    auto func = readAtFunc_.load();
+    if (!func || pos >= config_.fileSize || size == 0) {
+        return false;
+    }
+    probeBuffer_->reset();
+    probeBuffer_->setOffset(pos);
+    isWaitingTail_ = true;
+    isTailProbe_ = true;
+    auto isAccepted = std::invoke(*func, pos, size, [weak = weak_from_this()](DataPacket packet) {
+        auto self = weak.lock();
+        if (!self) {
+            return;
+        }
+        self->tailList_.withLock([&packet](auto& list) {
+            list.push_back(std::move(packet));
+        });
+        if (self->isStarved_.exchange(false)) {
+            self->worker_.start();
+        }
+    });
+    if (!isAccepted) {
+        isWaitingTail_ = false;
+        isTailProbe_ = false;
+        return false;
+    }
+    LogI("read mp4 tail at:{}, size:{}", pos, size);
+    return true;
+}
+
+void DemuxerComponent::handleTailData() noexcept {
+    auto tail = tailList_.withLock([](auto& list) {
+        std::optional<DataPacket> packet;
+        if (!list.empty()) {
+            packet = std::move(list.front());
+            list.pop_front();
+        }
+        return packet;
+    });
+    //the sequential reader is in the mdat meanwhile, it is moved back once the header is parsed
+    dataList_.withLock([](auto& list) {
+        list.clear();
+    });
+    if (!tail.has_value()) {
+        waitData();
+        return;
+    }
+    isWaitingTail_ = false;
+    auto pos = probeBuffer_->offset();
+    if (tail->empty()) {
+        LogE("read mp4 tail failed, probe from:{}", pos);
+        probeFrom(pos);
+        return;
+    }
+    openDemuxer(tail.value());
+}
+
+void DemuxerComponent::requestSideData() noexcept {
+    auto func = readAtFunc_.load();
+    auto mp4Demuxer = std::dynamic_pointer_cast<Mp4Demuxer>(demuxer_.load());
+    if (!func || !mp4Demuxer || !mp4Demuxer->isSideStreamEnabled() || isSideReading_) {
+        return;
+    }
+    auto range = mp4Demuxer->nextSideRange();
+    if (!range.isValid()) {
+        return;
+    }
+    isSideReading_ = true;
+    auto generation = sideGeneration_.load();
+    auto size = static_cast<uint64_t>(range.size.value_or(0));
+    auto isAccepted = std::invoke(*func, range.start(), size, [weak = weak_from_this(), generation](DataPacket packet) {
+        auto self = weak.lock();
+        if (!self || self->sideGeneration_ != generation) {
             return;
         }
-        auto probePos = static_cast<uint64_t>(pos);
-        seekToPos(probePos);
-        probeBuffer_->reset();
-        probeBuffer_->setOffset(probePos);
-        invokeSeekFunc(Range(probePos));
+        //a failed read goes in empty as well, the demuxer asks for the range again
+        packet.tag = std::string(Mp4Demuxer::kSideStreamTag);
+        self->dataList_.withLock([&packet](auto& list) {
+            list.push_back(std::move(packet));
+        });
+        if (self->isStarved_.exchange(false)) {
+            self->worker_.start();
+        }
+    });
+    if (!isAccepted) {
+        isSideReading_ = false;
+        LogE("read side range failed, {}", range.toString());
     }
 }
 
@@ -218,6 +437,8 @@ void DemuxerComponent::seekToPos(uint64_t pos) noexcept {
         LogE("demuxer component is closed.");
         return;
     }
+    sideGeneration_++;
+    isSideReading_ = false;
 
     if (auto demuxer = demuxer_.load()) {
         demuxer->seekPos(pos);
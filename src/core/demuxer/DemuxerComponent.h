@@ -5,16 +5,26 @@
 #include "Thread.h"
 #include "NonCopyable.h"
 #include "DemuxerManager.h"
+#include "IReader.h"
 #include <list>
 
 namespace slark {
 
 using HandleSeekFunc = std::function<void(Range)>;
 using HandleDemuxResultFunc = std::function<void(const std::shared_ptr<IDemuxer>&, DemuxerResult&&)>;
+///offset, size, callback, false if the range can not be read on the side
+using ReadAtFunc = std::function<bool(uint64_t, uint64_t, ReadAtCallBack)>;
 
-class DemuxerComponent: public slark::NonCopyable {
+class DemuxerComponent: public slark::NonCopyable,
+        public std::enable_shared_from_this<DemuxerComponent> {
 
 public:
+    ///data demuxed per worker run at most, so pause and flush still land quickly
+    static constexpr uint64_t kDemuxByteBudget = 4 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds kDemuxTimeBudget{20};
+    ///small contiguous packets are merged up to this size before parsing
+    static constexpr uint64_t kCoalesceSize = 256 * 1024;
+
     explicit DemuxerComponent(DemuxerConfig config);
 
     ~DemuxerComponent() override;
@@ -32,7 +42,10 @@ public:
     void seekToPos(uint64_t pos) noexcept;
 
     void flush() noexcept {
-        flushed_ = true;
+        //under the data lock, so the worker can not put back packets it took before the flush
+        dataList_.withLock([this](auto&) {
+            flushed_ = true;
+        });
     }
 
     ///In HLS, what you get is the TS index, while in other cases, it’s the file offset.
@@ -48,10 +61,20 @@ public:
         handleSeekFunc_.reset(std::make_shared<HandleSeekFunc>(std::move(func)));
     }
 
+    ///used to fetch a header behind the media data without moving the sequential reader
+    void setReadAtFunc(ReadAtFunc&& func) noexcept {
+        readAtFunc_.reset(std::make_shared<ReadAtFunc>(std::move(func)));
+    }
+
     [[nodiscard]] bool isRunning() const noexcept {
         return worker_.isRunning();
     }
 
+    ///demux throughput of the last report window, MB/s of busy time
+    [[nodiscard]] double throughput() const noexcept {
+        return throughput_;
+    }
+
     [[nodiscard]] bool isOpen() const noexcept {
         if (auto demuxer = demuxer_.load()) {
             return demuxer->isOpened();
@@ -115,6 +138,15 @@ public:
         return nullptr;
     }
 
+    [[nodiscard]] bool isLive() const noexcept {
+        if (auto demuxer = demuxer_.load()) {
+            return demuxer->isLive();
+        } else {
+            LogE("demuxer is nullptr.");
+        }
+        return false;
+    }
+
     [[nodiscard]] CTime totalDuration() const noexcept {
         if (auto demuxer = demuxer_.load()) {
             return demuxer->totalDuration();
@@ -147,6 +179,28 @@ public:
 private:
     void demuxData() noexcept;
 
+    ///one packet while probing, otherwise packets up to the byte budget with contiguous ones merged
+    std::list<DataPacket> takeData(bool isBatch) noexcept;
+
+    void updateThroughput(uint64_t bytes, Time::TimeDelta cost) noexcept;
+
+    ///pause until pushData or a range result, unless one came in meanwhile
+    void waitData() noexcept;
+
+    ///read size bytes from pos on the side, false if the reader can not
+    bool readTail(uint64_t pos, uint64_t size) noexcept;
+
+    ///bytes to read on the side for the missing part of the mp4 header
+    [[nodiscard]] uint64_t tailSize(const Range& missing) const noexcept;
+
+    void handleTailData() noexcept;
+
+    ///read the next range of a badly interleaved mp4 track on the side, one at a time
+    void requestSideData() noexcept;
+
+    ///move the sequential reader to pos and probe the data from there
+    void probeFrom(uint64_t pos) noexcept;
+
     void handleOpenMp4DemuxerResult(bool isSuccess) noexcept;
     
     void handleOpenWavDemuxerResult(bool isSuccess) noexcept;
@@ -179,11 +233,28 @@ private:
     DemuxerConfig config_;
     AtomicSharedPtr<HandleDemuxResultFunc> handleResultFunc_;
     AtomicSharedPtr<HandleSeekFunc> handleSeekFunc_;
+    AtomicSharedPtr<ReadAtFunc> readAtFunc_;
     Synchronized<std::list<DataPacket>> dataList_;
     std::unique_ptr<Buffer> probeBuffer_;
+    ///the tail of a file with the moov box behind the mdat is being read by readAt
+    std::atomic_bool isWaitingTail_ = false;
+    ///the probe buffer holds data read on the side, not the sequential stream
+    bool isTailProbe_ = false;
+    Synchronized<std::list<DataPacket>> tailList_;
+    ///a side range is being read, it is cleared when its packet is demuxed
+    std::atomic_bool isSideReading_ = false;
+    ///side ranges of an earlier seek are dropped
+    std::atomic<uint32_t> sideGeneration_ = 0;
     AtomicSharedPtr<IDemuxer> demuxer_;
     std::atomic_bool flushed_ = false;
     std::atomic_bool isClosed_ = false;
+    ///paused itself because the data list ran dry
+    std::atomic_bool isStarved_ = false;
+    struct {
+        uint64_t bytes = 0;
+        Time::TimeDelta cost;
+    } stats_;
+    std::atomic<double> throughput_ = 0;
 };
 
 } // slark
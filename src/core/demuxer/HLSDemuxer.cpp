@@ -5,22 +5,40 @@
 //  Created by Nevermore on 2024/12/9.
 //
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <optional>
 #include <utility>
 #include "HLSDemuxer.h"
 #include "Util.hpp"
 #include "MediaUtil.h"
+#include "ByteScan.h"
 
 namespace slark {
 
 M3U8Parser::M3U8Parser(std::string  baseUrl)
-    : baseUrl_(std::move(baseUrl)) {
+    : baseUrl_(std::move(baseUrl))
+    , basePrefix_(std::make_shared<const std::string>(baseUrl_ + "/")) {
     
 }
 
 void M3U8Parser::reset() noexcept {
     isPlayList_ = false;
     isCompleted_ = false;
+    isLoaded_ = false;
+    canBlockReload_ = false;
+    index = 0;
+    mediaSequence_ = 0;
+    totalDuration_ = 0.0;
+    targetDuration_ = 0.0;
+    partTargetDuration_ = 0.0;
+    holdBack_ = 0.0;
+    partHoldBack_ = 0.0;
     infos_.clear();
+    startTimes_.clear();
+    urlPrefixes_.clear();
+    parts_.clear();
     playListInfos_.clear();
 }
 
@@ -69,23 +87,203 @@ std::string spliceUrl(const std::string& baseUrl, std::string_view view) {
     return baseUrl + "/" + std::string(view);
 }
 
+std::string_view trimSpace(std::string_view view) noexcept {
+    while (!view.empty() && std::isspace(static_cast<unsigned char>(view.front()))) {
+        view.remove_prefix(1);
+    }
+    while (!view.empty() && std::isspace(static_cast<unsigned char>(view.back()))) {
+        view.remove_suffix(1);
+    }
+    return view;
+}
+
+///value of NAME=value or NAME="value" in an attribute list
+std::string_view attributeValue(std::string_view attributes, std::string_view name) noexcept {
+    size_t pos = 0;
+    while (pos < attributes.size()) {
+        auto equalPos = attributes.find('=', pos);
+        if (equalPos == std::string_view::npos) {
+            break;
+        }
+        auto key = trimSpace(attributes.substr(pos, equalPos - pos));
+        auto valuePos = equalPos + 1;
+        auto valueEnd = attributes.size();
+        std::string_view value;
+        if (valuePos < attributes.size() && attributes[valuePos] == '"') {
+            auto quoteEnd = attributes.find('"', valuePos + 1);
+            if (quoteEnd == std::string_view::npos) {
+                break;
+            }
+            value = attributes.substr(valuePos + 1, quoteEnd - valuePos - 1);
+            valueEnd = quoteEnd + 1;
+        } else {
+            valueEnd = std::min(attributes.find(',', valuePos), attributes.size());
+            value = trimSpace(attributes.substr(valuePos, valueEnd - valuePos));
+        }
+        if (key == name) {
+            return value;
+        }
+        pos = attributes.find(',', valueEnd);
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        pos++;
+    }
+    return {};
+}
+
+///leading digits of the view, 0 if there are none
+template <typename T>
+T toInteger(std::string_view view) noexcept {
+    view = trimSpace(view);
+    T value = 0;
+    std::from_chars(view.data(), view.data() + view.size(), value);
+    return value;
+}
+
+///m3u8 decimal-floating-point: digits with an optional fraction, no exponent
+double toDouble(std::string_view view) noexcept {
+    view = trimSpace(view);
+    uint64_t integer = 0;
+    auto [ptr, ec] = std::from_chars(view.data(), view.data() + view.size(), integer);
+    if (ec != std::errc()) {
+        return 0.0;
+    }
+    auto value = static_cast<double>(integer);
+    const auto end = view.data() + view.size();
+    if (ptr == end || *ptr != '.') {
+        return value;
+    }
+    ++ptr;
+    //digits beyond the precision of a double are dropped
+    constexpr ptrdiff_t kMaxFractionDigits = 15;
+    auto fractionEnd = ptr + std::min(end - ptr, kMaxFractionDigits);
+    uint64_t fraction = 0;
+    auto [fractionPtr, fractionEc] = std::from_chars(ptr, fractionEnd, fraction);
+    if (fractionEc != std::errc()) {
+        return value;
+    }
+    static constexpr double kScales[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                         1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    return value + static_cast<double>(fraction) / kScales[fractionPtr - ptr];
+}
+
+double M3U8Parser::holdBack() const noexcept {
+    if (partTargetDuration_ > 0.0) {
+        return partHoldBack_ > 0.0 ? partHoldBack_ : partTargetDuration_ * 3;
+    }
+    return holdBack_ > 0.0 ? holdBack_ : targetDuration_ * 3;
+}
+
+void M3U8Parser::parsePart(std::string_view attributes) noexcept {
+    TSPart part;
+    part.duration = toDouble(attributeValue(attributes, "DURATION"));
+    part.isIndependent = attributeValue(attributes, "INDEPENDENT") == "YES";
+    auto uri = attributeValue(attributes, "URI");
+    if (uri.empty()) {
+        LogE("parse part error: no uri");
+        return;
+    }
+    part.url = spliceUrl(baseUrl_, uri);
+    ///BYTERANGE="<length>[@<offset>]", without offset it follows the previous part of the same uri
+    if (auto byteRange = attributeValue(attributes, "BYTERANGE"); !byteRange.empty()) {
+        auto pos = byteRange.find('@');
+        part.range.size = toInteger<int64_t>(byteRange.substr(0, pos));
+        if (pos != std::string_view::npos) {
+            part.range.pos = toInteger<uint64_t>(byteRange.substr(pos + 1));
+        } else if (!parts_.empty() && parts_.back().url == part.url && parts_.back().range.isValid()) {
+            part.range.pos = parts_.back().range.end() + 1;
+        } else {
+            part.range.pos = 0;
+        }
+    }
+    parts_.push_back(std::move(part));
+}
+
+void M3U8Parser::parseServerControl(std::string_view attributes) noexcept {
+    canBlockReload_ = attributeValue(attributes, "CAN-BLOCK-RELOAD") == "YES";
+    if (auto holdBack = attributeValue(attributes, "HOLD-BACK"); !holdBack.empty()) {
+        holdBack_ = toDouble(holdBack);
+    }
+    if (auto partHoldBack = attributeValue(attributes, "PART-HOLD-BACK"); !partHoldBack.empty()) {
+        partHoldBack_ = toDouble(partHoldBack);
+    }
+}
+
+void M3U8Parser::merge(M3U8Parser& reloaded) noexcept {
+    isCompleted_ = reloaded.isCompleted_;
+    canBlockReload_ = reloaded.canBlockReload_;
+    targetDuration_ = reloaded.targetDuration_;
+    partTargetDuration_ = reloaded.partTargetDuration_;
+    holdBack_ = reloaded.holdBack_;
+    partHoldBack_ = reloaded.partHoldBack_;
+    parts_ = std::move(reloaded.parts_);
+    for (auto& info : reloaded.infos_) {
+        if (!infos_.empty() && info.mediaSequence <= infos_.back().mediaSequence) {
+            continue; //known, or slid out of the window before
+        }
+        if (!infos_.empty() && info.mediaSequence > infos_.back().mediaSequence + 1) {
+            LogE("live window moved past the reader, sequence {} -> {}", infos_.back().mediaSequence, info.mediaSequence);
+            infos_.back().isDiscontinuity = true;
+        }
+        addInfo(std::move(info));
+    }
+}
+
+void M3U8Parser::addInfo(TSInfo&& info) noexcept {
+    info.sequence = index++;
+    info.startTime = totalDuration_;
+    totalDuration_ += info.duration;
+    startTimes_.push_back(info.startTime);
+    infos_.push_back(std::move(info));
+}
+
+void M3U8Parser::setUrl(TSInfo& info, std::string_view view) noexcept {
+    //a plain name is relative to the play list, the common case shares one prefix
+    if (view.find('/') == std::string_view::npos && !view.starts_with("http")) {
+        info.urlPrefix = basePrefix_;
+        info.urlName = view;
+        return;
+    }
+    auto url = spliceUrl(baseUrl_, view);
+    auto pos = url.rfind('/') + 1;
+    std::string_view prefix(url.data(), pos);
+    auto it = std::ranges::find_if(urlPrefixes_, [prefix](const auto& urlPrefix) {
+        return *urlPrefix == prefix;
+    });
+    if (it == urlPrefixes_.end()) {
+        it = urlPrefixes_.insert(urlPrefixes_.end(), std::make_shared<const std::string>(prefix));
+    }
+    info.urlPrefix = *it;
+    info.urlName = url.substr(pos);
+}
+
+uint32_t M3U8Parser::tsIndexOf(double time) const noexcept {
+    auto it = std::upper_bound(startTimes_.begin(), startTimes_.end(), time);
+    if (it == startTimes_.begin()) {
+        return kNotFound;
+    }
+    auto tsIndex = static_cast<uint32_t>(std::distance(startTimes_.begin(), it) - 1);
+    return time <= infos_[tsIndex].endTime() ? tsIndex : kNotFound;
+}
+
 bool M3U8Parser::parse(Buffer& buffer) noexcept {
     DataView line;
     while(buffer.readLine(line)) {
-        auto content = line.removeSpace();
-        if (content.empty()) {
+        auto view = trimSpace(line.view());
+        if (view.empty()) {
             continue;
         }
-        auto view = std::string_view(content);
         if(view.starts_with("#EXTINF:")) {
             view = view.substr(8);
             view = view.substr(0, view.find(','));
             TSInfo info;
-            info.sequence = index++;
-            info.duration = std::stod(std::string(view));
-            info.startTime = totalDuration_;
-            infos_.push_back(info);
-            totalDuration_ += info.duration;
+            info.mediaSequence = mediaSequence_++;
+            info.duration = toDouble(view);
+            //parts listed before an EXTINF belong to that segment
+            info.parts = std::move(parts_);
+            parts_.clear();
+            addInfo(std::move(info));
         } else if (view.starts_with("#EXT-X-BYTERANGE:")) {
             view = view.substr(17);
             if (infos_.empty()) {
@@ -99,10 +297,18 @@ bool M3U8Parser::parse(Buffer& buffer) noexcept {
                 LogE("parse byte range error");
                 break;
             }
-            auto lengthView = view.substr(0, pos);
-            auto offsetView = view.substr(pos + 1);
-            info.range.pos = static_cast<uint64_t>(std::stol(std::string(offsetView)));
-            info.range.size = std::stol(std::string(lengthView));
+            info.range.pos = toInteger<uint64_t>(view.substr(pos + 1));
+            info.range.size = toInteger<int64_t>(view.substr(0, pos));
+        } else if (view.starts_with("#EXT-X-MEDIA-SEQUENCE:")) {
+            mediaSequence_ = toInteger<uint64_t>(view.substr(22));
+        } else if (view.starts_with("#EXT-X-TARGETDURATION:")) {
+            targetDuration_ = toDouble(view.substr(22));
+        } else if (view.starts_with("#EXT-X-PART-INF:")) {
+            partTargetDuration_ = toDouble(attributeValue(view.substr(16), "PART-TARGET"));
+        } else if (view.starts_with("#EXT-X-PART:")) {
+            parsePart(view.substr(12));
+        } else if (view.starts_with("#EXT-X-SERVER-CONTROL:")) {
+            parseServerControl(view.substr(22));
         } else if (view.starts_with("#EXT-X-DISCONTINUITY")) {
             if (!infos_.empty()) {
                 infos_.back().isDiscontinuity = true; //The next TS needs to reset the decoder
@@ -110,11 +316,8 @@ bool M3U8Parser::parse(Buffer& buffer) noexcept {
         } else if (view.starts_with("#EXT-X-STREAM-INF:")) {
             //play list
             isPlayList_ = true;
-            view = view.substr(18);
-            view = view.substr(0, view.find(','));
-            view = view.substr(view.find('=') + 1);
             PlayListInfo info;
-            info.codeRate = static_cast<uint32_t>(std::stoi(std::string(view)));
+            info.codeRate = toInteger<uint32_t>(attributeValue(view.substr(18), "BANDWIDTH"));
             playListInfos_.push_back(info);
         } else if(view.starts_with("#EXT-X-ENDLIST")) {
             isCompleted_ = true;
@@ -137,7 +340,7 @@ bool M3U8Parser::parse(Buffer& buffer) noexcept {
                     LogE("parse url: info array is empty!");
                     break;
                 }
-                infos_.back().url = spliceUrl(baseUrl_, view);
+                setUrl(infos_.back(), view);
             }
         }
     }
@@ -155,16 +358,24 @@ bool M3U8Parser::parse(Buffer& buffer) noexcept {
 }
 
 bool TSDemuxer::checkPacket(Buffer& buffer, uint64_t& pos) noexcept {
-    constexpr char kSyncByte = 0x47;
-    auto view = buffer.shotView();
-    auto p = view.find(kSyncByte);
-    if (p == std::string_view::npos) {
+    constexpr uint8_t kSyncByte = 0x47;
+    while (buffer.require(kPacketSize)) {
+        //confirm the sync byte with the next packet when it is available
+        auto size = buffer.require(kPacketSize * 2) ? kPacketSize * 2 : kPacketSize;
+        auto view = buffer.shotView(size);
+        //in sync the packet starts right here, scan only after losing it
+        auto isInSync = view[0] == kSyncByte && (size == kPacketSize || view[kPacketSize] == kSyncByte);
+        auto p = isInSync ? 0 : ByteScan::findSyncByte(view, kSyncByte, kPacketSize);
+        if (p == ByteScan::kNotFound) {
+            buffer.skip(static_cast<int64_t>(kPacketSize)); //no sync byte, discard
+            continue;
+        }
+        if (buffer.require(p + kPacketSize)) {
+            pos = buffer.pos() + p;
+            return true;
+        }
         return false;
     }
-    if (view.substr(p).size() >= kPacketSize) {
-        pos = buffer.pos() + p;
-        return true;
-    }
     return false;
 }
 
@@ -208,8 +419,8 @@ bool TSDemuxer::parsePacket(DataView data, uint32_t tsIndex, DemuxerResult& resu
         if (header.payloadUinitIndicator == 1 && videoInfo_) {
             if (videoInfo_->mediaInfo == MEDIA_MIMETYPE_VIDEO_AVC) {
                 packH264VideoPacket(tsIndex, result.videoFrames);
-            } else {
-                //TODO: pack h265
+            } else if (videoInfo_->mediaInfo == MEDIA_MIMETYPE_VIDEO_HEVC) {
+                packH265VideoPacket(tsIndex, result.videoFrames);
             }
         }
         parseTSPes(data, header.payloadUinitIndicator, videoESFrame_);
@@ -357,41 +568,67 @@ bool TSDemuxer::parseTSPes(DataView data, uint8_t payloadIndicator, TSPESFrame&
         dataOffset = 6; //pes header (6 byte)
     }
     SAssert(dataOffset < data.length(), "error! data offset > data length!");
-    pes.mediaData.append(data.substr(dataOffset));
+    //reserve the whole payload once, growing it packet by packet copies it over and over
+    auto payload = data.substr(dataOffset);
+    auto pesPacketLength = static_cast<uint64_t>((data[4] << 8) | data[5]);
+    auto expectSize = pesPacketLength > 0 && pesPacketLength + 6 > dataOffset ? pesPacketLength + 6 - dataOffset : pes.sizeHint;
+    pes.mediaData.reserve(std::max<uint64_t>(expectSize, payload.length()));
+    pes.mediaData.append(payload);
     return true;
 }
 
-void TSDemuxer::writeVideoData(AVFramePtr& frame, DataView view) noexcept {
-    Data header(4);
+void TSDemuxer::writeVideoHeader(uint8_t* header, uint64_t naluLength) noexcept {
 #if SLARK_ANDROID
-    header.rawData[0] = 0x0;
-    header.rawData[1] = 0x0;
-    header.rawData[2] = 0x0;
-    header.rawData[3] = 0x1;
+    header[0] = 0x0;
+    header[1] = 0x0;
+    header[2] = 0x0;
+    header[3] = 0x1;
+    (void)naluLength;
 #elif SLARK_IOS
-    auto length = static_cast<uint32_t>(view.length());
-    header.rawData[0] = static_cast<uint8_t>(length >> 24);
-    header.rawData[1] = static_cast<uint8_t>(length >> 16);
-    header.rawData[2] = static_cast<uint8_t>(length >> 8);
-    header.rawData[3] = static_cast<uint8_t>(length);
+    auto length = static_cast<uint32_t>(naluLength);
+    header[0] = static_cast<uint8_t>(length >> 24);
+    header[1] = static_cast<uint8_t>(length >> 16);
+    header[2] = static_cast<uint8_t>(length >> 8);
+    header[3] = static_cast<uint8_t>(length);
+#else
+    std::fill_n(header, kVideoHeaderSize, 0);
+    (void)naluLength;
 #endif
-    header.length = 4;
-    frame->data->append(header); //write header
+}
+
+void TSDemuxer::writeVideoData(AVFramePtr& frame, const DataRefPtr& block, Range range) noexcept {
+    constexpr std::string_view kStartCode("\x00\x00\x00\x01", kVideoHeaderSize);
+    auto pos = range.start();
+    auto view = block->view().substr(range);
+    if (!frame->data && pos >= kVideoHeaderSize &&
+        block->view().substr(pos - kVideoHeaderSize, kVideoHeaderSize).view() == kStartCode) {
+        //the 4 byte start code belongs to no other nalu, rewrite it in place and share the nalu
+        writeVideoHeader(block->rawData + pos - kVideoHeaderSize, view.length());
+        frame->data = Data::makeSlice(block, pos - kVideoHeaderSize, view.length() + kVideoHeaderSize);
+        return;
+    }
+    if (!frame->data) {
+        frame->data = std::make_unique<Data>();
+    }
+    uint8_t header[kVideoHeaderSize] = {0};
+    writeVideoHeader(header, view.length());
+    frame->data->append(DataView(header, kVideoHeaderSize)); //write header, a slice is copied here
     frame->data->append(view);
 }
 
-bool TSDemuxer::packH264VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept {
+DataRefPtr TSDemuxer::splitVideoPacket(std::vector<Range>& naluRanges) noexcept {
     if (videoESFrame_.mediaData.empty()) {
         LogI("media data is empty!");
-        return false;
+        return nullptr;
     }
     if (!parseInfo_.videoInfo.isValid) {
         parseInfo_.videoInfo.firstDts = videoESFrame_.pts;
         parseInfo_.videoInfo.firstPts = videoESFrame_.dts;
         parseInfo_.videoInfo.isValid = true;
     }
-    std::vector<Range> naluRanges;
-    auto view = videoESFrame_.mediaData.view();
+    //frames share the pes payload instead of copying every nalu
+    auto block = videoESFrame_.detach();
+    auto view = block->view();
     uint64_t pos = 0;
     while(!view.empty()) {
         Range range;
@@ -403,37 +640,85 @@ bool TSDemuxer::packH264VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) n
         pos = range.end();
         naluRanges.push_back(range);
     }
-    
-    view = videoESFrame_.mediaData.view();
+    return block;
+}
+
+bool TSDemuxer::updateParameterSet(DataRefPtr& parameterSet, DataView view) noexcept {
+    if (parameterSet && parameterSet->view() == view) {
+        return false;
+    }
+    parameterSet = std::make_shared<Data>();
+    parameterSet->append(view);
+    parseInfo_.isNotifiedHeader = false;
+    return true;
+}
+
+void TSDemuxer::appendSlice(AVFramePtrArray& frames, const DataRefPtr& block, Range range) noexcept {
+    if (frames.empty()) {
+        LogE("frames array is empty!");
+        return;
+    }
+    writeVideoData(frames.back(), block, range);
+}
+
+void TSDemuxer::pushVideoFrame(uint32_t tsIndex,
+                               std::shared_ptr<VideoFrameInfo> info,
+                               const DataRefPtr& block,
+                               Range range,
+                               AVFramePtrArray& frames) noexcept {
+    auto frame = std::make_unique<AVFrame>(AVFrameType::Video);
+    frame->info = info;
+    writeVideoData(frame, block, range);
+    frame->timeScale = 90000; //90k hz
+    frame->pts = videoESFrame_.pts;
+    frame->dts = videoESFrame_.dts;
+    frame->index = parseInfo_.videoInfo.frameIndex++;
+    info->width = videoInfo_->width;
+    info->height = videoInfo_->height;
+    recalculatePtsDts(frame->pts, frame->dts, false);
+    LogI("video, ts index: {} parse data:{}", tsIndex, frame->pts);
+    frame->pts -= parseInfo_.videoInfo.firstPts;
+    frame->dts -= parseInfo_.videoInfo.firstDts;
+
+    if (parseInfo_.calculatedFps == 0) {
+        if (frame->index != 0) {
+            frame->duration = static_cast<uint32_t>( (frame->ptsTime() /
+                static_cast<double>(frame->index)) * 1000);
+            parseInfo_.calculatedFps = static_cast<uint32_t>(round(1000.0 / static_cast<double>(frame->duration)));
+        } else {
+            frame->duration = 33; //default 33 ms
+        }
+    } else {
+        frame->duration = 1000 / parseInfo_.calculatedFps;
+    }
+    frames.push_back(std::move(frame));
+}
+
+bool TSDemuxer::packH264VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept {
+    std::vector<Range> naluRanges;
+    auto block = splitVideoPacket(naluRanges);
+    if (!block) {
+        return false;
+    }
+    auto view = block->view();
     for (const auto& range : naluRanges) {
         auto dataView = view.substr(range);
         auto naluType = static_cast<uint8_t>(dataView[0]) & 0x1f;
         auto info = std::make_shared<VideoFrameInfo>();
         if (naluType == 7) {
-            if (!videoInfo_->sps || videoInfo_->sps->view() != dataView) {
+            if (updateParameterSet(videoInfo_->sps, dataView)) {
                 parseH264Sps(dataView, videoInfo_);
                 videoInfo_->naluHeaderLength = 4;
-                videoInfo_->sps = std::make_shared<Data>();
-                videoInfo_->sps->append(dataView);
-                parseInfo_.isNotifiedHeader = false;
             }
             continue;
         } else if (naluType == 8) {
-            if (!videoInfo_->pps || videoInfo_->pps->view() != dataView) {
-                videoInfo_->pps = std::make_shared<Data>();
-                videoInfo_->pps->append(dataView);
-                parseInfo_.isNotifiedHeader = false;
-            }
+            updateParameterSet(videoInfo_->pps, dataView);
             continue;
         } else if (naluType == 5 || naluType == 1) {
             auto [firstMBInSlice, sliceType] = parseAvcSliceType(dataView);
             if (firstMBInSlice != 0) {
                 //multi slice
-                if (frames.empty()) {
-                    LogE("frames array is empty!");
-                } else {
-                    writeVideoData(frames.back(), dataView);
-                }
+                appendSlice(frames, block, range);
                 continue;
             }
             if (naluType == 5) {
@@ -449,34 +734,68 @@ bool TSDemuxer::packH264VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) n
         } else {
             continue;
         }
-        
-        auto frame = std::make_unique<AVFrame>(AVFrameType::Video);
-        frame->info = info;
-        frame->data = std::make_unique<Data>();
-        writeVideoData(frame, dataView);
-        frame->timeScale = 90000; //90k hz
-        frame->pts = videoESFrame_.pts;
-        frame->dts = videoESFrame_.dts;
-        frame->index = parseInfo_.videoInfo.frameIndex++;
-        info->width = videoInfo_->width;
-        info->height = videoInfo_->height;
-        recalculatePtsDts(frame->pts, frame->dts, false);
-        LogI("video, ts index: {} parse data:{}", tsIndex, frame->pts);
-        frame->pts -= parseInfo_.videoInfo.firstPts;
-        frame->dts -= parseInfo_.videoInfo.firstDts;
-    
-        if (parseInfo_.calculatedFps == 0) {
-            if (frame->index != 0) {
-                frame->duration = static_cast<uint32_t>( (frame->ptsTime() /
-                    static_cast<double>(frame->index)) * 1000);
-                parseInfo_.calculatedFps = static_cast<uint32_t>(round(1000.0 / static_cast<double>(frame->duration)));
-            } else {
-                frame->duration = 33; //default 33 ms
+        pushVideoFrame(tsIndex, info, block, range, frames);
+    }
+    videoESFrame_.reset();
+    return true;
+}
+
+bool TSDemuxer::packH265VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept {
+    //nal unit types, ITU-T H.265 table 7-1
+    constexpr uint8_t kMaxNonIrapSlice = 9; //TRAIL_N ... RASL_R
+    constexpr uint8_t kMinIrapSlice = 16; //BLA_W_LP
+    constexpr uint8_t kMaxIrapSlice = 21; //CRA_NUT
+    constexpr uint8_t kVps = 32;
+    constexpr uint8_t kSps = 33;
+    constexpr uint8_t kPps = 34;
+    std::vector<Range> naluRanges;
+    auto block = splitVideoPacket(naluRanges);
+    if (!block) {
+        return false;
+    }
+    auto view = block->view();
+    for (const auto& range : naluRanges) {
+        auto dataView = view.substr(range);
+        if (dataView.length() < 3) {
+            continue;
+        }
+        auto naluType = static_cast<uint8_t>((static_cast<uint8_t>(dataView[0]) >> 1) & 0x3f);
+        if (naluType == kVps) {
+            updateParameterSet(videoInfo_->vps, dataView);
+            continue;
+        } else if (naluType == kSps) {
+            if (updateParameterSet(videoInfo_->sps, dataView)) {
+                parseH265Sps(dataView, videoInfo_);
+                videoInfo_->naluHeaderLength = 4;
             }
-        } else {
-            frame->duration = 1000 / parseInfo_.calculatedFps;
+            continue;
+        } else if (naluType == kPps) {
+            if (updateParameterSet(videoInfo_->pps, dataView)) {
+                extraSliceHeaderBits_ = parseH265ExtraSliceHeaderBits(dataView);
+            }
+            continue;
+        } else if (naluType > kMaxIrapSlice || (naluType > kMaxNonIrapSlice && naluType < kMinIrapSlice)) {
+            //aud, sei and reserved types are not decoded
+            continue;
         }
-        frames.push_back(std::move(frame));
+        auto [firstSliceSegmentInPic, sliceType] = parseHevcSliceType(dataView, naluType, extraSliceHeaderBits_);
+        if (!firstSliceSegmentInPic) {
+            //multi slice
+            appendSlice(frames, block, range);
+            continue;
+        }
+        auto info = std::make_shared<VideoFrameInfo>();
+        if (naluType >= kMinIrapSlice) {
+            info->isIDRFrame = true;
+            info->frameType = VideoFrameType::IFrame;
+        } else if (sliceType == 0) {
+            info->frameType = VideoFrameType::BFrame;
+        } else if (sliceType == 1) {
+            info->frameType = VideoFrameType::PFrame;
+        } else if (sliceType == 2) {
+            info->frameType = VideoFrameType::IFrame;
+        }
+        pushVideoFrame(tsIndex, info, block, range, frames);
     }
     videoESFrame_.reset();
     return true;
@@ -495,15 +814,16 @@ void TSDemuxer::recalculatePtsDts(int64_t& pts, int64_t& dts, bool isAudio) noex
 }
 
 bool findAdtsHeader(DataView view, uint32_t& pos) noexcept {
-    pos = 0;
-    while (view.length() >= 7) {
-        if (view[0] == 0xff && (view[1] & 0xf0) == 0xf0) {
-            return true;
-        }
-        pos++;
-        view = view.substr(pos);
+    constexpr uint64_t kMinHeaderSize = 7;
+    if (view.length() < kMinHeaderSize) {
+        return false;
     }
-    return false;
+    auto res = ByteScan::findSyncword(view.substr(0, view.length() - kMinHeaderSize + 2));
+    if (res == ByteScan::kNotFound) {
+        return false;
+    }
+    pos = static_cast<uint32_t>(res);
+    return true;
 }
 
 bool parseAdtsHeader(DataView dataView, AACAdtsHeader& header) noexcept {
@@ -541,7 +861,8 @@ bool TSDemuxer::packAudioPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexc
         LogI("media data is empty!");
         return false;
     }
-    auto view = audioESFrame_.mediaData.view();
+    auto block = audioESFrame_.detach();
+    auto view = block->view();
     uint32_t start = 0;
     if (!findAdtsHeader(view, start)) {
         return false;
@@ -565,14 +886,14 @@ bool TSDemuxer::packAudioPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexc
         if (header.channel == 0) {
             header.channel = 2;
         }
-        auto dataView = view.substr(0, header.frameLength);
-        dataView = dataView.substr(static_cast<uint64_t>(headerLength));
+        auto dataPos = block->length - view.length() + static_cast<uint64_t>(headerLength);
+        auto dataSize = static_cast<uint64_t>(header.frameLength - headerLength);
         auto info = std::make_shared<AudioFrameInfo>();
         info->channels = header.channel;
         info->sampleRate = static_cast<uint64_t>(getAACSamplingRate(header.samplingIndex));
         info->refIndex = tsIndex;
         auto frame = std::make_unique<AVFrame>(AVFrameType::Audio);
-        frame->data = std::make_unique<Data>(dataView);
+        frame->data = Data::makeSlice(block, dataPos, dataSize);
         frame->duration = 1024 * 1000 / info->sampleRate; //ms
         frame->info = info;
         frame->timeScale = 90000;//90k
@@ -610,7 +931,7 @@ bool TSDemuxer::parseData(Buffer& buffer, uint32_t tsIndex, DemuxerResult& resul
     auto isNotifiedHeader = parseInfo_.isNotifiedHeader;
     while (checkPacket(buffer, pos)) {
         buffer.skipTo(static_cast<int64_t>(pos));
-        auto view = buffer.shotView().substr(0, kPacketSize);
+        auto view = buffer.shotView(kPacketSize);
         parsePacket(view, tsIndex, result);
         buffer.skipTo(static_cast<int64_t>(pos + kPacketSize));
     }
@@ -661,7 +982,10 @@ DemuxerResult HLSDemuxer::parseData(DataPacket& packet) noexcept {
         LogE("parse ts data error! offset:{}, ts index:{}", packet.offset, tsIndex);
         result.resultCode = DemuxerResultCode::Failed;
     }
-    if (tsIndex == getTSInfos().size() - 1 && buffer_->empty()) {
+    auto tsCount = withTSInfos([](const auto& infos) {
+        return infos.size();
+    });
+    if (tsIndex == tsCount - 1 && buffer_->empty() && !isLive()) {
         isCompleted_ = true;
     }
     return result;
@@ -676,54 +1000,186 @@ void HLSDemuxer::init(DemuxerConfig config) noexcept {
         baseUrl_ = config_.filePath;
     }
     mainParser_ = std::make_unique<M3U8Parser>(baseUrl_);
+    loadingParser_ = mainParser_.get();
     buffer_ = std::make_unique<Buffer>();
     tsDemuxer_ = std::make_unique<TSDemuxer>(audioInfo_, videoInfo_);
 }
 
 bool HLSDemuxer::open(std::unique_ptr<Buffer>& buffer) noexcept {
-    if (!mainParser_->isCompleted()) {
-        if (!mainParser_->parse(*buffer)) {
-            LogI("need more data.");
-            return false;
-        }
-        LogI("parser hls info complete:{}", mainParser_->isPlayList() ? "play list" : "normal");
-        if (mainParser_->isPlayList()) {
-            slinkParser_ = std::make_unique<M3U8Parser>(baseUrl_);
-        } else {
-            totalDuration_ = CTime(mainParser_->totalDuration());
-            isOpened_ = true;
-        }
-    } else if (mainParser_->isPlayList()) {
-        if (!slinkParser_->parse(*buffer)) {
-            LogI("need more data.");
-            return false;
+    if (!loadingParser_) {
+        LogE("no play list is being loaded");
+        return false;
+    }
+    //a live or master play list has no end tag, it is complete with its response
+    if (!loadingParser_->parse(*buffer)) {
+        LogI("need more data.");
+    }
+    return isOpened_;
+}
+
+bool HLSDemuxer::loadCompleted() noexcept {
+    auto parser = std::exchange(loadingParser_, nullptr);
+    if (!parser) {
+        LogE("no play list is being loaded");
+        return false;
+    }
+    parser->finish();
+    if (parser == mainParser_.get() && parser->isPlayList()) {
+        LogI("parser hls info complete: play list");
+        variantParsers_.resize(mainParser_->playListInfos().size());
+        return true;
+    }
+    if (parser == refreshParser_.get()) {
+        if (auto media = mediaParser(refreshVariant_)) {
+            std::lock_guard<std::mutex> lock(infosMutex_);
+            media->merge(*refreshParser_);
         }
-        LogI("parser hls info complete");
-        totalDuration_ = CTime(slinkParser_->totalDuration());
+        refreshParser_.reset();
+    } else if (!isOpened_) {
+        LogI("parser hls info complete:{}", parser->isLive() ? "live" : "vod");
+        totalDuration_ = CTime(parser->totalDuration());
         isOpened_ = true;
     }
+    if (auto media = mediaParser(variantIndex_); media && media->isLoaded()) {
+        totalDuration_ = CTime(media->totalDuration() - liveStartTime_);
+    }
     return true;
 }
 
+M3U8Parser* HLSDemuxer::mediaParser(uint32_t variantIndex) const noexcept {
+    if (!mainParser_) {
+        return nullptr;
+    }
+    if (!isPlayList()) {
+        return mainParser_.get();
+    }
+    return variantIndex < variantParsers_.size() ? variantParsers_[variantIndex].get() : nullptr;
+}
+
+bool HLSDemuxer::isLive() const noexcept {
+    auto media = mediaParser(variantIndex_);
+    return media && media->isLive();
+}
+
+uint32_t HLSDemuxer::liveStartIndex() noexcept {
+    auto media = mediaParser(variantIndex_);
+    std::lock_guard<std::mutex> lock(infosMutex_);
+    if (!media || media->TSInfos().empty()) {
+        return 0;
+    }
+    const auto& infos = media->TSInfos();
+    //walk back from the live edge until the hold back is covered, the parts of the open segment count
+    auto holdBack = media->holdBack();
+    double duration = 0.0;
+    for (const auto& part : media->openParts()) {
+        duration += part.duration;
+    }
+    auto index = static_cast<uint32_t>(infos.size());
+    if (media->openParts().empty() || !media->openParts().front().isIndependent || duration < holdBack) {
+        while (index > 0 && duration < holdBack) {
+            index--;
+            duration += infos[index].duration;
+        }
+        index = std::min(index, static_cast<uint32_t>(infos.size() - 1));
+    }
+    liveStartTime_ = index < infos.size() ? infos[index].startTime : media->totalDuration();
+    totalDuration_ = CTime(media->totalDuration() - liveStartTime_);
+    LogI("live start at ts:{}, hold back:{}, latency:{}", index, holdBack, duration);
+    return index;
+}
+
+std::vector<TSPart> HLSDemuxer::openParts() const noexcept {
+    auto media = mediaParser(variantIndex_);
+    std::lock_guard<std::mutex> lock(infosMutex_);
+    return media ? media->openParts() : std::vector<TSPart>{};
+}
+
+std::string HLSDemuxer::prepareRefresh() noexcept {
+    auto media = mediaParser(variantIndex_);
+    if (!media || !media->isLive()) {
+        return {};
+    }
+    auto url = isPlayList() ? mainParser_->playListInfos()[variantIndex_].m3u8Url : config_.filePath;
+    std::unique_lock<std::mutex> lock(infosMutex_);
+    if (media->canBlockReload() && !media->TSInfos().empty()) {
+        //ask for the next part or segment, the server holds the response until it exists
+        auto nextSequence = media->TSInfos().back().mediaSequence + 1;
+        url += url.find('?') == std::string::npos ? '?' : '&';
+        url += std::format("_HLS_msn={}", nextSequence);
+        if (media->partTargetDuration() > 0.0) {
+            url += std::format("&_HLS_part={}", media->openParts().size());
+        }
+    }
+    lock.unlock();
+    auto pos = url.find_last_of('/', url.find('?'));
+    refreshParser_ = std::make_unique<M3U8Parser>(pos == std::string::npos ? baseUrl_ : url.substr(0, pos));
+    refreshVariant_ = variantIndex_;
+    loadingParser_ = refreshParser_.get();
+    return url;
+}
+
+std::chrono::milliseconds HLSDemuxer::refreshInterval() const noexcept {
+    auto media = mediaParser(variantIndex_);
+    if (!media || media->canBlockReload()) {
+        return std::chrono::milliseconds(0);
+    }
+    auto interval = media->partTargetDuration() > 0.0 ? media->partTargetDuration() : media->targetDuration();
+    return std::chrono::milliseconds(static_cast<int64_t>(interval * 1000));
+}
+
 void HLSDemuxer::close() noexcept {
     seekTsIndex_ = kInvalidTSIndex;
     baseUrl_.clear();
     buffer_.reset();
+    loadingParser_ = nullptr;
     mainParser_.reset();
-    slinkParser_.reset();
+    refreshParser_.reset();
+    variantParsers_.clear();
+    variantIndex_ = 0;
+    liveStartTime_ = 0.0;
     tsDemuxer_.reset();
 }
 
+void HLSDemuxer::prepareVariant(uint32_t index) noexcept {
+    if (index >= variantParsers_.size()) {
+        LogE("prepare variant error:{}, count:{}", index, variantParsers_.size());
+        return;
+    }
+    //segments of a media play list are relative to its own url
+    const auto& url = mainParser_->playListInfos()[index].m3u8Url;
+    auto pos = url.find_last_of('/');
+    variantParsers_[index] = std::make_unique<M3U8Parser>(pos == std::string::npos ? baseUrl_ : url.substr(0, pos));
+    loadingParser_ = variantParsers_[index].get();
+}
+
+bool HLSDemuxer::isVariantLoaded(uint32_t index) const noexcept {
+    return index < variantParsers_.size() && variantParsers_[index] && variantParsers_[index]->isLoaded();
+}
+
+bool HLSDemuxer::switchVariant(uint32_t index) noexcept {
+    if (!isVariantLoaded(index)) {
+        LogE("variant is not loaded:{}", index);
+        return false;
+    }
+    variantIndex_ = index;
+    LogI("switch to variant:{}", index);
+    return true;
+}
+
 void HLSDemuxer::seekPos(uint64_t index) noexcept {
     if (!isOpened_) {
         LogE("demuxer closed");
         return;
     }
-    auto& infos = getTSInfos();
     auto tsIndex = static_cast<size_t>(index);
-    if (tsIndex < infos.size()) {
-        auto pos = infos[tsIndex].range.start();
-        IDemuxer::seekPos(pos);
+    auto pos = withTSInfos([tsIndex](const auto& infos) -> std::optional<uint64_t> {
+        if (tsIndex < infos.size()) {
+            return infos[tsIndex].range.start();
+        }
+        return std::nullopt;
+    });
+    if (pos) {
+        IDemuxer::seekPos(*pos);
     }
     if (tsDemuxer_) {
         tsDemuxer_->resetData();
@@ -737,21 +1193,21 @@ uint64_t HLSDemuxer::getSeekToPos(double time) noexcept {
     if (!isOpened_) {
         return kInvalidTSIndex;
     }
-    auto comp = [time](const auto& tsInfo){
-        return tsInfo.startTime <= time && time <= tsInfo.endTime();
-    };
-    auto& infos = getTSInfos();
-    auto it = std::find_if(infos.begin(), infos.end(), comp);
-    if (it == infos.end()) {
+    auto media = mediaParser(variantIndex_);
+    if (!media) {
         return kInvalidTSIndex;
     }
-    return it->sequence;
+    std::lock_guard<std::mutex> lock(infosMutex_);
+    auto tsIndex = media->tsIndexOf(time + liveStartTime_);
+    return tsIndex == M3U8Parser::kNotFound ? kInvalidTSIndex : tsIndex;
 }
 
 const std::vector<TSInfo>& HLSDemuxer::getTSInfos() const noexcept {
     SAssert(mainParser_ != nullptr, "demuxer closed");
     if (isPlayList()) {
-        return slinkParser_->TSInfos();
+        static const std::vector<TSInfo> kEmptyInfos;
+        auto index = variantIndex_.load();
+        return index < variantParsers_.size() && variantParsers_[index] ? variantParsers_[index]->TSInfos() : kEmptyInfos;
     }
     return mainParser_->TSInfos();
 }
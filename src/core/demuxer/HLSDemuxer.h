@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <mutex>
 #include "Buffer.hpp"
 #include "IDemuxer.h"
 #include "IOBase.h"
@@ -14,18 +15,37 @@
 
 namespace slark {
 
+///a partial segment of low-latency hls, EXT-X-PART
+struct TSPart {
+    bool isIndependent = false;
+    double duration = 0.0;
+    std::string url;
+    Range range;
+};
+
 struct TSInfo {
     bool isDiscontinuity = false;
     bool isSupportByteRange = false;
+    ///position in the parser, the ts index
     uint32_t sequence = 0;
+    ///EXT-X-MEDIA-SEQUENCE based number, stable across reloads of a live play list
+    uint64_t mediaSequence = 0;
     double duration = 0.0;
     double startTime = 0.0;
-    std::string url;
+    ///shared by the segments of a play list, the url is the prefix followed by the name
+    std::shared_ptr<const std::string> urlPrefix;
+    std::string urlName;
     Range range;
+    ///partial segments listed for the segments near the live edge
+    std::vector<TSPart> parts;
     
     double endTime() const noexcept {
         return startTime + duration;
     }
+
+    std::string url() const noexcept {
+        return urlPrefix ? *urlPrefix + urlName : urlName;
+    }
 };
 
 struct PlayListInfo {
@@ -35,10 +55,20 @@ struct PlayListInfo {
 };
 
 struct M3U8Parser : public NonCopyable {
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+
     M3U8Parser(std::string  baseUrl);
     ~M3U8Parser() = default;
     void reset() noexcept;
     bool parse(Buffer& buffer) noexcept;
+
+    ///the whole response is parsed, a media play list without EXT-X-ENDLIST is live
+    void finish() noexcept {
+        isLoaded_ = true;
+    }
+
+    ///append the segments of a reloaded live play list that are new by media sequence
+    void merge(M3U8Parser& reloaded) noexcept;
     
     const std::vector<PlayListInfo>& playListInfos() const noexcept {
         return playListInfos_;
@@ -59,13 +89,66 @@ struct M3U8Parser : public NonCopyable {
     double totalDuration() const noexcept {
         return totalDuration_;
     }
+
+    bool isLoaded() const noexcept {
+        return isLoaded_;
+    }
+
+    bool isLive() const noexcept {
+        return isLoaded_ && !isPlayList_ && !isCompleted_;
+    }
+
+    bool canBlockReload() const noexcept {
+        return canBlockReload_;
+    }
+
+    double targetDuration() const noexcept {
+        return targetDuration_;
+    }
+
+    double partTargetDuration() const noexcept {
+        return partTargetDuration_;
+    }
+
+    ///distance from the live edge to start playing at, seconds
+    double holdBack() const noexcept;
+
+    ///the ts playing at the time, kNotFound outside of the play list
+    uint32_t tsIndexOf(double time) const noexcept;
+
+    ///parts of the segment after the last listed one
+    const std::vector<TSPart>& openParts() const noexcept {
+        return parts_;
+    }
+private:
+    void parsePart(std::string_view attributes) noexcept;
+
+    void parseServerControl(std::string_view attributes) noexcept;
+
+    ///split the url into an interned prefix and the name
+    void setUrl(TSInfo& info, std::string_view view) noexcept;
+
+    void addInfo(TSInfo&& info) noexcept;
 private:
     bool isPlayList_ = false;
     bool isCompleted_ = false;
+    bool isLoaded_ = false;
+    bool canBlockReload_ = false;
     uint32_t index = 0;
+    ///media sequence of the next EXTINF of this response
+    uint64_t mediaSequence_ = 0;
     double totalDuration_ = 0.0;
+    double targetDuration_ = 0.0;
+    double partTargetDuration_ = 0.0;
+    double holdBack_ = 0.0;
+    double partHoldBack_ = 0.0;
     std::string baseUrl_;
+    std::shared_ptr<const std::string> basePrefix_;
+    std::vector<std::shared_ptr<const std::string>> urlPrefixes_;
     std::vector<TSInfo> infos_;
+    ///start time of every ts, a compact copy for searching by time
+    std::vector<double> startTimes_;
+    std::vector<TSPart> parts_;
     std::vector<PlayListInfo> playListInfos_;
 };
 
@@ -105,6 +188,14 @@ struct TSPESFrame {
     int64_t pts = 0;
     int64_t dts = 0;
     Data mediaData;
+    ///payload size of the last pes, reserved up front when the pes header has no length
+    uint64_t sizeHint = 0;
+
+    ///hand the payload to the frames, its size is kept as the hint of the next pes
+    DataRefPtr detach() noexcept {
+        sizeHint = mediaData.length;
+        return std::make_shared<Data>(std::move(mediaData));
+    }
     
     void reset() noexcept {
         pts = 0;
@@ -189,9 +280,28 @@ private:
     
     bool parseTSPes(DataView data, uint8_t payloadIndicator, TSPESFrame& pes) noexcept;
     
+    ///take the pending video pes and find its nalus, nullptr if there is none
+    DataRefPtr splitVideoPacket(std::vector<Range>& naluRanges) noexcept;
+
+    ///keep a changed vps, sps or pps, the decoder is told about it again
+    bool updateParameterSet(DataRefPtr& parameterSet, DataView view) noexcept;
+
+    ///a later slice of the picture in frames.back()
+    static void appendSlice(AVFramePtrArray& frames, const DataRefPtr& block, Range range) noexcept;
+
+    void pushVideoFrame(uint32_t tsIndex,
+                        std::shared_ptr<VideoFrameInfo> info,
+                        const DataRefPtr& block,
+                        Range range,
+                        AVFramePtrArray& frames) noexcept;
+
     bool packH264VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept;
+
+    bool packH265VideoPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept;
     
-    static void writeVideoData(AVFramePtr& frame, DataView view) noexcept;
+    static void writeVideoHeader(uint8_t* header, uint64_t naluLength) noexcept;
+
+    static void writeVideoData(AVFramePtr& frame, const DataRefPtr& block, Range range) noexcept;
     
     bool packAudioPacket(uint32_t tsIndex, AVFramePtrArray& frames) noexcept;
     
@@ -200,6 +310,7 @@ private:
 
 private:
     static constexpr uint32_t kPacketSize = 188;
+    static constexpr uint64_t kVideoHeaderSize = 4;
     TSPAT pat_;
     TSPMT pmt_;
     TSPESFrame audioESFrame_;
@@ -209,6 +320,8 @@ private:
     TSPtsFixInfo videoFixInfo_;
     std::shared_ptr<AudioInfo>& audioInfo_;
     std::shared_ptr<VideoInfo>& videoInfo_;
+    ///num_extra_slice_header_bits of the last hevc pps
+    uint32_t extraSliceHeaderBits_ = 0;
 };
 
 class HLSDemuxer : public IDemuxer {
@@ -229,8 +342,13 @@ public:
     
     ///In HLS, this function obtains the ts index, not the offset of the file
     uint64_t getSeekToPos(double) noexcept override;
-    
-    const std::vector<TSInfo>& getTSInfos() const noexcept;
+
+    ///call func with the ts infos of the current variant, a live reload appends to them meanwhile
+    template<typename Func>
+    decltype(auto) withTSInfos(Func&& func) const noexcept {
+        std::lock_guard<std::mutex> lock(infosMutex_);
+        return func(getTSInfos());
+    }
     
     inline static const DemuxerInfo& info() noexcept {
         static DemuxerInfo info = {
@@ -243,7 +361,7 @@ public:
     
     bool isPlayList() const noexcept {
         if (mainParser_) {
-            mainParser_->isPlayList();
+            return mainParser_->isPlayList();
         }
         return false;
     }
@@ -251,12 +369,55 @@ public:
     const std::vector<PlayListInfo>& playListInfos() const noexcept {
         return mainParser_->playListInfos();
     }
+
+    ///the m3u8 response fed to open is complete
+    bool loadCompleted() noexcept;
+
+    ///the media play list has no end yet and is reloaded while playing
+    [[nodiscard]] bool isLive() const noexcept override;
+
+    ///the ts to start a live play list at, it may be the open segment that only has parts
+    uint32_t liveStartIndex() noexcept;
+
+    ///parts of the live segment after the listed ones
+    [[nodiscard]] std::vector<TSPart> openParts() const noexcept;
+
+    ///the following m3u8 data reloads the live media play list, returns its url
+    std::string prepareRefresh() noexcept;
+
+    ///wait before reloading a live play list, 0 if the server blocks until it changes
+    [[nodiscard]] std::chrono::milliseconds refreshInterval() const noexcept;
+
+    ///the following m3u8 data is the media play list of the variant
+    void prepareVariant(uint32_t index) noexcept;
+
+    [[nodiscard]] bool isVariantLoaded(uint32_t index) const noexcept;
+
+    ///ts infos and the segments after this come from the variant, it must be loaded
+    bool switchVariant(uint32_t index) noexcept;
     
+private:
+    ///the media play list of the variant, the main one without a master play list
+    M3U8Parser* mediaParser(uint32_t variantIndex) const noexcept;
+
+    ///infosMutex_ must be held
+    const std::vector<TSInfo>& getTSInfos() const noexcept;
 private:
     static constexpr uint64_t kInvalidTSIndex = UINT64_MAX;
     uint64_t seekTsIndex_ = kInvalidTSIndex;
     std::unique_ptr<M3U8Parser> mainParser_;
-    std::unique_ptr<M3U8Parser> slinkParser_;
+    ///media play lists of a master play list, only live ones grow after loading
+    std::vector<std::unique_ptr<M3U8Parser>> variantParsers_;
+    ///a reload of a live play list, merged into its variant when complete
+    std::unique_ptr<M3U8Parser> refreshParser_;
+    ///guards the ts infos and parts of the media play lists against the merge of a reload
+    mutable std::mutex infosMutex_;
+    ///the parser the m3u8 data goes to
+    M3U8Parser* loadingParser_ = nullptr;
+    std::atomic<uint32_t> variantIndex_ = 0;
+    uint32_t refreshVariant_ = 0;
+    ///start time of the first ts played in a live play list
+    double liveStartTime_ = 0.0;
     std::unique_ptr<TSDemuxer> tsDemuxer_;
     std::string baseUrl_;
 };
@@ -98,6 +98,11 @@ public:
         return isCompleted_;
     }
 
+    ///the content keeps growing while it is played, it has no fixed duration
+    [[nodiscard]] virtual bool isLive() const noexcept {
+        return false;
+    }
+
     [[nodiscard]] bool hasVideo() const noexcept {
         return videoInfo_ != nullptr;
     }
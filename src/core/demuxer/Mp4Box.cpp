@@ -5,8 +5,10 @@
 //  Created by Nevermore
 //
 
+#include <bit>
 #include <format>
 #include "Mp4Box.hpp"
+#include "BitReader.h"
 #include "Util.hpp"
 
 namespace slark {
@@ -16,7 +18,7 @@ std::expected<BoxInfo, bool> Box::tryParseBoxInfo(Buffer& buffer) noexcept {
         return std::unexpected(false);
     }
     BoxInfo info;
-    info.start = static_cast<uint32_t>(buffer.pos());
+    info.start = buffer.pos();
     uint32_t tmpSize = 0;
     if (!buffer.read4ByteBE(tmpSize)) {
         return std::unexpected(false);
@@ -74,6 +76,7 @@ BoxRefPtr Box::createBox(Buffer& buffer) {
         {"mvhd", [](BoxInfo&& info) { return new BoxMvhd(std::move(info)); }},
         {"stsd", [](BoxInfo&& info) { return new BoxStsd(std::move(info)); }},
         {"stco", [](BoxInfo&& info) { return new BoxStco(std::move(info)); }},
+        {"co64", [](BoxInfo&& info) { return new BoxStco(std::move(info)); }},
         {"stsz", [](BoxInfo&& info) { return new BoxStsz(std::move(info)); }},
         {"stsc", [](BoxInfo&& info) { return new BoxStsc(std::move(info)); }},
         {"stts", [](BoxInfo&& info) { return new BoxStts(std::move(info)); }},
@@ -83,7 +86,15 @@ BoxRefPtr Box::createBox(Buffer& buffer) {
         {"meta", [](BoxInfo&& info) { return new BoxMeta(std::move(info)); }},
         {"avcC", [](BoxInfo&& info) { return new BoxAvcc(std::move(info)); }},
         {"hvcC", [](BoxInfo&& info) { return new BoxHvcc(std::move(info)); }},
-        {"mdhd", [](BoxInfo&& info) { return new BoxMdhd(std::move(info)); }}
+        {"mdhd", [](BoxInfo&& info) { return new BoxMdhd(std::move(info)); }},
+        {"tkhd", [](BoxInfo&& info) { return new BoxTkhd(std::move(info)); }},
+        {"mehd", [](BoxInfo&& info) { return new BoxMehd(std::move(info)); }},
+        {"trex", [](BoxInfo&& info) { return new BoxTrex(std::move(info)); }},
+        {"sidx", [](BoxInfo&& info) { return new BoxSidx(std::move(info)); }},
+        {"mfhd", [](BoxInfo&& info) { return new BoxMfhd(std::move(info)); }},
+        {"tfhd", [](BoxInfo&& info) { return new BoxTfhd(std::move(info)); }},
+        {"tfdt", [](BoxInfo&& info) { return new BoxTfdt(std::move(info)); }},
+        {"trun", [](BoxInfo&& info) { return new BoxTrun(std::move(info)); }}
     };
     if (boxFactory.contains(boxInfo.symbol)) {
         auto box = boxFactory.at(boxInfo.symbol)(std::move(boxInfo));
@@ -176,10 +187,26 @@ bool BoxMvhd::decode(Buffer& buffer) noexcept {
     }
     buffer.readByte(version);
     buffer.read3ByteBE(flags);
-    buffer.read4ByteBE(creationTime);
-    buffer.read4ByteBE(modificationTime);
-    buffer.read4ByteBE(timeScale);
-    buffer.read4ByteBE(duration);
+    if (version == 1) {
+        //64-bit times, 12 bytes more
+        if (!buffer.require(112 - 4)) {
+            buffer.skip(-4);
+            return false;
+        }
+        buffer.read8ByteBE(creationTime);
+        buffer.read8ByteBE(modificationTime);
+        buffer.read4ByteBE(timeScale);
+        buffer.read8ByteBE(duration);
+    } else {
+        uint32_t value = 0;
+        buffer.read4ByteBE(value);
+        creationTime = value;
+        buffer.read4ByteBE(value);
+        modificationTime = value;
+        buffer.read4ByteBE(timeScale);
+        buffer.read4ByteBE(value);
+        duration = value;
+    }
     uint16_t hRate = 0, lRate = 0;
     buffer.read2ByteBE(hRate);
     buffer.read2ByteBE(lRate);
@@ -392,125 +419,60 @@ bool BoxStsc::decode(Buffer& buffer) noexcept {
     return res;
 }
 
+///remember where the entries of a sample table start, they are read later by the sample index.
+///false if the box is too small for its entries
+bool locateTableEntries(const Buffer& buffer, const BoxInfo& info, uint32_t entryCount, uint32_t entrySize, uint64_t& entryStart) noexcept {
+    entryStart = buffer.pos();
+    return entryStart + static_cast<uint64_t>(entryCount) * entrySize <= info.end();
+}
+
 bool BoxStsz::decode(Buffer& buffer) noexcept {
     if (!buffer.require(12)) {
         return false;
     }
-    
-    int32_t offset = 0;
     buffer.skip(1 + 3); //version + flags
-    offset += 4;
-    
-    uint32_t sampleSize = 0;
     buffer.read4ByteBE(sampleSize);
-    offset += 4;
-    
-    uint32_t entryCount = 0;
-    buffer.read4ByteBE(entryCount);
-    offset += 4;
-    
-    if (sampleSize != 0) {
-        sampleSizes = std::vector<uint64_t>(entryCount, sampleSize);
-    } else {
-        bool res = true;
-        for (uint32_t i = 0; i < entryCount; i++) {
-            uint32_t size = 0;
-            if (!buffer.read4ByteBE(size)) {
-                res = false;
-                break;
-            }
-            offset += 4;
-            sampleSizes.push_back(size);
-        }
-        if (!res) {
-            buffer.skip(-offset);
-        }
-        return res;
-    }
-    return true;
+    buffer.read4ByteBE(sampleCount);
+    return locateTableEntries(buffer, info, sampleSize == 0 ? sampleCount : 0, 4, entryStart);
 }
 
 bool BoxStco::decode(Buffer& buffer) noexcept {
-    if (!buffer.require(12)) {
+    if (!buffer.require(8)) {
         return false;
     }
-    
-    int32_t offset = 0;
     buffer.skip(1 + 3); //version + flags
-    offset += 4;
-    
-    uint32_t entryCount = 0;
     buffer.read4ByteBE(entryCount);
-    offset += 4;
-    
-    bool res = true;
-    for (uint32_t i = 0; i < entryCount; i++) {
-        uint32_t size = 0;
-        if (!buffer.read4ByteBE(size)) {
-            res = false;
-            break;
-        }
-        offset += 4;
-        chunkOffsets.push_back(size);
-    }
-    if (!res) {
-        buffer.skip(-offset);
-    }
-    return res;
+    //co64 addresses chunks past 4 GB
+    is64Bit = info.symbol == "co64";
+    return locateTableEntries(buffer, info, entryCount, is64Bit ? 8 : 4, entryStart);
 }
 
 bool BoxStts::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(8)) {
+        return false;
+    }
     buffer.skip(1 + 3); //version + flags
-    
-    uint32_t entryCount = 0;
     buffer.read4ByteBE(entryCount);
-    
-    bool res = true;
-    for (uint32_t i = 0; i < entryCount; i++) {
-        SttsEntry entry;
-        buffer.read4ByteBE(entry.sampleCount);
-        buffer.read4ByteBE(entry.sampleDelta);
-        entrys.push_back(entry);
-    }
-    return res;
-}
-
-uint32_t BoxStts::sampleSize() const noexcept {
-    uint32_t count = 0;
-    for (auto& entry : entrys) {
-        count += entry.sampleCount;
-    }
-    return count;
+    return locateTableEntries(buffer, info, entryCount, 8, entryStart);
 }
 
 bool BoxCtts::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(8)) {
+        return false;
+    }
     buffer.readByte(version);
     buffer.skip(3); //flags
-    
-    uint32_t entryCount = 0;
     buffer.read4ByteBE(entryCount);
-
-    for (size_t i = 0; i < entryCount; i++) {
-        CttsEntry entry;
-        buffer.read4ByteBE(entry.sampleCount);
-        uint32_t sampleOffset = 0;
-        buffer.read4ByteBE(sampleOffset);
-        entry.sampleOffset = static_cast<int32_t>(sampleOffset);
-        entrys.push_back(entry);
-    }
-    return true;
+    return locateTableEntries(buffer, info, entryCount, 8, entryStart);
 }
 
 bool BoxStss::decode(Buffer& buffer) noexcept {
-    buffer.skip(1 + 3); //version + flags
-    uint32_t size = 0;
-    buffer.read4ByteBE(size);
-    for (size_t i = 0; i < size; i++) {
-        uint32_t index = 0;
-        buffer.read4ByteBE(index);
-        keyIndexs.push_back(index);
+    if (!buffer.require(8)) {
+        return false;
     }
-    return true;
+    buffer.skip(1 + 3); //version + flags
+    buffer.read4ByteBE(entryCount);
+    return locateTableEntries(buffer, info, entryCount, 4, entryStart);
 }
 
 std::string BoxEsds::description(const std::string& prefix) const noexcept {
@@ -571,22 +533,22 @@ bool BoxEsds::decode(Buffer& buffer) noexcept {
         if (objectTypeId == 0x40) {
             codecId = CodecId::AAC;
             if (esDescTag == 0x05) {
-                BitReadView view(buffer);
-                audioSpecConfig.audioObjectType = uint8_t(view.readBits(5));
-                audioSpecConfig.samplingFrequencyIndex = view.readBits(4);
+                BitReader reader(buffer.shotView(static_cast<uint64_t>(descLen)), false);
+                audioSpecConfig.audioObjectType = uint8_t(reader.readBits(5));
+                audioSpecConfig.samplingFrequencyIndex = reader.readBits(4);
                 if (audioSpecConfig.samplingFrequencyIndex == 0x0f) {
-                    audioSpecConfig.samplingFrequencyIndex = view.readBits(24);
+                    audioSpecConfig.samplingFrequencyIndex = reader.readBits(24);
                 }
-                audioSpecConfig.channelConfiguration = uint8_t(view.readBits(4));
+                audioSpecConfig.channelConfiguration = uint8_t(reader.readBits(4));
                 if (audioSpecConfig.audioObjectType == 5 ||
                     audioSpecConfig.audioObjectType == 29) {
-                    audioSpecConfig.samplingFreqIndexExt = view.readBits(4);
+                    audioSpecConfig.samplingFreqIndexExt = reader.readBits(4);
                     if (audioSpecConfig.samplingFreqIndexExt == 0x0f) {
-                        audioSpecConfig.samplingFreqIndexExt = view.readBits(24);
+                        audioSpecConfig.samplingFreqIndexExt = reader.readBits(24);
                     }
-                    audioSpecConfig.audioObjectTypeExt = uint8_t(view.readBits(5));
+                    audioSpecConfig.audioObjectTypeExt = uint8_t(reader.readBits(5));
                 }
-
+                buffer.skip(static_cast<int64_t>((reader.bitPos() + 7) / 8));
             }
         } else if (objectTypeId == 0x6b) {
             codecId = CodecId::MP3;
@@ -749,4 +711,196 @@ bool BoxHvcc::decode(Buffer& buffer) noexcept {
     return true;
 }
 
+bool BoxTkhd::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(4 + 8 + 4)) {
+        return false;
+    }
+    buffer.readByte(version);
+    buffer.read3ByteBE(flags);
+    buffer.skip(version == 1 ? 8 + 8 : 4 + 4); //creation time + modification time
+    return buffer.read4ByteBE(trackId);
+}
+
+bool BoxMehd::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(4 + 4)) {
+        return false;
+    }
+    buffer.readByte(version);
+    buffer.skip(3); //flags
+    if (version == 1) {
+        return buffer.read8ByteBE(fragmentDuration);
+    }
+    uint32_t duration = 0;
+    buffer.read4ByteBE(duration);
+    fragmentDuration = duration;
+    return true;
+}
+
+bool BoxTrex::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(4 + 5 * 4)) {
+        return false;
+    }
+    buffer.skip(1 + 3); //version + flags
+    buffer.read4ByteBE(trackId);
+    buffer.read4ByteBE(defaultSampleDescriptionIndex);
+    buffer.read4ByteBE(defaultSampleDuration);
+    buffer.read4ByteBE(defaultSampleSize);
+    buffer.read4ByteBE(defaultSampleFlags);
+    return true;
+}
+
+//sidx
+//  |--- (4byte) version + flags
+//  |--- (4byte) reference_ID
+//  |--- (4byte) timescale
+//  |--- (4/8byte) earliest_presentation_time, first_offset
+//  |--- (2byte) reserved, (2byte) reference_count
+//  |--- references: 1bit reference_type + 31bit referenced_size
+//                   (4byte) subsegment_duration
+//                   1bit starts_with_SAP + 3bit SAP_type + 28bit SAP_delta_time
+bool BoxSidx::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(info.size - info.headerSize)) {
+        return false;
+    }
+    buffer.readByte(version);
+    buffer.skip(3); //flags
+    buffer.read4ByteBE(referenceId);
+    buffer.read4ByteBE(timeScale);
+    if (version == 0) {
+        uint32_t time = 0;
+        uint32_t offset = 0;
+        buffer.read4ByteBE(time);
+        buffer.read4ByteBE(offset);
+        earliestPresentationTime = time;
+        firstOffset = offset;
+    } else {
+        buffer.read8ByteBE(earliestPresentationTime);
+        buffer.read8ByteBE(firstOffset);
+    }
+    buffer.skip(2); //reserved
+    uint16_t referenceCount = 0;
+    buffer.read2ByteBE(referenceCount);
+    references.reserve(referenceCount);
+    for (uint16_t i = 0; i < referenceCount; i++) {
+        uint32_t value = 0;
+        SidxReference reference;
+        if (!buffer.read4ByteBE(value)) {
+            return false;
+        }
+        reference.isIndex = (value >> 31) != 0;
+        reference.referencedSize = value & 0x7fffffff;
+        buffer.read4ByteBE(reference.subsegmentDuration);
+        buffer.read4ByteBE(value);
+        reference.startsWithSap = (value >> 31) != 0;
+        references.push_back(reference);
+    }
+    return true;
+}
+
+bool BoxMfhd::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(4 + 4)) {
+        return false;
+    }
+    buffer.skip(1 + 3); //version + flags
+    return buffer.read4ByteBE(sequenceNumber);
+}
+
+bool BoxTfhd::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(info.size - info.headerSize)) {
+        return false;
+    }
+    buffer.skip(1); //version
+    buffer.read3ByteBE(flags);
+    buffer.read4ByteBE(trackId);
+    auto readOptional = [&buffer](std::optional<uint32_t>& value) {
+        uint32_t v = 0;
+        buffer.read4ByteBE(v);
+        value = v;
+    };
+    if (flags & kBaseDataOffsetPresent) {
+        uint64_t offset = 0;
+        buffer.read8ByteBE(offset);
+        baseDataOffset = offset;
+    }
+    if (flags & kSampleDescriptionIndexPresent) {
+        readOptional(sampleDescriptionIndex);
+    }
+    if (flags & kDefaultSampleDurationPresent) {
+        readOptional(defaultSampleDuration);
+    }
+    if (flags & kDefaultSampleSizePresent) {
+        readOptional(defaultSampleSize);
+    }
+    if (flags & kDefaultSampleFlagsPresent) {
+        readOptional(defaultSampleFlags);
+    }
+    return true;
+}
+
+bool BoxTfdt::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(4 + 4)) {
+        return false;
+    }
+    buffer.readByte(version);
+    buffer.skip(3); //flags
+    if (version == 1) {
+        return buffer.read8ByteBE(baseMediaDecodeTime);
+    }
+    uint32_t time = 0;
+    buffer.read4ByteBE(time);
+    baseMediaDecodeTime = time;
+    return true;
+}
+
+//trun
+//  |--- (1byte) version, (3byte) flags
+//  |--- (4byte) sample_count
+//  |--- (4byte) data_offset, if flags & 0x000001
+//  |--- (4byte) first_sample_flags, if flags & 0x000004
+//  |--- samples: duration (0x000100), size (0x000200), flags (0x000400), composition offset (0x000800),
+//                4 bytes for every field that is present
+bool BoxTrun::decode(Buffer& buffer) noexcept {
+    if (!buffer.require(info.size - info.headerSize)) {
+        return false;
+    }
+    buffer.readByte(version);
+    buffer.read3ByteBE(flags);
+    uint32_t sampleCount = 0;
+    buffer.read4ByteBE(sampleCount);
+    if (flags & kDataOffsetPresent) {
+        uint32_t offset = 0;
+        buffer.read4ByteBE(offset);
+        dataOffset = static_cast<int32_t>(offset);
+    }
+    if (flags & kFirstSampleFlagsPresent) {
+        uint32_t sampleFlags = 0;
+        buffer.read4ByteBE(sampleFlags);
+        firstSampleFlags = sampleFlags;
+    }
+    auto fieldCount = static_cast<uint64_t>(std::popcount(flags & (kSampleDurationPresent | kSampleSizePresent |
+                                                                   kSampleFlagsPresent | kSampleCompositionOffsetPresent)));
+    if (!buffer.require(fieldCount * 4 * sampleCount)) {
+        return false;
+    }
+    entrys.resize(sampleCount);
+    for (auto& entry : entrys) {
+        if (flags & kSampleDurationPresent) {
+            buffer.read4ByteBE(entry.duration);
+        }
+        if (flags & kSampleSizePresent) {
+            buffer.read4ByteBE(entry.size);
+        }
+        if (flags & kSampleFlagsPresent) {
+            buffer.read4ByteBE(entry.flags);
+        }
+        if (flags & kSampleCompositionOffsetPresent) {
+            uint32_t offset = 0;
+            buffer.read4ByteBE(offset);
+            //version 0 offsets are unsigned, but negative ones written as version 0 show up in the wild
+            entry.compositionOffset = static_cast<int32_t>(offset);
+        }
+    }
+    return true;
+}
+
 }
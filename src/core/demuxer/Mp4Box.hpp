@@ -5,6 +5,7 @@
 //  Created by Nevermore
 //
 
+#include <optional>
 #include "Buffer.hpp"
 
 namespace slark {
@@ -24,7 +25,7 @@ using BoxRefPtr = std::shared_ptr<Box>;
 using BoxPtr = std::unique_ptr<Box>;
 
 struct BoxInfo {
-    uint32_t start = 0;
+    uint64_t start = 0;
     uint32_t type = 0;
     uint64_t size = 0;
     uint32_t headerSize = 8;
@@ -82,10 +83,10 @@ class BoxMvhd : public Box
 public:
     uint8_t version{};
     uint32_t flags{};
-    uint32_t creationTime{};
-    uint32_t modificationTime{};
+    uint64_t creationTime{};
+    uint64_t modificationTime{};
     uint32_t timeScale{};
-    uint32_t duration{};
+    uint64_t duration{};
     float preferredRate{};
     float preferredVolume{};
     std::string reserved{};
@@ -194,11 +195,15 @@ public:
     bool decode(Buffer&) noexcept override;
 };
 
-///Sample Size
+///Sample Size, the entries stay in the file and are read once into the sample index
 class BoxStsz : public Box
 {
 public:
-    std::vector<uint64_t> sampleSizes;
+    ///every sample has this size when it is not 0, there are no entries then
+    uint32_t sampleSize{};
+    uint32_t sampleCount{};
+    ///file position of the first entry
+    uint64_t entryStart{};
 public:
     BoxStsz(BoxInfo&& boxInfo)
         : Box(std::move(boxInfo)) {
@@ -210,11 +215,14 @@ public:
     bool decode(Buffer&) noexcept override;
 };
 
-///Chunk Offset
+///Chunk Offset, 32-bit in stco and 64-bit in co64
 class BoxStco : public Box
 {
 public:
-    std::vector<uint64_t> chunkOffsets;
+    bool is64Bit = false;
+    uint32_t entryCount{};
+    ///file position of the first entry
+    uint64_t entryStart{};
 public:
     BoxStco(BoxInfo&& boxInfo)
         : Box(std::move(boxInfo)) {
@@ -226,17 +234,13 @@ public:
     bool decode(Buffer&) noexcept override;
 };
 
-struct SttsEntry
-{
-    uint32_t sampleCount{};
-    uint32_t sampleDelta{};
-};
-
-///Time-to-Sample
+///Time-to-Sample, entries of sample count and sample delta
 class BoxStts : public Box
 {
 public:
-    std::vector<SttsEntry> entrys;
+    uint32_t entryCount{};
+    ///file position of the first entry
+    uint64_t entryStart{};
 public:
     BoxStts(BoxInfo&& boxInfo)
         : Box(std::move(boxInfo)) {
@@ -246,18 +250,15 @@ public:
 
 public:
     bool decode(Buffer&) noexcept override;
-    uint32_t sampleSize() const noexcept;
-};
-
-struct CttsEntry {
-    uint32_t sampleCount{};
-    int32_t sampleOffset{};
 };
 
+///Composition Time to Sample, entries of sample count and sample offset
 class BoxCtts : public Box {
 public:
     uint8_t version{};
-    std::vector<CttsEntry> entrys;
+    uint32_t entryCount{};
+    ///file position of the first entry
+    uint64_t entryStart{};
 public:
     BoxCtts(BoxInfo&& boxInfo)
         : Box(std::move(boxInfo)) {
@@ -269,9 +270,12 @@ public:
     bool decode(Buffer&) noexcept override;
 };
 
+///Sync Sample, entries of 1-based key frame numbers
 class BoxStss : public Box {
 public:
-    std::vector<uint32_t> keyIndexs;
+    uint32_t entryCount{};
+    ///file position of the first entry
+    uint64_t entryStart{};
 public:
     BoxStss(BoxInfo&& boxInfo)
         : Box(std::move(boxInfo)) {
@@ -379,4 +383,179 @@ public:
     std::string description(const std::string&) const noexcept override;
 };
 
+///Track Header, only the track id is kept
+class BoxTkhd : public Box {
+public:
+    uint8_t version{};
+    uint32_t flags{};
+    uint32_t trackId{};
+public:
+    BoxTkhd(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxTkhd() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+///Movie Extends Header, duration of the whole fragmented movie in the mvhd timescale
+class BoxMehd : public Box {
+public:
+    uint8_t version{};
+    uint64_t fragmentDuration{};
+public:
+    BoxMehd(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxMehd() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+///Track Extends, sample defaults of every fragment of a track
+class BoxTrex : public Box {
+public:
+    uint32_t trackId{};
+    uint32_t defaultSampleDescriptionIndex{};
+    uint32_t defaultSampleDuration{};
+    uint32_t defaultSampleSize{};
+    uint32_t defaultSampleFlags{};
+public:
+    BoxTrex(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxTrex() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+struct SidxReference {
+    ///the reference points to another sidx instead of a moof
+    bool isIndex = false;
+    uint32_t referencedSize{};
+    uint32_t subsegmentDuration{};
+    bool startsWithSap = false;
+};
+
+///Segment Index, time and size of every subsegment
+class BoxSidx : public Box {
+public:
+    uint8_t version{};
+    uint32_t referenceId{};
+    uint32_t timeScale{};
+    uint64_t earliestPresentationTime{};
+    ///the first subsegment starts this far after the end of the sidx
+    uint64_t firstOffset{};
+    std::vector<SidxReference> references;
+public:
+    BoxSidx(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxSidx() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+///Movie Fragment Header
+class BoxMfhd : public Box {
+public:
+    uint32_t sequenceNumber{};
+public:
+    BoxMfhd(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxMfhd() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+///Track Fragment Header, absent fields fall back to the trex defaults
+class BoxTfhd : public Box {
+public:
+    static constexpr uint32_t kBaseDataOffsetPresent = 0x000001;
+    static constexpr uint32_t kSampleDescriptionIndexPresent = 0x000002;
+    static constexpr uint32_t kDefaultSampleDurationPresent = 0x000008;
+    static constexpr uint32_t kDefaultSampleSizePresent = 0x000010;
+    static constexpr uint32_t kDefaultSampleFlagsPresent = 0x000020;
+    static constexpr uint32_t kDefaultBaseIsMoof = 0x020000;
+
+    uint32_t flags{};
+    uint32_t trackId{};
+    std::optional<uint64_t> baseDataOffset;
+    std::optional<uint32_t> sampleDescriptionIndex;
+    std::optional<uint32_t> defaultSampleDuration;
+    std::optional<uint32_t> defaultSampleSize;
+    std::optional<uint32_t> defaultSampleFlags;
+public:
+    BoxTfhd(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxTfhd() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+///Track Fragment Decode Time
+class BoxTfdt : public Box {
+public:
+    uint8_t version{};
+    uint64_t baseMediaDecodeTime{};
+public:
+    BoxTfdt(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxTfdt() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
+struct TrunEntry {
+    uint32_t duration{};
+    uint32_t size{};
+    uint32_t flags{};
+    int32_t compositionOffset{};
+};
+
+///Track Fragment Run, the fields of an entry are valid when their flag is set
+class BoxTrun : public Box {
+public:
+    static constexpr uint32_t kDataOffsetPresent = 0x000001;
+    static constexpr uint32_t kFirstSampleFlagsPresent = 0x000004;
+    static constexpr uint32_t kSampleDurationPresent = 0x000100;
+    static constexpr uint32_t kSampleSizePresent = 0x000200;
+    static constexpr uint32_t kSampleFlagsPresent = 0x000400;
+    static constexpr uint32_t kSampleCompositionOffsetPresent = 0x000800;
+    ///sample_is_non_sync_sample of the sample flags
+    static constexpr uint32_t kSampleIsNonSync = 0x010000;
+
+    uint8_t version{};
+    uint32_t flags{};
+    std::optional<int32_t> dataOffset;
+    std::optional<uint32_t> firstSampleFlags;
+    std::vector<TrunEntry> entrys;
+public:
+    BoxTrun(BoxInfo&& boxInfo)
+        : Box(std::move(boxInfo)) {
+        
+    }
+    ~BoxTrun() override = default;
+
+public:
+    bool decode(Buffer&) noexcept override;
+};
+
 }
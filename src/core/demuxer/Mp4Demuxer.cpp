@@ -5,6 +5,9 @@
 //  Created by Nevermore
 //
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <stack>
 #include <ranges>
 #include "IDemuxer.h"
@@ -13,6 +16,7 @@
 
 namespace slark {
 
+///udta and meta are left out, they are stepped over without decoding what they hold
 bool isContainerBox(std::string_view symbol) noexcept {
     using namespace std::string_view_literals;
     static const std::vector<std::string_view> kContainerBox = {
@@ -20,236 +24,516 @@ bool isContainerBox(std::string_view symbol) noexcept {
         "trak"sv,
         "edts"sv,
         "mdia"sv,
-        "meta"sv,
         "minf"sv,
         "stbl"sv,
         "dinf"sv,
-        "udta"sv,
+        "mvex"sv,
+        "moof"sv,
+        "traf"sv,
     };
     return std::any_of(kContainerBox.begin(), kContainerBox.end(), [symbol](const auto& view) {
         return view == symbol;
     });
 }
 
-void TrackContext::init() noexcept {
-    if (type == TrackType::Video && ctts) {
-        //Set pts to 0 and calculate the initial value of dts, which may be a negative number.
-        dts = pts - ctts->entrys[0].sampleOffset;
-        cttsEntrySampleIndex = 0;
+///Reads the entries of a sample table from the moov in the buffer, a batch at a time.
+///Every reader keeps its own position, so the tables of a track are walked side by side.
+class TableReader {
+public:
+    static constexpr uint64_t kBatchSize = 4096;
+
+    TableReader(Buffer& buffer, uint64_t start, uint64_t entryCount, uint32_t entrySize) noexcept
+        : buffer_(buffer)
+        , pos_(start)
+        , end_(start + entryCount * entrySize) {
+
     }
-}
 
-uint64_t TrackContext::getSeekPos(double targetTime) const noexcept {
-    if (!stts || !stsc || !stco || !stsz) {
-        return 0;
+    bool read(uint32_t& value) noexcept {
+        auto view = take(4);
+        return !view.empty() && Util::read4ByteBE(view, value);
     }
-    //found sample index
-    uint32_t sampleIndex = 0;
-    auto timeScale = static_cast<double>(mdhd->timeScale);
-    double currentTime = 0.0;
-    for (const auto& entry : stts->entrys) {
-        auto entryDuration = double(entry.sampleCount * entry.sampleDelta) / timeScale;
-        if (currentTime + entryDuration > targetTime) {
-            auto offset = static_cast<uint32_t>((targetTime - currentTime) * timeScale / entry.sampleDelta);
-            sampleIndex += std::min(offset, entry.sampleCount - 1);
-            break;
+
+    bool read(uint64_t& value) noexcept {
+        auto view = take(8);
+        return !view.empty() && Util::read8ByteBE(view, value);
+    }
+
+    ///a chunk offset of an stco or co64
+    bool readOffset(bool is64Bit, uint64_t& value) noexcept {
+        if (is64Bit) {
+            return read(value);
+        }
+        uint32_t value32 = 0;
+        if (!read(value32)) {
+            return false;
         }
-        currentTime += entryDuration;
-        sampleIndex += entry.sampleCount;
+        value = value32;
+        return true;
     }
-    if (sampleIndex == 0) {
-        //not found, default 1
-        sampleIndex = 1;
+
+    ///the next run of an stts or ctts with samples in it, false at the end of the table
+    bool readRun(uint32_t& count, uint32_t& value) noexcept {
+        uint32_t runCount = 0;
+        uint32_t runValue = 0;
+        do {
+            if (!read(runCount) || !read(runValue)) {
+                return false;
+            }
+        } while (runCount == 0);
+        count = runCount;
+        value = runValue;
+        return true;
     }
-    
-    uint32_t seekSampleIndex = sampleIndex;
-    if (type == TrackType::Video && stss) {
-        //found key frame index
-        const auto& keyIndexes = stss->keyIndexs;
-        auto it = std::lower_bound(keyIndexes.begin(), keyIndexes.end(), sampleIndex);
-        uint32_t keySampleIndex = it != keyIndexes.end() ? *it : keyIndexes.back();
-        seekSampleIndex = seekSampleIndex;
+
+    void skip(uint64_t size) noexcept {
+        auto rest = batch_.size() - cursor_;
+        if (size <= rest) {
+            cursor_ += size;
+        } else {
+            pos_ += size - rest;
+            cursor_ = batch_.size();
+        }
     }
-    
-    //found chunkIndex & sampleCount
-    uint32_t chunkIndex = 0;
-    uint32_t sampleCount = 0;
-    bool found = false;
-    for (size_t i = 0; i < stsc->entrys.size() && !found; ++i) {
-        const auto& entry = stsc->entrys[i];
-        uint32_t nextFirstChunk = (i + 1 < stsc->entrys.size()) ? stsc->entrys[i + 1].firstChunk : stco->chunkOffsets.size() + 1;
-        for (uint32_t chunk = entry.firstChunk; chunk < nextFirstChunk; ++chunk) {
-            uint32_t chunkSampleCount = entry.samplesPerChunk;
-            if (seekSampleIndex <= sampleCount + chunkSampleCount) {
-                chunkIndex = chunk - 1; // chunkOffsets start 0
-                found = true;
-                break;
-            }
-            sampleCount += chunkSampleCount;
+private:
+    DataView take(uint64_t size) noexcept {
+        if (cursor_ + size > batch_.size() && (!fill() || size > batch_.size())) {
+            return {};
         }
+        auto view = DataView(std::string_view(batch_).substr(cursor_, size));
+        cursor_ += size;
+        return view;
     }
-    if (!found) {
-        LogE("not found chunkIndex");
-        return 0;
+
+    bool fill() noexcept {
+        if (pos_ >= end_ || !buffer_.skipTo(static_cast<int64_t>(pos_))) {
+            return false;
+        }
+        auto view = buffer_.shotView(std::min(kBatchSize, end_ - pos_));
+        if (view.empty()) {
+            return false;
+        }
+        batch_.assign(view.view());
+        pos_ += view.length();
+        cursor_ = 0;
+        return true;
     }
-    if (chunkIndex >= stco->chunkOffsets.size()) {
-        LogE("chunkIndex out of range");
-        return 0;
+private:
+    Buffer& buffer_;
+    ///file position of the next batch
+    uint64_t pos_ = 0;
+    uint64_t end_ = 0;
+    std::string batch_;
+    uint64_t cursor_ = 0;
+};
+
+uint8_t* writeVarint(uint8_t* ptr, uint64_t value) noexcept {
+    while (value >= 0x80) {
+        *ptr++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
     }
-    uint64_t chunkOffset = stco->chunkOffsets[chunkIndex];
+    *ptr++ = static_cast<uint8_t>(value);
+    return ptr;
+}
 
-    uint32_t firstSampleInChunk = sampleCount + 1;
-    uint64_t sampleOffsetInChunk = 0;
-    for (uint32_t i = 0; i < seekSampleIndex - firstSampleInChunk; ++i) {
-        sampleOffsetInChunk += stsz->sampleSizes[firstSampleInChunk - 1 + i];
+uint64_t readVarint(const uint8_t*& ptr) noexcept {
+    uint64_t value = *ptr++;
+    if (value < 0x80) {
+        return value; //most deltas fit in one byte
     }
-    auto pos = chunkOffset + sampleOffsetInChunk;
-    LogI("[seek info] {} keySampleIndex:{}, time:{}, pos:{}",
-         type == TrackType::Video ? "video" : "audio",
-         seekSampleIndex, targetTime, pos);
-    return pos;
+    value &= 0x7f;
+    uint32_t shift = 7;
+    while (*ptr & 0x80) {
+        value |= static_cast<uint64_t>(*ptr++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*ptr++) << shift;
+    return value;
 }
 
-void TrackContext::seek(uint64_t pos) noexcept {
-    if (!stco || !stsz || !stsc || !stts) {
-        return;
+///zigzag, small negative deltas stay short
+uint64_t encodeSigned(int64_t value) noexcept {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t decodeSigned(uint64_t value) noexcept {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool Mp4SampleIndex::build(
+    Buffer& buffer,
+    const BoxStsz& stsz,
+    const BoxStsc& stsc,
+    const BoxStco& stco,
+    const BoxStts& stts,
+    const BoxCtts* ctts,
+    const BoxStss* stss,
+    bool isFirstPtsZero
+) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clearSamples();
+    auto bufferPos = buffer.pos();
+    TableReader sizeReader(buffer, stsz.entryStart, stsz.sampleSize == 0 ? stsz.sampleCount : 0, 4);
+    TableReader chunkReader(buffer, stco.entryStart, stco.entryCount, stco.is64Bit ? 8 : 4);
+    TableReader timeReader(buffer, stts.entryStart, stts.entryCount, 8);
+    TableReader ptsReader(buffer, ctts ? ctts->entryStart : 0, ctts ? ctts->entryCount : 0, 8);
+    TableReader keyReader(buffer, stss ? stss->entryStart : 0, stss ? stss->entryCount : 0, 4);
+    //a few bytes per sample, see append
+    bytes_.reserve(static_cast<uint64_t>(stsz.sampleCount) * 8);
+    pages_.reserve(stsz.sampleCount / kPageSize + 1);
+
+    int64_t dts = 0;
+    uint32_t timeRun = 0;
+    uint32_t sampleDelta = 0;
+    uint32_t ptsRun = 0;
+    uint32_t ptsValue = 0;
+    if (ptsReader.readRun(ptsRun, ptsValue) && isFirstPtsZero) {
+        //Set pts to 0 and calculate the initial value of dts, which may be a negative number.
+        dts = -static_cast<int64_t>(static_cast<int32_t>(ptsValue));
     }
-    
-    const auto& chunks = stco->chunkOffsets;
-    auto it = std::lower_bound(chunks.begin(), chunks.end(), pos);
-    if (it == chunks.end()) {
-        return;
+    uint32_t nextKey = 0;
+    if (stss && !keyReader.read(nextKey)) {
+        nextKey = 0;
     }
 
-    reset();
-    auto chunkIndex = std::distance(chunks.begin(), it);
-    uint32_t sampleIndex = 0;
-    const auto& entries = stsc->entrys;
-    for (size_t i = 0; i < entries.size(); ++i) {
-        const auto& entry = entries[i];
-        uint32_t firstChunk = entry.firstChunk - 1;
-        uint32_t nextFirstChunk = (i + 1 < entries.size()) ? entries[i + 1].firstChunk - 1 : static_cast<uint32_t>(chunks.size());
-        if (chunkIndex < nextFirstChunk) {
-            sampleIndex += (chunkIndex - firstChunk) * entry.samplesPerChunk;
-            break;
-        } else {
-            sampleIndex += (nextFirstChunk - firstChunk) * entry.samplesPerChunk;
+    //chunk by chunk, a sample of a truncated table ends the walk
+    uint64_t count = stsz.sampleCount;
+    uint64_t chunk = 0;
+    auto chunkEntrySize = stco.is64Bit ? 8 : 4;
+    for (size_t i = 0; i < stsc.entrys.size() && count_ < count; i++) {
+        const auto& entry = stsc.entrys[i];
+        auto firstChunk = static_cast<uint64_t>(std::max(entry.firstChunk, 1u) - 1);
+        auto nextFirstChunk = (i + 1 < stsc.entrys.size()) ?
+            static_cast<uint64_t>(std::max(stsc.entrys[i + 1].firstChunk, 1u) - 1) : static_cast<uint64_t>(stco.entryCount);
+        nextFirstChunk = std::min(nextFirstChunk, static_cast<uint64_t>(stco.entryCount));
+        if (firstChunk > chunk) {
+            chunkReader.skip((firstChunk - chunk) * chunkEntrySize);
+            chunk = firstChunk;
+        }
+        for (; chunk < nextFirstChunk && count_ < count; chunk++) {
+            uint64_t offset = 0;
+            if (!chunkReader.readOffset(stco.is64Bit, offset)) {
+                count = count_;
+                break;
+            }
+            for (uint32_t j = 0; j < entry.samplesPerChunk && count_ < count; j++) {
+                auto size = stsz.sampleSize;
+                if (size == 0 && !sizeReader.read(size)) {
+                    count = count_;
+                    break;
+                }
+                //the last stts delta and ctts offset cover any samples the tables miss
+                if (timeRun > 0 || timeReader.readRun(timeRun, sampleDelta)) {
+                    timeRun--;
+                }
+                if (ptsRun > 0 || ptsReader.readRun(ptsRun, ptsValue)) {
+                    ptsRun--;
+                }
+                //stss is 1-based and sorted, every sample is a key frame without it
+                auto isKeyFrame = true;
+                if (stss) {
+                    auto number = count_ + 1;
+                    while (nextKey != 0 && nextKey < number) {
+                        if (!keyReader.read(nextKey)) {
+                            nextKey = 0;
+                        }
+                    }
+                    isKeyFrame = nextKey == number;
+                }
+                appendSample(offset, size, dts, static_cast<int32_t>(ptsValue), isKeyFrame, sampleDelta);
+                offset += size;
+                dts += sampleDelta;
+            }
         }
     }
-    if (sampleIndex == 0) {
-        sampleIndex = 1;
+    if (count_ < stsz.sampleCount) {
+        LogE("sample table is truncated, samples:{}, chunks hold:{}", stsz.sampleCount, count_);
     }
-    if (stss) {
-        const auto& indexs = stss->keyIndexs;
-        auto it = std::lower_bound(indexs.begin(), indexs.end(), sampleIndex);
-        sampleIndex = it != indexs.end() ? *it : indexs.back();
+    bytes_.shrink_to_fit();
+    buffer.skipTo(static_cast<int64_t>(bufferPos));
+    return count_ > 0;
+}
+
+void Mp4SampleIndex::append(uint64_t offset, uint32_t size, int64_t dts, int32_t ptsDelta, bool isKeyFrame, uint32_t duration) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    appendSample(offset, size, dts, ptsDelta, isKeyFrame, duration);
+}
+
+void Mp4SampleIndex::clear() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clearSamples();
+}
+
+void Mp4SampleIndex::appendSample(uint64_t offset, uint32_t size, int64_t dts, int32_t ptsDelta, bool isKeyFrame, uint32_t duration) noexcept {
+    auto pageIndex = count_ % kPageSize;
+    if (pageIndex == 0) {
+        pages_.push_back({offset, dts, bytes_.size(), kPageSize});
+        nextOffset_ = offset;
+        lastDts_ = dts;
+        lastDtsDelta_ = 0;
+    } else if (cache_.page == pages_.size() - 1) {
+        cache_.page = UINT64_MAX; //the cached page grows
     }
-    index = sampleIndex - 1;
-    for(uint64_t i = 0; i < index; i++) {
-        calcIndex();
+    auto& page = pages_.back();
+    if (isKeyFrame && page.firstKey == kPageSize) {
+        page.firstKey = static_cast<uint32_t>(pageIndex);
     }
-    auto start = stco->chunkOffsets[chunkLogicIndex] + static_cast<uint64_t>(sampleOffset);
-    while (start < pos) {
-        index++;
-        calcIndex();
-        start = stco->chunkOffsets[chunkLogicIndex] + static_cast<uint64_t>(sampleOffset);
+    //size with the key flag, gap to the end of the last sample, change of the dts delta, pts delta
+    auto dtsDelta = dts - lastDts_;
+    std::array<uint8_t, 4 * 10> coded;
+    auto* ptr = writeVarint(coded.data(), (static_cast<uint64_t>(size) << 1) | (isKeyFrame ? 1 : 0));
+    ptr = writeVarint(ptr, encodeSigned(static_cast<int64_t>(offset - nextOffset_)));
+    ptr = writeVarint(ptr, encodeSigned(dtsDelta - lastDtsDelta_));
+    ptr = writeVarint(ptr, encodeSigned(ptsDelta));
+    bytes_.insert(bytes_.end(), coded.data(), ptr);
+    nextOffset_ = offset + size;
+    lastDts_ = dts;
+    lastDtsDelta_ = dtsDelta;
+    lastDuration_ = duration;
+    count_++;
+}
+
+void Mp4SampleIndex::clearSamples() noexcept {
+    pages_.clear();
+    bytes_.clear();
+    count_ = 0;
+    nextOffset_ = 0;
+    lastDts_ = 0;
+    lastDtsDelta_ = 0;
+    lastDuration_ = 0;
+    cache_.page = UINT64_MAX;
+}
+
+const Mp4SampleIndex::DecodedPage& Mp4SampleIndex::decodePage(uint64_t index) const noexcept {
+    auto pageIndex = index / kPageSize;
+    if (cache_.page == pageIndex) {
+        return cache_;
+    }
+    const auto& page = pages_[pageIndex];
+    auto count = std::min<uint64_t>(kPageSize, count_ - pageIndex * kPageSize);
+    cache_.offsets.resize(count);
+    cache_.sizes.resize(count);
+    cache_.dts.resize(count);
+    cache_.ptsDeltas.resize(count);
+    cache_.keyFrames.resize(count);
+    const auto* ptr = bytes_.data() + page.byteStart;
+    auto* offsets = cache_.offsets.data();
+    auto* sizes = cache_.sizes.data();
+    auto* dtsValues = cache_.dts.data();
+    auto* ptsDeltas = cache_.ptsDeltas.data();
+    auto* keyFrames = cache_.keyFrames.data();
+    auto offset = page.offset;
+    auto dts = page.dts;
+    int64_t dtsDelta = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        auto sizeAndKey = readVarint(ptr);
+        offset += static_cast<uint64_t>(decodeSigned(readVarint(ptr)));
+        dtsDelta += decodeSigned(readVarint(ptr));
+        dts += dtsDelta;
+        auto size = static_cast<uint32_t>(sizeAndKey >> 1);
+        offsets[i] = offset;
+        sizes[i] = size;
+        keyFrames[i] = static_cast<uint8_t>(sizeAndKey & 1);
+        dtsValues[i] = dts;
+        ptsDeltas[i] = static_cast<int32_t>(decodeSigned(readVarint(ptr)));
+        offset += size;
     }
+    cache_.page = pageIndex;
+    return cache_;
+}
 
-    if (type == TrackType::Audio) {
-        LogI("[seek info] audio sampleIndex:{}, dts:{}, pos:{}", index, dts, start);
-    } else {
-        LogI("[seek info] video sampleIndex:{}, dts:{}, pos:{}", index, dts, start);
+uint32_t Mp4SampleIndex::duration(uint64_t index) const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index + 1 >= count_) {
+        return lastDuration_;
     }
+    auto dts = decodePage(index).dts[index % kPageSize];
+    auto next = index + 1;
+    auto nextDts = next % kPageSize == 0 ? pages_[next / kPageSize].dts : decodePage(next).dts[next % kPageSize];
+    return static_cast<uint32_t>(nextDts - dts);
 }
 
-void TrackContext::reset() noexcept {
-    stszSampleSizeIndex = 0;
-    stscEntryIndex = 0;
-    entrySampleIndex = 0;
-    chunkLogicIndex = 0;
-    sampleOffset = 0;
-    
-    sttsEntryIndex = 0;
-    sttsEntrySampleIndex = 0;
-    
-    cttsEntryIndex = 0;
-    cttsEntrySampleIndex = 0;
-    keyIndex = 0;
-    
-    dts = 0;
-    pts = 0;
-    index = 0;
-    isCompleted = false;
-    init();
+uint64_t Mp4SampleIndex::findByOffset(uint64_t pos) const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    //the first page which starts at or after pos, the sample is in the page before or is its first one
+    auto it = std::lower_bound(pages_.begin(), pages_.end(), pos, [](const Page& page, uint64_t value) {
+        return page.offset < value;
+    });
+    if (it == pages_.begin()) {
+        return 0;
+    }
+    auto first = static_cast<uint64_t>(std::distance(pages_.begin(), it) - 1) * kPageSize;
+    const auto& offsets = decodePage(first).offsets;
+    auto inner = std::lower_bound(offsets.begin(), offsets.end(), pos);
+    return first + static_cast<uint64_t>(std::distance(offsets.begin(), inner));
 }
 
-void TrackContext::calcIndex() noexcept {
-    auto size = stsz->sampleSizes[stszSampleSizeIndex];
-    auto& entry = stsc->entrys[stscEntryIndex];
-    stszSampleSizeIndex++;
+uint64_t Mp4SampleIndex::findByDts(int64_t dts) const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::upper_bound(pages_.begin(), pages_.end(), dts, [](int64_t value, const Page& page) {
+        return value < page.dts;
+    });
+    if (it == pages_.begin()) {
+        return 0;
+    }
+    auto first = static_cast<uint64_t>(std::distance(pages_.begin(), it) - 1) * kPageSize;
+    const auto& values = decodePage(first).dts;
+    auto inner = std::upper_bound(values.begin(), values.end(), dts);
+    return first + static_cast<uint64_t>(std::distance(values.begin(), inner)) - 1;
+}
 
-    sampleOffset += size;
-    entrySampleIndex++;
-    if (entrySampleIndex >= entry.samplesPerChunk) {
-        if (chunkLogicIndex + 1 < stco->chunkOffsets.size()) {
-            chunkLogicIndex++;
-        } else {
-            isCompleted = true;
+uint64_t Mp4SampleIndex::nextKeyFrame(uint64_t index) const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pageIndex = index / kPageSize;
+    if (pageIndex >= pages_.size() || index >= count_) {
+        return count_;
+    }
+    //only the page of index is decoded, the later ones tell their first key frame
+    auto inner = static_cast<uint32_t>(index % kPageSize);
+    const auto& page = pages_[pageIndex];
+    if (page.firstKey != kPageSize && page.firstKey >= inner) {
+        return pageIndex * kPageSize + page.firstKey;
+    } else if (page.firstKey != kPageSize) {
+        const auto& keyFrames = decodePage(index).keyFrames;
+        for (auto i = inner; i < keyFrames.size(); i++) {
+            if (keyFrames[i]) {
+                return pageIndex * kPageSize + i;
+            }
         }
-        sampleOffset = 0;
-        entrySampleIndex = 0;
     }
-
-    if (stscEntryIndex + 1 < stsc->entrys.size()) {
-        if (chunkLogicIndex >= (stsc->entrys[stscEntryIndex + 1].firstChunk - 1)) {
-            stscEntryIndex++;
+    for (pageIndex++; pageIndex < pages_.size(); pageIndex++) {
+        if (pages_[pageIndex].firstKey != kPageSize) {
+            return pageIndex * kPageSize + pages_[pageIndex].firstKey;
         }
     }
+    return count_;
+}
 
-    auto& sttsEntry = stts->entrys[sttsEntryIndex];
-    sttsEntrySampleIndex++;
-    if (sttsEntrySampleIndex >= sttsEntry.sampleCount) {
-        sttsEntrySampleIndex = 0;
-        if (sttsEntryIndex + 1 < stts->entrys.size()) {
-            sttsEntryIndex++;
-        }
+uint64_t Mp4SampleIndex::memorySize() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cacheSize = cache_.offsets.capacity() * sizeof(uint64_t) + cache_.sizes.capacity() * sizeof(uint32_t) +
+        cache_.dts.capacity() * sizeof(int64_t) + cache_.ptsDeltas.capacity() * sizeof(int32_t) + cache_.keyFrames.capacity() / 8;
+    return bytes_.capacity() + pages_.capacity() * sizeof(Page) + cacheSize;
+}
+
+void TrackContext::init(Buffer& buffer) noexcept {
+    if (!stsz || !stsc || !stco || !stts || stsz->sampleCount == 0) {
+        return; //a fragmented track brings its samples with the moof boxes
+    }
+    if (!samples.build(buffer, *stsz, *stsc, *stco, *stts, ctts.get(), stss.get(), type == TrackType::Video)) {
+        LogE("build sample index failed");
+        return;
     }
-    dts += sttsEntry.sampleDelta;
+    firstDts = samples.dts(0);
+}
+
+void TrackContext::parseTrackFragment(const Box& traf, uint64_t moofStart) noexcept {
+    using namespace std::string_view_literals;
+    auto tfhd = std::dynamic_pointer_cast<BoxTfhd>(traf.getChild("tfhd"sv));
+    if (!tfhd) {
+        LogE("traf without tfhd, track:{}", trackId);
+        return;
+    }
+    auto tfdt = std::dynamic_pointer_cast<BoxTfdt>(traf.getChild("tfdt"sv));
+    auto defaultDuration = tfhd->defaultSampleDuration.value_or(trex ? trex->defaultSampleDuration : 0);
+    auto defaultSize = tfhd->defaultSampleSize.value_or(trex ? trex->defaultSampleSize : 0);
+    auto defaultFlags = tfhd->defaultSampleFlags.value_or(trex ? trex->defaultSampleFlags : 0);
+    //without base data offset the data offsets of the runs count from the moof
+    auto baseOffset = tfhd->baseDataOffset.value_or(moofStart);
+    auto dataPos = baseOffset;
+    auto dts = tfdt ? static_cast<int64_t>(tfdt->baseMediaDecodeTime) : nextDts;
 
-    if (ctts) {
-        cttsEntrySampleIndex++;
-        if (cttsEntrySampleIndex >= ctts->entrys[cttsEntryIndex].sampleCount) {
-            if (cttsEntryIndex + 1 < ctts->entrys.size()) {
-                cttsEntryIndex ++;
+    samples.clear();
+    reset();
+    for (const auto& child : traf.childs) {
+        auto trun = std::dynamic_pointer_cast<BoxTrun>(child);
+        if (!trun) {
+            continue;
+        }
+        if (trun->dataOffset) {
+            dataPos = static_cast<uint64_t>(static_cast<int64_t>(baseOffset) + *trun->dataOffset);
+        }
+        if (!dtsShift) {
+            auto hasOffset = type == TrackType::Video && !trun->entrys.empty() &&
+                (trun->flags & BoxTrun::kSampleCompositionOffsetPresent);
+            dtsShift = hasOffset ? -static_cast<int64_t>(trun->entrys.front().compositionOffset) : 0;
+        }
+        for (size_t i = 0; i < trun->entrys.size(); i++) {
+            const auto& entry = trun->entrys[i];
+            auto duration = (trun->flags & BoxTrun::kSampleDurationPresent) ? entry.duration : defaultDuration;
+            auto size = (trun->flags & BoxTrun::kSampleSizePresent) ? entry.size : defaultSize;
+            auto sampleFlags = defaultFlags;
+            if (trun->flags & BoxTrun::kSampleFlagsPresent) {
+                sampleFlags = entry.flags;
+            } else if (i == 0 && trun->firstSampleFlags) {
+                sampleFlags = *trun->firstSampleFlags;
             }
-            cttsEntrySampleIndex = 0;
+            auto ptsDelta = (trun->flags & BoxTrun::kSampleCompositionOffsetPresent) ? entry.compositionOffset : 0;
+            auto isKeyFrame = type == TrackType::Audio || !(sampleFlags & BoxTrun::kSampleIsNonSync);
+            samples.append(dataPos, size, dts + *dtsShift, ptsDelta, isKeyFrame, duration);
+            dataPos += size;
+            dts += duration;
         }
-        pts = dts + ctts->entrys[cttsEntryIndex].sampleOffset;
-    } else {
-        pts = dts;
     }
+    nextDts = dts;
+    if (isWaitingKeyFrame) {
+        index = samples.nextKeyFrame(0);
+        isWaitingKeyFrame = index >= samples.size();
+    }
+    isCompleted = index >= samples.size();
 }
 
-bool TrackContext::isInRange(Buffer& buffer) const noexcept {
-    if (stszSampleSizeIndex >= stsz->sampleSizes.size() || stscEntryIndex >= stsc->entrys.size()) {
-        return false;
+uint64_t TrackContext::getSeekPos(double targetTime) const noexcept {
+    if (samples.empty() || !mdhd) {
+        return 0;
     }
-    auto start = stco->chunkOffsets[chunkLogicIndex] + static_cast<uint64_t>(sampleOffset);
-    auto end = start + stsz->sampleSizes[stszSampleSizeIndex];
-    auto bufferStart = buffer.offset();
-    auto bufferEnd = bufferStart + buffer.totalLength();
-    if (bufferStart <= start && end <= bufferEnd) {
-        return true;
+    auto targetDts = samples.dts(0) + static_cast<int64_t>(targetTime * static_cast<double>(mdhd->timeScale));
+    auto sampleIndex = samples.findByDts(targetDts);
+    auto pos = samples.offset(sampleIndex);
+    LogI("[seek info] {} sampleIndex:{}, time:{}, pos:{}",
+         type == TrackType::Video ? "video" : "audio",
+         sampleIndex, targetTime, pos);
+    return pos;
+}
+
+void TrackContext::seek(uint64_t pos) noexcept {
+    auto sampleIndex = samples.findByOffset(pos);
+    if (sampleIndex >= samples.size()) {
+        return;
+    }
+
+    reset();
+    //seeking lands on a key frame, or the first sample after pos when none follows
+    auto keySampleIndex = samples.nextKeyFrame(sampleIndex);
+    if (keySampleIndex < samples.size()) {
+        sampleIndex = keySampleIndex;
+    }
+    index = sampleIndex;
+
+    if (type == TrackType::Audio) {
+        LogI("[seek info] audio sampleIndex:{}, dts:{}, pos:{}", index, samples.dts(index), samples.offset(index));
+    } else {
+        LogI("[seek info] video sampleIndex:{}, dts:{}, pos:{}", index, samples.dts(index), samples.offset(index));
     }
-    return false;
+}
+
+void TrackContext::reset() noexcept {
+    keyIndex = 0;
+    index = 0;
+    isCompleted = false;
+}
+
+bool TrackContext::isInRange(Buffer& buffer) const noexcept {
+    uint64_t offset = 0;
+    return isInRange(buffer, offset);
 }
 
 bool TrackContext::isInRange(Buffer& buffer, uint64_t& offset) const noexcept {
-    if (stszSampleSizeIndex >= stsz->sampleSizes.size() || stscEntryIndex >= stsc->entrys.size()) {
+    if (index >= samples.size()) {
         return false;
     }
-    auto start = stco->chunkOffsets[chunkLogicIndex] + static_cast<uint64_t>(sampleOffset);
-    auto end = start + stsz->sampleSizes[stszSampleSizeIndex];
+    auto start = samples.offset(index);
+    auto end = start + samples.sampleSize(index);
     auto bufferStart = buffer.offset();
     auto bufferEnd = bufferStart + buffer.totalLength();
     if (bufferStart <= start && end <= bufferEnd) {
@@ -259,6 +543,56 @@ bool TrackContext::isInRange(Buffer& buffer, uint64_t& offset) const noexcept {
     return false;
 }
 
+///One pass over the length prefixed nalus of a sample. Where the decoder takes annex-b the length fields
+///become start codes, in place when they have 4 bytes, otherwise in a pooled copy. onNalu sees each nalu
+///from its header on, offsets gets where the headers sit in the result.
+template<typename Func>
+void rewriteNalus(DataPtr& data, uint16_t lengthSize, std::vector<uint32_t>& offsets, Func&& onNalu) noexcept {
+    constexpr uint64_t kStartCodeSize = 4;
+    constexpr uint8_t kStartCode[kStartCodeSize] = {0x00, 0x00, 0x00, 0x01};
+#if SLARK_ANDROID
+    constexpr bool isAnnexB = true;
+#else
+    constexpr bool isAnnexB = false; //video toolbox takes the length fields as they are
+#endif
+    auto isInPlace = !isAnnexB || lengthSize == kStartCodeSize;
+    //a slice of a demux chunk or of a file mapping is shared, it is copied to the pool first
+    if (isAnnexB && isInPlace && !data->isWritable()) {
+        data->ensureUnique();
+    }
+    DataPtr scratch = isInPlace ? nullptr : Data::obtain(data->length + kStartCodeSize * 4);
+    auto* bytes = data->rawData;
+    auto total = data->length;
+    uint64_t pos = 0;
+    while (pos + lengthSize < total) {
+        uint32_t naluSize = 0;
+        for (uint16_t i = 0; i < lengthSize; i++) {
+            naluSize = (naluSize << 8) | bytes[pos + i];
+        }
+        auto start = pos + lengthSize;
+        if (naluSize == 0 || naluSize > total - start) {
+            LogE("bad nalu size:{} at:{}, sample size:{}", naluSize, pos, total);
+            break;
+        }
+        DataView nalu(bytes + start, naluSize);
+        if (scratch) {
+            scratch->append(DataView(kStartCode, kStartCodeSize));
+            offsets.push_back(static_cast<uint32_t>(scratch->length));
+            scratch->append(nalu);
+        } else {
+            if constexpr (isAnnexB) {
+                std::copy_n(kStartCode, kStartCodeSize, bytes + pos);
+            }
+            offsets.push_back(static_cast<uint32_t>(start));
+        }
+        onNalu(nalu);
+        pos = start + naluSize;
+    }
+    if (scratch) {
+        data = std::move(scratch);
+    }
+}
+
 AVFramePtrArray TrackContext::parseH264FrameData(
     AVFramePtr frame,
     DataPtr data,
@@ -273,63 +607,38 @@ AVFramePtrArray TrackContext::parseH264FrameData(
         }
     }
     AVFramePtrArray frames;
-    auto view = data->view();
-    auto& sttsEntry = stts->entrys[sttsEntryIndex];
-    frame->duration = static_cast<uint32_t>(static_cast<double>(sttsEntry.sampleDelta) / static_cast<double>(frame->timeScale) * 1000.0); //ms
-    while (!view.empty()) {
-        uint32_t naluSize = 0;
-        auto sizeView = view.substr(0, 4);
-        Util::readBE(sizeView, naluByteSize + 1, naluSize);
-        uint8_t naluHeader = 0;
-        auto naluHeaderView = view.substr(4, 1);
-        Util::readByte(naluHeaderView, naluHeader);
-        uint8_t naluType = naluHeader & 0x1f;
-        uint32_t totalSize = naluSize + naluByteSize + 1; //naluSize + header size
-        auto info = std::make_shared<VideoFrameInfo>();
-        frameInfo->copy(info);
-        if (naluType == 5 || naluType == 1) {
-            if (naluType == 5) {
-                info->isIDRFrame = true;
-                keyIndex = frame->index;
-            } else {
-                info->isIDRFrame = false;
-                info->keyIndex = keyIndex;
-            }
-            DataPtr frameData;
-            if (totalSize == data->length) {
-                frameData = std::move(data);
-                view = {};
-                data.reset();
-            } else {
-                frameData = std::make_unique<Data>(view.substr(0, totalSize));
-                view = view.substr(totalSize);
-            }
-            // parseAvcSliceType need skip header
-            auto [firstMBInSlice, sliceType] = parseAvcSliceType(frameData->view().substr(4));
-            if (sliceType == 0 || sliceType == 5) {
-                info->frameType = VideoFrameType::PFrame;
-            } else if (sliceType == 1 || sliceType == 6) {
-                info->frameType = VideoFrameType::BFrame;
-            } else if (sliceType == 2 || sliceType == 7) {
-                info->frameType = VideoFrameType::IFrame;
-            }
-            info->keyIndex = keyIndex;
-            if (view.empty()) {
-                frame->info = info;
-                frame->data = std::move(frameData);
-                frames.push_back(std::move(frame));
-                frame.reset();
-            } else {
-                auto newFrame = frame->copy();
-                newFrame->info = info;
-                newFrame->data = std::move(frameData);
-                frames.push_back(std::move(newFrame));
-            }
-        } else {
-            //don't care
-            view = view.substr(totalSize);
+    auto sampleDelta = samples.duration(frame->index);
+    frame->duration = static_cast<uint32_t>(static_cast<double>(sampleDelta) / static_cast<double>(frame->timeScale) * 1000.0); //ms
+    auto info = std::make_shared<VideoFrameInfo>();
+    frameInfo->copy(info);
+    //the whole sample is one frame, its first slice tells the frame type
+    bool hasSlice = false;
+    rewriteNalus(data, naluByteSize + 1, info->naluOffsets, [&](DataView nalu) {
+        uint8_t naluType = nalu[0] & 0x1f;
+        if (hasSlice || (naluType != 5 && naluType != 1)) {
+            return;
+        }
+        hasSlice = true;
+        if (naluType == 5) {
+            info->isIDRFrame = true;
+            keyIndex = frame->index;
+        }
+        auto [firstMBInSlice, sliceType] = parseAvcSliceType(nalu);
+        if (sliceType == 0 || sliceType == 5) {
+            info->frameType = VideoFrameType::PFrame;
+        } else if (sliceType == 1 || sliceType == 6) {
+            info->frameType = VideoFrameType::BFrame;
+        } else if (sliceType == 2 || sliceType == 7) {
+            info->frameType = VideoFrameType::IFrame;
         }
+    });
+    if (!hasSlice) {
+        return frames; //parameter sets or sei only, nothing to decode
     }
+    info->keyIndex = keyIndex;
+    frame->info = std::move(info);
+    frame->data = std::move(data);
+    frames.push_back(std::move(frame));
     return frames;
 }
 
@@ -342,69 +651,50 @@ AVFramePtrArray TrackContext::parseH265FrameData(
         auto hvccBox = std::dynamic_pointer_cast<BoxHvcc>(stsd->getChild("hvc1")->getChild("hvcC"));
         if (hvccBox) {
             naluByteSize = hvccBox->naluByteSize;
+            //the slice type sits behind the extra slice header bits of the pps
+            if (!hvccBox->pps.empty() && hvccBox->pps.front()) {
+                extraSliceHeaderBits = parseH265ExtraSliceHeaderBits(hvccBox->pps.front()->view());
+            }
         } else {
             naluByteSize = 3; //default nalu size
         }
     }
+    //nal unit types, ITU-T H.265 table 7-1
+    constexpr uint8_t kMaxSlice = 21; //CRA_NUT
+    constexpr uint8_t kMinIrapSlice = 16; //BLA_W_LP
     AVFramePtrArray frames;
-    auto view = data->view();
-    auto& sttsEntry = stts->entrys[sttsEntryIndex];
-    frame->duration = static_cast<uint32_t>(static_cast<double>(sttsEntry.sampleDelta) / static_cast<double>(frame->timeScale) * 1000.0); //ms
-    while (!view.empty()) {
-        uint32_t naluSize = 0;
-        auto sizeView = view.substr(0, 4);
-        Util::readBE(sizeView, naluByteSize + 1, naluSize);
-        uint8_t naluHeader = 0;
-        auto naluHeaderView = view.substr(4, 1);
-        Util::readByte(naluHeaderView, naluHeader);
-        uint8_t naluType = (naluHeader >> 1) & 0x3f; // HEVC NALU type: bits 1-6
-        uint32_t totalSize = naluSize + naluByteSize + 1; //naluSize + header size
-        auto info = std::make_shared<VideoFrameInfo>();
-        frameInfo->copy(info);
-        // HEVC: IDR_W_RADL(19), IDR_N_LP(20), TRAIL_R(1), TRAIL_N(0)
-        if (naluType >= 0 && naluType <= 21) {
-            if (naluType >= 16 && naluType <= 21) {
-                info->isIDRFrame = true;
-                keyIndex = frame->index;
-            } else {
-                info->isIDRFrame = false;
-                info->keyIndex = keyIndex;
-            }
-            DataPtr frameData;
-            if (totalSize == data->length) {
-                frameData = std::move(data);
-                view = {};
-                data.reset();
-            } else {
-                frameData = std::make_unique<Data>(view.substr(0, totalSize));
-                view = view.substr(totalSize);
-            }
-            // parseSliceType for HEVC, need skip header
-            auto [firstSliceSegmentInPic, sliceType] = parseHevcSliceType(frameData->view().substr(4), naluType);
-            if (sliceType == 0) {
-                info->frameType = VideoFrameType::PFrame;
-            } else if (sliceType == 1) {
-                info->frameType = VideoFrameType::BFrame;
-            } else if (sliceType == 2) {
-                info->frameType = VideoFrameType::IFrame;
-            }
-            info->keyIndex = keyIndex;
-            if (view.empty()) {
-                frame->info = info;
-                frame->data = std::move(frameData);
-                frames.push_back(std::move(frame));
-                frame.reset();
-            } else {
-                auto newFrame = frame->copy();
-                newFrame->info = info;
-                newFrame->data = std::move(frameData);
-                frames.push_back(std::move(newFrame));
-            }
-        } else {
-            //don't care
-            view = view.substr(totalSize);
+    auto sampleDelta = samples.duration(frame->index);
+    frame->duration = static_cast<uint32_t>(static_cast<double>(sampleDelta) / static_cast<double>(frame->timeScale) * 1000.0); //ms
+    auto info = std::make_shared<VideoFrameInfo>();
+    frameInfo->copy(info);
+    //the whole sample is one frame, its first slice tells the frame type
+    bool hasSlice = false;
+    rewriteNalus(data, naluByteSize + 1, info->naluOffsets, [&](DataView nalu) {
+        auto naluType = static_cast<uint8_t>((nalu[0] >> 1) & 0x3f);
+        if (hasSlice || naluType > kMaxSlice || nalu.length() < 3) {
+            return;
         }
+        hasSlice = true;
+        if (naluType >= kMinIrapSlice) {
+            info->isIDRFrame = true;
+            keyIndex = frame->index;
+        }
+        auto [firstSliceSegmentInPic, sliceType] = parseHevcSliceType(nalu, naluType, extraSliceHeaderBits);
+        if (sliceType == 0) {
+            info->frameType = VideoFrameType::BFrame;
+        } else if (sliceType == 1) {
+            info->frameType = VideoFrameType::PFrame;
+        } else if (sliceType == 2) {
+            info->frameType = VideoFrameType::IFrame;
+        }
+    });
+    if (!hasSlice) {
+        return frames; //parameter sets or sei only, nothing to decode
     }
+    info->keyIndex = keyIndex;
+    frame->info = std::move(info);
+    frame->data = std::move(data);
+    frames.push_back(std::move(frame));
     return frames;
 }
 
@@ -412,17 +702,19 @@ void TrackContext::parseData(Buffer& buffer, std::shared_ptr<FrameInfo> frameInf
     if (!isInRange(buffer)) {
         return;
     }
-    auto start = stco->chunkOffsets[chunkLogicIndex] + static_cast<uint64_t>(sampleOffset);
-    auto size = stsz->sampleSizes[stszSampleSizeIndex];
+    auto start = samples.offset(index);
+    auto size = samples.sampleSize(index);
     //LogI("parse data start:{}, size:{}, pos:{}", start, size, buffer.pos());
     if (!buffer.skipTo(static_cast<int64_t>(start))) {
         return;
     }
     //LogI("skip to pos:{}, read pos:{}, offset:{}", buffer.pos(), buffer.readPos(), buffer.offset());
     auto frame = std::make_unique<AVFrame>();
-    frame->index = index++;
-    frame->dts = dts;
-    frame->pts = pts;
+    frame->index = index;
+    frame->dts = samples.dts(index);
+    frame->pts = samples.pts(index);
+    index++;
+    isCompleted = index >= samples.size();
     frame->offset = start;
     frame->timeScale = mdhd->timeScale;
     if (type == TrackType::Audio) {
@@ -430,11 +722,11 @@ void TrackContext::parseData(Buffer& buffer, std::shared_ptr<FrameInfo> frameInf
         auto info = std::dynamic_pointer_cast<AudioFrameInfo>(frameInfo);
         frame->duration = static_cast<uint32_t>(info->duration(size) * 1000.0);
         frame->info = frameInfo;
-        frame->data = buffer.readData(size);
+        frame->data = buffer.readSlice(size);
         packets.push_back(std::move(frame));
     } else if (type == TrackType::Video) {
         frame->frameType = AVFrameType::Video;
-        auto data = buffer.readData(size);
+        auto data = buffer.readSlice(size);
         if (codecId == CodecId::AVC) {
             auto frames = parseH264FrameData(std::move(frame),
                                              std::move(data),
@@ -451,22 +743,6 @@ void TrackContext::parseData(Buffer& buffer, std::shared_ptr<FrameInfo> frameInf
                            std::make_move_iterator(frames.end()));
         }
     }
-    calcIndex();
-}
-
-bool Mp4Demuxer::probeMoovBox(Buffer& buffer, int64_t& start, uint32_t& size) noexcept {
-    auto view = buffer.view();
-    auto pos = view.find("moov");
-    if (pos == std::string_view::npos) {
-        return false;
-    }
-    auto boxStart = pos - 4;
-    start = static_cast<int64_t>(boxStart + buffer.offset()); //size start pos
-    if (start < 0) {
-        return false;
-    }
-    auto sizeView = view.substr(boxStart, 4);
-    return Util::read4ByteBE(sizeView, size);
 }
 
 bool Mp4Demuxer::parseMoovBox(Buffer& buffer, const BoxRefPtr& moovBox) noexcept {
@@ -478,6 +754,7 @@ bool Mp4Demuxer::parseMoovBox(Buffer& buffer, const BoxRefPtr& moovBox) noexcept
     }
     [[maybe_unused]] bool res  = true;
     std::shared_ptr<BoxMdhd> mdhdBox;
+    uint32_t trackId = 0;
     while ((buffer.pos() - moovBox->info.start) < moovBox->info.size) {
         auto box = Box::createBox(buffer);
         if (!box) {
@@ -500,9 +777,14 @@ bool Mp4Demuxer::parseMoovBox(Buffer& buffer, const BoxRefPtr& moovBox) noexcept
                 tracks_[codecId]->type = stsdBox->isAudio ? TrackType::Audio : TrackType::Video;
                 tracks_[codecId]->codecId = codecId;
                 tracks_[codecId]->mediaBoxName = mediaBoxName;
+                tracks_[codecId]->trackId = trackId;
             }
         } else if (box->info.symbol == "mdhd") {
             mdhdBox = std::dynamic_pointer_cast<BoxMdhd>(box);
+        } else if (box->info.symbol == "tkhd") {
+            trackId = std::dynamic_pointer_cast<BoxTkhd>(box)->trackId;
+        } else if (box->info.symbol == "mvex") {
+            isFragmented_ = true;
         }
         
         parentBox.top()->append(box);
@@ -537,46 +819,75 @@ bool Mp4Demuxer::open(std::unique_ptr<Buffer>& buffer) noexcept {
         rootBox_ = std::make_shared<Box>(std::move(info));
     }
     auto res = false;
+    uint64_t headerEnd = 0;
+    missingRange_ = Range();
     while (!buffer->empty()) {
+        headerEnd = buffer->pos();
         auto box = Box::createBox(*buffer);
         if (!box) {
             break;
         }
         
-        if (box->info.symbol == "moov") {
+        if (isFragmented_ && box->info.symbol != "sidx") {
+            break; //the fragments are streamed from here
+        } else if (box->info.symbol == "sidx") {
+            auto sidxBox = std::dynamic_pointer_cast<BoxSidx>(box);
+            if (!sidxBox->decode(*buffer)) {
+                break; //not all here, it is parsed with the fragments
+            }
+            parseSidxBox(*sidxBox);
+            rootBox_->append(box);
+        } else if (box->info.symbol == "moov") {
             res = parseMoovBox(*buffer, box);
             if (!res) {
+                missingRange_ = Range(box->info.start, static_cast<int64_t>(box->info.size));
                 break;
             }
             rootBox_->append(box);
         } else if (box->info.symbol == "mdat") {
-            headerInfo_ = std::make_unique<DemuxerHeaderInfo>();
-            headerInfo_->headerLength = box->info.start;
-            headerInfo_->dataSize = box->info.size;
+            //the media data may be split in several mdat boxes, it spans all of them
+            if (!headerInfo_) {
+                headerInfo_ = std::make_unique<DemuxerHeaderInfo>();
+                headerInfo_->headerLength = box->info.start;
+            }
+            headerInfo_->dataSize = box->info.start + box->info.size - headerInfo_->headerLength;
             rootBox_->append(box);
         } else {
             rootBox_->append(box);
         }
 
         auto endPos = box->info.size + box->info.start;
+        headerEnd = endPos;
         auto skipOffset = endPos - buffer->pos();
         if (!buffer->skip(static_cast<int64_t>(skipOffset))) {
-            if (box->info.symbol != "mdat") {
-                res = false;
-            }
-            break;
+            break; //the rest is streamed, or fetched once the moov is known
         }
     }
+    if (!res && !missingRange_.isValid()) {
+        missingRange_ = Range(headerEnd);
+    }
+    if (res && isFragmented_) {
+        headerInfo_ = std::make_unique<DemuxerHeaderInfo>();
+        headerInfo_->headerLength = headerEnd;
+        headerInfo_->dataSize = config_.fileSize > headerEnd ? config_.fileSize - headerEnd : 0;
+    }
     
     if (!res) {
         buffer->resetReadPos();
     } else {
-        initData();
+        initData(*buffer);
+        if (!headerInfo_ && !isFragmented_) {
+            //no mdat header has been read, the samples run to the end of file
+            auto start = dataStart();
+            headerInfo_ = std::make_unique<DemuxerHeaderInfo>();
+            headerInfo_->headerLength = start;
+            headerInfo_->dataSize = config_.fileSize > start ? config_.fileSize - start : 0;
+        }
     }
     return res;
 }
 
-void initTrack(std::shared_ptr<TrackContext>& track) {
+void initTrack(std::shared_ptr<TrackContext>& track, Buffer& buffer) {
     for (auto& child : track->stbl->childs) {
         if (child->info.symbol == "stsd") {
             track->stsd = std::dynamic_pointer_cast<BoxStsd>(child);
@@ -584,7 +895,7 @@ void initTrack(std::shared_ptr<TrackContext>& track) {
             track->stts = std::dynamic_pointer_cast<BoxStts>(child);
         } else if (child->info.symbol == "stsz") {
             track->stsz = std::dynamic_pointer_cast<BoxStsz>(child);
-        } else if (child->info.symbol == "stco") {
+        } else if (child->info.symbol == "stco" || child->info.symbol == "co64") {
             track->stco = std::dynamic_pointer_cast<BoxStco>(child);
         } else if (child->info.symbol == "stsc") {
             track->stsc = std::dynamic_pointer_cast<BoxStsc>(child);
@@ -594,14 +905,33 @@ void initTrack(std::shared_ptr<TrackContext>& track) {
             track->stss = std::dynamic_pointer_cast<BoxStss>(child);
         }
     }
-    track->init();
+    track->init(buffer);
 }
 
-void Mp4Demuxer::initData() noexcept {
-    auto mvhdBox = std::dynamic_pointer_cast<BoxMvhd>(rootBox_->getChild("moov")->getChild("mvhd"));
-    totalDuration_ = CTime(static_cast<double>(mvhdBox->duration) / static_cast<double>(mvhdBox->timeScale));
+void Mp4Demuxer::initData(Buffer& buffer) noexcept {
+    auto moovBox = rootBox_->getChild("moov");
+    auto mvhdBox = std::dynamic_pointer_cast<BoxMvhd>(moovBox->getChild("mvhd"));
+    auto mvexBox = moovBox->getChild("mvex");
+    uint64_t duration = mvhdBox->duration;
+    if (duration == 0 && mvexBox) {
+        if (auto mehdBox = std::dynamic_pointer_cast<BoxMehd>(mvexBox->getChild("mehd")); mehdBox) {
+            duration = mehdBox->fragmentDuration;
+        }
+    }
+    //a fragmented file may only tell its duration by the sidx
+    if (duration > 0 || totalDuration_.second() <= 0) {
+        totalDuration_ = CTime(static_cast<double>(duration) / static_cast<double>(mvhdBox->timeScale));
+    }
     for (auto& [codecId, track] : tracks_) {
-        initTrack(track);
+        if (mvexBox) {
+            for (const auto& child : mvexBox->childs) {
+                auto trexBox = std::dynamic_pointer_cast<BoxTrex>(child);
+                if (trexBox && trexBox->trackId == track->trackId) {
+                    track->trex = trexBox;
+                }
+            }
+        }
+        initTrack(track, buffer);
         auto stsdBox = track->stsd;
         if (!stsdBox) {
             LogI("get stsd error");
@@ -629,13 +959,18 @@ void Mp4Demuxer::initData() noexcept {
             videoInfo_ = std::make_shared<VideoInfo>();
             videoInfo_->width = stsdBox->width;
             videoInfo_->height = stsdBox->height;
-            auto sttsBox = track->stts;
-            auto delta = sttsBox->entrys.front().sampleDelta;
+            const auto& samples = track->samples;
+            uint32_t delta = 0;
+            if (!samples.empty()) {
+                delta = samples.duration(0);
+            } else if (track->trex) {
+                delta = track->trex->defaultSampleDuration;
+            }
             videoInfo_->timeScale = track->mdhd->timeScale;
             if (delta > 0) {
                 videoInfo_->fps = static_cast<uint16_t>(videoInfo_->timeScale / delta);
-            } else {
-                auto sampleSize = static_cast<double>(sttsBox->sampleSize());
+            } else if (!samples.empty() && totalDuration_.second() > 0) {
+                auto sampleSize = static_cast<double>(samples.size());
                 videoInfo_->fps = static_cast<uint16_t>(ceil(sampleSize / totalDuration_.second()));
             }
             if (codecId == CodecId::AVC) {
@@ -672,6 +1007,16 @@ void Mp4Demuxer::close() noexcept {
     tracks_.clear();
     buffer_.reset();
     rootBox_.reset();
+    isFragmented_ = false;
+    nextBoxPos_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(fragmentsMutex_);
+        fragments_.clear();
+    }
+    isIndexedBySidx_ = false;
+    fragmentOriginDts_.reset();
+    sideTrack_.reset();
+    sideBuffer_.reset();
     reset();
 }
 
@@ -702,6 +1047,9 @@ std::string Mp4Demuxer::description() const noexcept {
 }
 
 DemuxerResult Mp4Demuxer::parseData(DataPacket& packet) noexcept {
+    if (isOpened_ && sideTrack_ && packet.tag == kSideStreamTag) {
+        return parseSideData(packet);
+    }
     if (packet.empty() || !isOpened_) {
         return {DemuxerResultCode::Failed, AVFramePtrArray(), AVFramePtrArray()};
     }
@@ -709,12 +1057,50 @@ DemuxerResult Mp4Demuxer::parseData(DataPacket& packet) noexcept {
         return {DemuxerResultCode::InvalidData, AVFramePtrArray(), AVFramePtrArray()};
     }
     DemuxerResult result;
-    while(!buffer_->empty()) {
+    parseSamples(*buffer_, false, result);
+    while (isFragmented_ && parseFragmentBoxes(result)) {
+        parseSamples(*buffer_, false, result);
+    }
+    if (!result.audioFrames.empty() || !result.videoFrames.empty()) {
+        buffer_->shrink();
+    }
+    
+    isCompleted_ = isCompleted();
+    if (isCompleted_) {
+        LogI("demux completed");
+    }
+    return result;
+}
+
+DemuxerResult Mp4Demuxer::parseSideData(DataPacket& packet) noexcept {
+    DemuxerResult result;
+    if (packet.empty()) {
+        //the track index did not move, the same range is read again
+        LogE("side read failed at:{}", packet.offset);
+        return result;
+    }
+    sideBuffer_->reset();
+    sideBuffer_->setOffset(static_cast<uint64_t>(packet.offset));
+    if (!sideBuffer_->append(static_cast<uint64_t>(packet.offset), std::move(packet.data))) {
+        return {DemuxerResultCode::InvalidData, AVFramePtrArray(), AVFramePtrArray()};
+    }
+    //a range of an earlier seek holds none of the samples due, nothing is parsed then
+    parseSamples(*sideBuffer_, true, result);
+    sideBuffer_->reset();
+    isCompleted_ = isCompleted();
+    return result;
+}
+
+void Mp4Demuxer::parseSamples(Buffer& buffer, bool isSide, DemuxerResult& result) noexcept {
+    while(!buffer.empty()) {
         uint64_t offset = INT64_MAX; //To find the earliest starting track
         std::shared_ptr<TrackContext> parseTrack;
         for (const auto& track : std::views::values(tracks_)) {
             uint64_t tOffset = INT64_MAX;
-            if (!track->isInRange(*buffer_, tOffset)) {
+            if ((track == sideTrack_) != isSide) {
+                continue;
+            }
+            if (!track->isInRange(buffer, tOffset)) {
                 continue;
             } else if (tOffset < offset && parseTrack != track){
                 parseTrack = track;
@@ -729,24 +1115,144 @@ DemuxerResult Mp4Demuxer::parseData(DataPacket& packet) noexcept {
             info->bitsPerSample = audioInfo_->bitsPerSample;
             info->channels = audioInfo_->channels;
             info->sampleRate = audioInfo_->sampleRate;
-            parseTrack->parseData(*buffer_, info, result.audioFrames);
+            parseTrack->parseData(buffer, info, result.audioFrames);
         } else if (parseTrack->type == TrackType::Video) {
             auto info = std::make_shared<VideoFrameInfo>();
             info->width = videoInfo_->width;
             info->height = videoInfo_->height;
             ///fix me: nalu size
-            parseTrack->parseData(*buffer_, info, result.videoFrames);
+            parseTrack->parseData(buffer, info, result.videoFrames);
         }
     }
-    if (!result.audioFrames.empty() || !result.videoFrames.empty()) {
-        buffer_->shrink();
+}
+
+bool Mp4Demuxer::parseFragmentBoxes(DemuxerResult& result) noexcept {
+    bool isParsed = false;
+    //only box headers are read, an mdat is consumed by the samples of its moof.
+    //the samples of a parsed moof go first, the buffer stays in front of their mdat,
+    //or the samples of the last fragment of a buffer would sit behind its read position
+    while (!isParsed && buffer_->skipTo(static_cast<int64_t>(nextBoxPos_))) {
+        auto box = Box::createBox(*buffer_);
+        if (!box) {
+            break;
+        }
+        auto bodySize = box->info.size - box->info.headerSize;
+        if (box->info.symbol == "moof") {
+            if (!buffer_->require(bodySize)) {
+                break;
+            }
+            parseMoofBox(box, result);
+            isParsed = true;
+        } else if (box->info.symbol == "sidx") {
+            if (!buffer_->require(bodySize)) {
+                break;
+            }
+            auto sidxBox = std::dynamic_pointer_cast<BoxSidx>(box);
+            if (sidxBox->decode(*buffer_)) {
+                parseSidxBox(*sidxBox);
+            }
+        }
+        nextBoxPos_ = box->info.end();
     }
-    
-    isCompleted_ = isCompleted();
-    if (isCompleted_) {
-        LogI("demux completed");
+    //stay before the next box, the buffer is shrunk up to the read position
+    buffer_->skipTo(static_cast<int64_t>(nextBoxPos_));
+    return isParsed;
+}
+
+///decode the boxes inside parent, all of parent is in the buffer
+void decodeChildBoxes(Buffer& buffer, const BoxRefPtr& parent) noexcept {
+    buffer.skipTo(static_cast<int64_t>(parent->info.start + parent->info.headerSize));
+    while (buffer.pos() + 8 <= parent->info.end()) {
+        auto box = Box::createBox(buffer);
+        if (!box || box->info.end() > parent->info.end()) {
+            LogE("bad child box in {}", parent->info.symbol);
+            break;
+        }
+        parent->append(box);
+        if (isContainerBox(box->info.symbol)) {
+            decodeChildBoxes(buffer, box);
+        } else {
+            box->decode(buffer);
+        }
+        buffer.skipTo(static_cast<int64_t>(box->info.end()));
     }
-    return result;
+}
+
+void Mp4Demuxer::parseMoofBox(const BoxRefPtr& moofBox, DemuxerResult& result) noexcept {
+    using namespace std::string_view_literals;
+    decodeChildBoxes(*buffer_, moofBox);
+    std::shared_ptr<TrackContext> timeTrack;
+    for (const auto& traf : moofBox->childs) {
+        if (traf->info.symbol != "traf"sv) {
+            continue;
+        }
+        auto tfhd = std::dynamic_pointer_cast<BoxTfhd>(traf->getChild("tfhd"sv));
+        if (!tfhd) {
+            continue;
+        }
+        auto it = std::ranges::find_if(tracks_, [trackId = tfhd->trackId](const auto& pair) {
+            return pair.second->trackId == trackId;
+        });
+        if (it == tracks_.end()) {
+            continue; //a track we don't play
+        }
+        auto& track = it->second;
+        track->parseTrackFragment(*traf, moofBox->info.start);
+        if (track->samples.empty()) {
+            continue;
+        }
+        if (!timeTrack || track->type == TrackType::Video) {
+            timeTrack = track;
+        }
+        if (track->type == TrackType::Video && videoInfo_ && videoInfo_->fps == 0) {
+            if (auto duration = track->samples.duration(0); duration > 0) {
+                videoInfo_->fps = static_cast<uint16_t>(videoInfo_->timeScale / duration);
+                result.resultCode = DemuxerResultCode::ParsedFPS;
+            }
+        }
+    }
+    if (!timeTrack || isIndexedBySidx_ || !timeTrack->mdhd) {
+        return;
+    }
+    //no sidx, remember the fragments on the way to seek back into them
+    auto dts = timeTrack->samples.dts(0);
+    if (!fragmentOriginDts_) {
+        fragmentOriginDts_ = dts;
+    }
+    auto pos = moofBox->info.start;
+    std::lock_guard<std::mutex> lock(fragmentsMutex_);
+    if (fragments_.empty() || fragments_.back().pos < pos) {
+        auto time = static_cast<double>(dts - *fragmentOriginDts_) / static_cast<double>(timeTrack->mdhd->timeScale);
+        fragments_.push_back({time, pos});
+    }
+}
+
+void Mp4Demuxer::parseSidxBox(const BoxSidx& sidxBox) noexcept {
+    if (isIndexedBySidx_ || sidxBox.timeScale == 0) {
+        return;
+    }
+    //built aside, a seek may read the fragments meanwhile
+    std::vector<Mp4Fragment> fragments;
+    auto pos = sidxBox.info.end() + sidxBox.firstOffset;
+    uint64_t duration = 0;
+    for (const auto& reference : sidxBox.references) {
+        //a reference to a nested sidx is stepped over, its subsegments are not seek points
+        if (!reference.isIndex) {
+            fragments.push_back({static_cast<double>(duration) / static_cast<double>(sidxBox.timeScale), pos});
+        }
+        pos += reference.referencedSize;
+        duration += reference.subsegmentDuration;
+    }
+    isIndexedBySidx_ = !fragments.empty();
+    if (totalDuration_.second() <= 0) {
+        totalDuration_ = CTime(static_cast<double>(duration) / static_cast<double>(sidxBox.timeScale));
+    }
+    auto count = fragments.size();
+    {
+        std::lock_guard<std::mutex> lock(fragmentsMutex_);
+        fragments_.swap(fragments);
+    }
+    LogI("sidx subsegments:{}, duration:{}", count, totalDuration_.second());
 }
 
 bool Mp4Demuxer::isCompleted() const noexcept {
@@ -756,17 +1262,60 @@ bool Mp4Demuxer::isCompleted() const noexcept {
             isCompleted = false;
         }
     }
+    if (isFragmented_) {
+        //every fragment completes its tracks, only the end of the file completes the demuxing
+        return isCompleted && config_.fileSize > 0 && nextBoxPos_ >= config_.fileSize;
+    }
     if (!isCompleted) {
         auto mediaDataBox = rootBox_->getChild("mdat");
-        if (mediaDataBox && buffer_->pos() >= (mediaDataBox->info.size + mediaDataBox->info.start)) {
+        auto isSideCompleted = !sideTrack_ || sideTrack_->isCompleted;
+        if (mediaDataBox && isSideCompleted && buffer_->pos() >= (mediaDataBox->info.size + mediaDataBox->info.start)) {
             isCompleted = true;
         }
     }
     return isCompleted;
 }
 
+uint64_t Mp4Demuxer::dataStart() const noexcept {
+    if (isFragmented_) {
+        return headerInfo_ ? headerInfo_->headerLength : 0; //the first box after the header
+    }
+    //the first sample, the moov of a file which is not fast started may leave a gap in front of it
+    uint64_t firstOffset = std::numeric_limits<uint64_t>::max();
+    for (const auto& track : std::views::values(tracks_)) {
+        if (track != sideTrack_ && !track->samples.empty()) {
+            firstOffset = std::min(firstOffset, track->samples.offset(0));
+        }
+    }
+    if (firstOffset != std::numeric_limits<uint64_t>::max()) {
+        return firstOffset;
+    }
+    if (!headerInfo_) {
+        return 0;
+    }
+    //skip the mdat header, 16 bytes with a 64-bit size
+    auto mediaDataBox = rootBox_ ? rootBox_->getChild("mdat") : nullptr;
+    return headerInfo_->headerLength + (mediaDataBox ? mediaDataBox->info.headerSize : 8);
+}
+
 uint64_t Mp4Demuxer::getSeekToPos(double time) noexcept {
-    auto offset = headerInfo_->headerLength + 8;//skip size and type
+    if (isFragmented_) {
+        std::lock_guard<std::mutex> lock(fragmentsMutex_);
+        //the fragment which starts last at or before time
+        auto it = std::upper_bound(fragments_.begin(), fragments_.end(), time, [](double value, const Mp4Fragment& fragment) {
+            return value < fragment.time;
+        });
+        auto pos = it == fragments_.begin() ? dataStart() : std::prev(it)->pos;
+        LogI("seek to time:{}, fragment pos:{}, fragments:{}", time, pos, fragments_.size());
+        return pos;
+    }
+    if (sideTrack_) {
+        //the side track follows the video, see seekPos
+        auto pos = findTrack(TrackType::Video)->getSeekPos(time);
+        LogI("seek to time, video offset:{}, audio is read on the side", pos);
+        return pos;
+    }
+    auto offset = dataStart();
     uint64_t videoOffset = offset;
     uint64_t audioOffset = offset;
     for (const auto& track:std::views::values(tracks_)) {
@@ -782,9 +1331,143 @@ uint64_t Mp4Demuxer::getSeekToPos(double time) noexcept {
 
 void Mp4Demuxer::seekPos(uint64_t pos) noexcept  {
     IDemuxer::seekPos(pos);
+    if (isFragmented_) {
+        //pos is the start of a fragment, its moof brings the samples
+        nextBoxPos_ = pos;
+        for (auto& track : std::views::values(tracks_)) {
+            track->samples.clear();
+            track->reset();
+            track->isWaitingKeyFrame = true;
+        }
+        return;
+    }
     for (auto& track:std::views::values(tracks_)) {
-        track->seek(pos);
+        if (track != sideTrack_) {
+            track->seek(pos);
+        }
+    }
+    if (sideTrack_) {
+        seekSideTrack();
+    }
+}
+
+///seconds from the first sample to the sample at index
+double trackTime(const TrackContext& track, uint64_t index) noexcept {
+    const auto& samples = track.samples;
+    auto count = samples.size();
+    if (count == 0 || !track.mdhd || track.mdhd->timeScale == 0) {
+        return 0;
+    }
+    index = std::min(index, count - 1);
+    //firstDts keeps the first page out, a walk over the index decodes every page once
+    return static_cast<double>(samples.dts(index) - track.firstDts) / static_cast<double>(track.mdhd->timeScale);
+}
+
+std::shared_ptr<TrackContext> Mp4Demuxer::findTrack(TrackType type) const noexcept {
+    auto it = std::ranges::find_if(tracks_, [type](const auto& pair) {
+        return pair.second->type == type;
+    });
+    return it == tracks_.end() ? nullptr : it->second;
+}
+
+uint64_t Mp4Demuxer::interleaveDistance() const noexcept {
+    auto video = findTrack(TrackType::Video);
+    auto audio = findTrack(TrackType::Audio);
+    if (isFragmented_ || !video || !audio || video->samples.empty() || audio->samples.empty()) {
+        return 0;
+    }
+    //both indexes are walked forward, each decodes its pages once and in order
+    uint64_t distance = 0;
+    uint64_t videoIndex = 0;
+    const auto& videoSamples = video->samples;
+    const auto& audioSamples = audio->samples;
+    auto videoCount = videoSamples.size();
+    auto audioCount = audioSamples.size();
+    auto nextVideoTime = trackTime(*video, 1);
+    for (uint64_t i = 0; i < audioCount; i++) {
+        auto time = trackTime(*audio, i);
+        while (videoIndex + 1 < videoCount && nextVideoTime <= time) {
+            videoIndex++;
+            nextVideoTime = trackTime(*video, videoIndex + 1);
+        }
+        auto audioOffset = audioSamples.offset(i);
+        auto videoOffset = videoSamples.offset(videoIndex);
+        distance = std::max(distance, audioOffset > videoOffset ? audioOffset - videoOffset : videoOffset - audioOffset);
+    }
+    return distance;
+}
+
+void Mp4Demuxer::enableSideStream() noexcept {
+    if (isFragmented_ || !findTrack(TrackType::Video)) {
+        return;
+    }
+    sideTrack_ = findTrack(TrackType::Audio);
+    if (sideTrack_) {
+        sideBuffer_ = std::make_unique<Buffer>();
+        seekSideTrack();
+    }
+}
+
+std::optional<double> Mp4Demuxer::mainTime() const noexcept {
+    std::optional<double> time;
+    for (const auto& track : std::views::values(tracks_)) {
+        if (track != sideTrack_ && !track->isCompleted && track->index < track->samples.size()) {
+            auto trackStart = trackTime(*track, track->index);
+            time = time ? std::min(*time, trackStart) : trackStart;
+        }
+    }
+    return time;
+}
+
+void Mp4Demuxer::seekSideTrack() noexcept {
+    auto& samples = sideTrack_->samples;
+    sideTrack_->reset();
+    if (sideBuffer_) {
+        sideBuffer_->reset();
+    }
+    if (samples.empty() || !sideTrack_->mdhd) {
+        return;
+    }
+    auto time = mainTime();
+    if (!time) {
+        sideTrack_->index = samples.size();
+        sideTrack_->isCompleted = true;
+        return;
+    }
+    auto dts = sideTrack_->firstDts + static_cast<int64_t>(*time * static_cast<double>(sideTrack_->mdhd->timeScale));
+    sideTrack_->index = samples.findByDts(dts);
+    LogI("[seek info] side audio sampleIndex:{}, time:{}", sideTrack_->index, *time);
+}
+
+Range Mp4Demuxer::nextSideRange() const noexcept {
+    //ahead of the video by this much at most, the demuxed audio is not piled up
+    constexpr double kSideLeadTime = 10.0;
+    constexpr uint64_t kSideReadSize = 1024 * 1024;
+    //samples with a smaller gap in between are read together, a request costs more than the gap
+    constexpr uint64_t kSideMergeGap = 64 * 1024;
+    if (!sideTrack_ || sideTrack_->isCompleted) {
+        return {};
+    }
+    const auto& samples = sideTrack_->samples;
+    auto index = sideTrack_->index;
+    if (index >= samples.size()) {
+        return {};
+    }
+    //once the sequential stream is all parsed the rest of the side track is due
+    if (auto time = mainTime(); time && trackTime(*sideTrack_, index) > *time + kSideLeadTime) {
+        return {};
+    }
+    auto start = samples.offset(index);
+    auto end = start + samples.sampleSize(index);
+    for (index++; index < samples.size(); index++) {
+        auto offset = samples.offset(index);
+        auto sampleEnd = offset + samples.sampleSize(index);
+        if (offset < end || offset - end > kSideMergeGap || sampleEnd - start > kSideReadSize) {
+            break;
+        }
+        end = sampleEnd;
     }
+    return Range(start, static_cast<int64_t>(end - start));
 }
 
 }
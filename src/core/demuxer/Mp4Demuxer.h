@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <mutex>
+#include <optional>
 #include "IDemuxer.h"
+#include "Range.h"
 #include "Mp4Box.hpp"
 
 namespace slark {
@@ -17,6 +20,121 @@ enum class TrackType {
     Audio = 1,
     Video = 2,
 };
+
+///Per-sample table of a track, built once from stsz/stsc/stco/stts/ctts/stss.
+///Samples are stored in pages of kPageSize, delta and varint coded, only the first offset
+///and dts of every page stay plain to binary search them. A page is decoded when one of
+///its samples is read and stays cached until another page is read. The pages and the cache are guarded,
+///seek lookups come from the player thread while the demux worker reads, or for a fragment refills, the same index.
+class Mp4SampleIndex {
+public:
+    static constexpr uint32_t kPageSize = 256;
+
+    ///read the sample tables from the moov in buffer, their entries are not kept
+    bool build(Buffer& buffer,
+               const BoxStsz& stsz,
+               const BoxStsc& stsc,
+               const BoxStco& stco,
+               const BoxStts& stts,
+               const BoxCtts* ctts,
+               const BoxStss* stss,
+               bool isFirstPtsZero) noexcept;
+
+    ///add the next sample of a fragment
+    void append(uint64_t offset, uint32_t size, int64_t dts, int32_t ptsDelta, bool isKeyFrame, uint32_t duration) noexcept;
+
+    void clear() noexcept;
+
+    [[nodiscard]] uint64_t size() const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_ == 0;
+    }
+
+    [[nodiscard]] uint64_t offset(uint64_t index) const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return decodePage(index).offsets[index % kPageSize];
+    }
+
+    [[nodiscard]] uint32_t sampleSize(uint64_t index) const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return decodePage(index).sizes[index % kPageSize];
+    }
+
+    [[nodiscard]] int64_t dts(uint64_t index) const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return decodePage(index).dts[index % kPageSize];
+    }
+
+    [[nodiscard]] int64_t pts(uint64_t index) const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto& page = decodePage(index);
+        return page.dts[index % kPageSize] + page.ptsDeltas[index % kPageSize];
+    }
+
+    [[nodiscard]] bool isKeyFrame(uint64_t index) const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return decodePage(index).keyFrames[index % kPageSize];
+    }
+
+    ///in timescale units
+    [[nodiscard]] uint32_t duration(uint64_t index) const noexcept;
+
+    ///first sample that starts at or after pos, size() if none
+    [[nodiscard]] uint64_t findByOffset(uint64_t pos) const noexcept;
+
+    ///last sample whose dts is not greater than dts, 0 if none
+    [[nodiscard]] uint64_t findByDts(int64_t dts) const noexcept;
+
+    ///first key frame at or after index, size() if none
+    [[nodiscard]] uint64_t nextKeyFrame(uint64_t index) const noexcept;
+
+    ///bytes held by the coded samples and the page heads
+    [[nodiscard]] uint64_t memorySize() const noexcept;
+private:
+    struct Page {
+        ///offset and dts of the first sample
+        uint64_t offset = 0;
+        int64_t dts = 0;
+        ///where the coded samples start in bytes_
+        uint64_t byteStart = 0;
+        ///index of the first key frame in the page, kPageSize if none
+        uint32_t firstKey = kPageSize;
+    };
+
+    struct DecodedPage {
+        uint64_t page = UINT64_MAX;
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> sizes;
+        std::vector<int64_t> dts;
+        std::vector<int32_t> ptsDeltas;
+        std::vector<uint8_t> keyFrames;
+    };
+
+    ///mutex_ must be held by the ones below
+    void appendSample(uint64_t offset, uint32_t size, int64_t dts, int32_t ptsDelta, bool isKeyFrame, uint32_t duration) noexcept;
+
+    void clearSamples() noexcept;
+
+    ///the page which holds the sample at index, index must be less than count_
+    const DecodedPage& decodePage(uint64_t index) const noexcept;
+private:
+    std::vector<Page> pages_;
+    std::vector<uint8_t> bytes_;
+    uint64_t count_ = 0;
+    ///where the next sample starts if it follows the last one without a gap
+    uint64_t nextOffset_ = 0;
+    int64_t lastDts_ = 0;
+    int64_t lastDtsDelta_ = 0;
+    uint32_t lastDuration_ = 0;
+    mutable std::mutex mutex_;
+    mutable DecodedPage cache_;
+};
+
 class TrackContext {
 public:
     bool isCompleted = false;
@@ -32,24 +150,24 @@ public:
     std::shared_ptr<BoxStts> stts;
     std::shared_ptr<BoxCtts> ctts;
     std::shared_ptr<BoxStss> stss;
+    ///sample defaults of a fragmented track
+    std::shared_ptr<BoxTrex> trex;
     
-    uint32_t stszSampleSizeIndex = 0;
-    uint32_t stscEntryIndex = 0;
-    uint32_t entrySampleIndex = 0;
-    uint32_t chunkLogicIndex = 0;
-    uint32_t sampleOffset = 0;
-    
-    uint32_t sttsEntryIndex = 0;
-    uint32_t sttsEntrySampleIndex = 0;
-    
-    uint32_t cttsEntryIndex = 0;
-    uint32_t cttsEntrySampleIndex = 0;
-    
-    int64_t dts = 0;
-    int64_t pts = 0;
+    Mp4SampleIndex samples;
     uint64_t index = 0;
     uint64_t keyIndex = 0;
     uint16_t naluByteSize = 0;
+    ///num_extra_slice_header_bits of the hvcC pps
+    uint32_t extraSliceHeaderBits = 0;
+    uint32_t trackId = 0;
+    ///dts of the sample after the last fragment, for fragments without tfdt
+    int64_t nextDts = 0;
+    ///dts of the first sample of the moov sample table, the track times count from it
+    int64_t firstDts = 0;
+    ///the first fragment moves the dts so that the first pts is 0, like ctts does for a moov sample table
+    std::optional<int64_t> dtsShift;
+    ///after a seek the samples before the first key frame of a fragment are dropped
+    bool isWaitingKeyFrame = false;
 public:
     bool isInRange(Buffer& buffer) const noexcept;
     
@@ -76,13 +194,28 @@ public:
         DataPtr data,
         std::shared_ptr<VideoFrameInfo> frameInfo
     );
-    void calcIndex() noexcept;
 
-    void init() noexcept;
+    ///build the sample index from the moov in buffer, the sample table boxes must be set
+    void init(Buffer& buffer) noexcept;
+
+    ///replace the samples with the ones of a traf, the samples of the last fragment are done by now
+    void parseTrackFragment(const Box& traf, uint64_t moofStart) noexcept;
+};
+
+///where a fragment starts, for seeking in a fragmented file
+struct Mp4Fragment {
+    ///seconds from the first fragment
+    double time = 0;
+    uint64_t pos = 0;
 };
 
 class Mp4Demuxer: public IDemuxer {
 public:
+    ///audio and video samples of the same time further apart than this are read as two streams
+    static constexpr uint64_t kSplitInterleaveDistance = 4 * 1024 * 1024;
+    ///packets of the side stream carry this tag
+    static constexpr std::string_view kSideStreamTag = "mp4_side";
+
     Mp4Demuxer() {
         type_ = DemuxerType::MP4;
     }
@@ -108,19 +241,82 @@ public:
         return info;
     }
     
-    bool probeMoovBox(Buffer& buffer, int64_t& start, uint32_t& size) noexcept;
+    ///after a failed open, the top level data it needs next: the moov once its header was read,
+    ///otherwise the position of the first box header which is not in the buffer
+    [[nodiscard]] const Range& missingRange() const noexcept {
+        return missingRange_;
+    }
+
+    ///the first byte to read after open, the mdat payload or the first fragment
+    [[nodiscard]] uint64_t dataStart() const noexcept;
+
+    ///the largest distance in bytes between an audio sample and the video sample of its time,
+    ///walks the whole sample index
+    [[nodiscard]] uint64_t interleaveDistance() const noexcept;
+
+    ///read the audio track on the side from now on, the sequential stream only feeds the video
+    void enableSideStream() noexcept;
+
+    [[nodiscard]] bool isSideStreamEnabled() const noexcept {
+        return sideTrack_ != nullptr;
+    }
+
+    ///the next samples of the side track to read, invalid if they are not due yet
+    [[nodiscard]] Range nextSideRange() const noexcept;
+
+    ///moov with mvex, the samples are described by moof boxes
+    [[nodiscard]] bool isFragmented() const noexcept {
+        return isFragmented_;
+    }
 
     ///debug info
     [[nodiscard]] std::string description() const noexcept;
 private:
     bool parseMoovBox(Buffer& buffer, const BoxRefPtr& moovBox) noexcept;
 
-    void initData() noexcept;
+    ///the samples in the buffer of the side track, or of the other tracks
+    void parseSamples(Buffer& buffer, bool isSide, DemuxerResult& result) noexcept;
+
+    ///a range read for the side track, it holds whole samples
+    DemuxerResult parseSideData(DataPacket& packet) noexcept;
+
+    ///the side track goes to the time the other tracks were moved to
+    void seekSideTrack() noexcept;
+
+    ///seconds of the next sample to parse from the sequential stream, none once it is all parsed
+    [[nodiscard]] std::optional<double> mainTime() const noexcept;
+
+    [[nodiscard]] std::shared_ptr<TrackContext> findTrack(TrackType type) const noexcept;
+
+    ///walk the top level boxes of a fragmented file, true if a moof brought new samples
+    bool parseFragmentBoxes(DemuxerResult& result) noexcept;
+
+    void parseMoofBox(const BoxRefPtr& moofBox, DemuxerResult& result) noexcept;
+
+    ///the subsegments of the first sidx are the seek points
+    void parseSidxBox(const BoxSidx& sidxBox) noexcept;
+
+    ///buffer holds the moov, the sample tables are read from it
+    void initData(Buffer& buffer) noexcept;
     
     bool isCompleted() const noexcept;
 private:
     BoxRefPtr rootBox_;
     std::unordered_map<CodecId, std::shared_ptr<TrackContext>> tracks_;
+    bool isFragmented_ = false;
+    ///position of the next top level box of a fragmented file
+    uint64_t nextBoxPos_ = 0;
+    Range missingRange_;
+    ///sorted by pos, from the sidx or else from the moof boxes seen so far
+    ///written by the demux worker and read by seeks, guarded by fragmentsMutex_
+    std::vector<Mp4Fragment> fragments_;
+    mutable std::mutex fragmentsMutex_;
+    bool isIndexedBySidx_ = false;
+    ///dts of the first fragment of the track the fragment times are measured on
+    std::optional<int64_t> fragmentOriginDts_;
+    ///a badly interleaved track read by range, its index is the read cursor
+    std::shared_ptr<TrackContext> sideTrack_;
+    std::unique_ptr<Buffer> sideBuffer_;
 };
 
 }
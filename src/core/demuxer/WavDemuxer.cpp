@@ -248,7 +248,7 @@ DemuxerResult WAVDemuxer::parseData(DataPacket& packet) noexcept {
     while (buffer_->length() >= frameLength) {
         auto prasedLength = buffer_->pos();
         auto frame = std::make_unique<AVFrame>();
-        frame->data = buffer_->readData(frameLength);
+        frame->data = buffer_->readSlice(frameLength);
         frame->duration = static_cast<uint32_t>(static_cast<double>(sampleCount) /
                                                 static_cast<double>(audioInfo_->sampleRate) * 1000);
         frame->pts = static_cast<int64_t>(static_cast<double>(prasedLength) / scale * audioInfo_->timeScale);
@@ -263,7 +263,7 @@ DemuxerResult WAVDemuxer::parseData(DataPacket& packet) noexcept {
     if (isCompleted) {
         auto prasedLength = buffer_->pos();
         auto frame = std::make_unique<AVFrame>();
-        frame->data = buffer_->readData(buffer_->length());
+        frame->data = buffer_->readSlice(buffer_->length());
         frame->duration = static_cast<uint32_t>(static_cast<double>(frame->data->length) / scale * 1000);
         frame->timeScale = audioInfo_->timeScale;
         frame->pts = static_cast<uint64_t>(ceil(static_cast<double>(prasedLength) / scale * audioInfo_->timeScale));
@@ -90,6 +90,8 @@ struct PlayerInfo {
     bool isValid = false;
     bool hasVideo = false;
     bool hasAudio = false;
+    ///a live stream, duration is the part known when it was prepared
+    bool isLive = false;
     double duration = 0;
 };
 
@@ -0,0 +1,121 @@
+//
+// Created by Nevermore on 2025/7/16.
+// slark ConnectionPool
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <vector>
+#include "Log.hpp"
+#include "include/ConnectionPool.h"
+
+namespace slark::http {
+
+ConnectionPool& ConnectionPool::shareInstance() {
+    static ConnectionPool instance;
+    return instance;
+}
+
+std::string ConnectionPool::key(const Url& url) noexcept {
+    return url.scheme + "://" + url.host + ":" + url.port;
+}
+
+SocketPtr ConnectionPool::acquire(const Url& url) noexcept {
+    std::vector<SocketPtr> closed;
+    SocketPtr res(nullptr, &freeSocket);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evictExpired(closed);
+        auto it = connections_.find(key(url));
+        if (it == connections_.end()) {
+            return res;
+        }
+        auto& connections = it->second;
+        while (!connections.empty() && !res) {
+            auto socket = std::move(connections.back().socket);
+            connections.pop_back();
+            idleCount_--;
+            //an idle connection has nothing to read, readable means the peer closed it or sent garbage
+            if (socket->isLive() && !socket->canReceive(0).isSuccess()) {
+                res = std::move(socket);
+            } else {
+                closed.push_back(std::move(socket));
+            }
+        }
+        if (connections.empty()) {
+            connections_.erase(it);
+        }
+    }
+    if (res) {
+        LogI("reuse connection:{}", key(url));
+    }
+    return res;
+}
+
+void ConnectionPool::release(const Url& url, SocketPtr socket) noexcept {
+    if (!socket) {
+        return;
+    }
+    std::vector<SocketPtr> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evictExpired(evicted);
+        auto& connections = connections_[key(url)];
+        if (connections.size() >= kMaxIdleCountPerHost) {
+            evicted.push_back(std::move(connections.front().socket));
+            connections.pop_front();
+            idleCount_--;
+        }
+        connections.push_back({std::move(socket), Time::nowTimeStamp()});
+        idleCount_++;
+        while (idleCount_ > kMaxIdleCount) {
+            //the connection idle for the longest time goes first
+            auto oldest = connections_.end();
+            for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+                if (!it->second.empty() && (oldest == connections_.end() ||
+                    it->second.front().idleTime < oldest->second.front().idleTime)) {
+                    oldest = it;
+                }
+            }
+            evicted.push_back(std::move(oldest->second.front().socket));
+            oldest->second.pop_front();
+            idleCount_--;
+            if (oldest->second.empty()) {
+                connections_.erase(oldest);
+            }
+        }
+    }
+    //closing a TLS connection writes, not under the lock
+    evicted.clear();
+}
+
+void ConnectionPool::evictExpired(std::vector<SocketPtr>& evicted) noexcept {
+    auto now = Time::nowTimeStamp();
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        auto& connections = it->second;
+        while (!connections.empty() && (now - connections.front().idleTime).toMilliSeconds() >= kMaxIdleTime) {
+            evicted.push_back(std::move(connections.front().socket));
+            connections.pop_front();
+            idleCount_--;
+        }
+        if (connections.empty()) {
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ConnectionPool::clear() noexcept {
+    decltype(connections_) connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+        idleCount_ = 0;
+    }
+}
+
+uint32_t ConnectionPool::idleCount() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idleCount_;
+}
+
+} //end of namespace slark::http
@@ -65,85 +65,4 @@ std::string htmlEncode(
     return oss.str();
 }
 
-bool parseChunkHandler(
-    DataPtr& data,
-    int64_t& chunkSize,
-    bool& isCompleted,
-    const std::function<void(ResultCode, int32_t)>& errorHandler,
-    const std::function<void(DataPtr)>& dataHandler
-) noexcept {
-    constexpr std::string_view kCRLF = "\r\n"sv;
-    bool res = true;
-    auto dataView = data->view();
-    while (!dataView.empty()) {
-        if (chunkSize <= 0) {
-            auto pos = dataView.find(kCRLF);
-            if (pos == std::string_view::npos) {
-                errorHandler(ResultCode::ChunkSizeError, 0);
-                res = false;
-                break;
-            }
-            chunkSize = std::stol(dataView.substr(0, pos).str(), nullptr, 16);
-            if (chunkSize == 0) {
-                isCompleted = true;
-                break;
-            }
-            dataView = dataView.substr(pos + kCRLF.size());
-        } else {
-            auto size = std::min(static_cast<uint64_t>(chunkSize), dataView.length());
-            dataHandler(std::make_unique<Data>(dataView.substr(0, size).view()));
-            dataView = dataView.substr(size);
-            chunkSize -= static_cast<int64_t>(size);
-        }
-
-        if (dataView.find(kCRLF) == 0) {
-            dataView = dataView.substr(kCRLF.size());
-        }
-    }
-
-    if (dataView.empty()) {
-        data->reset();
-    } else {
-        data = std::make_unique<Data>(dataView.view());
-    }
-    return res;
-}
-
-std::tuple<bool, int64_t> parseResponseHeader(
-    DataView data,
-    ResponseHeader& response
-) noexcept {
-    constexpr std::string_view kCRLF = "\r\n"sv;
-    constexpr std::string_view kHeaderEnd = "\r\n\r\n"sv;
-    ///https://www.rfc-editor.org/rfc/rfc7230#section-3.1.2:~:text=header%2Dfield%20CRLF%20)-,CRLF,-%5B%20message%2Dbody%20%5D
-    auto headerEndPos = data.find(kHeaderEnd);
-    if (headerEndPos == std::string_view::npos) {
-        return {false, 0};
-    }
-    auto headerView = data.substr(0, headerEndPos);
-
-    auto headerViews = headerView.split(kCRLF);
-    ///parse version and status
-    auto statusView = headerViews[0];
-    constexpr std::string_view kHTTPFlag = "HTTP/"sv;
-    if (auto versionPos = statusView.find(kHTTPFlag); versionPos != std::string_view::npos) {
-        ///HTTP-version SP status-code SP reason-phrase CRLF
-        response.headers["Version"] = statusView.substr(versionPos, kHTTPFlag.size() + 3).view();
-        response.httpStatusCode = static_cast<HttpStatusCode>(std::stoi(statusView.substr(kHTTPFlag.size() + 4, 3).str()));
-        response.reasonPhrase = statusView.substr(versionPos + kHTTPFlag.size() + 3 + 1 + 3 + 1).view();
-    }
-    for (auto& view : headerViews) {
-        if (view.empty() || view.find(':') == std::string_view::npos) {
-            continue;
-        }
-        auto fieldValue = view.split(": ");
-        if (fieldValue.size() == 2) {
-            auto& name = fieldValue[0];
-            auto& value = fieldValue[1];
-            response.headers[name.removePrefix(' ').str()] = value.removePrefix(' ').str();
-        }
-    }
-    return {true, headerEndPos + kHeaderEnd.size()};
-}
-
 } // slark::http::Util
\ No newline at end of file
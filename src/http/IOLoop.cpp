@@ -0,0 +1,244 @@
+//
+// Created by Nevermore on 2025/7/18.
+// slark IOLoop
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <vector>
+#include "Log.hpp"
+#include "include/IOLoop.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
+
+namespace slark::http {
+
+///ready sockets handled per wait
+constexpr int kMaxEventCount = 64;
+///first and longest sleep after a failed wait
+constexpr std::chrono::milliseconds kMinBackOffTime{1};
+constexpr std::chrono::milliseconds kMaxBackOffTime{1000};
+
+IOLoop& IOLoop::shareInstance() {
+    static IOLoop instance;
+    return instance;
+}
+
+IOLoop::IOLoop() {
+#if defined(__linux__)
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd_ < 0 || wakeFd_ < 0) {
+        LogE("create io loop failed, errno:{}", errno);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+#else
+    if (::pipe(wakePipe_) != 0) {
+        LogE("create io loop failed, errno:{}", errno);
+    }
+    for (auto fd : wakePipe_) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+#endif
+    worker_ = std::thread(&IOLoop::process, this);
+}
+
+IOLoop::~IOLoop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isExited_ = true;
+    }
+    cond_.notify_all();
+    wakeUp();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+#if defined(__linux__)
+    ::close(epollFd_);
+    ::close(wakeFd_);
+#else
+    ::close(wakePipe_[0]);
+    ::close(wakePipe_[1]);
+#endif
+}
+
+bool IOLoop::isInLoopThread() const noexcept {
+    return std::this_thread::get_id() == worker_.get_id();
+}
+
+void IOLoop::wakeUp() noexcept {
+#if defined(__linux__)
+    uint64_t value = 1;
+    [[maybe_unused]] auto size = ::write(wakeFd_, &value, sizeof(value));
+#else
+    char value = 1;
+    [[maybe_unused]] auto size = ::write(wakePipe_[1], &value, sizeof(value));
+#endif
+}
+
+bool IOLoop::add(Socket socket, ReadableFunc func) noexcept {
+    if (socket == kInvalidSocket || !func) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux__)
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = socket;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) != 0) {
+        LogE("watch socket {} failed, errno:{}", socket, errno);
+        return false;
+    }
+#endif
+    watchers_[socket] = std::make_shared<ReadableFunc>(std::move(func));
+#if !defined(__linux__)
+    //poll rebuilds its list on every wait
+    wakeUp();
+#endif
+    return true;
+}
+
+void IOLoop::remove(Socket socket) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (watchers_.erase(socket) == 0) {
+            return;
+        }
+#if defined(__linux__)
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, socket, nullptr);
+#endif
+    }
+    waitCall(socket);
+}
+
+void IOLoop::waitCall(Socket socket) noexcept {
+    if (socket == kInvalidSocket || isInLoopThread()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this, socket] {
+        return callingSocket_ != socket;
+    });
+}
+
+void IOLoop::backOff(std::chrono::milliseconds& delay) noexcept {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait_for(lock, delay, [this] {
+        return isExited_.load();
+    });
+    delay = std::min(delay * 2, kMaxBackOffTime);
+}
+
+#if defined(__linux__)
+void IOLoop::rebuildPollSet() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) {
+        LogE("recreate epoll failed, errno:{}", errno);
+        return;
+    }
+    ::close(epollFd_);
+    epollFd_ = fd;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+    for (const auto& [socket, func] : watchers_) {
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = socket;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) != 0) {
+            LogE("rewatch socket {} failed, errno:{}", socket, errno);
+        }
+    }
+}
+#endif
+
+std::shared_ptr<IOLoop::ReadableFunc> IOLoop::prepareCall(Socket socket) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = watchers_.find(socket);
+    if (it == watchers_.end()) {
+        //removed after the wait returned
+        return nullptr;
+    }
+    callingSocket_ = socket;
+    return it->second;
+}
+
+void IOLoop::finishCall() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callingSocket_ = kInvalidSocket;
+    }
+    cond_.notify_all();
+}
+
+void IOLoop::process() noexcept {
+    std::vector<Socket> readySockets;
+    readySockets.reserve(kMaxEventCount);
+#if defined(__linux__)
+    epoll_event events[kMaxEventCount];
+#else
+    std::vector<pollfd> pollFds;
+#endif
+    auto backOffTime = kMinBackOffTime;
+    while (!isExited_) {
+        readySockets.clear();
+#if defined(__linux__)
+        auto count = ::epoll_wait(epollFd_, events, kMaxEventCount, -1);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == wakeFd_) {
+                uint64_t value = 0;
+                [[maybe_unused]] auto size = ::read(wakeFd_, &value, sizeof(value));
+            } else {
+                readySockets.push_back(events[i].data.fd);
+            }
+        }
+#else
+        pollFds.clear();
+        pollFds.push_back({wakePipe_[0], POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& [socket, func] : watchers_) {
+                pollFds.push_back({socket, POLLIN, 0});
+            }
+        }
+        auto count = ::poll(pollFds.data(), static_cast<nfds_t>(pollFds.size()), -1);
+        if (count > 0 && pollFds.front().revents) {
+            char buffer[64];
+            while (::read(wakePipe_[0], buffer, sizeof(buffer)) > 0);
+        }
+        for (size_t i = 1; count > 0 && i < pollFds.size(); i++) {
+            if (pollFds[i].revents) {
+                readySockets.push_back(pollFds[i].fd);
+            }
+        }
+#endif
+        auto error = errno;
+        if (count < 0 && error != EINTR) {
+            //retrying at once would spin on an error that does not go away
+            LogE("io loop wait failed, errno:{}", error);
+#if defined(__linux__)
+            if (error == EBADF || error == EINVAL) {
+                rebuildPollSet();
+            }
+#endif
+            backOff(backOffTime);
+            continue;
+        }
+        backOffTime = kMinBackOffTime;
+        for (auto socket : readySockets) {
+            if (auto func = prepareCall(socket)) {
+                (*func)();
+                finishCall();
+            }
+        }
+    }
+}
+
+}//end of namespace slark::http
@@ -50,7 +50,7 @@ std::tuple<SocketResult, int64_t> PlainSocket::send(const std::string_view& data
 
 std::tuple<SocketResult, DataPtr> PlainSocket::receive() const noexcept {
     SocketResult result;
-    auto data = std::make_unique<Data>(kDefaultReadSize);
+    auto data = Data::obtain(kDefaultReadSize);
     int32_t receiveSize = 0;
     int32_t retryCount = 0;
     do {
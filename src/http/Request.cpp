@@ -17,17 +17,31 @@
 #include "Util.hpp"
 #include "Log.hpp"
 #include "HttpUtil.h"
+#include "ConnectionPool.h"
+#include "IOLoop.h"
+#include "ResponseParser.h"
 
 namespace slark::http {
 
 using namespace std::chrono_literals;
 
+///reads of one socket per readable event, 1mb with the default read size
+constexpr int32_t kMaxReadCountPerEvent = 64;
+///threads connecting and sending for all requests, the responses are read on the io loop
+constexpr uint32_t kRequestWorkerCount = 4;
+
+static ThreadPool& requestWorkers() {
+    static ThreadPool pool(ThreadPoolConfig{kRequestWorkerCount});
+    return pool;
+}
+
 Request::Request(const RequestInfo& info, const ResponseHandler& responseHandler)
     : startStamp_(Time::nowTimeStamp().point())
     , info_(info)
     , handler_(responseHandler)
     , socket_(nullptr, freeSocket)
-    , url_(nullptr, freeUrl) {
+    , url_(nullptr, freeUrl)
+    , parser_(nullptr, freeResponseParser) {
     config();
 }
 
@@ -36,20 +50,37 @@ Request::Request(RequestInfo&& info, ResponseHandler&& responseHandler)
     , info_(std::move(info))
     , handler_(std::move(responseHandler))
     , socket_(nullptr,freeSocket)
-    , url_(nullptr, freeUrl) {
+    , url_(nullptr, freeUrl)
+    , parser_(nullptr, freeResponseParser) {
     config();
 }
 
 Request::~Request() {
     isValid_ = false;
-    if (worker_ && worker_->joinable()) {
-        worker_->join();
+    //the loop may be finishing the request on its own, wait for it as well
+    stopReceive();
+    IOLoop::shareInstance().waitCall(receivingSocket_);
+    while (true) {
+        std::future<void> worker;
+        {
+            std::lock_guard<std::mutex> lock(workerMutex_);
+            worker = std::move(worker_);
+        }
+        if (!worker.valid()) {
+            break;
+        }
+        worker.wait();
     }
+    //the worker may have handed the socket over before it saw the request invalid
+    stopReceive();
+    IOLoop::shareInstance().waitCall(receivingSocket_);
 }
 
 void Request::config() noexcept {
     info_.reqId = Random::randomString(20);
-    worker_ = std::make_unique<std::thread>(&Request::process, this);
+    runOnWorker([this] {
+        process();
+    });
 }
 
 #ifdef __clang__
@@ -58,12 +89,33 @@ void Request::config() noexcept {
 #endif
 
 void Request::sendRequest() noexcept {
-    auto errorHandler = [&](ResultCode code, int32_t errorCode) {
-        this->onError(code, errorCode);
-    };
     timerId_ = TimerManager::shareInstance().runAfter(info_.timeout, [this]{
         onError(ResultCode::Timeout, 0);
     });
+    isReusedSocket_ = false;
+    if (auto socket = ConnectionPool::shareInstance().acquire(*url_)) {
+        socket_ = std::move(socket);
+        isReusedSocket_ = true;
+        if (isValid_ && handler_.onConnected) {
+            handler_.onConnected(info_);
+        }
+    } else if (!connect()) {
+        return;
+    }
+    if (!send()) {
+        return;
+    }
+    if (timerId_.isValid()) {
+        TimerManager::shareInstance().cancel(timerId_);
+        timerId_ = TimerId::kInvalidTimerId;
+    }
+    startReceive();
+}
+
+bool Request::connect() noexcept {
+    auto errorHandler = [&](ResultCode code, int32_t errorCode) {
+        this->onError(code, errorCode);
+    };
     addrinfo hints{};
     hints.ai_family = GetAddressFamily(info_.ipVersion);
     hints.ai_socktype = SOCK_STREAM; //tcp
@@ -75,7 +127,7 @@ void Request::sendRequest() noexcept {
         auto errorMessage = std::string(gai_strerror(addrCode));
         LogE("get addr info failed: {}, last error: {}", errorMessage, lastError);
         errorHandler(ResultCode::GetAddressFailed, lastError);
-        return;
+        return false;
     }
     auto ipVersion = info_.ipVersion;
     if (ipVersion == IPVersion::Auto) {
@@ -86,7 +138,9 @@ void Request::sendRequest() noexcept {
 #if ENABLE_HTTPS
         socketPtr = new TSLSocket(ipVersion);
 #else
+        freeaddrinfo(addressInfo);
         errorHandler(ResultCode::SchemeNotSupported, 0);
+        return false;
 #endif
     } else {
         socketPtr = new PlainSocket(ipVersion);
@@ -101,28 +155,20 @@ void Request::sendRequest() noexcept {
     auto timeout = getRemainTime();
     if (timeout <= 0) {
         errorHandler(ResultCode::Timeout, GetLastError());
-        return;
+        return false;
     }
     auto result = socket_->connect(addressInfoPtr, timeout);
     if (!result.isSuccess()) {
         LogE("connect {} failed, error code: {}, result code: {}",
              url_->url(), result.errorCode, static_cast<int>(result.resultCode));
         errorHandler(result.resultCode, GetLastError());
-        return;
-    } else {
-        LogI("connect {} success", url_->url());
-        if (isValid_ && handler_.onConnected) {
-            handler_.onConnected(info_);
-        }
-    }
-    if (!send()) {
-        return;
+        return false;
     }
-    if (timerId_.isValid()) {
-        TimerManager::shareInstance().cancel(timerId_);
-        timerId_ = TimerId::kInvalidTimerId;
+    LogI("connect {} success", url_->url());
+    if (isValid_ && handler_.onConnected) {
+        handler_.onConnected(info_);
     }
-    receive();
+    return true;
 }
 
 void Request::redirect(const std::string& url) noexcept {
@@ -172,7 +218,6 @@ bool Request::send() noexcept {
         onError(canSend.resultCode, canSend.errorCode);
         return false;
     }
-    std::this_thread::sleep_for(1ms);
     auto sendData = Util::htmlEncode(info_, *url_);
     auto dataView = std::string_view(sendData);
     do {
@@ -189,63 +234,79 @@ bool Request::send() noexcept {
     return true;
 }
 
-bool Request::isReceivable() noexcept {
-    while (true) {
-        if (!isValid_) {
-            onCompleted();
-            return false;
-        }
-        auto canReceive = socket_->canReceive(100);//wait 1000ms
-        if (canReceive.isSuccess()) {
+void Request::startReceive() noexcept {
+    parser_ = std::unique_ptr<ResponseParser, decltype(&freeResponseParser)>(new ResponseParser(
+        [this](ResponseHeader& header) {
+            if (header.isNeedRedirect() && info_.isAllowRedirect) {
+                return false;
+            }
+            onResponseHeader(std::move(header));
             return true;
-        }
-        if (canReceive.resultCode == ResultCode::Retry) {
-            continue;
-        }
-        if (canReceive.resultCode == ResultCode::Timeout) {
-            std::this_thread::sleep_for(10ms);
-            continue;
-        }
-        onError(canReceive.resultCode, canReceive.errorCode);
-        return false;//disconnect
-    }
-}
-
-bool Request::parseChunk(DataPtr& data, int64_t& chunkSize, bool& isCompleted) noexcept {
-    return Util::parseChunkHandler(data, chunkSize, isCompleted,
-        [this](ResultCode resultCode, int32_t errorCode){
-            onError(resultCode, errorCode);
         },
         [this](DataPtr data) {
             onResponseData(std::move(data));
-        });
+        }), freeResponseParser);
+    auto socket = socket_->fd();
+    receivingSocket_ = socket;
+    isReceiving_ = true;
+    if (!IOLoop::shareInstance().add(socket, [this]{ onReadable(); })) {
+        isReceiving_ = false;
+        onError(ResultCode::Failed, GetLastError());
+    }
 }
 
-void Request::receive() noexcept {
-    ResponseHeader response;
-    auto recvDataPtr = std::make_unique<Data>();
-    bool parseHeaderSuccess = false;
-    int64_t contentLength = INT64_MAX;
-    int64_t recvLength = 0;
-    std::string transferCoding;
-    int64_t chunkSize = kInvalid;
-    while (true) {
-        if (!isReceivable()) {
-            return;
-        }
-        std::this_thread::sleep_for(1ms);
+void Request::stopReceive() noexcept {
+    if (isReceiving_.exchange(false)) {
+        IOLoop::shareInstance().remove(receivingSocket_);
+    }
+}
+
+void Request::runOnWorker(std::function<void()> func) noexcept {
+    std::lock_guard<std::mutex> lock(workerMutex_);
+    if (!isValid_) {
+        return;
+    }
+    //the previous task has handed the socket to the io loop, it is about to return
+    if (worker_.valid()) {
+        worker_.wait();
+    }
+    auto res = requestWorkers().submit(std::move(func));
+    if (!res) {
+        LogE("submit request task failed");
+        return;
+    }
+    worker_ = std::move(res.value());
+}
+
+void Request::onReadable() noexcept {
+    //a fast peer must not keep the loop from the other sockets, what is left is read on the next call
+    for (int32_t i = 0; i < kMaxReadCountPerEvent; i++) {
         if (!isValid_) {
             onCompleted();
             return;
         }
         auto [recvResult, dataPtr] = socket_->receive();
-        bool isCompleted = (recvResult.resultCode == ResultCode::Completed ||
-                            recvResult.resultCode == ResultCode::Disconnected);
         if (!recvResult.isSuccess()) {
             if (recvResult.resultCode == ResultCode::Retry) {
-                continue;
+                return;
             }
-            if (isCompleted) {
+            if (isReusedSocket_ && parser_->parsedSize() == 0) {
+                //the server closed the pooled connection before answering, send again on a new one
+                LogI("pooled connection is closed, reconnect {}", url_->url());
+                stopReceive();
+                runOnWorker([this] {
+                    isReusedSocket_ = false;
+                    socket_.reset();
+                    if (connect() && send()) {
+                        startReceive();
+                    }
+                });
+                return;
+            }
+            if (recvResult.resultCode == ResultCode::Completed ||
+                recvResult.resultCode == ResultCode::Disconnected) {
+                //ends a body without length, a cut short one is delivered as it is
+                parser_->finish();
                 isCompleted_ = true;
                 onCompleted();
             } else {
@@ -254,38 +315,19 @@ void Request::receive() noexcept {
             return;
         }
 
-        if (!parseHeaderSuccess) {
-            recvDataPtr->append(std::move(dataPtr));
-            auto [isSuccess, headerSize] = Util::parseResponseHeader(recvDataPtr->view(), response);
-            parseHeaderSuccess = isSuccess;
-            if (!isSuccess) {
-                continue;
-            }
-            if (response.isNeedRedirect() && info_.isAllowRedirect) {
-                redirect(response.headers["Location"]);
-                return;
-            }
-            Util::parseFieldValue(response.headers, "Content-Length", contentLength);
-            Util::parseFieldValue(response.headers, "Transfer-Encoding", transferCoding);
-            onResponseHeader(std::move(response));
-            dataPtr = recvDataPtr->copy(static_cast<uint64_t>(headerSize));
-            recvDataPtr->reset();
-        }
-
-        recvLength += static_cast<int64_t>(dataPtr->length);
-        if (transferCoding == "chunked") {
-            recvDataPtr->append(std::move(dataPtr));
-            if (!parseChunk(recvDataPtr, chunkSize, isCompleted)) {
-                return; //disconnect
-            }
-        } else {
-            isCompleted = isCompleted || recvLength >= contentLength;
-            if (parseHeaderSuccess && !dataPtr->empty()){
-                onResponseData(std::move(dataPtr));
+        if (!parser_->parse(std::move(dataPtr))) {
+            if (parser_->isStopped()) {
+                stopReceive();
+                runOnWorker([this, location = parser_->header().headers["Location"]] {
+                    redirect(location);
+                });
+            } else {
+                this->onError(parser_->errorCode(), 0);
             }
+            return;
         }
-
-        if (isCompleted) {
+        if (parser_->isCompleted()) {
+            isReusable_ = parser_->isKeepAlive();
             isCompleted_ = true;
             onCompleted();
             return; //disconnect
@@ -322,6 +364,8 @@ void Request::onResponseData(DataPtr dataPtr) noexcept {
 }
 
 void Request::onCompleted() noexcept {
+    //the socket is closed or pooled below, the loop must not watch it any longer
+    stopReceive();
     if (timerId_.isValid()) {
         TimerManager::shareInstance().cancel(timerId_);
         timerId_ = TimerId::kInvalidTimerId;
@@ -332,6 +376,10 @@ void Request::onCompleted() noexcept {
         }
     }
     isValid_ = false;
+    if (isReusable_ && socket_ && url_) {
+        ConnectionPool::shareInstance().release(*url_, std::move(socket_));
+    }
+    isReusable_ = false;
     socket_.reset(); //release resource
 }
 
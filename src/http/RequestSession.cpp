@@ -16,6 +16,8 @@
 #include "include/public/Type.h"
 #include "include/PlainSocket.h"
 #include "include/Url.h"
+#include "include/ConnectionPool.h"
+#include "include/ResponseParser.h"
 
 #define MakeUrlPtr(url) std::unique_ptr<Url, decltype(&freeUrl)>(new Url(url), freeUrl)
 
@@ -37,6 +39,7 @@ RequestSession::~RequestSession() {
         worker_->join();
     }
     worker_.reset();
+    releaseSocket();
 }
 
 void RequestSession::clear() noexcept {
@@ -106,6 +109,14 @@ void RequestSession::setupSocket() noexcept {
     }
 }
 
+void RequestSession::releaseSocket() noexcept {
+    if (socket_ && host_ && isSocketReusable_) {
+        ConnectionPool::shareInstance().release(*host_, std::move(socket_));
+    }
+    isSocketReusable_ = false;
+    socket_.reset();
+}
+
 void RequestSession::process() noexcept {
     while (true) {
         std::string host;
@@ -132,12 +143,20 @@ void RequestSession::process() noexcept {
         LogI("current task url:{}", currentTask_->requestInfo->url);
         if (!host_ || (host_ && host_->host != currentTask_->host->host) ) {
             LogI("host change");
+            releaseSocket();
             host_ = std::move(currentTask_->host);
+        }
+        if (socket_ && (!isSocketReusable_ || !socket_->isLive())) {
+            //the rest of an unfinished response would be read as the answer of this request
             socket_.reset();
         }
-        if (socket_ == nullptr || !socket_->isLive()) {
+        if (socket_ == nullptr) {
+            socket_ = ConnectionPool::shareInstance().acquire(*host_);
+        }
+        if (socket_ == nullptr) {
             setupSocket();
         }
+        isSocketReusable_ = false;
         if (!socket_ || !socket_->isLive()) {
             LogE("socket is not valid");
             onError(ResultCode::ConnectAddressError, 0);
@@ -151,13 +170,11 @@ void RequestSession::process() noexcept {
 }
 
 bool RequestSession::send() noexcept {
-    using namespace std::chrono_literals;
     auto canSend = socket_->canSend(getRemainTime());
     if (!currentTask_ || !canSend.isSuccess()) {
         onError(canSend.resultCode, canSend.errorCode);
         return false;
     }
-    std::this_thread::sleep_for(1ms);
     currentTask_->requestInfo->headers["Connection"] = "keep-alive";
     if (!currentTask_->host) {
         currentTask_->host = std::unique_ptr<Url, decltype(&freeUrl)>(new Url(currentTask_->requestInfo->url), freeUrl);
@@ -228,16 +245,6 @@ bool RequestSession::isReceivable() noexcept {
     }
 }
 
-bool RequestSession::parseChunk(DataPtr& data, int64_t& chunkSize, bool& isCompleted) noexcept {
-    return Util::parseChunkHandler(data, chunkSize, isCompleted,
-     [this](ResultCode resultCode, int32_t errorCode){
-         onError(resultCode, errorCode);
-     },
-     [this](DataPtr data) {
-         onResponseData(std::move(data));
-     });
-}
-
 void RequestSession::redirect(const std::string& host) noexcept {
     LogI("redirect:{}", host);
     bool isSuccess = false;
@@ -256,20 +263,26 @@ void RequestSession::redirect(const std::string& host) noexcept {
 }
 
 void RequestSession::receive() noexcept {
-    using namespace std::chrono_literals;
-    ResponseHeader response;
-    auto recvDataPtr = std::make_unique<Data>();
-    bool parseHeaderSuccess = false;
-    int64_t contentLength = INT64_MAX;
-    int64_t recvLength = 0;
-    std::string transferCoding;
-    int64_t chunkSize = kInvalid;
+    std::string location;
+    ResponseParser parser(
+        [this, &location](ResponseHeader& header) {
+            if (header.isNeedRedirect() && currentTask_->requestInfo->isAllowRedirect) {
+                location = header.headers["Location"];
+                return false;
+            }
+            onResponseHeader(std::move(header));
+            return true;
+        },
+        [this](DataPtr data) {
+            onResponseData(std::move(data));
+        });
+    //read until the socket runs dry, only then wait for it
+    bool isNeedWait = true;
     while (true) {
-        if (!isReceivable()) {
+        if (isNeedWait && !isReceivable()) {
             isBusy_ = false;
             return;
         }
-        std::this_thread::sleep_for(1ms);
         if (!currentTask_->isValid_ || isExited_) {
             LogI("session close");
             isBusy_ = false;
@@ -277,13 +290,14 @@ void RequestSession::receive() noexcept {
         }
 
         auto [recvResult, dataPtr] = socket_->receive();
-        bool isCompleted = (recvResult.resultCode == ResultCode::Completed ||
-                            recvResult.resultCode == ResultCode::Disconnected);
+        isNeedWait = recvResult.resultCode == ResultCode::Retry;
         if (!recvResult.isSuccess()) {
             if (recvResult.resultCode == ResultCode::Retry) {
                 continue;
             }
-            if (isCompleted) {
+            if (recvResult.resultCode == ResultCode::Completed ||
+                recvResult.resultCode == ResultCode::Disconnected) {
+                parser.finish();
                 currentTask_->isCompleted_ = true;
                 onCompleted();
             } else {
@@ -292,38 +306,16 @@ void RequestSession::receive() noexcept {
             return;
         }
 
-        if (!parseHeaderSuccess) {
-            recvDataPtr->append(std::move(dataPtr));
-            auto [isSuccess, headerSize] = Util::parseResponseHeader(recvDataPtr->view(), response);
-            parseHeaderSuccess = isSuccess;
-            if (!isSuccess) {
-                continue;
-            }
-            if (response.isNeedRedirect() && currentTask_->requestInfo->isAllowRedirect) {
-                redirect(response.headers["Location"]);
-                return;
-            }
-            Util::parseFieldValue(response.headers, "Content-Length", contentLength);
-            Util::parseFieldValue(response.headers, "Transfer-Encoding", transferCoding);
-            onResponseHeader(std::move(response));
-            dataPtr = recvDataPtr->copy(static_cast<uint64_t>(headerSize));
-            recvDataPtr->reset();
-        }
-
-        recvLength += static_cast<int64_t>(dataPtr->length);
-        if (transferCoding == "chunked") {
-            recvDataPtr->append(std::move(dataPtr));
-            if (!parseChunk(recvDataPtr, chunkSize, isCompleted)) {
-                return; //disconnect
-            }
-        } else {
-            isCompleted = isCompleted || recvLength >= contentLength;
-            if (parseHeaderSuccess && !dataPtr->empty()){
-                onResponseData(std::move(dataPtr));
+        if (!parser.parse(std::move(dataPtr))) {
+            if (parser.isStopped()) {
+                redirect(location);
+            } else {
+                onError(parser.errorCode(), 0);
             }
+            return;
         }
-
-        if (isCompleted) {
+        if (parser.isCompleted()) {
+            isSocketReusable_ = parser.isKeepAlive();
             currentTask_->isCompleted_ = true;
             onCompleted();
             return;
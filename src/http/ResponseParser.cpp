@@ -0,0 +1,279 @@
+//
+// Created by Nevermore on 2025/7/20.
+// slark ResponseParser
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include "include/ResponseParser.h"
+
+namespace slark::http {
+
+namespace {
+
+bool isEqualIgnoreCase(std::string_view lhs, std::string_view rhs) noexcept {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+bool containsIgnoreCase(std::string_view str, std::string_view token) noexcept {
+    if (token.size() > str.size()) {
+        return false;
+    }
+    for (size_t i = 0; i + token.size() <= str.size(); i++) {
+        if (isEqualIgnoreCase(str.substr(i, token.size()), token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view trim(std::string_view str) noexcept {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+} //end of namespace
+
+ResponseParser::ResponseParser(HeaderFunc onHeader, BodyFunc onBody) noexcept
+    : onHeader_(std::move(onHeader))
+    , onBody_(std::move(onBody)) {
+
+}
+
+bool ResponseParser::readLine(const Data& data, uint64_t& pos) noexcept {
+    auto begin = reinterpret_cast<const char*>(data.rawData) + pos;
+    auto size = data.length - pos;
+    auto end = static_cast<const char*>(std::memchr(begin, '\n', size));
+    if (end == nullptr) {
+        line_.append(begin, size);
+        pos = data.length;
+        if (line_.size() > kMaxLineSize) {
+            onError(ResultCode::ResponseInvalid);
+        }
+        return false;
+    }
+    line_.append(begin, static_cast<size_t>(end - begin));
+    pos += static_cast<uint64_t>(end - begin) + 1;
+    if (!line_.empty() && line_.back() == '\r') {
+        line_.pop_back();
+    }
+    return true;
+}
+
+bool ResponseParser::parseStatusLine() noexcept {
+    ///HTTP-version SP status-code SP reason-phrase
+    constexpr std::string_view kHTTPFlag = "HTTP/";
+    constexpr size_t kVersionSize = kHTTPFlag.size() + 3;
+    std::string_view line = line_;
+    if (!line.starts_with(kHTTPFlag) || line.size() < kVersionSize + 4 || line[kVersionSize] != ' ') {
+        onError(ResultCode::ResponseInvalid);
+        return false;
+    }
+    auto version = line.substr(0, kVersionSize);
+    uint16_t code = 0;
+    auto codeView = line.substr(kVersionSize + 1, 3);
+    auto [ptr, ec] = std::from_chars(codeView.data(), codeView.data() + codeView.size(), code);
+    if (ec != std::errc() || ptr != codeView.data() + codeView.size()) {
+        onError(ResultCode::ResponseInvalid);
+        return false;
+    }
+    header_.headers["Version"] = version;
+    header_.httpStatusCode = static_cast<HttpStatusCode>(code);
+    header_.reasonPhrase = trim(line.substr(kVersionSize + 4));
+    isHttp10_ = version == "HTTP/1.0";
+    return true;
+}
+
+void ResponseParser::parseHeaderLine() noexcept {
+    std::string_view line = line_;
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        return;
+    }
+    auto name = trim(line.substr(0, colon));
+    auto value = trim(line.substr(colon + 1));
+    if (isEqualIgnoreCase(name, "Content-Length")) {
+        uint64_t size = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), size);
+        if (ec != std::errc() || ptr != value.data() + value.size()) {
+            onError(ResultCode::ResponseInvalid);
+            return;
+        }
+        hasContentLength_ = true;
+        remainSize_ = size;
+    } else if (isEqualIgnoreCase(name, "Transfer-Encoding")) {
+        isChunked_ = containsIgnoreCase(value, "chunked");
+    } else if (isEqualIgnoreCase(name, "Connection")) {
+        isConnectionClose_ = containsIgnoreCase(value, "close");
+        isConnectionKeepAlive_ = containsIgnoreCase(value, "keep-alive");
+    }
+    header_.headers[std::string(name)] = value;
+}
+
+bool ResponseParser::onHeaderEnd() noexcept {
+    auto code = static_cast<uint16_t>(header_.httpStatusCode);
+    if (code >= 100 && code < 200) {
+        //an interim response, the final one follows on the same connection
+        header_ = ResponseHeader();
+        hasContentLength_ = false;
+        isChunked_ = false;
+        isConnectionClose_ = false;
+        isConnectionKeepAlive_ = false;
+        remainSize_ = 0;
+        state_ = State::StatusLine;
+        return true;
+    }
+    if (onHeader_ && !onHeader_(header_)) {
+        state_ = State::Stopped;
+        return false;
+    }
+    if (header_.httpStatusCode == HttpStatusCode::NoContent ||
+        header_.httpStatusCode == HttpStatusCode::NotModified) {
+        state_ = State::Completed;
+    } else if (isChunked_) {
+        //chunked wins over a length, rfc7230 3.3.3
+        state_ = State::ChunkSize;
+    } else if (hasContentLength_) {
+        state_ = remainSize_ == 0 ? State::Completed : State::Body;
+    } else {
+        isCloseDelimited_ = true;
+        state_ = State::Body;
+    }
+    return true;
+}
+
+bool ResponseParser::parseChunkSize() noexcept {
+    ///chunk-size [ chunk-ext ] CRLF
+    std::string_view line = line_;
+    line = trim(line.substr(0, line.find(';')));
+    uint64_t size = 0;
+    auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+    if (line.empty() || ec != std::errc() || ptr != line.data() + line.size()) {
+        onError(ResultCode::ChunkSizeError);
+        return false;
+    }
+    remainSize_ = size;
+    state_ = size == 0 ? State::Trailer : State::ChunkData;
+    return true;
+}
+
+void ResponseParser::onError(ResultCode code) noexcept {
+    state_ = State::Error;
+    errorCode_ = code;
+}
+
+bool ResponseParser::parse(DataPtr data) noexcept {
+    if (state_ == State::Error || state_ == State::Stopped) {
+        return false;
+    }
+    if (!data || data->empty() || state_ == State::Completed) {
+        return true;
+    }
+    parsedSize_ += data->length;
+    DataRefPtr block = std::move(data);
+    const auto length = block->length;
+    uint64_t pos = 0;
+    auto emitBody = [&](uint64_t size) {
+        if (onBody_ && size > 0) {
+            onBody_(Data::makeSlice(block, pos, size));
+        }
+        pos += size;
+    };
+    while (pos < length && state_ < State::Completed) {
+        switch (state_) {
+            case State::StatusLine:
+                if (readLine(*block, pos)) {
+                    if (!line_.empty() && parseStatusLine()) {
+                        state_ = State::HeaderLine;
+                    }
+                    line_.clear();
+                }
+                break;
+            case State::HeaderLine:
+                if (readLine(*block, pos)) {
+                    if (line_.empty()) {
+                        onHeaderEnd();
+                    } else {
+                        parseHeaderLine();
+                    }
+                    line_.clear();
+                }
+                break;
+            case State::Body:
+                if (isCloseDelimited_) {
+                    emitBody(length - pos);
+                } else {
+                    auto size = std::min(remainSize_, length - pos);
+                    emitBody(size);
+                    remainSize_ -= size;
+                    if (remainSize_ == 0) {
+                        state_ = State::Completed;
+                    }
+                }
+                break;
+            case State::ChunkSize:
+                if (readLine(*block, pos)) {
+                    parseChunkSize();
+                    line_.clear();
+                }
+                break;
+            case State::ChunkData: {
+                auto size = std::min(remainSize_, length - pos);
+                emitBody(size);
+                remainSize_ -= size;
+                if (remainSize_ == 0) {
+                    state_ = State::ChunkDataEnd;
+                }
+                break;
+            }
+            case State::ChunkDataEnd:
+                if (readLine(*block, pos)) {
+                    if (line_.empty()) {
+                        state_ = State::ChunkSize;
+                    } else {
+                        onError(ResultCode::ChunkSizeError);
+                    }
+                    line_.clear();
+                }
+                break;
+            case State::Trailer:
+                //trailer fields are not used, an empty line ends the message
+                if (readLine(*block, pos)) {
+                    if (line_.empty()) {
+                        state_ = State::Completed;
+                    }
+                    line_.clear();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return state_ != State::Error && state_ != State::Stopped;
+}
+
+bool ResponseParser::finish() noexcept {
+    if (state_ == State::Body && isCloseDelimited_) {
+        state_ = State::Completed;
+    }
+    return isCompleted();
+}
+
+bool ResponseParser::isKeepAlive() const noexcept {
+    if (!isCompleted() || isCloseDelimited_ || isConnectionClose_) {
+        return false;
+    }
+    //http/1.0 closes unless asked otherwise
+    return !isHttp10_ || isConnectionKeepAlive_;
+}
+
+} //end of namespace slark::http
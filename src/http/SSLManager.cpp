@@ -167,43 +167,28 @@ std::tuple<SocketResult, int64_t> SSLManager::write(const SSLPtr& sslPtr, const
 }
 
 std::tuple<SocketResult, DataPtr> SSLManager::read(const SSLPtr& sslPtr) noexcept {
-    using namespace std::chrono_literals;
     SocketResult res;
     if (sslPtr == nullptr) {
         res.resultCode = ResultCode::Failed;
         return {res, nullptr};
     }
-    bool isNeedRetry = false;
-    auto data = std::make_unique<Data>(kDefaultReadSize);
-    int32_t retryCount = 0;
-    do {
-        retryCount++;
-        auto recvLength = static_cast<int64_t>(SSL_read(sslPtr.get(), data->rawData, kDefaultReadSize));
-        if (recvLength == 0) {
-            res.resultCode = ResultCode::Disconnected;
-            break;
-        } else if (recvLength < 0) {
-            res.resultCode = ResultCode::Failed;
-            res.errorCode = SSL_get_error(sslPtr.get(), 0);
-            if (res.errorCode == SSL_ERROR_SYSCALL) {
-                res.errorCode = errno; //System call error
-                LogE("SSL read error: {}, {}", res.errorCode, getOpenSSLErrorMessage());
-                break;
-            }
-            if (retryCount >= kMaxRetryCount) {
-                res.resultCode = ResultCode::RetryReachMaxCount;
-                break;
-            }
-            if ((SSL_ERROR_WANT_WRITE == res.errorCode || SSL_ERROR_WANT_READ == res.errorCode)) {
-                isNeedRetry = true;
-            }
-            std::this_thread::sleep_for(1ms);
-        } else {
-            res.reset();
-            data->length = static_cast<uint64_t>(recvLength);
-            break;
+    auto data = Data::obtain(kDefaultReadSize);
+    auto recvLength = static_cast<int64_t>(SSL_read(sslPtr.get(), data->rawData, kDefaultReadSize));
+    if (recvLength == 0) {
+        res.resultCode = ResultCode::Disconnected;
+    } else if (recvLength < 0) {
+        res.resultCode = ResultCode::Failed;
+        res.errorCode = SSL_get_error(sslPtr.get(), 0);
+        if (res.errorCode == SSL_ERROR_SYSCALL) {
+            res.errorCode = errno; //System call error
+            LogE("SSL read error: {}, {}", res.errorCode, getOpenSSLErrorMessage());
+        } else if (SSL_ERROR_WANT_WRITE == res.errorCode || SSL_ERROR_WANT_READ == res.errorCode) {
+            //the record is incomplete, the caller waits until the socket is readable again
+            res.resultCode = ResultCode::Retry;
         }
-    } while (isNeedRetry);
+    } else {
+        data->length = static_cast<uint64_t>(recvLength);
+    }
     return {res, std::move(data)};
 }
 
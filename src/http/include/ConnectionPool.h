@@ -0,0 +1,55 @@
+//
+// Created by Nevermore on 2025/7/16.
+// slark ConnectionPool
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Socket.h"
+#include "Time.hpp"
+#include "Url.h"
+
+namespace slark::http {
+
+using SocketPtr = std::unique_ptr<ISocket, decltype(&freeSocket)>;
+
+///Idle keep-alive connections, plain and TLS, keyed by scheme, host and port.
+///A connection is only given back after its last response was read completely.
+class ConnectionPool {
+public:
+    static constexpr uint32_t kMaxIdleCountPerHost = 4;
+    static constexpr uint32_t kMaxIdleCount = 16;
+    static constexpr std::chrono::milliseconds kMaxIdleTime{30000}; //30s
+
+    static ConnectionPool& shareInstance();
+
+    ///the most recently used live connection to the host of url, nullptr if none
+    SocketPtr acquire(const Url& url) noexcept;
+
+    void release(const Url& url, SocketPtr socket) noexcept;
+
+    void clear() noexcept;
+
+    [[nodiscard]] uint32_t idleCount() noexcept;
+private:
+    struct IdleConnection {
+        SocketPtr socket;
+        Time::TimePoint idleTime;
+    };
+
+    static std::string key(const Url& url) noexcept;
+
+    ///move expired connections to evicted, the caller holds mutex_ and closes them after unlocking
+    void evictExpired(std::vector<SocketPtr>& evicted) noexcept;
+private:
+    std::mutex mutex_;
+    uint32_t idleCount_ = 0;
+    std::unordered_map<std::string, std::deque<IdleConnection>> connections_;
+};
+
+} //end of namespace slark::http
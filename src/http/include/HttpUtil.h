@@ -56,18 +56,5 @@ std::string htmlEncode(
     const Url& url
 ) noexcept;
 
-bool parseChunkHandler(
-    DataPtr& data,
-    int64_t& chunkSize,
-    bool& isCompleted,
-    const std::function<void(ResultCode, int32_t)>& errorHandler,
-    const std::function<void(DataPtr)>& dataHandler
-) noexcept;
-
-std::tuple<bool, int64_t> parseResponseHeader(
-    DataView data,
-    ResponseHeader& response
-) noexcept;
-
 } // slark
 
@@ -0,0 +1,79 @@
+//
+// Created by Nevermore on 2025/7/18.
+// slark IOLoop
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "Socket.h"
+
+namespace slark::http {
+
+///One thread waiting on the readiness of every watched socket, epoll on linux and poll elsewhere.
+///Readiness is level triggered, a handler that leaves data unread is called again.
+class IOLoop {
+public:
+    using ReadableFunc = std::function<void()>;
+
+    static IOLoop& shareInstance();
+
+    IOLoop();
+
+    ~IOLoop();
+
+    IOLoop(const IOLoop&) = delete;
+    IOLoop& operator=(const IOLoop&) = delete;
+
+    ///func is called on the loop thread whenever the socket is readable or closed by the peer
+    bool add(Socket socket, ReadableFunc func) noexcept;
+
+    ///once it returns func is neither running nor called again,
+    ///called from func itself it only stops the following calls
+    void remove(Socket socket) noexcept;
+
+    ///wait until func of the socket is not running, returns at once on the loop thread
+    void waitCall(Socket socket) noexcept;
+
+    [[nodiscard]] bool isInLoopThread() const noexcept;
+private:
+    void process() noexcept;
+
+    void wakeUp() noexcept;
+
+    ///sleep after a failed wait, the delay doubles with every failure in a row
+    void backOff(std::chrono::milliseconds& delay) noexcept;
+
+#if defined(__linux__)
+    ///a new epoll instance watching the wake fd and every socket again, used once the old one fails
+    void rebuildPollSet() noexcept;
+#endif
+
+    ///the socket the loop is about to call, nullptr if it is no longer watched
+    std::shared_ptr<ReadableFunc> prepareCall(Socket socket) noexcept;
+
+    void finishCall() noexcept;
+private:
+    std::atomic_bool isExited_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::unordered_map<Socket, std::shared_ptr<ReadableFunc>> watchers_;
+    ///the socket whose func is running on the loop thread
+    Socket callingSocket_ = kInvalidSocket;
+#if defined(__linux__)
+    int epollFd_ = kInvalid;
+    int wakeFd_ = kInvalid;
+#else
+    int wakePipe_[2] = {kInvalid, kInvalid};
+#endif
+    std::thread worker_;
+};
+
+}//end of namespace slark::http
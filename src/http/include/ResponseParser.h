@@ -0,0 +1,114 @@
+//
+// Created by Nevermore on 2025/7/20.
+// slark ResponseParser
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <functional>
+#include <string>
+#include "public/Type.h"
+
+namespace slark::http {
+
+///Resumable HTTP/1.1 response parser, fed with the data as it arrives.
+///Every byte is looked at once, body bytes are handed out as slices of the received data.
+class ResponseParser {
+public:
+    ///called once the header is complete, return false to stop before the body
+    using HeaderFunc = std::function<bool(ResponseHeader&)>;
+    using BodyFunc = std::function<void(DataPtr)>;
+
+    enum class State : uint8_t {
+        StatusLine,
+        HeaderLine,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailer,
+        Completed,
+        Stopped,
+        Error,
+    };
+
+    ///a header or chunk size line longer than this is malformed
+    static constexpr uint64_t kMaxLineSize = 64 * 1024;
+
+    ResponseParser(HeaderFunc onHeader, BodyFunc onBody) noexcept;
+
+    ///false if the data is malformed or the header func stopped parsing
+    bool parse(DataPtr data) noexcept;
+
+    ///the peer closed the connection, true if that ends the response
+    bool finish() noexcept;
+
+    [[nodiscard]] State state() const noexcept {
+        return state_;
+    }
+
+    [[nodiscard]] bool isCompleted() const noexcept {
+        return state_ == State::Completed;
+    }
+
+    [[nodiscard]] bool isStopped() const noexcept {
+        return state_ == State::Stopped;
+    }
+
+    [[nodiscard]] bool isHeaderCompleted() const noexcept {
+        return state_ > State::HeaderLine && state_ != State::Error;
+    }
+
+    ///the response ended by its length or last chunk and the server keeps the connection
+    [[nodiscard]] bool isKeepAlive() const noexcept;
+
+    [[nodiscard]] ResultCode errorCode() const noexcept {
+        return errorCode_;
+    }
+
+    ///the header, valid until it is moved out by the header func
+    [[nodiscard]] ResponseHeader& header() noexcept {
+        return header_;
+    }
+
+    [[nodiscard]] uint64_t parsedSize() const noexcept {
+        return parsedSize_;
+    }
+private:
+    ///collect a line up to LF from pos, true once it is complete
+    bool readLine(const Data& data, uint64_t& pos) noexcept;
+
+    bool parseStatusLine() noexcept;
+
+    void parseHeaderLine() noexcept;
+
+    ///decide how the body is delimited, false if the header func stopped parsing
+    bool onHeaderEnd() noexcept;
+
+    bool parseChunkSize() noexcept;
+
+    void onError(ResultCode code) noexcept;
+private:
+    State state_ = State::StatusLine;
+    ResultCode errorCode_ = ResultCode::Success;
+    bool hasContentLength_ = false;
+    bool isChunked_ = false;
+    ///no length and not chunked, the body ends when the peer closes
+    bool isCloseDelimited_ = false;
+    bool isConnectionClose_ = false;
+    bool isConnectionKeepAlive_ = false;
+    bool isHttp10_ = false;
+    ///bytes left of the body or of the current chunk
+    uint64_t remainSize_ = 0;
+    uint64_t parsedSize_ = 0;
+    std::string line_;
+    ResponseHeader header_;
+    HeaderFunc onHeader_;
+    BodyFunc onBody_;
+};
+
+inline void freeResponseParser(ResponseParser* parser) noexcept {
+    delete parser;
+}
+
+} //end of namespace slark::http
@@ -93,6 +93,10 @@ public:
     [[nodiscard]] bool setKeepLive() const noexcept;
 
     [[nodiscard]] bool isLive() const noexcept;
+
+    [[nodiscard]] Socket fd() const noexcept {
+        return socket_;
+    }
 protected:
     ResultCode config() noexcept;
 private:
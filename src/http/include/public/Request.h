@@ -4,6 +4,7 @@
 // Copyright (c) 2024 Nevermore All rights reserved.
 #pragma once
 
+#include <future>
 #include "Type.h"
 #include "TimerManager.h"
 
@@ -22,6 +23,10 @@ extern void freeSocket(ISocket*) noexcept;
 
 extern void freeUrl(Url*) noexcept;
 
+class ResponseParser;
+
+extern void freeResponseParser(ResponseParser*) noexcept;
+
 class Request {
 public:
     ///Data copying may result in some performance degradation
@@ -56,6 +61,9 @@ private:
 
     void sendRequest() noexcept;
 
+    ///resolve and connect a new socket, errors are reported
+    bool connect() noexcept;
+
     void redirect(const std::string&) noexcept;
 
     void process() noexcept;
@@ -64,11 +72,16 @@ private:
 
     bool send() noexcept;
 
-    bool isReceivable() noexcept;
+    ///hand the socket to the io loop, the response is read on its thread
+    void startReceive() noexcept;
+
+    ///read everything the socket holds, called by the io loop
+    void onReadable() noexcept;
 
-    void receive() noexcept;
+    void stopReceive() noexcept;
 
-    bool parseChunk(DataPtr& data, int64_t& chunkSize, bool& isCompleted) noexcept;
+    ///connecting blocks, the first send, redirects and reconnects run on a pool shared by all requests
+    void runOnWorker(std::function<void()> func) noexcept;
 
     void onResponseHeader(ResponseHeader&&) noexcept;
 
@@ -79,14 +92,24 @@ private:
     void onCompleted() noexcept;
 private:
     std::atomic<bool> isCompleted_ = false;
+    std::atomic<bool> isReceiving_ = false;
+    ///the socket last handed to the io loop
+    std::atomic<int> receivingSocket_ = kInvalid;
     std::atomic<bool> isValid_ = true;
+    ///the socket came from the connection pool
+    bool isReusedSocket_ = false;
+    ///the response was read completely and the server keeps the connection
+    bool isReusable_ = false;
     uint8_t redirectCount_ = 0;
     uint64_t startStamp_ = 0;
     RequestInfo info_;
     ResponseHandler handler_;
     std::unique_ptr<ISocket, decltype(&freeSocket)> socket_;
     std::unique_ptr<Url, decltype(&freeUrl)> url_;
-    std::unique_ptr<std::thread> worker_ = nullptr;
+    std::unique_ptr<ResponseParser, decltype(&freeResponseParser)> parser_;
+    ///the io loop replaces the worker task while the request may be destroyed
+    std::mutex workerMutex_;
+    std::future<void> worker_;
     TimerId timerId_{};
 };
 
@@ -54,6 +54,9 @@ public:
 private:
     void setupSocket() noexcept;
 
+    ///keep the socket in the connection pool if its last response was read completely
+    void releaseSocket() noexcept;
+
     void redirect(const std::string&) noexcept;
 
     void process() noexcept;
@@ -66,8 +69,6 @@ private:
 
     void receive() noexcept;
 
-    bool parseChunk(DataPtr& data, int64_t& chunkSize, bool& isCompleted) noexcept;
-
     void onResponseHeader(ResponseHeader&&) noexcept;
 
     void onResponseData(DataPtr data) noexcept;
@@ -80,6 +81,7 @@ private:
     std::mutex taskMutex_;
     std::atomic<bool> isExited_ = false;
     std::atomic<bool> isBusy_ = false;
+    bool isSocketReusable_ = false;
     std::condition_variable cond_;
     std::unique_ptr<ISocket, decltype(&freeSocket)> socket_;
     std::unique_ptr<Url, decltype(&freeUrl)> host_;
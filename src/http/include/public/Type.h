@@ -5,6 +5,7 @@
 //
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <functional>
@@ -152,6 +153,7 @@ enum class ResultCode {
     RedirectError,
     RedirectReachMaxCount,
     ChunkSizeError,
+    ResponseInvalid,
 };
 #ifdef __clang__
 #pragma clang diagnostic pop
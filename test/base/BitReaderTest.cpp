@@ -0,0 +1,126 @@
+//
+// Created by Nevermore on 2025/7/9.
+// slark BitReaderTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "BitReader.h"
+
+using namespace slark;
+
+namespace {
+
+///MSB first bit writer for building test streams
+class BitWriter {
+public:
+    void write(uint64_t value, uint32_t n) {
+        for (uint32_t i = n; i > 0; i--) {
+            if (bitCount_ % 8 == 0) {
+                bytes_.push_back('\0');
+            }
+            auto bit = (value >> (i - 1)) & 0x01;
+            bytes_.back() = static_cast<char>(static_cast<uint8_t>(bytes_.back()) | (bit << (7 - bitCount_ % 8)));
+            bitCount_++;
+        }
+    }
+
+    void writeUE(uint32_t value) {
+        auto code = static_cast<uint64_t>(value) + 1;
+        auto length = static_cast<uint32_t>(std::bit_width(code));
+        write(0, length - 1);
+        write(code, length);
+    }
+
+    void writeSE(int32_t value) {
+        writeUE(value > 0 ? static_cast<uint32_t>(2 * value - 1) : static_cast<uint32_t>(-2 * static_cast<int64_t>(value)));
+    }
+
+    const std::string& bytes() const {
+        return bytes_;
+    }
+private:
+    std::string bytes_;
+    uint64_t bitCount_ = 0;
+};
+
+} //end of namespace
+
+TEST(BitReader, readBits) {
+    std::string str("\xA5\xFF\x00\x12\x34\x56\x78\x9A\xBC\xDE\xF0", 11);
+    BitReader reader(DataView(str), false);
+    EXPECT_EQ(reader.readBits(1), 1);
+    EXPECT_EQ(reader.readBits(3), 2);
+    EXPECT_EQ(reader.readBits(4), 5);
+    EXPECT_EQ(reader.readBits(16), 0xFF00);
+    EXPECT_EQ(reader.readBits(32), 0x12345678);
+    EXPECT_EQ(reader.readBits(0), 0);
+    EXPECT_EQ(reader.readBits(24), 0x9ABCDE);
+    EXPECT_EQ(reader.bitPos(), 80);
+    EXPECT_FALSE(reader.isError());
+    EXPECT_EQ(reader.readBits(4), 0xF);
+    EXPECT_EQ(reader.readBits(8), 0);
+    EXPECT_TRUE(reader.isError());
+    EXPECT_EQ(reader.readBits(1), 0);
+}
+
+TEST(BitReader, expGolomb) {
+    BitWriter writer;
+    std::vector<uint32_t> values = {0, 1, 2, 3, 7, 255, 65535, 1u << 20, 0xFFFFFFFE};
+    for (auto value : values) {
+        writer.writeUE(value);
+        writer.writeSE(static_cast<int32_t>(value % 1000) - 500);
+    }
+    writer.write(1, 1);
+    BitReader reader(DataView(writer.bytes()), false);
+    for (auto value : values) {
+        EXPECT_EQ(reader.readUE(), value);
+        EXPECT_EQ(reader.readSE(), static_cast<int32_t>(value % 1000) - 500);
+    }
+    EXPECT_TRUE(reader.readBit());
+    EXPECT_FALSE(reader.isError());
+}
+
+TEST(BitReader, invalidExpGolomb) {
+    std::string zeros(8, '\0');
+    BitReader reader(DataView(zeros), false);
+    EXPECT_EQ(reader.readUE(), 0);
+    EXPECT_TRUE(reader.isError());
+}
+
+TEST(BitReader, emulationPrevention) {
+    std::string str("\x00\x00\x03\x01\x00\x00\x03\x00\x00\x00\x03\x03\xFF", 13);
+    BitReader reader{DataView(str)};
+    EXPECT_EQ(reader.readBits(24), 0x000001);
+    EXPECT_EQ(reader.readBits(24), 0x000000);
+    EXPECT_EQ(reader.readBits(8), 0x00);
+    EXPECT_EQ(reader.readBits(24), 0x0003FF);
+    EXPECT_FALSE(reader.isError());
+
+    BitReader raw(DataView(str), false);
+    EXPECT_EQ(raw.readBits(32), 0x00000301);
+}
+
+TEST(BitReader, matchBitByBit) {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint32_t> byteDis(0, 255);
+    std::uniform_int_distribution<uint32_t> bitsDis(0, 32);
+    std::string str(1024, '\0');
+    for (auto& c : str) {
+        c = static_cast<char>(byteDis(gen));
+    }
+    BitReader reader(DataView(str), false);
+    uint64_t pos = 0;
+    while (pos < str.size() * 8) {
+        auto n = std::min<uint64_t>(bitsDis(gen), str.size() * 8 - pos);
+        uint64_t expect = 0;
+        for (uint64_t i = 0; i < n; i++, pos++) {
+            auto bit = (static_cast<uint8_t>(str[pos / 8]) >> (7 - pos % 8)) & 0x01;
+            expect = (expect << 1) | bit;
+        }
+        ASSERT_EQ(reader.readBits(static_cast<uint32_t>(n)), expect);
+    }
+    EXPECT_FALSE(reader.isError());
+}
@@ -81,3 +81,74 @@ TEST(BufferTest, ReadData) {
     EXPECT_EQ(ptr->view().view(), std::string_view("hello world!"));
     EXPECT_EQ(buffer.pos(), 12 + 4);
 }
+
+TEST(BufferTest, CrossChunkRead) {
+    Buffer buffer;
+    buffer.append(0, std::make_unique<Data>("ab"));
+    buffer.append(0, std::make_unique<Data>("cd"));
+    buffer.append(0, std::make_unique<Data>("efgh\nij"));
+    uint32_t value = 0;
+    EXPECT_TRUE(buffer.read3ByteBE(value));
+    EXPECT_EQ(value, 0x616263);
+    EXPECT_EQ(buffer.shotView(4).view(), std::string_view("defg"));
+    auto ptr = buffer.readData(3);
+    EXPECT_EQ(ptr->view().view(), std::string_view("def"));
+    DataView line;
+    EXPECT_TRUE(buffer.readLine(line));
+    EXPECT_EQ(line.view(), std::string_view("gh"));
+    EXPECT_FALSE(buffer.readLine(line));
+    EXPECT_TRUE(buffer.skipTo(1));
+    uint8_t byte = 0;
+    EXPECT_TRUE(buffer.readByte(byte));
+    EXPECT_EQ(byte, 'b');
+    EXPECT_EQ(buffer.shotView().view(), std::string_view("cdefgh\nij"));
+    EXPECT_EQ(buffer.view().view(), std::string_view("abcdefgh\nij"));
+}
+
+TEST(BufferTest, CrossChunkLineOutlivesReads) {
+    Buffer buffer;
+    buffer.append(0, std::make_unique<Data>("#EXT"));
+    buffer.append(0, std::make_unique<Data>("M3U\nab"));
+    buffer.append(0, std::make_unique<Data>("cd\n"));
+    DataView line;
+    EXPECT_TRUE(buffer.readLine(line));
+    uint32_t value = 0;
+    EXPECT_TRUE(buffer.read4ByteBE(value));
+    EXPECT_EQ(buffer.shotView(1).view(), std::string_view("\n"));
+    EXPECT_EQ(line.view(), std::string_view("#EXTM3U"));
+}
+
+TEST(BufferTest, ShrinkChunks) {
+    Buffer buffer;
+    buffer.append(0, std::make_unique<Data>("abc"));
+    buffer.append(0, std::make_unique<Data>("defg"));
+    EXPECT_TRUE(buffer.skip(4));
+    buffer.shrink();
+    EXPECT_EQ(buffer.pos(), 4);
+    EXPECT_EQ(buffer.length(), 3);
+    buffer.append(7, std::make_unique<Data>("hi"));
+    std::string str;
+    EXPECT_TRUE(buffer.readString(5, str));
+    EXPECT_EQ(str, "efghi");
+    EXPECT_TRUE(buffer.empty());
+    buffer.shrink();
+    EXPECT_EQ(buffer.pos(), 9);
+    EXPECT_EQ(buffer.detachData(), nullptr);
+}
+
+TEST(BufferTest, ReadSlice) {
+    Buffer buffer;
+    buffer.append(0, std::make_unique<Data>("abcd"));
+    buffer.append(0, std::make_unique<Data>("efgh"));
+    auto slice = buffer.readSlice(3);
+    EXPECT_TRUE(slice->isSlice());
+    EXPECT_EQ(slice->view().view(), std::string_view("abc"));
+    auto crossData = buffer.readSlice(3);
+    EXPECT_FALSE(crossData->isSlice());
+    EXPECT_EQ(crossData->view().view(), std::string_view("def"));
+    EXPECT_EQ(buffer.view().view(), std::string_view("abcdefgh"));
+    EXPECT_EQ(slice->view().view(), std::string_view("abc"));
+    buffer.shrink();
+    buffer.reset();
+    EXPECT_EQ(slice->view().view(), std::string_view("abc"));
+}
@@ -0,0 +1,106 @@
+//
+// Created by Nevermore on 2025/7/8.
+// slark ByteScanTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include "ByteScan.h"
+
+using namespace slark;
+
+namespace {
+
+std::string randomBytes(uint64_t size, uint32_t seed, uint8_t maxValue) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<uint32_t> dis(0, maxValue);
+    std::string str(size, '\0');
+    for (auto& c : str) {
+        c = static_cast<char>(dis(gen));
+    }
+    return str;
+}
+
+uint64_t findAll(const std::string& str, ScanLevel level, int type) {
+    uint64_t sum = 0;
+    uint64_t count = 0;
+    for (uint64_t offset = 0; offset < str.size();) {
+        auto view = DataView(std::string_view(str).substr(offset));
+        uint64_t res = ByteScan::kNotFound;
+        if (type == 0) {
+            res = ByteScan::findStartCode(view, level);
+        } else if (type == 1) {
+            res = ByteScan::findSyncByte(view, 0x47, 188, level);
+        } else {
+            res = ByteScan::findSyncword(view, level);
+        }
+        if (res == ByteScan::kNotFound) {
+            break;
+        }
+        sum += offset + res;
+        count++;
+        offset += res + 1;
+    }
+    return sum * 31 + count;
+}
+
+} //end of namespace
+
+TEST(ByteScan, startCode) {
+    for (auto level : ByteScan::supportedLevels()) {
+        EXPECT_EQ(ByteScan::findStartCode(DataView(std::string_view("\x00\x00\x01", 3)), level), 0);
+        EXPECT_EQ(ByteScan::findStartCode(DataView(std::string_view("\x05\x00\x00\x00\x01\x65", 6)), level), 2);
+        EXPECT_EQ(ByteScan::findStartCode(DataView(std::string_view("\x00\x01\x00\x00", 4)), level), ByteScan::kNotFound);
+        std::string str(100, '\x02');
+        str.replace(70, 3, std::string_view("\x00\x00\x01", 3));
+        EXPECT_EQ(ByteScan::findStartCode(DataView(str), level), 70);
+        EXPECT_EQ(ByteScan::findStartCode(DataView(std::string_view(str).substr(0, 72)), level), ByteScan::kNotFound);
+    }
+}
+
+TEST(ByteScan, syncByte) {
+    for (auto level : ByteScan::supportedLevels()) {
+        std::string str(188 * 3, '\0');
+        str[5] = 0x47; //not confirmed by the next packet
+        str[20] = 0x47;
+        str[20 + 188] = 0x47;
+        EXPECT_EQ(ByteScan::findSyncByte(DataView(str), 0x47, 188, level), 20);
+        std::string tail(188, '\0');
+        tail[100] = 0x47;
+        EXPECT_EQ(ByteScan::findSyncByte(DataView(tail), 0x47, 188, level), 100);
+        EXPECT_EQ(ByteScan::findByte(DataView(tail), 0x47, level), 100);
+    }
+}
+
+TEST(ByteScan, syncword) {
+    for (auto level : ByteScan::supportedLevels()) {
+        std::string str(64, '\x10');
+        str[40] = '\xff';
+        str[41] = '\xe1';
+        str[50] = '\xff';
+        str[51] = '\xf1';
+        EXPECT_EQ(ByteScan::findSyncword(DataView(str), level), 50);
+        EXPECT_EQ(ByteScan::findSyncword(DataView(std::string_view(str).substr(0, 51)), level), ByteScan::kNotFound);
+    }
+}
+
+TEST(ByteScan, matchScalar) {
+    //small alphabets so every pattern shows up often, at every alignment
+    for (uint32_t seed = 0; seed < 8; seed++) {
+        auto zeros = randomBytes(4096 + seed, seed, 2);
+        auto syncs = randomBytes(4096 + seed, seed, 0x47);
+        auto words = randomBytes(4096 + seed, seed, 255);
+        for (auto& c : syncs) {
+            c = c == 0x46 ? 0x47 : c;
+        }
+        auto expectStart = findAll(zeros, ScanLevel::Scalar, 0);
+        auto expectSync = findAll(syncs, ScanLevel::Scalar, 1);
+        auto expectWord = findAll(words, ScanLevel::Scalar, 2);
+        for (auto level : ByteScan::supportedLevels()) {
+            EXPECT_EQ(findAll(zeros, level, 0), expectStart) << ByteScan::levelName(level);
+            EXPECT_EQ(findAll(syncs, level, 1), expectSync) << ByteScan::levelName(level);
+            EXPECT_EQ(findAll(words, level, 2), expectWord) << ByteScan::levelName(level);
+        }
+    }
+}
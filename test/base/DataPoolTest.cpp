@@ -0,0 +1,67 @@
+//
+// Created by Nevermore on 2025/7/2.
+// slark DataPoolTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "Data.hpp"
+#include "DataPool.h"
+
+using namespace slark;
+
+TEST(DataPool, roundUp) {
+    EXPECT_EQ(DataPool::roundUp(100), 100);
+    EXPECT_EQ(DataPool::roundUp(2048), 2048);
+    EXPECT_EQ(DataPool::roundUp(2049), 2560);
+    EXPECT_EQ(DataPool::roundUp(4096), 4096);
+    EXPECT_EQ(DataPool::roundUp(64 * 1024), 64 * 1024);
+    EXPECT_EQ(DataPool::roundUp(64 * 1024 + 1), 80 * 1024);
+    EXPECT_EQ(DataPool::roundUp(DataPool::kMaxBlockSize), DataPool::kMaxBlockSize);
+    EXPECT_EQ(DataPool::roundUp(DataPool::kMaxBlockSize + 1), DataPool::kMaxBlockSize + 1);
+    EXPECT_TRUE(DataPool::isPooledSize(16 * 1024));
+    EXPECT_FALSE(DataPool::isPooledSize(16 * 1024 + 1));
+}
+
+TEST(DataPool, reuse) {
+    DataPool::trim();
+    auto before = DataPool::stats();
+    auto data = Data::obtain(64 * 1024);
+    EXPECT_EQ(data->capacity, 64 * 1024);
+    EXPECT_EQ(data->length, 0);
+    auto* ptr = data->rawData;
+    data.reset();
+    auto reused = Data::obtain(64 * 1024);
+    EXPECT_EQ(reused->rawData, ptr);
+    auto after = DataPool::stats();
+    EXPECT_EQ(after.missCount - before.missCount, 1);
+    EXPECT_EQ(after.hitCount - before.hitCount, 1);
+}
+
+TEST(DataPool, crossThread) {
+    DataPool::trim();
+    constexpr int kCount = 64;
+    std::vector<DataPtr> list;
+    for (int i = 0; i < kCount; i++) {
+        list.push_back(Data::obtain(64 * 1024));
+    }
+    std::thread([&list]() {
+        list.clear();
+    }).join();
+    EXPECT_GT(DataPool::stats().depotBytes, 0);
+    auto before = DataPool::stats();
+    auto data = Data::obtain(64 * 1024);
+    EXPECT_EQ(DataPool::stats().hitCount - before.hitCount, 1);
+}
+
+TEST(DataPool, copy) {
+    Data data(std::string(3000, 'a'));
+    auto copyData = data.copy();
+    EXPECT_EQ(copyData->length, 3000);
+    EXPECT_EQ(copyData->capacity, 3072);
+    EXPECT_EQ(copyData->view(), data.view());
+    copyData->append(std::string_view("bbbb"));
+    EXPECT_EQ(copyData->length, 3004);
+    EXPECT_EQ(copyData->view().substr(3000).view(), "bbbb");
+}
@@ -91,4 +91,61 @@ TEST(Data, reset) {
     data.resetData();
     ASSERT_EQ(data.view().view(), "");
     ASSERT_EQ(data.length, 0);
-}
\ No newline at end of file
+}
+TEST(Data, slice) {
+    auto block = std::make_shared<Data>("hello world!");
+    auto slice = Data::makeSlice(block, 6, 5);
+    ASSERT_TRUE(slice->isSlice());
+    ASSERT_EQ(slice->view().view(), "world");
+    ASSERT_EQ(slice->rawData, block->rawData + 6);
+    auto subSlice = slice->slice(1, 3);
+    ASSERT_TRUE(subSlice->isSlice());
+    ASSERT_EQ(subSlice->owner, block);
+    ASSERT_EQ(subSlice->view().view(), "orl");
+    block.reset();
+    ASSERT_EQ(subSlice->view().view(), "orl");
+    auto copyData = *slice;
+    ASSERT_FALSE(copyData.isSlice());
+    ASSERT_EQ(copyData.view().view(), "world");
+}
+
+TEST(Data, sliceCopyOnWrite) {
+    auto block = std::make_shared<Data>("hello world!");
+    auto slice = Data::makeSlice(block, 0, 5);
+    slice->append(std::string_view("!"));
+    ASSERT_FALSE(slice->isSlice());
+    ASSERT_EQ(slice->view().view(), "hello!");
+    ASSERT_EQ(block->view().view(), "hello world!");
+
+    auto other = Data::makeSlice(block, 6, 5);
+    other->ensureUnique();
+    other->rawData[0] = 'W';
+    ASSERT_EQ(other->view().view(), "World");
+    ASSERT_EQ(block->view().view(), "hello world!");
+    ASSERT_EQ(block.use_count(), 1);
+}
+
+TEST(Data, writable) {
+    auto block = std::make_shared<Data>("hello world!");
+    auto slice = Data::makeSlice(block, 6, 5);
+    ASSERT_TRUE(block->isWritable());
+    ASSERT_FALSE(slice->isWritable()); //shared with block
+    auto other = Data::makeSlice(block, 0, 5);
+    block.reset();
+    ASSERT_FALSE(slice->isWritable()); //shared with other
+    other.reset();
+    ASSERT_TRUE(slice->isWritable());
+    slice->ensureUnique();
+    ASSERT_TRUE(slice->isWritable());
+}
+
+TEST(Data, readOnlyBlock) {
+    auto block = std::make_shared<Data>("hello world!");
+    block->isReadOnly = true;
+    ASSERT_FALSE(block->isWritable());
+    auto slice = Data::makeSlice(block, 6, 5);
+    block.reset();
+    ASSERT_FALSE(slice->isWritable());
+    slice->ensureUnique();
+    ASSERT_TRUE(slice->isWritable());
+}
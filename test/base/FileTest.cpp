@@ -6,9 +6,11 @@
 
 #include <gtest/gtest.h>
 #include <utility>
+#include <fstream>
 #include "IReader.h"
 #include "Writer.hpp"
 #include "Reader.h"
+#include "MmapReader.h"
 
 using namespace slark;
 
@@ -79,6 +81,100 @@ TEST(Reader, open) {
     ASSERT_EQ(reader.state(), IOState::Closed);
 }
 
+TEST(MmapReader, read) {
+    using namespace std::chrono_literals;
+    File::deleteFile("test_mmap.txt");
+    std::string str;
+    for (uint32_t i = 0; str.size() < kMmapReadBlockSize * 2 + 100; i++) {
+        str += std::to_string(i);
+    }
+    std::ofstream("test_mmap.txt", std::ios::binary) << str;
+
+    std::mutex mutex;
+    std::string result;
+    std::vector<DataPacket> packets;
+    MmapReader reader;
+    auto task = std::make_unique<ReaderTask>([&](IReader*, DataPacket data, IOState) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(data.offset, static_cast<int64_t>(result.size()));
+        ASSERT_TRUE(data.data->isSlice());
+        result.append(data.data->view().view());
+        packets.push_back(std::move(data));
+    });
+    task->path = "test_mmap.txt";
+    task->timeInterval = 1ms;
+    ASSERT_TRUE(reader.open(std::move(task)));
+    ASSERT_EQ(reader.size(), str.size());
+    reader.start();
+    while (!reader.isCompleted()) {
+        std::this_thread::sleep_for(10ms);
+    }
+    ASSERT_EQ(reader.state(), IOState::EndOfFile);
+    reader.close();
+    ASSERT_EQ(reader.state(), IOState::Closed);
+    ASSERT_EQ(packets.size(), 3);
+    ASSERT_EQ(result, str);
+    //the packets keep the mapping alive after the reader is closed
+    ASSERT_EQ(packets.back().data->view().view(), std::string_view(str).substr(kMmapReadBlockSize * 2));
+    File::deleteFile("test_mmap.txt");
+}
+
+TEST(MmapReader, readRange) {
+    using namespace std::chrono_literals;
+    File::deleteFile("test_mmap_range.txt");
+    std::string str = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::ofstream("test_mmap_range.txt", std::ios::binary) << str;
+
+    std::mutex mutex;
+    std::string result;
+    MmapReader reader;
+    auto task = std::make_unique<ReaderTask>([&](IReader*, DataPacket data, IOState) {
+        std::lock_guard<std::mutex> lock(mutex);
+        result.append(data.data->view().view());
+    });
+    task->path = "test_mmap_range.txt";
+    ASSERT_TRUE(reader.open(std::move(task)));
+    reader.updateReadRange(Range(10, 6));
+    while (!reader.isCompleted()) {
+        std::this_thread::sleep_for(10ms);
+    }
+    reader.close();
+    ASSERT_EQ(result, "abcdef");
+    File::deleteFile("test_mmap_range.txt");
+}
+
+TEST(Reader, readAt) {
+    File::deleteFile("test_read_at.txt");
+    std::string str = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::ofstream("test_read_at.txt", std::ios::binary) << str;
+
+    auto check = [&str](IReader& reader) {
+        auto task = std::make_unique<ReaderTask>([](IReader*, DataPacket, IOState) {
+
+        });
+        task->path = "test_read_at.txt";
+        ASSERT_TRUE(reader.open(std::move(task)));
+        std::vector<DataPacket> packets;
+        auto callBack = [&packets](DataPacket packet) {
+            packets.push_back(std::move(packet));
+        };
+        ASSERT_TRUE(reader.readAt(10, 6, callBack));
+        ASSERT_TRUE(reader.readAt(30, 100, callBack));
+        ASSERT_TRUE(reader.readAt(100, 6, callBack));
+        ASSERT_EQ(packets.size(), 3);
+        ASSERT_EQ(packets[0].offset, 10);
+        ASSERT_EQ(packets[0].data->view().view(), "abcdef");
+        ASSERT_EQ(packets[1].data->view().view(), std::string_view(str).substr(30));
+        ASSERT_TRUE(packets[2].empty());
+        reader.close();
+    };
+    Reader reader;
+    check(reader);
+    MmapReader mmapReader;
+    check(mmapReader);
+    File::deleteFile("test_read_at.txt");
+}
+
 TEST(File, isExist) {
     Writer writer1;
     writer1.open("test1.txt");
@@ -49,4 +49,49 @@ TEST(Thread, timer) {
         std::println("delay us: {}", time.point());
     });
     std::this_thread::sleep_for(20ms);
-}
\ No newline at end of file
+}
+TEST(Thread, idle) {
+    using namespace std::chrono;
+    std::atomic<int> x = 0;
+    Thread* self = nullptr;
+    Thread thread(Util::genRandomName("thread"), [&](){
+        x++;
+        self->idle();
+    });
+    self = &thread;
+    thread.start();
+    std::this_thread::sleep_for(50ms);
+    auto count = x.load();
+    ASSERT_GE(count, 1);
+    ASSERT_LE(count, 2);
+    auto t = Time::nowTimeStamp();
+    thread.wakeUp();
+    while (x.load() == count && (Time::nowTimeStamp() - t).toMilliSeconds() < 100ms) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(x.load(), count + 1);
+    thread.stop();
+}
+
+TEST(Thread, idleUntilTimer) {
+    using namespace std::chrono;
+    std::atomic<int> x = 0;
+    Thread* self = nullptr;
+    Thread thread(Util::genRandomName("thread"), [&](){
+        self->idle();
+    });
+    self = &thread;
+    thread.start();
+    std::this_thread::sleep_for(10ms);
+    auto t = Time::nowTimeStamp();
+    thread.runAfter(20ms, [&]{
+        x++;
+    });
+    while (x.load() == 0 && (Time::nowTimeStamp() - t).toMilliSeconds() < 500ms) {
+        std::this_thread::sleep_for(1ms);
+    }
+    auto cost = (Time::nowTimeStamp() - t).toMilliSeconds();
+    ASSERT_EQ(x.load(), 1);
+    ASSERT_LT(cost, 200ms);
+    thread.stop();
+}
@@ -0,0 +1,121 @@
+//
+// Created by Nevermore on 2025/7/22.
+// slark AbrControllerTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "AbrController.h"
+
+using namespace slark;
+using namespace std::chrono_literals;
+
+namespace {
+
+const std::vector<uint32_t> kBandwidths = {800'000, 2'000'000, 5'000'000};
+
+uint32_t select(uint32_t current, double throughput, double bufferTime) {
+    ThroughputBufferStrategy strategy;
+    return strategy.select(AbrContext{kBandwidths, current, throughput, bufferTime});
+}
+
+///always asks for the same variant
+class FixedStrategy : public IAbrStrategy {
+public:
+    explicit FixedStrategy(uint32_t index)
+        : index_(index) {
+
+    }
+
+    uint32_t select(const AbrContext&) noexcept override {
+        return index_;
+    }
+private:
+    uint32_t index_;
+};
+
+}
+
+TEST(ThroughputEstimator, FirstSampleIsTheRate) {
+    ThroughputEstimator estimator;
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 0.0);
+    //1 MB in 2 s
+    estimator.addSample(1'000'000, 2000ms);
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 4'000'000.0);
+}
+
+TEST(ThroughputEstimator, WeightsTheNewestSample) {
+    ThroughputEstimator estimator;
+    estimator.addSample(1'000'000, 1000ms);
+    estimator.addSample(2'000'000, 1000ms);
+    auto expected = ThroughputEstimator::kAlpha * 16'000'000.0 + (1.0 - ThroughputEstimator::kAlpha) * 8'000'000.0;
+    EXPECT_DOUBLE_EQ(estimator.throughput(), expected);
+}
+
+TEST(ThroughputEstimator, IgnoresSmallSamples) {
+    ThroughputEstimator estimator;
+    estimator.addSample(ThroughputEstimator::kMinSampleSize - 1, 1ms);
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 0.0);
+    estimator.addSample(1'000'000, 1000ms);
+    estimator.addSample(1024, 1ms);
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 8'000'000.0);
+    estimator.reset();
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 0.0);
+}
+
+TEST(ThroughputEstimator, ZeroCostCountsAsOneMillisecond) {
+    ThroughputEstimator estimator;
+    estimator.addSample(100'000, 0ms);
+    EXPECT_DOUBLE_EQ(estimator.throughput(), 800'000'000.0);
+}
+
+TEST(ThroughputBufferStrategy, KeepsVariantWithoutThroughput) {
+    EXPECT_EQ(select(1, 0.0, 30.0), 1u);
+}
+
+TEST(ThroughputBufferStrategy, TakesBestVariantWithinMargin) {
+    //6.5 Mbps leaves 5.2 Mbps after the safety margin
+    EXPECT_EQ(select(0, 6'500'000.0, 15.0), 2u);
+    //6 Mbps leaves 4.8 Mbps, only 2 Mbps fits
+    EXPECT_EQ(select(0, 6'000'000.0, 15.0), 1u);
+}
+
+TEST(ThroughputBufferStrategy, FallsBackToLowestVariant) {
+    EXPECT_EQ(select(2, 100'000.0, 5.0), 0u);
+}
+
+TEST(ThroughputBufferStrategy, NoUpSwitchOnSmallBuffer) {
+    EXPECT_EQ(select(0, 10'000'000.0, ThroughputBufferStrategy::kMinUpSwitchBuffer - 1.0), 0u);
+    EXPECT_EQ(select(0, 10'000'000.0, ThroughputBufferStrategy::kMinUpSwitchBuffer), 2u);
+}
+
+TEST(ThroughputBufferStrategy, NoDownSwitchOnLargeBuffer) {
+    EXPECT_EQ(select(2, 1'000'000.0, ThroughputBufferStrategy::kMaxDownSwitchBuffer + 1.0), 2u);
+    EXPECT_EQ(select(2, 1'000'000.0, ThroughputBufferStrategy::kMaxDownSwitchBuffer), 0u);
+}
+
+TEST(AbrController, UsesReplacedStrategy) {
+    AbrController controller;
+    controller.setBandwidths(kBandwidths);
+    controller.setStrategy(std::make_unique<FixedStrategy>(2));
+    EXPECT_EQ(controller.select(0.0), 2u);
+    //an index out of range keeps the current variant
+    controller.setStrategy(std::make_unique<FixedStrategy>(3));
+    EXPECT_EQ(controller.select(0.0), 0u);
+}
+
+TEST(AbrController, SelectsFromMeasuredDownloads) {
+    AbrController controller;
+    controller.setBandwidths(kBandwidths);
+    EXPECT_EQ(controller.select(20.0), 0u);
+    //8 Mbps
+    controller.onSegmentDownloaded(1'000'000, 1000ms);
+    EXPECT_EQ(controller.select(20.0), 2u);
+    controller.setCurrentIndex(2);
+    EXPECT_EQ(controller.currentIndex(), 2u);
+    controller.reset();
+    EXPECT_EQ(controller.variantCount(), 0u);
+    EXPECT_EQ(controller.currentIndex(), 0u);
+}
@@ -0,0 +1,228 @@
+//
+// Created by Nevermore on 2025/7/27.
+// slark MediaUtilTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <bit>
+#include <memory>
+#include <string>
+#include "MediaUtil.h"
+#include "VideoInfo.h"
+
+using namespace slark;
+
+namespace {
+
+///MSB first bit writer for building test streams
+class BitWriter {
+public:
+    void write(uint64_t value, uint32_t n) {
+        for (uint32_t i = n; i > 0; i--) {
+            if (bitCount_ % 8 == 0) {
+                bytes_.push_back('\0');
+            }
+            auto bit = (value >> (i - 1)) & 0x01;
+            bytes_.back() = static_cast<char>(static_cast<uint8_t>(bytes_.back()) | (bit << (7 - bitCount_ % 8)));
+            bitCount_++;
+        }
+    }
+
+    void writeUE(uint32_t value) {
+        auto code = static_cast<uint64_t>(value) + 1;
+        auto length = static_cast<uint32_t>(std::bit_width(code));
+        write(0, length - 1);
+        write(code, length);
+    }
+
+    ///rbsp_stop_one_bit and the alignment zeros
+    void finish() {
+        write(1, 1);
+        if (bitCount_ % 8) {
+            write(0, 8 - bitCount_ % 8);
+        }
+    }
+
+    ///the nalu with emulation prevention bytes
+    std::string ebsp() const {
+        std::string res;
+        uint32_t zeroCount = 0;
+        for (auto c : bytes_) {
+            auto byte = static_cast<uint8_t>(c);
+            if (zeroCount >= 2 && byte <= 0x03) {
+                res.push_back('\x03');
+                zeroCount = 0;
+            }
+            res.push_back(c);
+            zeroCount = byte == 0 ? zeroCount + 1 : 0;
+        }
+        return res;
+    }
+private:
+    std::string bytes_;
+    uint64_t bitCount_ = 0;
+};
+
+void writeNaluHeader(BitWriter& writer, uint8_t naluType) {
+    writer.write(0, 1); // forbidden_zero_bit
+    writer.write(naluType, 6);
+    writer.write(0, 6); // nuh_layer_id
+    writer.write(1, 3); // nuh_temporal_id_plus1
+}
+
+///main profile, 1280x736 coded with a conformance window down to 720 lines, 30000/1001 fps
+std::string makeSps() {
+    BitWriter writer;
+    writeNaluHeader(writer, 33);
+    writer.write(0, 4); // sps_video_parameter_set_id
+    writer.write(0, 3); // sps_max_sub_layers_minus1
+    writer.write(1, 1); // sps_temporal_id_nesting_flag
+    //profile_tier_level
+    writer.write(0, 2); // general_profile_space
+    writer.write(0, 1); // general_tier_flag
+    writer.write(1, 5); // general_profile_idc
+    writer.write(0x60000000, 32); // general_profile_compatibility_flags
+    writer.write(0b1001, 4); // progressive, interlaced, non packed, frame only
+    writer.write(0, 43); // general_reserved_zero_43bits
+    writer.write(0, 1); // general_reserved_zero_bit
+    writer.write(93, 8); // general_level_idc
+    writer.writeUE(0); // sps_seq_parameter_set_id
+    writer.writeUE(1); // chroma_format_idc
+    writer.writeUE(1280); // pic_width_in_luma_samples
+    writer.writeUE(736); // pic_height_in_luma_samples
+    writer.write(1, 1); // conformance_window_flag
+    writer.writeUE(0);
+    writer.writeUE(0);
+    writer.writeUE(0);
+    writer.writeUE(8); // conf_win_bottom_offset, in chroma lines
+    writer.writeUE(0); // bit_depth_luma_minus8
+    writer.writeUE(0); // bit_depth_chroma_minus8
+    writer.writeUE(4); // log2_max_pic_order_cnt_lsb_minus4
+    writer.write(1, 1); // sps_sub_layer_ordering_info_present_flag
+    writer.writeUE(4); // sps_max_dec_pic_buffering_minus1
+    writer.writeUE(2); // sps_max_num_reorder_pics
+    writer.writeUE(0); // sps_max_latency_increase_plus1
+    writer.writeUE(0); // log2_min_luma_coding_block_size_minus3
+    writer.writeUE(3); // log2_diff_max_min_luma_coding_block_size
+    writer.writeUE(0); // log2_min_luma_transform_block_size_minus2
+    writer.writeUE(3); // log2_diff_max_min_luma_transform_block_size
+    writer.writeUE(1); // max_transform_hierarchy_depth_inter
+    writer.writeUE(1); // max_transform_hierarchy_depth_intra
+    writer.write(0, 1); // scaling_list_enabled_flag
+    writer.write(0b11, 2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+    writer.write(0, 1); // pcm_enabled_flag
+    writer.writeUE(2); // num_short_term_ref_pic_sets
+    //set 0, explicit
+    writer.writeUE(1); // num_negative_pics
+    writer.writeUE(0); // num_positive_pics
+    writer.writeUE(0); // delta_poc_s0_minus1
+    writer.write(1, 1); // used_by_curr_pic_s0_flag
+    //set 1, predicted from set 0
+    writer.write(1, 1); // inter_ref_pic_set_prediction_flag
+    writer.write(0, 1); // delta_rps_sign
+    writer.writeUE(0); // abs_delta_rps_minus1
+    writer.write(1, 1); // used_by_curr_pic_flag
+    writer.write(1, 1); // used_by_curr_pic_flag
+    writer.write(0, 1); // long_term_ref_pics_present_flag
+    writer.write(0b11, 2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+    writer.write(1, 1); // vui_parameters_present_flag
+    writer.write(0, 1); // aspect_ratio_info_present_flag
+    writer.write(0, 1); // overscan_info_present_flag
+    writer.write(0, 1); // video_signal_type_present_flag
+    writer.write(0, 1); // chroma_loc_info_present_flag
+    writer.write(0, 3); // neutral_chroma_indication_flag, field_seq_flag, frame_field_info_present_flag
+    writer.write(0, 1); // default_display_window_flag
+    writer.write(1, 1); // vui_timing_info_present_flag
+    writer.write(1001, 32); // vui_num_units_in_tick
+    writer.write(30000, 32); // vui_time_scale
+    writer.write(0, 1); // vui_poc_proportional_to_timing_flag
+    writer.write(0, 1); // vui_hrd_parameters_present_flag
+    writer.write(0, 1); // bitstream_restriction_flag
+    writer.write(0, 1); // sps_extension_present_flag
+    writer.finish();
+    return writer.ebsp();
+}
+
+std::string makePps(uint32_t extraSliceHeaderBits) {
+    BitWriter writer;
+    writeNaluHeader(writer, 34);
+    writer.writeUE(0); // pps_pic_parameter_set_id
+    writer.writeUE(0); // pps_seq_parameter_set_id
+    writer.write(0, 1); // dependent_slice_segments_enabled_flag
+    writer.write(0, 1); // output_flag_present_flag
+    writer.write(extraSliceHeaderBits, 3); // num_extra_slice_header_bits
+    writer.write(0, 1); // sign_data_hiding_enabled_flag
+    writer.write(0, 1); // cabac_init_present_flag
+    writer.finish();
+    return writer.ebsp();
+}
+
+///the slice segment header up to slice_type
+std::string makeSlice(uint8_t naluType, bool isFirstSegment, uint32_t extraSliceHeaderBits, uint32_t sliceType) {
+    BitWriter writer;
+    writeNaluHeader(writer, naluType);
+    writer.write(isFirstSegment, 1); // first_slice_segment_in_pic_flag
+    if (isFirstSegment) {
+        if (naluType >= 16 && naluType <= 23) {
+            writer.write(0, 1); // no_output_of_prior_pics_flag
+        }
+        writer.writeUE(0); // slice_pic_parameter_set_id
+        //slice_reserved_flag, set to tell them from the slice type
+        writer.write((1u << extraSliceHeaderBits) - 1, extraSliceHeaderBits);
+        writer.writeUE(sliceType);
+    } else {
+        writer.write(0x5A, 8); // slice_segment_address and the rest
+    }
+    writer.finish();
+    return writer.ebsp();
+}
+
+} //end of namespace
+
+TEST(MediaUtil, h265Sps) {
+    auto sps = makeSps();
+    auto videoInfo = std::make_shared<VideoInfo>();
+    parseH265Sps(DataView(sps), videoInfo);
+    EXPECT_EQ(videoInfo->width, 1280u);
+    EXPECT_EQ(videoInfo->height, 720u);
+    EXPECT_EQ(videoInfo->fps, 29);
+}
+
+TEST(MediaUtil, h265TruncatedSps) {
+    auto sps = makeSps();
+    auto videoInfo = std::make_shared<VideoInfo>();
+    //ends inside the profile tier level
+    parseH265Sps(DataView(sps).substr(0, 8), videoInfo);
+    EXPECT_EQ(videoInfo->width, 0u);
+    EXPECT_EQ(videoInfo->height, 0u);
+    EXPECT_EQ(videoInfo->fps, 0);
+}
+
+TEST(MediaUtil, h265ExtraSliceHeaderBits) {
+    for (uint32_t bits = 0; bits < 8; bits++) {
+        auto pps = makePps(bits);
+        EXPECT_EQ(parseH265ExtraSliceHeaderBits(DataView(pps)), bits);
+    }
+    auto pps = makePps(2);
+    EXPECT_EQ(parseH265ExtraSliceHeaderBits(DataView(pps).substr(0, 2)), 0u);
+}
+
+TEST(MediaUtil, h265SliceType) {
+    constexpr uint8_t kIdrWRadl = 19;
+    constexpr uint8_t kTrailR = 1;
+    constexpr uint32_t kSliceB = 0;
+    constexpr uint32_t kSliceP = 1;
+    constexpr uint32_t kSliceI = 2;
+    auto extraBits = parseH265ExtraSliceHeaderBits(DataView(makePps(2)));
+
+    auto idr = makeSlice(kIdrWRadl, true, extraBits, kSliceI);
+    EXPECT_EQ(parseHevcSliceType(DataView(idr), kIdrWRadl, extraBits), std::make_tuple(1u, kSliceI));
+
+    auto trail = makeSlice(kTrailR, true, extraBits, kSliceP);
+    EXPECT_EQ(parseHevcSliceType(DataView(trail), kTrailR, extraBits), std::make_tuple(1u, kSliceP));
+    //the reserved flags are read as the slice type when the pps is ignored
+    EXPECT_EQ(parseHevcSliceType(DataView(trail), kTrailR, 0), std::make_tuple(1u, kSliceB));
+
+    auto continuation = makeSlice(kTrailR, false, extraBits, kSliceP);
+    EXPECT_EQ(parseHevcSliceType(DataView(continuation), kTrailR, extraBits), std::make_tuple(0u, kInvalidSliceType));
+}
@@ -0,0 +1,143 @@
+//
+// Created by Nevermore on 2025/7/28.
+// slark Mp4BoxTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include "Mp4Demuxer.h"
+#include "Mp4BoxWriter.h"
+
+using namespace slark;
+using namespace slark::test;
+
+namespace {
+
+constexpr uint64_t k4GB = 0x1'0000'0000;
+
+std::unique_ptr<Buffer> makeBuffer(const std::string& bytes) {
+    auto buffer = std::make_unique<Buffer>(bytes.size());
+    buffer->append(0, std::make_unique<Data>(bytes));
+    return buffer;
+}
+
+///create and decode the next box, the buffer is left at its end
+template<typename T>
+std::shared_ptr<T> decodeBox(Buffer& buffer) {
+    auto box = Box::createBox(buffer);
+    if (!box) {
+        return nullptr;
+    }
+    auto res = std::dynamic_pointer_cast<T>(box);
+    if (res && !res->decode(buffer)) {
+        return nullptr;
+    }
+    buffer.skipTo(static_cast<int64_t>(box->info.end()));
+    return res;
+}
+
+std::string makeMvhd(uint8_t version, uint64_t duration) {
+    std::string body;
+    put(body, 1, version == 1 ? 8 : 4); // creation time
+    put(body, 2, version == 1 ? 8 : 4); // modification time
+    put(body, 1000, 4); // time scale
+    put(body, duration, version == 1 ? 8 : 4);
+    put(body, 0x00010000, 4); // rate
+    put(body, 0x0100, 2); // volume
+    body.append(10 + 36 + 24, '\0'); // reserved, matrix, pre defined
+    put(body, 3, 4); // next track id
+    return fullBox("mvhd", version, 0, body);
+}
+
+} //end of namespace
+
+TEST(Mp4Box, mvhdVersion0) {
+    auto buffer = makeBuffer(makeMvhd(0, 90'000));
+    auto mvhd = decodeBox<BoxMvhd>(*buffer);
+    ASSERT_NE(mvhd, nullptr);
+    EXPECT_EQ(mvhd->creationTime, 1u);
+    EXPECT_EQ(mvhd->modificationTime, 2u);
+    EXPECT_EQ(mvhd->timeScale, 1000u);
+    EXPECT_EQ(mvhd->duration, 90'000u);
+    EXPECT_EQ(mvhd->nextTrackId, 3u);
+    EXPECT_TRUE(buffer->empty());
+}
+
+TEST(Mp4Box, mvhdVersion1) {
+    //a duration that does not fit 32 bits
+    auto buffer = makeBuffer(makeMvhd(1, k4GB + 1));
+    auto mvhd = decodeBox<BoxMvhd>(*buffer);
+    ASSERT_NE(mvhd, nullptr);
+    EXPECT_EQ(mvhd->version, 1);
+    EXPECT_EQ(mvhd->creationTime, 1u);
+    EXPECT_EQ(mvhd->modificationTime, 2u);
+    EXPECT_EQ(mvhd->timeScale, 1000u);
+    EXPECT_EQ(mvhd->duration, k4GB + 1);
+    EXPECT_EQ(mvhd->nextTrackId, 3u);
+    EXPECT_TRUE(buffer->empty());
+}
+
+TEST(Mp4Box, truncatedMvhdVersion1) {
+    //enough for version 0, short of the 12 bytes more of version 1
+    auto bytes = makeMvhd(1, k4GB + 1);
+    bytes.resize(bytes.size() - 8);
+    auto buffer = makeBuffer(bytes);
+    auto box = Box::createBox(*buffer);
+    ASSERT_NE(box, nullptr);
+    auto bodyPos = buffer->pos();
+    EXPECT_FALSE(box->decode(*buffer));
+    EXPECT_EQ(buffer->pos(), bodyPos);
+}
+
+TEST(Mp4Box, co64ChunkOffsets) {
+    std::string stsz;
+    put(stsz, 0, 4); // sample size, every sample has its own
+    put(stsz, 3, 4);
+    put(stsz, 100, 4);
+    put(stsz, 200, 4);
+    put(stsz, 300, 4);
+    std::string stsc;
+    put(stsc, 1, 4);
+    put(stsc, 1, 4); // first chunk
+    put(stsc, 2, 4); // samples per chunk
+    put(stsc, 1, 4); // sample description index
+    std::string co64;
+    put(co64, 2, 4);
+    put(co64, k4GB, 8);
+    put(co64, 2 * k4GB + 16, 8);
+    std::string stts;
+    put(stts, 1, 4);
+    put(stts, 3, 4); // sample count
+    put(stts, 1000, 4); // sample delta
+    auto buffer = makeBuffer(fullBox("stsz", 0, 0, stsz) + fullBox("stsc", 0, 0, stsc) +
+        fullBox("co64", 0, 0, co64) + fullBox("stts", 0, 0, stts));
+
+    auto stszBox = decodeBox<BoxStsz>(*buffer);
+    auto stscBox = decodeBox<BoxStsc>(*buffer);
+    auto co64Box = decodeBox<BoxStco>(*buffer);
+    auto sttsBox = decodeBox<BoxStts>(*buffer);
+    ASSERT_TRUE(stszBox && stscBox && co64Box && sttsBox);
+    EXPECT_TRUE(co64Box->is64Bit);
+    EXPECT_EQ(co64Box->entryCount, 2u);
+
+    Mp4SampleIndex samples;
+    ASSERT_TRUE(samples.build(*buffer, *stszBox, *stscBox, *co64Box, *sttsBox, nullptr, nullptr, false));
+    ASSERT_EQ(samples.size(), 3u);
+    EXPECT_EQ(samples.offset(0), k4GB);
+    EXPECT_EQ(samples.offset(1), k4GB + 100);
+    EXPECT_EQ(samples.offset(2), 2 * k4GB + 16);
+    EXPECT_EQ(samples.sampleSize(2), 300u);
+    EXPECT_EQ(samples.dts(2), 2000);
+    EXPECT_EQ(samples.findByOffset(2 * k4GB), 2u);
+}
+
+TEST(Mp4Box, co64TooShortForItsEntries) {
+    std::string co64;
+    put(co64, 2, 4);
+    put(co64, k4GB, 8);
+    auto buffer = makeBuffer(fullBox("co64", 0, 0, co64));
+    auto box = Box::createBox(*buffer);
+    ASSERT_NE(box, nullptr);
+    EXPECT_FALSE(box->decode(*buffer));
+}
@@ -0,0 +1,36 @@
+//
+// Created by Nevermore on 2025/7/28.
+// slark Mp4BoxWriter
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace slark::test {
+
+///big endian
+inline void put(std::string& out, uint64_t value, uint32_t bytes) {
+    for (uint32_t i = bytes; i > 0; i--) {
+        out.push_back(static_cast<char>((value >> ((i - 1) * 8)) & 0xff));
+    }
+}
+
+inline std::string box(std::string_view type, const std::string& body) {
+    std::string res;
+    put(res, 8 + body.size(), 4);
+    res.append(type);
+    res.append(body);
+    return res;
+}
+
+inline std::string fullBox(std::string_view type, uint8_t version, uint32_t flags, const std::string& body) {
+    std::string head;
+    put(head, version, 1);
+    put(head, flags, 3);
+    return box(type, head + body);
+}
+
+}
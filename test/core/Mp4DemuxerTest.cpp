@@ -0,0 +1,342 @@
+//
+// Created by Nevermore on 2025/7/28.
+// slark Mp4DemuxerTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Mp4Demuxer.h"
+#include "Mp4BoxWriter.h"
+
+using namespace slark;
+using namespace slark::test;
+
+namespace {
+
+constexpr uint32_t kTimeScale = 44100;
+constexpr uint32_t kSampleDuration = 1024;
+constexpr uint32_t kSampleSize = 64;
+constexpr uint32_t kSamplesPerFragment = 4;
+constexpr uint32_t kFragmentCount = 3;
+constexpr double kFragmentTime = static_cast<double>(kSampleDuration * kSamplesPerFragment) / kTimeScale;
+
+std::string makeFtyp() {
+    std::string ftyp = "isom";
+    put(ftyp, 0x200, 4); // minor version
+    ftyp.append("isomiso6");
+    return box("ftyp", ftyp);
+}
+
+std::string makeEsds() {
+    std::string decoderSpecific;
+    put(decoderSpecific, 0x05, 1);
+    put(decoderSpecific, 2, 1);
+    put(decoderSpecific, 0x1210, 2); // aac lc, 44100, stereo
+    std::string decoderConfig;
+    put(decoderConfig, 0x40, 1); // object type, aac
+    put(decoderConfig, 0x15, 1); // stream type
+    put(decoderConfig, 0, 3); // buffer size
+    put(decoderConfig, 128000, 4); // max bitrate
+    put(decoderConfig, 128000, 4); // avg bitrate
+    decoderConfig.append(decoderSpecific);
+    std::string esDesc;
+    put(esDesc, 1, 2); // es id
+    put(esDesc, 0, 1); // flags
+    put(esDesc, 0x04, 1);
+    put(esDesc, decoderConfig.size(), 1);
+    esDesc.append(decoderConfig);
+    std::string body;
+    put(body, 0x03, 1);
+    put(body, esDesc.size(), 1);
+    body.append(esDesc);
+    return fullBox("esds", 0, 0, body);
+}
+
+std::string makeMvhd() {
+    std::string mvhd;
+    put(mvhd, 0, 8); // creation and modification time
+    put(mvhd, 1000, 4); // time scale
+    put(mvhd, 0, 4); // duration, told by the sidx, the fragments or the tracks
+    put(mvhd, 0x00010000, 4); // rate
+    put(mvhd, 0x0100, 2); // volume
+    mvhd.append(10 + 36 + 24, '\0'); // reserved, matrix, pre defined
+    put(mvhd, 3, 4); // next track id
+    return fullBox("mvhd", 0, 0, mvhd);
+}
+
+std::string makeAudioSampleEntry() {
+    std::string mp4a(6, '\0');
+    put(mp4a, 1, 2); // data reference index
+    mp4a.append(8, '\0');
+    put(mp4a, 2, 2); // channels
+    put(mp4a, 16, 2); // sample size
+    put(mp4a, 0, 4);
+    put(mp4a, static_cast<uint64_t>(kTimeScale) << 16, 4);
+    mp4a.append(makeEsds());
+    return box("mp4a", mp4a);
+}
+
+std::string makeVideoSampleEntry() {
+    std::string avc1(6, '\0');
+    put(avc1, 1, 2); // data reference index
+    avc1.append(16, '\0');
+    put(avc1, 320, 2); // width
+    put(avc1, 240, 2); // height
+    avc1.append(12, '\0'); // resolution and reserved
+    put(avc1, 1, 2); // frame count
+    avc1.append(32 + 2 + 2, '\0'); // compressor name, depth and pre defined
+    //no avcC, only the sample table is read
+    avc1.append(box("pasp", std::string(8, '\0')));
+    return box("avc1", avc1);
+}
+
+///the sample table boxes of samples of one size and one duration, all in one chunk
+std::string makeSampleTable(uint32_t count, uint32_t size, uint32_t duration, uint64_t chunkOffset) {
+    std::string stts;
+    put(stts, 1, 4);
+    put(stts, count, 4);
+    put(stts, duration, 4);
+    std::string stsc;
+    put(stsc, 1, 4);
+    put(stsc, 1, 4); // first chunk
+    put(stsc, count, 4); // samples per chunk
+    put(stsc, 1, 4); // sample description index
+    std::string stsz;
+    put(stsz, size, 4);
+    put(stsz, count, 4);
+    std::string stco;
+    put(stco, 1, 4);
+    put(stco, chunkOffset, 4);
+    return fullBox("stts", 0, 0, stts) + fullBox("stsc", 0, 0, stsc) +
+        fullBox("stsz", 0, 0, stsz) + fullBox("stco", 0, 0, stco);
+}
+
+std::string makeTrak(uint32_t trackId, const std::string& sampleEntry, const std::string& sampleTable) {
+    std::string tkhd;
+    put(tkhd, 0, 8);
+    put(tkhd, trackId, 4);
+    tkhd.append(60, '\0');
+
+    std::string mdhd;
+    put(mdhd, 0, 8);
+    put(mdhd, kTimeScale, 4);
+    put(mdhd, 0, 4);
+    put(mdhd, 0x55c4, 2); // language
+    put(mdhd, 0, 2);
+
+    std::string stsd;
+    put(stsd, 1, 4);
+    stsd.append(sampleEntry);
+    auto stbl = box("stbl", fullBox("stsd", 0, 0, stsd) + sampleTable);
+    auto mdia = box("mdia", fullBox("mdhd", 0, 0, mdhd) + box("minf", stbl));
+    return box("trak", fullBox("tkhd", 0, 3, tkhd) + mdia);
+}
+
+std::string makeFragmentedMoov() {
+    std::string emptyTable(4, '\0');
+    std::string stsz(8, '\0');
+    auto sampleTable = fullBox("stts", 0, 0, emptyTable) + fullBox("stsc", 0, 0, emptyTable) +
+        fullBox("stsz", 0, 0, stsz) + fullBox("stco", 0, 0, emptyTable);
+    std::string trex;
+    put(trex, 1, 4); // track id
+    put(trex, 1, 4); // sample description index
+    put(trex, kSampleDuration, 4);
+    put(trex, 0, 4); // sample size, told by the runs
+    put(trex, 0, 4); // sample flags
+    return box("moov", makeMvhd() + makeTrak(1, makeAudioSampleEntry(), sampleTable) +
+        box("mvex", fullBox("trex", 0, 0, trex)));
+}
+
+///moof and mdat of a fragment, every sample is filled with its index
+std::string makeFragment(uint32_t sequence) {
+    auto makeMoof = [sequence](uint32_t dataOffset) {
+        std::string mfhd;
+        put(mfhd, sequence + 1, 4);
+        std::string tfhd;
+        put(tfhd, 1, 4); // track id
+        std::string tfdt;
+        put(tfdt, static_cast<uint64_t>(sequence) * kSamplesPerFragment * kSampleDuration, 8);
+        std::string trun;
+        put(trun, kSamplesPerFragment, 4);
+        put(trun, dataOffset, 4);
+        for (uint32_t i = 0; i < kSamplesPerFragment; i++) {
+            put(trun, kSampleSize, 4);
+        }
+        auto traf = box("traf", fullBox("tfhd", 0, 0, tfhd) + fullBox("tfdt", 1, 0, tfdt) +
+            fullBox("trun", 0, BoxTrun::kDataOffsetPresent | BoxTrun::kSampleSizePresent, trun));
+        return box("moof", fullBox("mfhd", 0, 0, mfhd) + traf);
+    };
+    //the data offset counts from the moof, past the mdat header
+    auto moof = makeMoof(0);
+    moof = makeMoof(static_cast<uint32_t>(moof.size() + 8));
+    std::string samples;
+    for (uint32_t i = 0; i < kSamplesPerFragment; i++) {
+        samples.append(kSampleSize, static_cast<char>(sequence * kSamplesPerFragment + i));
+    }
+    return moof + box("mdat", samples);
+}
+
+struct Mp4File {
+    std::string data;
+    std::vector<uint64_t> fragmentPos;
+};
+
+Mp4File makeFragmentedFile(bool hasSidx) {
+    std::vector<std::string> fragments;
+    for (uint32_t i = 0; i < kFragmentCount; i++) {
+        fragments.push_back(makeFragment(i));
+    }
+    Mp4File file;
+    file.data = makeFtyp() + makeFragmentedMoov();
+    if (hasSidx) {
+        std::string sidx;
+        put(sidx, 1, 4); // reference id
+        put(sidx, kTimeScale, 4);
+        put(sidx, 0, 4); // earliest presentation time
+        put(sidx, 0, 4); // first offset, the fragments follow
+        put(sidx, 0, 2);
+        put(sidx, kFragmentCount, 2);
+        for (const auto& fragment : fragments) {
+            put(sidx, fragment.size(), 4);
+            put(sidx, kSamplesPerFragment * kSampleDuration, 4);
+            put(sidx, 0x90000000, 4); // starts with sap, type 1
+        }
+        file.data.append(fullBox("sidx", 0, 0, sidx));
+    }
+    for (const auto& fragment : fragments) {
+        file.fragmentPos.push_back(file.data.size());
+        file.data.append(fragment);
+    }
+    return file;
+}
+
+constexpr uint32_t kVideoCount = 10;
+constexpr uint32_t kVideoSize = 50;
+constexpr uint32_t kAudioCount = 20;
+constexpr uint32_t kAudioSize = 20;
+
+///all the video samples first, then all the audio, like a badly interleaved file.
+///an audio sample lasts half a video sample
+Mp4File makeSequentialFile() {
+    auto makeMoov = [](uint64_t videoStart, uint64_t audioStart) {
+        return box("moov", makeMvhd() +
+            makeTrak(1, makeVideoSampleEntry(), makeSampleTable(kVideoCount, kVideoSize, kSampleDuration * 2, videoStart)) +
+            makeTrak(2, makeAudioSampleEntry(), makeSampleTable(kAudioCount, kAudioSize, kSampleDuration, audioStart)));
+    };
+    auto ftyp = makeFtyp();
+    auto videoStart = ftyp.size() + makeMoov(0, 0).size() + 8;
+    auto audioStart = videoStart + kVideoCount * kVideoSize;
+    Mp4File file;
+    file.data = ftyp + makeMoov(videoStart, audioStart) + box("mdat", std::string(kVideoCount * kVideoSize + kAudioCount * kAudioSize, '\0'));
+    return file;
+}
+
+void open(Mp4Demuxer& demuxer, const Mp4File& file) {
+    demuxer.init(DemuxerConfig{file.data.size(), ""});
+    auto buffer = std::make_unique<Buffer>(file.data.size());
+    buffer->append(0, std::make_unique<Data>(file.data));
+    ASSERT_TRUE(demuxer.open(buffer));
+}
+
+DemuxerResult parse(Mp4Demuxer& demuxer, const Mp4File& file, uint64_t pos) {
+    DataPacket packet;
+    packet.offset = static_cast<int64_t>(pos);
+    packet.data = std::make_unique<Data>(std::string_view(file.data).substr(pos));
+    return demuxer.parseData(packet);
+}
+
+///Mp4Demuxer hides it with its own check
+bool isCompleted(const IDemuxer& demuxer) {
+    return demuxer.isCompleted();
+}
+
+void expectSamples(const AVFramePtrArray& frames, uint32_t firstSample) {
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        auto sample = firstSample + i;
+        EXPECT_EQ(frames[i]->dts, static_cast<int64_t>(sample * kSampleDuration));
+        ASSERT_EQ(frames[i]->data->length, kSampleSize);
+        EXPECT_EQ(frames[i]->data->rawData[0], sample);
+    }
+}
+
+} //end of namespace
+
+TEST(Mp4Demuxer, fragmentedFileWithSidx) {
+    auto file = makeFragmentedFile(true);
+    Mp4Demuxer demuxer;
+    open(demuxer, file);
+    ASSERT_NE(demuxer.headerInfo(), nullptr);
+    EXPECT_EQ(demuxer.headerInfo()->headerLength, file.fragmentPos.front());
+    //kept in milliseconds
+    EXPECT_NEAR(demuxer.totalDuration().second(), kFragmentTime * kFragmentCount, 0.001);
+    //the sidx tells the fragments before any of them is read
+    EXPECT_EQ(demuxer.getSeekToPos(0.0), file.fragmentPos[0]);
+    EXPECT_EQ(demuxer.getSeekToPos(kFragmentTime * 1.5), file.fragmentPos[1]);
+    EXPECT_EQ(demuxer.getSeekToPos(100.0), file.fragmentPos[2]);
+
+    auto result = parse(demuxer, file, 0);
+    ASSERT_EQ(result.audioFrames.size(), kSamplesPerFragment * kFragmentCount);
+    expectSamples(result.audioFrames, 0);
+    EXPECT_TRUE(isCompleted(demuxer));
+}
+
+TEST(Mp4Demuxer, fragmentedFileWithoutSidx) {
+    auto file = makeFragmentedFile(false);
+    Mp4Demuxer demuxer;
+    open(demuxer, file);
+    //no fragment is known yet, a seek starts over
+    EXPECT_EQ(demuxer.getSeekToPos(kFragmentTime * 1.5), file.fragmentPos[0]);
+
+    auto result = parse(demuxer, file, 0);
+    ASSERT_EQ(result.audioFrames.size(), kSamplesPerFragment * kFragmentCount);
+    expectSamples(result.audioFrames, 0);
+    //the moof boxes read so far are the seek points
+    EXPECT_EQ(demuxer.getSeekToPos(0.0), file.fragmentPos[0]);
+    EXPECT_EQ(demuxer.getSeekToPos(kFragmentTime * 1.5), file.fragmentPos[1]);
+    EXPECT_EQ(demuxer.getSeekToPos(kFragmentTime * 2.5), file.fragmentPos[2]);
+}
+
+TEST(Mp4Demuxer, seekFragmentedFile) {
+    auto file = makeFragmentedFile(true);
+    Mp4Demuxer demuxer;
+    open(demuxer, file);
+    auto pos = demuxer.getSeekToPos(kFragmentTime * 1.5);
+    demuxer.seekPos(pos);
+    auto result = parse(demuxer, file, pos);
+    ASSERT_EQ(result.audioFrames.size(), kSamplesPerFragment * (kFragmentCount - 1));
+    expectSamples(result.audioFrames, kSamplesPerFragment);
+    EXPECT_TRUE(isCompleted(demuxer));
+}
+
+TEST(Mp4Demuxer, sideStreamOfSequentialFile) {
+    auto file = makeSequentialFile();
+    Mp4Demuxer demuxer;
+    open(demuxer, file);
+    uint64_t audioStart = file.data.size() - kAudioCount * kAudioSize;
+    uint64_t videoStart = audioStart - kVideoCount * kVideoSize;
+    EXPECT_EQ(demuxer.dataStart(), videoStart);
+    //audio sample i plays with video sample i / 2
+    uint64_t distance = 0;
+    for (uint64_t i = 0; i < kAudioCount; i++) {
+        distance = std::max(distance, audioStart + i * kAudioSize - (videoStart + i / 2 * kVideoSize));
+    }
+    EXPECT_EQ(demuxer.interleaveDistance(), distance);
+
+    demuxer.enableSideStream();
+    ASSERT_TRUE(demuxer.isSideStreamEnabled());
+    //the audio follows the first video sample, all of it is due and read at once
+    auto range = demuxer.nextSideRange();
+    EXPECT_EQ(range.start(), audioStart);
+    EXPECT_EQ(range.size.value_or(0), kAudioCount * kAudioSize);
+    //the sequential stream only feeds the video
+    auto result = parse(demuxer, file, 0);
+    EXPECT_TRUE(result.audioFrames.empty());
+    //with all the video parsed the rest of the audio stays due
+    range = demuxer.nextSideRange();
+    EXPECT_EQ(range.start(), audioStart);
+    EXPECT_EQ(range.size.value_or(0), kAudioCount * kAudioSize);
+}
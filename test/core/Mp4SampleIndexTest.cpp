@@ -0,0 +1,142 @@
+//
+// Created by Nevermore on 2025/7/28.
+// slark Mp4SampleIndexTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "Mp4Demuxer.h"
+
+using namespace slark;
+
+namespace {
+
+struct Sample {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    int64_t dts = 0;
+    int32_t ptsDelta = 0;
+    bool isKeyFrame = false;
+};
+
+constexpr uint32_t kSampleDuration = 1000;
+constexpr uint32_t kKeyFrameInterval = 300;
+
+///more than two pages, the last one without a key frame. Gaps between some samples,
+///a dts step that changes now and then and negative pts deltas
+std::vector<Sample> makeSamples(uint64_t count) {
+    std::vector<Sample> samples;
+    uint64_t offset = 1000;
+    int64_t dts = -2000;
+    for (uint64_t i = 0; i < count; i++) {
+        Sample sample;
+        sample.offset = offset + (i % 50 == 0 ? 7 : 0);
+        sample.size = 100 + static_cast<uint32_t>(i % 3) * 40;
+        sample.dts = dts;
+        sample.ptsDelta = static_cast<int32_t>(i % 4) * 250 - 250;
+        sample.isKeyFrame = i % kKeyFrameInterval == 0;
+        samples.push_back(sample);
+        offset = sample.offset + sample.size;
+        dts += kSampleDuration + (i % 10 == 9 ? 500 : 0);
+    }
+    return samples;
+}
+
+void fill(Mp4SampleIndex& index, const std::vector<Sample>& samples) {
+    for (const auto& sample : samples) {
+        index.append(sample.offset, sample.size, sample.dts, sample.ptsDelta, sample.isKeyFrame, kSampleDuration);
+    }
+}
+
+uint64_t expectedNextKeyFrame(const std::vector<Sample>& samples, uint64_t index) {
+    for (; index < samples.size(); index++) {
+        if (samples[index].isKeyFrame) {
+            break;
+        }
+    }
+    return index;
+}
+
+} //end of namespace
+
+TEST(Mp4SampleIndex, roundTripAcrossPages) {
+    auto samples = makeSamples(Mp4SampleIndex::kPageSize * 2 + 88);
+    Mp4SampleIndex index;
+    fill(index, samples);
+    ASSERT_EQ(index.size(), samples.size());
+    //back and forth, every page is decoded more than once
+    for (uint64_t step : {1u, 97u}) {
+        for (uint64_t n = 0; n < samples.size(); n++) {
+            auto i = (n * step) % samples.size();
+            const auto& sample = samples[i];
+            EXPECT_EQ(index.offset(i), sample.offset) << i;
+            EXPECT_EQ(index.sampleSize(i), sample.size) << i;
+            EXPECT_EQ(index.dts(i), sample.dts) << i;
+            EXPECT_EQ(index.pts(i), sample.dts + sample.ptsDelta) << i;
+            EXPECT_EQ(index.isKeyFrame(i), sample.isKeyFrame) << i;
+        }
+    }
+    for (uint64_t i = 0; i + 1 < samples.size(); i++) {
+        EXPECT_EQ(index.duration(i), static_cast<uint32_t>(samples[i + 1].dts - samples[i].dts)) << i;
+    }
+    EXPECT_EQ(index.duration(samples.size() - 1), kSampleDuration);
+}
+
+TEST(Mp4SampleIndex, findAcrossPages) {
+    auto samples = makeSamples(Mp4SampleIndex::kPageSize * 2 + 88);
+    Mp4SampleIndex index;
+    fill(index, samples);
+    EXPECT_EQ(index.findByDts(samples.front().dts - 1), 0u);
+    EXPECT_EQ(index.findByOffset(0), 0u);
+    for (uint64_t i = 0; i < samples.size(); i++) {
+        const auto& sample = samples[i];
+        EXPECT_EQ(index.findByDts(sample.dts), i) << i;
+        EXPECT_EQ(index.findByDts(sample.dts + kSampleDuration - 1), i) << i;
+        EXPECT_EQ(index.findByOffset(sample.offset), i) << i;
+        if (i > 0) {
+            EXPECT_EQ(index.findByOffset(samples[i - 1].offset + 1), i) << i;
+        }
+        EXPECT_EQ(index.nextKeyFrame(i), expectedNextKeyFrame(samples, i)) << i;
+    }
+    EXPECT_EQ(index.findByOffset(samples.back().offset + 1), samples.size());
+    EXPECT_EQ(index.nextKeyFrame(samples.size()), samples.size());
+}
+
+TEST(Mp4SampleIndex, clearAndRefill) {
+    Mp4SampleIndex index;
+    fill(index, makeSamples(Mp4SampleIndex::kPageSize + 1));
+    EXPECT_EQ(index.dts(Mp4SampleIndex::kPageSize), makeSamples(Mp4SampleIndex::kPageSize + 1).back().dts);
+    index.clear();
+    EXPECT_TRUE(index.empty());
+    //the cached page of the old samples must not be read again
+    auto samples = makeSamples(10);
+    for (auto& sample : samples) {
+        sample.offset += 5000;
+    }
+    fill(index, samples);
+    ASSERT_EQ(index.size(), samples.size());
+    EXPECT_EQ(index.offset(0), samples.front().offset);
+    EXPECT_EQ(index.offset(9), samples.back().offset);
+    EXPECT_EQ(index.findByOffset(samples[3].offset), 3u);
+}
+
+TEST(Mp4SampleIndex, refillWhileLookingUp) {
+    //a fragment refills the index on the demux worker while seeks look it up
+    auto samples = makeSamples(Mp4SampleIndex::kPageSize * 3);
+    Mp4SampleIndex index;
+    fill(index, samples);
+    std::thread worker([&index, &samples] {
+        for (int i = 0; i < 50; i++) {
+            index.clear();
+            fill(index, samples);
+        }
+    });
+    for (int i = 0; i < 2000; i++) {
+        //a partly filled index holds the first samples only
+        EXPECT_LE(index.findByDts(samples[600].dts), 600u);
+        EXPECT_LE(index.nextKeyFrame(1), kKeyFrameInterval);
+    }
+    worker.join();
+    EXPECT_EQ(index.findByDts(samples[600].dts), 600u);
+}
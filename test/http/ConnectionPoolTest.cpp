@@ -0,0 +1,143 @@
+//
+// Created by Nevermore on 2025/7/16.
+// slark ConnectionPoolTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include "Data.hpp"
+#include "Request.h"
+#include "Type.h"
+
+using namespace slark::http;
+
+namespace {
+
+///keep-alive http server on the loopback, answers every request on a connection with "hello"
+class LocalServer {
+public:
+    LocalServer() {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(listenFd_, 8);
+        socklen_t length = sizeof(addr);
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread([this] {
+            while (true) {
+                auto fd = ::accept(listenFd_, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                acceptCount_++;
+                std::lock_guard<std::mutex> lock(mutex_);
+                connections_.push_back(fd);
+                workers_.emplace_back(&LocalServer::serve, fd);
+            }
+        });
+    }
+
+    ~LocalServer() {
+        ::shutdown(listenFd_, SHUT_RDWR);
+        ::close(listenFd_);
+        acceptor_.join();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto fd : connections_) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        for (auto fd : connections_) {
+            ::close(fd);
+        }
+    }
+
+    [[nodiscard]] std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_) + "/hello";
+    }
+
+    [[nodiscard]] int acceptCount() const {
+        return acceptCount_;
+    }
+private:
+    static void serve(int fd) {
+        std::string request;
+        char buffer[1024];
+        while (true) {
+            auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (size <= 0) {
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(size));
+            while (request.find("\r\n\r\n") != std::string::npos) {
+                request.erase(0, request.find("\r\n\r\n") + 4);
+                std::string_view response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+                ::send(fd, response.data(), response.size(), 0);
+            }
+        }
+    }
+private:
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<int> acceptCount_ = 0;
+    std::mutex mutex_;
+    std::vector<int> connections_;
+    std::vector<std::thread> workers_;
+    std::thread acceptor_;
+};
+
+std::string get(const std::string& url) {
+    std::condition_variable cond;
+    std::mutex mutex;
+    bool isFinished = false;
+    std::string body;
+    RequestInfo info;
+    info.url = url;
+    info.methodType = HttpMethodType::Get;
+    ResponseHandler handler;
+    handler.onData = [&](const RequestInfo&, slark::DataPtr data) {
+        body.append(data->view().view());
+    };
+    auto finish = [&] {
+        {
+            std::lock_guard lock(mutex);
+            isFinished = true;
+        }
+        cond.notify_all();
+    };
+    handler.onError = [&](const RequestInfo&, ErrorInfo) {
+        finish();
+    };
+    handler.onCompleted = [&](const RequestInfo&) {
+        finish();
+    };
+    {
+        Request request(std::move(info), std::move(handler));
+        std::unique_lock lock(mutex);
+        cond.wait(lock, [&] { return isFinished; });
+    }
+    return body;
+}
+
+} //end of namespace
+
+TEST(ConnectionPool, reuseKeepAliveConnection) {
+    LocalServer server;
+    ASSERT_EQ(get(server.url()), "hello");
+    ASSERT_EQ(get(server.url()), "hello");
+    ASSERT_EQ(get(server.url()), "hello");
+    ASSERT_EQ(server.acceptCount(), 1);
+}
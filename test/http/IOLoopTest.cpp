@@ -0,0 +1,161 @@
+//
+// Created by Nevermore on 2025/7/18.
+// slark IOLoopTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Data.hpp"
+#include "Request.h"
+#include "Type.h"
+
+using namespace slark::http;
+
+namespace {
+
+constexpr uint64_t kBodySize = 4 * 1024 * 1024;
+
+///http server on the loopback, answers every connection with a kBodySize body and closes it
+class BodyServer {
+public:
+    BodyServer() {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(listenFd_, 16);
+        socklen_t length = sizeof(addr);
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread([this] {
+            while (true) {
+                auto fd = ::accept(listenFd_, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                workers_.emplace_back(&BodyServer::serve, fd);
+            }
+        });
+    }
+
+    ~BodyServer() {
+        ::shutdown(listenFd_, SHUT_RDWR);
+        ::close(listenFd_);
+        acceptor_.join();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    [[nodiscard]] std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_) + "/body";
+    }
+private:
+    static void serve(int fd) {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (size <= 0) {
+                ::close(fd);
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(size));
+        }
+        auto header = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: " + std::to_string(kBodySize) + "\r\n\r\n";
+        ::send(fd, header.data(), header.size(), MSG_NOSIGNAL);
+        std::string body(kBodySize, 'x');
+        std::string_view view = body;
+        while (!view.empty()) {
+            auto size = ::send(fd, view.data(), view.size(), MSG_NOSIGNAL);
+            if (size <= 0) {
+                break;
+            }
+            view.remove_prefix(static_cast<size_t>(size));
+        }
+        ::close(fd);
+    }
+private:
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::vector<std::thread> workers_;
+    std::thread acceptor_;
+};
+
+} //end of namespace
+
+TEST(IOLoop, concurrentRequests) {
+    constexpr uint32_t kCount = 8;
+    BodyServer server;
+    std::condition_variable cond;
+    std::mutex mutex;
+    uint32_t finishedCount = 0;
+    std::atomic<uint64_t> errorCount = 0;
+    std::vector<std::atomic<uint64_t>> receivedSizes(kCount);
+    std::vector<std::unique_ptr<Request>> requests;
+    for (uint32_t i = 0; i < kCount; i++) {
+        RequestInfo info;
+        info.url = server.url();
+        info.methodType = HttpMethodType::Get;
+        ResponseHandler handler;
+        handler.onData = [&receivedSizes, i](const RequestInfo&, slark::DataPtr data) {
+            receivedSizes[i] += data->length;
+        };
+        handler.onError = [&](const RequestInfo&, ErrorInfo) {
+            errorCount++;
+        };
+        handler.onCompleted = [&](const RequestInfo&) {
+            {
+                std::lock_guard lock(mutex);
+                finishedCount++;
+            }
+            cond.notify_all();
+        };
+        requests.push_back(std::make_unique<Request>(std::move(info), std::move(handler)));
+    }
+    {
+        std::unique_lock lock(mutex);
+        cond.wait(lock, [&] { return finishedCount == kCount; });
+    }
+    requests.clear();
+    ASSERT_EQ(errorCount, 0);
+    for (const auto& size : receivedSizes) {
+        ASSERT_EQ(size, kBodySize);
+    }
+}
+
+TEST(IOLoop, destroyWhileReceiving) {
+    BodyServer server;
+    for (int i = 0; i < 8; i++) {
+        std::condition_variable cond;
+        std::mutex mutex;
+        bool isReceived = false;
+        RequestInfo info;
+        info.url = server.url();
+        info.methodType = HttpMethodType::Get;
+        ResponseHandler handler;
+        handler.onData = [&](const RequestInfo&, slark::DataPtr) {
+            {
+                std::lock_guard lock(mutex);
+                isReceived = true;
+            }
+            cond.notify_all();
+        };
+        auto request = std::make_unique<Request>(std::move(info), std::move(handler));
+        std::unique_lock lock(mutex);
+        cond.wait(lock, [&] { return isReceived; });
+        lock.unlock();
+        //the io loop may be inside the handler right now
+        request.reset();
+    }
+}
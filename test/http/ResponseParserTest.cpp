@@ -0,0 +1,152 @@
+//
+// Created by Nevermore on 2025/7/20.
+// slark ResponseParserTest
+// Copyright (c) 2025 Nevermore All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "Data.hpp"
+#include "ResponseParser.h"
+
+using namespace slark;
+using namespace slark::http;
+
+namespace {
+
+struct ParseResult {
+    ResponseHeader header;
+    std::string body;
+    uint32_t headerCount = 0;
+    std::vector<bool> isSlices;
+};
+
+ResponseParser makeParser(ParseResult& result) {
+    return {
+        [&result](ResponseHeader& header) {
+            result.headerCount++;
+            result.header = std::move(header);
+            return true;
+        },
+        [&result](DataPtr data) {
+            result.isSlices.push_back(data->isSlice());
+            result.body.append(data->view().view());
+        }
+    };
+}
+
+///feed str in pieces of step bytes
+bool feed(ResponseParser& parser, std::string_view str, size_t step) {
+    for (size_t pos = 0; pos < str.size(); pos += step) {
+        if (!parser.parse(std::make_unique<Data>(str.substr(pos, step)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} //end of namespace
+
+TEST(ResponseParser, contentLength) {
+    constexpr std::string_view kResponse = "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nServer: slark\r\n\r\nhello world";
+    for (size_t step : {1ul, 3ul, 7ul, kResponse.size()}) {
+        ParseResult result;
+        auto parser = makeParser(result);
+        ASSERT_TRUE(feed(parser, kResponse, step));
+        ASSERT_TRUE(parser.isCompleted());
+        ASSERT_TRUE(parser.isKeepAlive());
+        ASSERT_EQ(result.headerCount, 1);
+        ASSERT_EQ(result.header.httpStatusCode, HttpStatusCode::OK);
+        ASSERT_EQ(result.header.reasonPhrase, "OK");
+        ASSERT_EQ(result.header.headers["Server"], "slark");
+        ASSERT_EQ(result.header.headers["Version"], "HTTP/1.1");
+        ASSERT_EQ(result.body, "hello world");
+    }
+}
+
+TEST(ResponseParser, bodyIsSliced) {
+    ParseResult result;
+    auto parser = makeParser(result);
+    ASSERT_TRUE(feed(parser, "HTTP/1.1 200 OK\r\nContent-Length: 8\r\n\r\nabcd", 64));
+    ASSERT_TRUE(feed(parser, "efgh", 64));
+    ASSERT_TRUE(parser.isCompleted());
+    ASSERT_EQ(result.body, "abcdefgh");
+    for (auto isSlice : result.isSlices) {
+        ASSERT_TRUE(isSlice);
+    }
+}
+
+TEST(ResponseParser, chunked) {
+    constexpr std::string_view kResponse = "HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n"
+                                           "5\r\nhello\r\n1;ext=1\r\n \r\nA\r\n0123456789\r\n0\r\nExpires: 0\r\n\r\n";
+    for (size_t step : {1ul, 2ul, 5ul, kResponse.size()}) {
+        ParseResult result;
+        auto parser = makeParser(result);
+        ASSERT_TRUE(feed(parser, kResponse, step));
+        ASSERT_TRUE(parser.isCompleted());
+        ASSERT_TRUE(parser.isKeepAlive());
+        ASSERT_EQ(result.body, "hello 0123456789");
+    }
+}
+
+TEST(ResponseParser, closeDelimited) {
+    ParseResult result;
+    auto parser = makeParser(result);
+    ASSERT_TRUE(feed(parser, "HTTP/1.0 200 OK\r\n\r\nsome", 3));
+    ASSERT_TRUE(feed(parser, " data", 3));
+    ASSERT_FALSE(parser.isCompleted());
+    ASSERT_TRUE(parser.finish());
+    ASSERT_FALSE(parser.isKeepAlive());
+    ASSERT_EQ(result.body, "some data");
+}
+
+TEST(ResponseParser, connectionClose) {
+    ParseResult result;
+    auto parser = makeParser(result);
+    ASSERT_TRUE(feed(parser, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n", 4));
+    ASSERT_TRUE(parser.isCompleted());
+    ASSERT_FALSE(parser.isKeepAlive());
+    ASSERT_TRUE(result.body.empty());
+}
+
+TEST(ResponseParser, interimResponse) {
+    ParseResult result;
+    auto parser = makeParser(result);
+    ASSERT_TRUE(feed(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 204 No Content\r\n\r\n", 6));
+    ASSERT_TRUE(parser.isCompleted());
+    ASSERT_EQ(result.headerCount, 1);
+    ASSERT_EQ(result.header.httpStatusCode, HttpStatusCode::NoContent);
+}
+
+TEST(ResponseParser, stopAtHeader) {
+    ResponseParser parser(
+        [](ResponseHeader& header) {
+            return !header.isNeedRedirect();
+        },
+        nullptr);
+    ASSERT_FALSE(feed(parser, "HTTP/1.1 302 Found\r\nLocation: http://slark/a\r\nContent-Length: 3\r\n\r\nabc", 5));
+    ASSERT_TRUE(parser.isStopped());
+    ASSERT_EQ(parser.header().headers["Location"], "http://slark/a");
+}
+
+TEST(ResponseParser, invalid) {
+    {
+        ParseResult result;
+        auto parser = makeParser(result);
+        ASSERT_FALSE(feed(parser, "SSH-2.0-OpenSSH\r\n", 64));
+        ASSERT_EQ(parser.errorCode(), ResultCode::ResponseInvalid);
+    }
+    {
+        ParseResult result;
+        auto parser = makeParser(result);
+        ASSERT_FALSE(feed(parser, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 64));
+        ASSERT_EQ(parser.errorCode(), ResultCode::ChunkSizeError);
+    }
+    {
+        ParseResult result;
+        auto parser = makeParser(result);
+        ASSERT_FALSE(feed(parser, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n", 64));
+        ASSERT_EQ(parser.errorCode(), ResultCode::ChunkSizeError);
+    }
+}